@@ -2,19 +2,86 @@
 
 #include <cmath>
 
-static void Render(game_back_buffer *BackBuffer, game_state *GameState)
+#include "aqcube_back_buffer.cpp"
+#include "aqcube_software_renderer.cpp"
+#include "aqcube_audio.cpp"
+
+// Note(joe): The field of spinning cubes Render draws, about 7k triangles.
+#define GAME_CUBES_PER_SIDE 24
+#define GAME_CUBE_SPACING 1.6f
+
+struct game_state
+{
+    int OffsetX;
+    int OffsetY;
+
+    int ToneHz;
+
+    uint32 FrameIndex;
+    memory_arena FrameArena;
+    software_renderer Renderer;
+    software_mesh Cube;
+
+    audio_mixer Mixer;
+    uint32 ToneVoice;
+};
+
+// Note(joe): Corner i is at -0.5 or +0.5 on x, y and z by its bits 0, 1 and 2. Every
+// face is counter-clockwise from outside.
+static glm::vec3 GlobalCubePositions[8] =
+{
+    glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f),
+    glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f),
+    glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f),
+    glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f),
+};
+static uint32 GlobalCubeIndices[36] =
+{
+    4, 5, 7, 4, 7, 6, // +z
+    0, 2, 3, 0, 3, 1, // -z
+    1, 3, 7, 1, 7, 5, // +x
+    0, 4, 6, 0, 6, 2, // -x
+    2, 6, 7, 2, 7, 3, // +y
+    0, 1, 5, 0, 5, 4, // -y
+};
+
+static void Render(game_back_buffer *BackBuffer, game_state *GameState, platform_work_queue *Queue)
 {
-    int32 *Pixel = (int32 *)BackBuffer->Memory;
-    for (int YIndex = 0; YIndex < BackBuffer->Height; ++YIndex)
+    TIMED_FUNCTION();
+
+    // Note(joe): Not streamed, the tiles are about to draw over it.
+    FillBackBufferGradient(BackBuffer, GameState->OffsetX, GameState->OffsetY, Queue, false);
+
+    temporary_memory FrameMemory = BeginTemporaryMemory(&GameState->FrameArena);
+    software_renderer *Renderer = &GameState->Renderer;
+    BeginSoftwareFrame(Renderer, &GameState->FrameArena, BackBuffer, Queue, 0);
+
+    // Note(joe): Left and right scroll the gradient and go round the field, up and
+    // down scroll it and raise the camera.
+    float t = GameState->FrameIndex / 60.0f;
+    float Yaw = DEG_TO_RAD(0.2f*GameState->OffsetX);
+    float Height = 10.0f + 0.02f*GameState->OffsetY;
+    glm::vec3 Eye(24.0f*sinf(Yaw), Height, 24.0f*cosf(Yaw));
+    glm::mat4 View = glm::lookAt(Eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Projection = glm::perspective(DEG_TO_RAD(45), (float)BackBuffer->Width/(float)BackBuffer->Height, 0.1f, 100.0f);
+    glm::mat4 ClipFromWorld = Projection*View;
+
+    float Center = 0.5f*(GAME_CUBES_PER_SIDE - 1);
+    for (int Z = 0; Z < GAME_CUBES_PER_SIDE; ++Z)
     {
-        for (int XIndex = 0; XIndex < BackBuffer->Width; ++XIndex)
+        for (int X = 0; X < GAME_CUBES_PER_SIDE; ++X)
         {
-            uint8 b = GameState->OffsetX + XIndex;
-            uint8 g = GameState->OffsetY + YIndex;
-            uint8 r = GameState->OffsetX + XIndex + GameState->OffsetY + YIndex;
-            *Pixel++ = (b << 0 | g << 8 | r << 16);
+            glm::vec3 Position(GAME_CUBE_SPACING*(X - Center), 0.0f, GAME_CUBE_SPACING*(Z - Center));
+            glm::mat4 WorldFromModel = glm::translate(glm::mat4(1.0f), Position);
+            WorldFromModel = glm::rotate(WorldFromModel, t*(1.0f + 0.25f*((X + Z) % 4)),
+                                         glm::normalize(glm::vec3(1.0f, 0.5f*(X % 3), 0.5f + 0.5f*(Z % 2))));
+            glm::vec3 Color(0.3f + 0.7f*X / (GAME_CUBES_PER_SIDE - 1), 0.5f, 0.3f + 0.7f*Z / (GAME_CUBES_PER_SIDE - 1));
+            DrawSoftwareMesh(Renderer, ClipFromWorld, WorldFromModel, &GameState->Cube, Color);
         }
     }
+
+    RenderSoftwareFrame(Renderer);
+    EndTemporaryMemory(FrameMemory);
 }
 
 void UpdateGameAndRender(game_memory *Memory, game_back_buffer *BackBuffer, game_sound_buffer *SoundBuffer, game_controller_input *Input)
@@ -26,6 +93,19 @@ void UpdateGameAndRender(game_memory *Memory, game_back_buffer *BackBuffer, game
         GameState->OffsetY = 0;
         GameState->ToneHz = 256;
 
+        GameState->FrameIndex = 0;
+        InitializeArena(&GameState->FrameArena, "Frame", Memory->TransientStorageSize, Memory->TransientStorage);
+        GameState->Renderer = {};
+        GameState->Renderer.LightDirection = glm::normalize(glm::vec3(0.4f, 1.0f, 0.6f));
+        GameState->Renderer.Ambient = 0.2f;
+        GameState->Cube.Positions = GlobalCubePositions;
+        GameState->Cube.VertexCount = ArrayCount(GlobalCubePositions);
+        GameState->Cube.Indices = GlobalCubeIndices;
+        GameState->Cube.IndexCount = ArrayCount(GlobalCubeIndices);
+
+        InitAudioMixer(&GameState->Mixer, 1.0f);
+        GameState->ToneVoice = PlaySine(&GameState->Mixer, (float)GameState->ToneHz, 0.25f, 0.0f);
+
         Memory->IsInitialized = true;
     }
     if (Input->Up.IsDown)
@@ -47,27 +127,15 @@ void UpdateGameAndRender(game_memory *Memory, game_back_buffer *BackBuffer, game
         GameState->OffsetX += 10;
     }
 
-    Render(BackBuffer, GameState);
+    Render(BackBuffer, GameState, Memory->HighPriorityQueue);
     GetSoundSamples(SoundBuffer, GameState);
+    ++GameState->FrameIndex;
 }
 
 void GetSoundSamples(game_sound_buffer *SoundBuffer, game_state* GameState)
 {
-    // TODO(joe): This is pretty hacky but the real game won't be generating sounds
-    // using sine anyway. Remove this when we can actually play sound files.
-    static float tSine = 0.0f;
-
-    float WavePeriod = (float)SoundBuffer->SamplesPerSec / GameState->ToneHz;
-
-    int16 *Sample = SoundBuffer->Samples;
-    for (int SampleIndex = 0; SampleIndex < SoundBuffer->SampleCount; ++SampleIndex)
-    {
-        float SineValue = sinf(tSine);
-        uint16 ToneValue = (uint16)(SoundBuffer->ToneVolume*SineValue);
-
-        *Sample++ = ToneValue; // Left
-        *Sample++ = ToneValue; // Right
-
-        tSine += 2*PI32 * 1.0f/WavePeriod;
-    }
+    // TODO(joe): Still just the one tone until there are sound files to load, but it
+    // goes through the mixer like they will.
+    SetVoiceFrequency(&GameState->Mixer, GameState->ToneVoice, (float)GameState->ToneHz);
+    MixSound(&GameState->Mixer, SoundBuffer, &GameState->FrameArena);
 }
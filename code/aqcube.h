@@ -8,9 +8,87 @@
 
 // Note(joe): These are service to the game provided by the platform layer.
 void *ReadFile(char *Filename);
-// TODO(joe): WriteFile
 void FreeMemory(void *Memory);
 
+// Note(joe): Writes go to a temporary file next to Filename that only replaces it
+// once EndWriteFile succeeds, so nobody (other threads, the next run) ever sees half
+// a file. WriteToFile just records failures in NoErrors, check the result of
+// EndWriteFile. Safe to use from the worker threads.
+struct write_file
+{
+    bool NoErrors;
+    intptr_t Handle;
+    char FileName[256];
+    char TempFileName[272];
+};
+write_file BeginWriteFile(char *Filename);
+void WriteToFile(write_file *File, void *Memory, uint64 Size);
+bool EndWriteFile(write_file *File);
+bool RemoveFile(char *Filename);
+// Note(joe): Creates any missing parents too. True if the directory is there afterwards.
+bool MakeDirectory(char *Path);
+
+// Note(joe): Read-only views of a file. The pages are shared with the OS file
+// cache, so consume the data straight out of Memory instead of copying it. The
+// view is NOT null terminated.
+enum file_access_hint
+{
+    FileAccess_Normal,
+    FileAccess_Sequential, // Read front to back once (shader sources, image containers).
+    FileAccess_Random,     // Jumping around (mesh tables).
+    FileAccess_WillNeed,   // Start paging it in now.
+    FileAccess_DontNeed,   // Done with it for now, the pages can be dropped.
+};
+struct mapped_file
+{
+    void *Memory;
+    uint64 Size;
+};
+mapped_file MapFile(char *Filename, file_access_hint Hint = FileAccess_Normal);
+void AdviseMappedFile(mapped_file *File, uint64 Offset, uint64 Size, file_access_hint Hint);
+void UnmapFile(mapped_file *File);
+
+// Note(joe): Jobs run on the platform's worker threads. Only one thread (the main
+// thread) adds entries. DoNextWorkQueueEntry lets that thread help out while it waits,
+// and it returns false if there was nothing left to take.
+struct platform_work_queue;
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(platform_work_queue *Queue, void *Data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+void AddWorkQueueEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data);
+bool DoNextWorkQueueEntry(platform_work_queue *Queue);
+void CompleteAllWork(platform_work_queue *Queue);
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CompletePreviousReadsBeforeFutureReads _ReadBarrier()
+#define CompletePreviousWritesBeforeFutureWrites _WriteBarrier()
+// Note(joe): Both of these return the value from before the operation.
+inline uint32 AtomicCompareExchangeUInt32(uint32 volatile *Value, uint32 New, uint32 Expected)
+{
+    uint32 Result = (uint32)_InterlockedCompareExchange((long volatile *)Value, (long)New, (long)Expected);
+    return Result;
+}
+inline uint32 AtomicAddUInt32(uint32 volatile *Value, uint32 Addend)
+{
+    uint32 Result = (uint32)_InterlockedExchangeAdd((long volatile *)Value, (long)Addend);
+    return Result;
+}
+#else
+#define CompletePreviousReadsBeforeFutureReads __sync_synchronize()
+#define CompletePreviousWritesBeforeFutureWrites __sync_synchronize()
+inline uint32 AtomicCompareExchangeUInt32(uint32 volatile *Value, uint32 New, uint32 Expected)
+{
+    uint32 Result = __sync_val_compare_and_swap(Value, Expected, New);
+    return Result;
+}
+inline uint32 AtomicAddUInt32(uint32 volatile *Value, uint32 Addend)
+{
+    uint32 Result = __sync_fetch_and_add(Value, Addend);
+    return Result;
+}
+#endif
+
 // Note(joe): These are service to the platform layer provided by the game.
 struct game_memory
 {
@@ -19,16 +97,14 @@ struct game_memory
     uint64 TransientStorageSize;
     void *TransientStorage; // This should always be cleared to zero.
 
+    // Note(joe): Can be 0, the game does everything on the calling thread then.
+    platform_work_queue *HighPriorityQueue;
+
     bool IsInitialized;
 };
 
-struct game_state
-{
-    int OffsetX;
-    int OffsetY;
-
-    int ToneHz;
-};
+// Note(joe): Lives at the start of PermanentStorage, aqcube.cpp has it.
+struct game_state;
 
 struct loaded_image
 {
@@ -64,12 +140,17 @@ struct game_back_buffer
     int Pitch;
     int BytesPerPixel;
 };
+// Note(joe): SampleCount stereo frames, left then right.
 struct game_sound_buffer
 {
     int16 *Samples;
     int SampleCount;
-    int16 ToneVolume;
-    int16 SamplesPerSec;
+    int SamplesPerSec;
 };
 void UpdateGameAndRender(game_memory *Memory, game_back_buffer *BackBuffer, game_sound_buffer *SoundBuffer, game_controller_input *Input);
 void GetSoundSamples(game_sound_buffer *SoundBuffer, game_state* GameState);
+
+#include "aqcube_memory.h"
+#include "aqcube_hash.h"
+#include "aqcube_profile.h"
+#include "aqcube_texture_format.h"
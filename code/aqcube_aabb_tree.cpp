@@ -0,0 +1,826 @@
+//
+// Dynamic AABB tree
+//
+// Note(joe): A binary tree of boxes over everything a scene wants to find again:
+// what's in view, what a light reaches, what the mouse is over. Leaves are objects,
+// internal nodes hold the union of their children, so every query throws away
+// whole subtrees at a time and costs about the log of the object count plus
+// whatever it finds.
+//
+// Leaves keep two boxes. The tight one is the object's own and is what queries
+// report against. The fat one is grown by a margin, and further in the direction
+// the object was last seen moving, and it's what the tree is built from. An object
+// that moves but stays inside its fat box costs nothing. One that leaves it is
+// taken out and put back in, which touches a path of nodes, not the tree.
+//
+// Inserting picks the sibling that grows the surface area of the tree least
+// (Catto's branch and bound from Box2D) and then rotates on the way back up to keep
+// the heights balanced. That's good for things that come and go. For content that
+// doesn't move, RebuildAabbTree throws away the internal nodes and builds them
+// again top down by the surface area heuristic, which makes a tree that's cheaper
+// to query than any insertion order would.
+//
+// Proxies are node indices and stay put for as long as the object is in the tree,
+// rebuilds included.
+//
+
+#include <cfloat>
+
+#define AABB_TREE_NULL 0xFFFFFFFF
+
+// Note(joe): World units. The margin is what the fat boxes grow by all round, the
+// multiplier is how many frames of the last displacement they also get ahead.
+#define AABB_TREE_MARGIN 0.1f
+#define AABB_TREE_DISPLACEMENT_MULTIPLIER 4.0f
+
+// Note(joe): A rebuild past this depth stops using the SAH and splits at the median,
+// which adds at most 32 more levels, so a rebuilt tree is never taller than 96.
+#define AABB_TREE_SAH_MAX_DEPTH 64
+
+// Note(joe): Traversal stacks. A traversal holds at most one node per level plus
+// one. The insert balancing keeps every node's children within one level of each
+// other, under 1.44 log2 of the leaf count (46 for 2^32 leaves), and a rebuild is
+// capped at AABB_TREE_SAH_MAX_DEPTH + 32, so neither can run out of this.
+#define AABB_TREE_STACK_SIZE 256
+
+#define AABB_TREE_SAH_BINS 16
+
+struct aabb
+{
+    glm::vec3 Min;
+    glm::vec3 Max;
+};
+
+inline aabb Union(aabb A, aabb B)
+{
+    aabb Result;
+    Result.Min = glm::min(A.Min, B.Min);
+    Result.Max = glm::max(A.Max, B.Max);
+    return Result;
+}
+
+// Note(joe): Half the surface area, only ever compared with itself.
+inline float GetHalfArea(aabb Box)
+{
+    glm::vec3 Size = Box.Max - Box.Min;
+    return Size.x*Size.y + Size.y*Size.z + Size.z*Size.x;
+}
+
+inline bool Contains(aabb Outer, aabb Inner)
+{
+    bool Result = (Outer.Min.x <= Inner.Min.x) && (Outer.Min.y <= Inner.Min.y) && (Outer.Min.z <= Inner.Min.z) &&
+                  (Inner.Max.x <= Outer.Max.x) && (Inner.Max.y <= Outer.Max.y) && (Inner.Max.z <= Outer.Max.z);
+    return Result;
+}
+
+// Note(joe): The box that holds Box once it's been through Transform.
+inline aabb TransformAabb(aabb Box, glm::mat4 &Transform)
+{
+    glm::vec3 Center = glm::vec3(Transform*glm::vec4(0.5f*(Box.Min + Box.Max), 1.0f));
+    glm::vec3 LocalExtent = 0.5f*(Box.Max - Box.Min);
+    glm::vec3 Extent = glm::abs(glm::vec3(Transform[0]))*LocalExtent.x +
+                       glm::abs(glm::vec3(Transform[1]))*LocalExtent.y +
+                       glm::abs(glm::vec3(Transform[2]))*LocalExtent.z;
+
+    aabb Result;
+    Result.Min = Center - Extent;
+    Result.Max = Center + Extent;
+    return Result;
+}
+
+struct aabb_tree_node
+{
+    aabb Box;   // Fat for leaves.
+    aabb Tight; // Leaves only.
+
+    uint32 Parent; // The next free node while it's on the free list.
+    uint32 Child[2];
+    int32 Height; // Leaves are 0, free nodes -1.
+    uint32 UserData;
+};
+
+struct aabb_tree
+{
+    aabb_tree_node *Nodes;
+    uint32 MaxNodes;
+    uint32 Root;
+    uint32 FreeList;
+    uint32 LeafCount;
+
+    // Note(joe): Diagnostics. Every box a query looks at, and every move that had
+    // to come out and go back in.
+    uint64 NodesVisited;
+    uint32 Reinserts;
+};
+
+inline bool IsLeaf(aabb_tree_node *Node)
+{
+    return (Node->Child[0] == AABB_TREE_NULL);
+}
+
+// Note(joe): A tree of N leaves never needs more than 2N - 1 nodes.
+static void InitAabbTree(aabb_tree *Tree, memory_arena *Arena, uint32 MaxProxies)
+{
+    Tree->MaxNodes = (MaxProxies > 0) ? 2*MaxProxies - 1 : 1;
+    Tree->Nodes = PushArray(Arena, Tree->MaxNodes, aabb_tree_node);
+    for (uint32 NodeIndex = 0; NodeIndex < Tree->MaxNodes; ++NodeIndex)
+    {
+        Tree->Nodes[NodeIndex].Parent = (NodeIndex + 1 < Tree->MaxNodes) ? NodeIndex + 1 : AABB_TREE_NULL;
+        Tree->Nodes[NodeIndex].Height = -1;
+    }
+    Tree->Root = AABB_TREE_NULL;
+    Tree->FreeList = 0;
+    Tree->LeafCount = 0;
+    Tree->NodesVisited = 0;
+    Tree->Reinserts = 0;
+}
+
+static uint32 AllocateAabbTreeNode(aabb_tree *Tree)
+{
+    assert(Tree->FreeList != AABB_TREE_NULL);
+    uint32 Result = Tree->FreeList;
+    aabb_tree_node *Node = Tree->Nodes + Result;
+    Tree->FreeList = Node->Parent;
+    Node->Parent = AABB_TREE_NULL;
+    Node->Child[0] = AABB_TREE_NULL;
+    Node->Child[1] = AABB_TREE_NULL;
+    Node->Height = 0;
+    Node->UserData = 0;
+    return Result;
+}
+
+static void FreeAabbTreeNode(aabb_tree *Tree, uint32 NodeIndex)
+{
+    Tree->Nodes[NodeIndex].Parent = Tree->FreeList;
+    Tree->Nodes[NodeIndex].Height = -1;
+    Tree->FreeList = NodeIndex;
+}
+
+inline void UpdateAabbTreeNode(aabb_tree *Tree, uint32 NodeIndex)
+{
+    aabb_tree_node *Node = Tree->Nodes + NodeIndex;
+    aabb_tree_node *A = Tree->Nodes + Node->Child[0];
+    aabb_tree_node *B = Tree->Nodes + Node->Child[1];
+    Node->Box = Union(A->Box, B->Box);
+    Node->Height = 1 + ((A->Height > B->Height) ? A->Height : B->Height);
+}
+
+inline void ReplaceAabbTreeChild(aabb_tree *Tree, uint32 Parent, uint32 OldChild, uint32 NewChild)
+{
+    if (Parent == AABB_TREE_NULL)
+    {
+        Tree->Root = NewChild;
+    }
+    else
+    {
+        aabb_tree_node *Node = Tree->Nodes + Parent;
+        Node->Child[(Node->Child[0] == OldChild) ? 0 : 1] = NewChild;
+    }
+}
+
+// Note(joe): If one side of A is more than one taller than the other, the taller
+// child comes up to replace A and A takes the shorter of its grandchildren.
+// Returns whichever node is now where A was.
+static uint32 BalanceAabbTree(aabb_tree *Tree, uint32 IndexA)
+{
+    aabb_tree_node *A = Tree->Nodes + IndexA;
+    if (IsLeaf(A) || A->Height < 2)
+    {
+        return IndexA;
+    }
+
+    uint32 Result = IndexA;
+    int32 Balance = Tree->Nodes[A->Child[1]].Height - Tree->Nodes[A->Child[0]].Height;
+    if (Balance > 1 || Balance < -1)
+    {
+        // Note(joe): Up is the taller child. A becomes its first child.
+        int Side = (Balance > 1) ? 1 : 0;
+        uint32 IndexUp = A->Child[Side];
+        aabb_tree_node *Up = Tree->Nodes + IndexUp;
+        uint32 IndexF = Up->Child[0];
+        uint32 IndexG = Up->Child[1];
+
+        Up->Child[0] = IndexA;
+        Up->Parent = A->Parent;
+        A->Parent = IndexUp;
+        ReplaceAabbTreeChild(Tree, Up->Parent, IndexA, IndexUp);
+
+        // Note(joe): The taller grandchild stays up with Up, the other goes to A.
+        uint32 Taller = (Tree->Nodes[IndexF].Height > Tree->Nodes[IndexG].Height) ? IndexF : IndexG;
+        uint32 Shorter = (Taller == IndexF) ? IndexG : IndexF;
+        Up->Child[1] = Taller;
+        A->Child[Side] = Shorter;
+        Tree->Nodes[Shorter].Parent = IndexA;
+
+        UpdateAabbTreeNode(Tree, IndexA);
+        UpdateAabbTreeNode(Tree, IndexUp);
+        Result = IndexUp;
+    }
+
+    return Result;
+}
+
+static void InsertAabbTreeLeaf(aabb_tree *Tree, uint32 Leaf)
+{
+    if (Tree->Root == AABB_TREE_NULL)
+    {
+        Tree->Root = Leaf;
+        Tree->Nodes[Leaf].Parent = AABB_TREE_NULL;
+        return;
+    }
+
+    // Note(joe): Walk down towards the sibling that costs least. Going into a child
+    // costs the growth of everything above it, and stops being worth it once that's
+    // more than pairing the leaf with this node.
+    aabb LeafBox = Tree->Nodes[Leaf].Box;
+    uint32 Index = Tree->Root;
+    while (!IsLeaf(Tree->Nodes + Index))
+    {
+        aabb_tree_node *Node = Tree->Nodes + Index;
+        float Area = GetHalfArea(Node->Box);
+        float CombinedArea = GetHalfArea(Union(Node->Box, LeafBox));
+        float Cost = 2.0f*CombinedArea;
+        float InheritanceCost = 2.0f*(CombinedArea - Area);
+
+        float ChildCosts[2];
+        for (int Side = 0; Side < 2; ++Side)
+        {
+            aabb_tree_node *Child = Tree->Nodes + Node->Child[Side];
+            float NewArea = GetHalfArea(Union(Child->Box, LeafBox));
+            ChildCosts[Side] = (IsLeaf(Child) ? NewArea : NewArea - GetHalfArea(Child->Box)) + InheritanceCost;
+        }
+
+        if (Cost < ChildCosts[0] && Cost < ChildCosts[1])
+        {
+            break;
+        }
+        Index = Node->Child[(ChildCosts[0] < ChildCosts[1]) ? 0 : 1];
+    }
+
+    uint32 Sibling = Index;
+    uint32 OldParent = Tree->Nodes[Sibling].Parent;
+    uint32 NewParent = AllocateAabbTreeNode(Tree);
+    aabb_tree_node *Parent = Tree->Nodes + NewParent;
+    Parent->Parent = OldParent;
+    Parent->Child[0] = Sibling;
+    Parent->Child[1] = Leaf;
+    Parent->Box = Union(LeafBox, Tree->Nodes[Sibling].Box);
+    Parent->Height = Tree->Nodes[Sibling].Height + 1;
+    ReplaceAabbTreeChild(Tree, OldParent, Sibling, NewParent);
+    Tree->Nodes[Sibling].Parent = NewParent;
+    Tree->Nodes[Leaf].Parent = NewParent;
+
+    for (Index = Tree->Nodes[Leaf].Parent; Index != AABB_TREE_NULL; Index = Tree->Nodes[Index].Parent)
+    {
+        Index = BalanceAabbTree(Tree, Index);
+        UpdateAabbTreeNode(Tree, Index);
+    }
+}
+
+static void RemoveAabbTreeLeaf(aabb_tree *Tree, uint32 Leaf)
+{
+    if (Leaf == Tree->Root)
+    {
+        Tree->Root = AABB_TREE_NULL;
+        return;
+    }
+
+    // Note(joe): The leaf's parent goes too, its other child takes its place.
+    uint32 Parent = Tree->Nodes[Leaf].Parent;
+    uint32 GrandParent = Tree->Nodes[Parent].Parent;
+    uint32 Sibling = Tree->Nodes[Parent].Child[(Tree->Nodes[Parent].Child[0] == Leaf) ? 1 : 0];
+    ReplaceAabbTreeChild(Tree, GrandParent, Parent, Sibling);
+    Tree->Nodes[Sibling].Parent = GrandParent;
+    FreeAabbTreeNode(Tree, Parent);
+
+    for (uint32 Index = GrandParent; Index != AABB_TREE_NULL; Index = Tree->Nodes[Index].Parent)
+    {
+        Index = BalanceAabbTree(Tree, Index);
+        UpdateAabbTreeNode(Tree, Index);
+    }
+}
+
+inline aabb FattenAabb(aabb Box, glm::vec3 Displacement)
+{
+    aabb Result;
+    Result.Min = Box.Min - glm::vec3(AABB_TREE_MARGIN);
+    Result.Max = Box.Max + glm::vec3(AABB_TREE_MARGIN);
+
+    glm::vec3 Ahead = AABB_TREE_DISPLACEMENT_MULTIPLIER*Displacement;
+    Result.Min += glm::min(Ahead, glm::vec3(0.0f));
+    Result.Max += glm::max(Ahead, glm::vec3(0.0f));
+    return Result;
+}
+
+// Note(joe): UserData comes back from the queries, usually the scene's index for it.
+static uint32 CreateAabbTreeProxy(aabb_tree *Tree, aabb Box, uint32 UserData)
+{
+    uint32 Result = AllocateAabbTreeNode(Tree);
+    aabb_tree_node *Node = Tree->Nodes + Result;
+    Node->Tight = Box;
+    Node->Box = FattenAabb(Box, glm::vec3(0.0f));
+    Node->UserData = UserData;
+    InsertAabbTreeLeaf(Tree, Result);
+    ++Tree->LeafCount;
+    return Result;
+}
+
+static void DestroyAabbTreeProxy(aabb_tree *Tree, uint32 Proxy)
+{
+    assert(Proxy < Tree->MaxNodes && Tree->Nodes[Proxy].Height == 0);
+    RemoveAabbTreeLeaf(Tree, Proxy);
+    FreeAabbTreeNode(Tree, Proxy);
+    --Tree->LeafCount;
+}
+
+// Note(joe): Displacement is how far the object went since the last move. Returns
+// true if it left its fat box and had to be put back in.
+static bool MoveAabbTreeProxy(aabb_tree *Tree, uint32 Proxy, aabb Box, glm::vec3 Displacement)
+{
+    assert(Proxy < Tree->MaxNodes && Tree->Nodes[Proxy].Height == 0);
+    aabb_tree_node *Node = Tree->Nodes + Proxy;
+    Node->Tight = Box;
+
+    bool Result = false;
+    if (!Contains(Node->Box, Box))
+    {
+        RemoveAabbTreeLeaf(Tree, Proxy);
+        Node->Box = FattenAabb(Box, Displacement);
+        InsertAabbTreeLeaf(Tree, Proxy);
+        ++Tree->Reinserts;
+        Result = true;
+    }
+    return Result;
+}
+
+// Note(joe): The cheap alternative to a move for things that wobble in place. The
+// leaf keeps its spot and its ancestors grow to cover it, stopping at the first one
+// that already did. The tree gets looser every time, so something that travels
+// wants MoveAabbTreeProxy, or a rebuild now and then.
+static void RefitAabbTreeProxy(aabb_tree *Tree, uint32 Proxy, aabb Box)
+{
+    assert(Proxy < Tree->MaxNodes && Tree->Nodes[Proxy].Height == 0);
+    aabb_tree_node *Node = Tree->Nodes + Proxy;
+    Node->Tight = Box;
+    if (!Contains(Node->Box, Box))
+    {
+        Node->Box = FattenAabb(Box, glm::vec3(0.0f));
+        for (uint32 Index = Node->Parent; Index != AABB_TREE_NULL; Index = Tree->Nodes[Index].Parent)
+        {
+            aabb_tree_node *Parent = Tree->Nodes + Index;
+            aabb Grown = Union(Tree->Nodes[Parent->Child[0]].Box, Tree->Nodes[Parent->Child[1]].Box);
+            if (Contains(Parent->Box, Grown))
+            {
+                break;
+            }
+            Parent->Box = Union(Parent->Box, Grown);
+        }
+    }
+}
+
+//
+// Rebuild
+//
+
+struct sah_bin
+{
+    aabb Box;
+    uint32 Count;
+};
+
+// Note(joe): The rebuild works on a copy of each leaf's box and centre, kept together
+// and partitioned in place, rather than going back to the nodes, which end up
+// scattered all over the pool.
+struct sah_leaf
+{
+    aabb Box;
+    glm::vec3 Center;
+    uint32 Node;
+};
+
+inline glm::vec3 GetAabbCenter(aabb Box)
+{
+    return 0.5f*(Box.Min + Box.Max);
+}
+
+inline int GetSahBin(float Value, float Min, float Scale)
+{
+    int Result = (int)((Value - Min)*Scale);
+    return (Result < AABB_TREE_SAH_BINS) ? Result : AABB_TREE_SAH_BINS - 1;
+}
+
+// Note(joe): Moves the leaves so the one with the Nth smallest centre on Axis is at
+// N, with none bigger before it and none smaller after it.
+static void SelectSahLeaf(sah_leaf *Leaves, uint32 LeafCount, uint32 N, int Axis)
+{
+    int64 First = 0;
+    int64 Last = (int64)LeafCount - 1;
+    while (First < Last)
+    {
+        float Pivot = Leaves[(First + Last) / 2].Center[Axis];
+        int64 Low = First;
+        int64 High = Last;
+        while (Low <= High)
+        {
+            while (Leaves[Low].Center[Axis] < Pivot)
+            {
+                ++Low;
+            }
+            while (Leaves[High].Center[Axis] > Pivot)
+            {
+                --High;
+            }
+            if (Low <= High)
+            {
+                sah_leaf Swap = Leaves[Low];
+                Leaves[Low++] = Leaves[High];
+                Leaves[High--] = Swap;
+            }
+        }
+
+        if ((int64)N <= High)
+        {
+            Last = High;
+        }
+        else if ((int64)N >= Low)
+        {
+            First = Low;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+// Note(joe): Builds a subtree over Leaves and returns its root. Each split is the
+// best of AABB_TREE_SAH_BINS - 1 candidate planes on each axis by the surface area
+// heuristic, the count on each side times the area of its box. Depth is how far
+// down the subtree's root goes, past AABB_TREE_SAH_MAX_DEPTH the splits are medians.
+static uint32 BuildAabbSubtree(aabb_tree *Tree, sah_leaf *Leaves, uint32 LeafCount, uint32 Depth)
+{
+    if (LeafCount == 1)
+    {
+        return Leaves[0].Node;
+    }
+
+    aabb CenterBounds = { Leaves[0].Center, Leaves[0].Center };
+    for (uint32 i = 1; i < LeafCount; ++i)
+    {
+        CenterBounds.Min = glm::min(CenterBounds.Min, Leaves[i].Center);
+        CenterBounds.Max = glm::max(CenterBounds.Max, Leaves[i].Center);
+    }
+
+    // Note(joe): One pass drops every leaf into a bin on all three axes.
+    glm::vec3 BinScale;
+    sah_bin Bins[3][AABB_TREE_SAH_BINS] = {};
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        float AxisSize = CenterBounds.Max[Axis] - CenterBounds.Min[Axis];
+        BinScale[Axis] = (AxisSize > 0.0f) ? (float)AABB_TREE_SAH_BINS / AxisSize : 0.0f;
+    }
+    for (uint32 i = 0; i < LeafCount; ++i)
+    {
+        sah_leaf *Leaf = Leaves + i;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            sah_bin *Bin = Bins[Axis] + GetSahBin(Leaf->Center[Axis], CenterBounds.Min[Axis], BinScale[Axis]);
+            Bin->Box = Bin->Count ? Union(Bin->Box, Leaf->Box) : Leaf->Box;
+            ++Bin->Count;
+        }
+    }
+
+    int BestAxis = -1;
+    int BestSplit = 0;
+    float BestCost = FLT_MAX;
+    for (int Axis = 0; (Depth < AABB_TREE_SAH_MAX_DEPTH) && (Axis < 3); ++Axis)
+    {
+        if (BinScale[Axis] == 0.0f)
+        {
+            continue;
+        }
+
+        // Note(joe): Sweep from the right to get the cost of everything past each
+        // plane, then from the left to add what's before it.
+        float RightCosts[AABB_TREE_SAH_BINS];
+        aabb Right = {};
+        uint32 RightCount = 0;
+        for (int Bin = AABB_TREE_SAH_BINS - 1; Bin > 0; --Bin)
+        {
+            if (Bins[Axis][Bin].Count)
+            {
+                Right = RightCount ? Union(Right, Bins[Axis][Bin].Box) : Bins[Axis][Bin].Box;
+                RightCount += Bins[Axis][Bin].Count;
+            }
+            RightCosts[Bin] = RightCount ? RightCount*GetHalfArea(Right) : 0.0f;
+        }
+
+        aabb Left = {};
+        uint32 LeftCount = 0;
+        for (int Bin = 0; Bin < AABB_TREE_SAH_BINS - 1; ++Bin)
+        {
+            if (Bins[Axis][Bin].Count)
+            {
+                Left = LeftCount ? Union(Left, Bins[Axis][Bin].Box) : Bins[Axis][Bin].Box;
+                LeftCount += Bins[Axis][Bin].Count;
+            }
+            if (LeftCount && LeftCount < LeafCount)
+            {
+                float Cost = LeftCount*GetHalfArea(Left) + RightCosts[Bin + 1];
+                if (Cost < BestCost)
+                {
+                    BestCost = Cost;
+                    BestAxis = Axis;
+                    BestSplit = Bin + 1;
+                }
+            }
+        }
+    }
+
+    uint32 LeftCount = 0;
+    if (BestAxis >= 0)
+    {
+        sah_leaf *First = Leaves;
+        sah_leaf *Last = Leaves + LeafCount;
+        while (First < Last)
+        {
+            if (GetSahBin(First->Center[BestAxis], CenterBounds.Min[BestAxis], BinScale[BestAxis]) < BestSplit)
+            {
+                ++First;
+            }
+            else
+            {
+                sah_leaf Swap = *First;
+                *First = *--Last;
+                *Last = Swap;
+            }
+        }
+        LeftCount = (uint32)(First - Leaves);
+    }
+    // Note(joe): Too deep, or the bins couldn't tell the centres apart. Half the
+    // leaves go each side of the median on the widest axis, so the depth left is
+    // at most log2 of the count. With every centre in the same place any half will do.
+    if (LeftCount == 0 || LeftCount == LeafCount)
+    {
+        glm::vec3 CenterSize = CenterBounds.Max - CenterBounds.Min;
+        int Axis = (CenterSize.x > CenterSize.y) ? ((CenterSize.x > CenterSize.z) ? 0 : 2) : ((CenterSize.y > CenterSize.z) ? 1 : 2);
+        LeftCount = LeafCount / 2;
+        SelectSahLeaf(Leaves, LeafCount, LeftCount, Axis);
+    }
+
+    uint32 Result = AllocateAabbTreeNode(Tree);
+    uint32 Child0 = BuildAabbSubtree(Tree, Leaves, LeftCount, Depth + 1);
+    uint32 Child1 = BuildAabbSubtree(Tree, Leaves + LeftCount, LeafCount - LeftCount, Depth + 1);
+    aabb_tree_node *Node = Tree->Nodes + Result;
+    Node->Child[0] = Child0;
+    Node->Child[1] = Child1;
+    Tree->Nodes[Child0].Parent = Result;
+    Tree->Nodes[Child1].Parent = Result;
+    UpdateAabbTreeNode(Tree, Result);
+    return Result;
+}
+
+// Note(joe): For content that's done moving. Scratch holds a copy of the leaves
+// while it works.
+static void RebuildAabbTree(aabb_tree *Tree, memory_arena *Scratch)
+{
+    TIMED_FUNCTION();
+
+    if (Tree->LeafCount == 0)
+    {
+        return;
+    }
+
+    temporary_memory RebuildMemory = BeginTemporaryMemory(Scratch);
+    sah_leaf *Leaves = PushArray(Scratch, Tree->LeafCount, sah_leaf);
+    uint32 LeafCount = 0;
+    for (uint32 NodeIndex = 0; NodeIndex < Tree->MaxNodes; ++NodeIndex)
+    {
+        aabb_tree_node *Node = Tree->Nodes + NodeIndex;
+        if (Node->Height == 0)
+        {
+            sah_leaf *Leaf = Leaves + LeafCount++;
+            Leaf->Box = Node->Box;
+            Leaf->Center = GetAabbCenter(Node->Box);
+            Leaf->Node = NodeIndex;
+        }
+        else if (Node->Height > 0)
+        {
+            FreeAabbTreeNode(Tree, NodeIndex);
+        }
+    }
+    assert(LeafCount == Tree->LeafCount);
+
+    Tree->Root = BuildAabbSubtree(Tree, Leaves, LeafCount, 0);
+    Tree->Nodes[Tree->Root].Parent = AABB_TREE_NULL;
+    EndTemporaryMemory(RebuildMemory);
+}
+
+// Note(joe): Total area of the internal nodes over the root's, what a random ray or
+// small query expects to visit. Lower is better.
+static float GetAabbTreeCost(aabb_tree *Tree)
+{
+    float Result = 0.0f;
+    if (Tree->Root != AABB_TREE_NULL)
+    {
+        float Total = 0.0f;
+        for (uint32 NodeIndex = 0; NodeIndex < Tree->MaxNodes; ++NodeIndex)
+        {
+            if (Tree->Nodes[NodeIndex].Height > 0)
+            {
+                Total += GetHalfArea(Tree->Nodes[NodeIndex].Box);
+            }
+        }
+        float RootArea = GetHalfArea(Tree->Nodes[Tree->Root].Box);
+        Result = (RootArea > 0.0f) ? Total / RootArea : 0.0f;
+    }
+    return Result;
+}
+
+//
+// Queries
+//
+// Note(joe): They all write the UserData of what they find to Results, stop adding
+// once MaxResults is reached, and return how many they found.
+//
+
+// Note(joe): Planes the node is entirely inside get dropped from its children's
+// tests, and once there are none left the whole subtree goes in without a look.
+static uint32 QueryAabbTreeFrustum(aabb_tree *Tree, frustum *Frustum, uint32 *Results, uint32 MaxResults)
+{
+    TIMED_FUNCTION();
+
+    uint32 ResultCount = 0;
+    uint32 NodesVisited = 0;
+    uint32 Stack[AABB_TREE_STACK_SIZE];
+    uint32 StackMasks[AABB_TREE_STACK_SIZE];
+    uint32 StackCount = 0;
+    if (Tree->Root != AABB_TREE_NULL)
+    {
+        Stack[StackCount] = Tree->Root;
+        StackMasks[StackCount++] = 0x3F;
+    }
+
+    while (StackCount && ResultCount < MaxResults)
+    {
+        --StackCount;
+        aabb_tree_node *Node = Tree->Nodes + Stack[StackCount];
+        uint32 Mask = StackMasks[StackCount];
+        ++NodesVisited;
+
+        aabb Box = IsLeaf(Node) ? Node->Tight : Node->Box;
+        glm::vec3 Center = GetAabbCenter(Box);
+        glm::vec3 Extent = 0.5f*(Box.Max - Box.Min);
+        bool Outside = false;
+        for (int PlaneIndex = 0; !Outside && PlaneIndex < 6; ++PlaneIndex)
+        {
+            if (Mask & (1 << PlaneIndex))
+            {
+                glm::vec4 Plane = Frustum->Planes[PlaneIndex];
+                float Distance = Plane.x*Center.x + Plane.y*Center.y + Plane.z*Center.z + Plane.w;
+                float Reach = fabsf(Plane.x)*Extent.x + fabsf(Plane.y)*Extent.y + fabsf(Plane.z)*Extent.z;
+                Outside = (Distance + Reach < 0.0f);
+                if (Distance - Reach >= 0.0f)
+                {
+                    Mask &= ~(1 << PlaneIndex);
+                }
+            }
+        }
+        if (Outside)
+        {
+            continue;
+        }
+
+        if (IsLeaf(Node))
+        {
+            Results[ResultCount++] = Node->UserData;
+        }
+        else
+        {
+            assert(StackCount + 2 <= AABB_TREE_STACK_SIZE);
+            for (int Side = 0; Side < 2; ++Side)
+            {
+                Stack[StackCount] = Node->Child[Side];
+                StackMasks[StackCount++] = Mask;
+            }
+        }
+    }
+
+    Tree->NodesVisited += NodesVisited;
+    GlobalRenderStats.ObjectsTested += NodesVisited;
+    GlobalRenderStats.ObjectsVisible += ResultCount;
+
+    return ResultCount;
+}
+
+inline bool OverlapsSphere(aabb Box, glm::vec3 Center, float Radius)
+{
+    glm::vec3 Nearest = glm::clamp(Center, Box.Min, Box.Max);
+    glm::vec3 Offset = Nearest - Center;
+    return (glm::dot(Offset, Offset) <= Radius*Radius);
+}
+
+static uint32 QueryAabbTreeSphere(aabb_tree *Tree, glm::vec3 Center, float Radius, uint32 *Results, uint32 MaxResults)
+{
+    uint32 ResultCount = 0;
+    uint32 NodesVisited = 0;
+    uint32 Stack[AABB_TREE_STACK_SIZE];
+    uint32 StackCount = 0;
+    if (Tree->Root != AABB_TREE_NULL)
+    {
+        Stack[StackCount++] = Tree->Root;
+    }
+
+    while (StackCount && ResultCount < MaxResults)
+    {
+        aabb_tree_node *Node = Tree->Nodes + Stack[--StackCount];
+        ++NodesVisited;
+        if (IsLeaf(Node))
+        {
+            if (OverlapsSphere(Node->Tight, Center, Radius))
+            {
+                Results[ResultCount++] = Node->UserData;
+            }
+        }
+        else if (OverlapsSphere(Node->Box, Center, Radius))
+        {
+            assert(StackCount + 2 <= AABB_TREE_STACK_SIZE);
+            Stack[StackCount++] = Node->Child[0];
+            Stack[StackCount++] = Node->Child[1];
+        }
+    }
+
+    Tree->NodesVisited += NodesVisited;
+    return ResultCount;
+}
+
+// Note(joe): Slab test. Returns the distance along the ray where it enters the box,
+// or where it starts if it's already inside, and FLT_MAX for a miss.
+inline float IntersectRayAabb(aabb Box, glm::vec3 Origin, glm::vec3 InverseDirection, float MaxDistance)
+{
+    glm::vec3 T0 = (Box.Min - Origin)*InverseDirection;
+    glm::vec3 T1 = (Box.Max - Origin)*InverseDirection;
+    glm::vec3 Near = glm::min(T0, T1);
+    glm::vec3 Far = glm::max(T0, T1);
+    float Enter = glm::max(glm::max(Near.x, Near.y), glm::max(Near.z, 0.0f));
+    float Exit = glm::min(glm::min(Far.x, Far.y), glm::min(Far.z, MaxDistance));
+    return (Enter <= Exit) ? Enter : FLT_MAX;
+}
+
+// Note(joe): The nearest object whose box the ray hits within MaxDistance. The
+// nearer child is looked at first and anything further than the best hit so far
+// gets skipped. Direction doesn't have to be normalised, distances are in its units.
+static bool RayCastAabbTree(aabb_tree *Tree, glm::vec3 Origin, glm::vec3 Direction, float MaxDistance,
+                            uint32 *HitUserData, float *HitDistance)
+{
+    glm::vec3 InverseDirection(1.0f / Direction.x, 1.0f / Direction.y, 1.0f / Direction.z);
+    float Best = MaxDistance;
+    bool Result = false;
+    uint32 NodesVisited = 0;
+
+    uint32 Stack[AABB_TREE_STACK_SIZE];
+    uint32 StackCount = 0;
+    if (Tree->Root != AABB_TREE_NULL && IntersectRayAabb(Tree->Nodes[Tree->Root].Box, Origin, InverseDirection, Best) != FLT_MAX)
+    {
+        Stack[StackCount++] = Tree->Root;
+    }
+
+    while (StackCount)
+    {
+        aabb_tree_node *Node = Tree->Nodes + Stack[--StackCount];
+        ++NodesVisited;
+        if (IsLeaf(Node))
+        {
+            float Distance = IntersectRayAabb(Node->Tight, Origin, InverseDirection, Best);
+            if (Distance != FLT_MAX)
+            {
+                Best = Distance;
+                *HitUserData = Node->UserData;
+                Result = true;
+            }
+        }
+        else
+        {
+            float Distances[2];
+            for (int Side = 0; Side < 2; ++Side)
+            {
+                Distances[Side] = IntersectRayAabb(Tree->Nodes[Node->Child[Side]].Box, Origin, InverseDirection, Best);
+            }
+            // Note(joe): Push the far one first so the near one comes off next.
+            int Near = (Distances[0] <= Distances[1]) ? 0 : 1;
+            assert(StackCount + 2 <= AABB_TREE_STACK_SIZE);
+            if (Distances[1 - Near] != FLT_MAX)
+            {
+                Stack[StackCount++] = Node->Child[1 - Near];
+            }
+            if (Distances[Near] != FLT_MAX)
+            {
+                Stack[StackCount++] = Node->Child[Near];
+            }
+        }
+    }
+
+    *HitDistance = Best;
+    Tree->NodesVisited += NodesVisited;
+    return Result;
+}
@@ -0,0 +1,372 @@
+//
+// Audio mixer
+//
+// Note(joe): Every playing voice is summed into a float stereo bus, and only the bus
+// is saturated and interleaved into the platform's int16 game_sound_buffer. A voice
+// is either a loaded_sound being played back or a sine oscillator. Each one costs
+// the same fixed amount of work per sample, however many others are playing.
+//
+// Volume and pan are gains on the two channels, with constant power panning. When a
+// voice's gains change they are ramped over the next buffer, so moving a voice never
+// clicks. Oscillators keep their phase as a 32 bit fraction of a turn, so it wraps
+// exactly and never drifts however long they run. The sine comes from a polynomial,
+// good to about 0.001, so 4 samples cost the same as one.
+//
+// SSE2 does 4 samples at a time, with a scalar version of the same maths for
+// everything else.
+//
+
+#include "aqcube_simd.h"
+
+#define AUDIO_MAX_VOICES 512
+
+// Note(joe): The bus and every loaded_sound are padded by this much, so the SIMD loop
+// can finish a block past the end without anyone checking.
+#define AUDIO_PADDING 4
+
+// Note(joe): Mono floats at the rate they're played at, -1 to 1.
+struct loaded_sound
+{
+    uint32 SampleCount;
+    float *Samples; // SampleCount + AUDIO_PADDING, the padding is 0.
+};
+
+// Note(joe): The samples are left for the caller to fill in.
+static void PushLoadedSound(loaded_sound *Sound, memory_arena *Arena, uint32 SampleCount)
+{
+    Sound->SampleCount = SampleCount;
+    Sound->Samples = PushArray(Arena, SampleCount + AUDIO_PADDING, float);
+    for (uint32 Pad = 0; Pad < AUDIO_PADDING; ++Pad)
+    {
+        Sound->Samples[SampleCount + Pad] = 0.0f;
+    }
+}
+
+enum voice_type
+{
+    Voice_Sound,
+    Voice_Sine,
+};
+
+struct playing_voice
+{
+    voice_type Type;
+    bool Active;
+    uint16 Generation;
+
+    float Volume;
+    float Pan; // -1 is left, 1 is right.
+    float Gain[2];
+    bool Started; // False until the first mix, which starts at the gains instead of ramping.
+
+    loaded_sound *Sound;
+    uint32 SamplePosition;
+    bool Looping;
+
+    float Frequency;
+    uint32 Phase;
+};
+
+struct audio_mixer
+{
+    playing_voice Voices[AUDIO_MAX_VOICES];
+    uint32 VoiceHighWater; // Every active voice is below this.
+    uint32 ActiveVoiceCount;
+    float MasterVolume;
+
+    // Note(joe): Diagnostics, counted every MixSound.
+    uint32 VoicesMixed;
+    uint32 SamplesMixed;
+};
+
+static void InitAudioMixer(audio_mixer *Mixer, float MasterVolume)
+{
+    *Mixer = {};
+    Mixer->MasterVolume = MasterVolume;
+}
+
+// Note(joe): The slot is in the low 16 bits, plus one so 0 means none, and the
+// slot's generation is above it. A voice that finished can't be reached through an
+// old id once its slot is reused.
+inline uint32 GetVoiceId(audio_mixer *Mixer, uint32 Slot)
+{
+    return ((uint32)Mixer->Voices[Slot].Generation << 16) | (Slot + 1);
+}
+
+inline playing_voice *GetVoice(audio_mixer *Mixer, uint32 VoiceId)
+{
+    playing_voice *Result = 0;
+
+    uint32 Slot = (VoiceId & 0xFFFF) - 1;
+    if (Slot < AUDIO_MAX_VOICES)
+    {
+        playing_voice *Voice = Mixer->Voices + Slot;
+        if (Voice->Active && Voice->Generation == (VoiceId >> 16))
+        {
+            Result = Voice;
+        }
+    }
+
+    return Result;
+}
+
+// Note(joe): Returns 0 when every voice is taken.
+static playing_voice *StartVoice(audio_mixer *Mixer, voice_type Type, float Volume, float Pan, uint32 *VoiceId)
+{
+    playing_voice *Result = 0;
+
+    for (uint32 Slot = 0; Slot < AUDIO_MAX_VOICES; ++Slot)
+    {
+        playing_voice *Voice = Mixer->Voices + Slot;
+        if (!Voice->Active)
+        {
+            uint16 Generation = (uint16)(Voice->Generation + 1);
+            *Voice = {};
+            Voice->Type = Type;
+            Voice->Active = true;
+            Voice->Generation = Generation;
+            Voice->Volume = Volume;
+            Voice->Pan = Pan;
+
+            Mixer->VoiceHighWater = glm::max(Mixer->VoiceHighWater, Slot + 1);
+            ++Mixer->ActiveVoiceCount;
+            *VoiceId = GetVoiceId(Mixer, Slot);
+            Result = Voice;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+static uint32 PlaySound(audio_mixer *Mixer, loaded_sound *Sound, float Volume, float Pan, bool Looping)
+{
+    uint32 Result = 0;
+    playing_voice *Voice = StartVoice(Mixer, Voice_Sound, Volume, Pan, &Result);
+    if (Voice)
+    {
+        Voice->Sound = Sound;
+        Voice->Looping = Looping;
+    }
+    return Result;
+}
+
+static uint32 PlaySine(audio_mixer *Mixer, float Frequency, float Volume, float Pan)
+{
+    uint32 Result = 0;
+    playing_voice *Voice = StartVoice(Mixer, Voice_Sine, Volume, Pan, &Result);
+    if (Voice)
+    {
+        Voice->Frequency = Frequency;
+    }
+    return Result;
+}
+
+static void SetVoiceVolume(audio_mixer *Mixer, uint32 VoiceId, float Volume, float Pan)
+{
+    playing_voice *Voice = GetVoice(Mixer, VoiceId);
+    if (Voice)
+    {
+        Voice->Volume = Volume;
+        Voice->Pan = Pan;
+    }
+}
+
+static void SetVoiceFrequency(audio_mixer *Mixer, uint32 VoiceId, float Frequency)
+{
+    playing_voice *Voice = GetVoice(Mixer, VoiceId);
+    if (Voice)
+    {
+        Voice->Frequency = Frequency;
+    }
+}
+
+static void StopVoice(audio_mixer *Mixer, uint32 VoiceId)
+{
+    playing_voice *Voice = GetVoice(Mixer, VoiceId);
+    if (Voice)
+    {
+        Voice->Active = false;
+        --Mixer->ActiveVoiceCount;
+    }
+}
+
+// Note(joe): x in -pi to pi. A parabola through the sine's zeros and peaks, then
+// pulled towards the real curve by a second one.
+inline float GetSineApproximation(float x)
+{
+    float y = (4.0f / PI32)*x - (4.0f / (PI32*PI32))*x*fabsf(x);
+    return 0.225f*(y*fabsf(y) - y) + y;
+}
+
+#if AQCUBE_SSE2
+inline __m128 GetSineApproximation(__m128 x)
+{
+    __m128 SignMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.0f / PI32), x),
+                          _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f / (PI32*PI32)), x), _mm_and_ps(x, SignMask)));
+    return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, _mm_and_ps(y, SignMask)), y)), y);
+}
+#endif
+
+// Note(joe): Phase is a fraction of a turn in 32 bits, as signed it's -pi to pi.
+#define AUDIO_RADIANS_PER_PHASE (PI32 / 2147483648.0f)
+
+// Note(joe): Adds Count samples of Voice into the bus from Offset on, with the gains
+// ramping from Gain by Step a sample. Source is the sound's samples for Voice_Sound.
+static void MixVoiceSpan(playing_voice *Voice, float *Source, uint32 PhaseStep, float *Left, float *Right,
+                         uint32 Offset, uint32 Count, float GainLeft, float GainRight, float StepLeft, float StepRight)
+{
+#if AQCUBE_SSE2
+    __m128 Lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 WideLeft = _mm_add_ps(_mm_set1_ps(GainLeft), _mm_mul_ps(_mm_set1_ps(StepLeft), Lane));
+    __m128 WideRight = _mm_add_ps(_mm_set1_ps(GainRight), _mm_mul_ps(_mm_set1_ps(StepRight), Lane));
+    __m128 WideStepLeft = _mm_set1_ps(4.0f*StepLeft);
+    __m128 WideStepRight = _mm_set1_ps(4.0f*StepRight);
+
+    __m128i Phase = _mm_setr_epi32((int32)Voice->Phase, (int32)(Voice->Phase + PhaseStep),
+                                   (int32)(Voice->Phase + 2*PhaseStep), (int32)(Voice->Phase + 3*PhaseStep));
+    __m128i WidePhaseStep = _mm_set1_epi32((int32)(4*PhaseStep));
+    __m128 RadiansPerPhase = _mm_set1_ps(AUDIO_RADIANS_PER_PHASE);
+
+    for (uint32 Index = 0; Index < Count; Index += 4)
+    {
+        __m128 Sample;
+        if (Voice->Type == Voice_Sine)
+        {
+            Sample = GetSineApproximation(_mm_mul_ps(_mm_cvtepi32_ps(Phase), RadiansPerPhase));
+            Phase = _mm_add_epi32(Phase, WidePhaseStep);
+        }
+        else
+        {
+            Sample = _mm_loadu_ps(Source + Index);
+        }
+
+        float *L = Left + Offset + Index;
+        float *R = Right + Offset + Index;
+        _mm_storeu_ps(L, _mm_add_ps(_mm_loadu_ps(L), _mm_mul_ps(Sample, WideLeft)));
+        _mm_storeu_ps(R, _mm_add_ps(_mm_loadu_ps(R), _mm_mul_ps(Sample, WideRight)));
+        WideLeft = _mm_add_ps(WideLeft, WideStepLeft);
+        WideRight = _mm_add_ps(WideRight, WideStepRight);
+    }
+#else
+    uint32 Phase = Voice->Phase;
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+        float Sample;
+        if (Voice->Type == Voice_Sine)
+        {
+            Sample = GetSineApproximation((float)(int32)Phase*AUDIO_RADIANS_PER_PHASE);
+            Phase += PhaseStep;
+        }
+        else
+        {
+            Sample = Source[Index];
+        }
+        Left[Offset + Index] += Sample*(GainLeft + StepLeft*Index);
+        Right[Offset + Index] += Sample*(GainRight + StepRight*Index);
+    }
+#endif
+}
+
+// Note(joe): Writes SoundBuffer->SampleCount stereo frames. The bus goes in
+// TempArena and is popped again before this returns.
+static void MixSound(audio_mixer *Mixer, game_sound_buffer *SoundBuffer, memory_arena *TempArena)
+{
+    TIMED_FUNCTION();
+
+    if (SoundBuffer->SampleCount <= 0 || SoundBuffer->SamplesPerSec <= 0)
+    {
+        return;
+    }
+    uint32 SampleCount = (uint32)SoundBuffer->SampleCount;
+
+    temporary_memory TempMemory = BeginTemporaryMemory(TempArena);
+    float *Left = PushArray(TempArena, SampleCount + AUDIO_PADDING, float);
+    float *Right = PushArray(TempArena, SampleCount + AUDIO_PADDING, float);
+    memset(Left, 0, (SampleCount + AUDIO_PADDING)*sizeof(float));
+    memset(Right, 0, (SampleCount + AUDIO_PADDING)*sizeof(float));
+
+    float InverseCount = 1.0f / (float)SampleCount;
+    for (uint32 Slot = 0; Slot < Mixer->VoiceHighWater; ++Slot)
+    {
+        playing_voice *Voice = Mixer->Voices + Slot;
+        if (!Voice->Active)
+        {
+            continue;
+        }
+
+        float Angle = 0.25f*PI32*(glm::clamp(Voice->Pan, -1.0f, 1.0f) + 1.0f);
+        float TargetLeft = Voice->Volume*cosf(Angle);
+        float TargetRight = Voice->Volume*sinf(Angle);
+        if (!Voice->Started)
+        {
+            Voice->Gain[0] = TargetLeft;
+            Voice->Gain[1] = TargetRight;
+            Voice->Started = true;
+        }
+        float StepLeft = (TargetLeft - Voice->Gain[0])*InverseCount;
+        float StepRight = (TargetRight - Voice->Gain[1])*InverseCount;
+
+        if (Voice->Type == Voice_Sine)
+        {
+            double Turns = glm::max((double)Voice->Frequency, 0.0) / (double)SoundBuffer->SamplesPerSec;
+            uint32 PhaseStep = (uint32)(uint64)(Turns*4294967296.0);
+            MixVoiceSpan(Voice, 0, PhaseStep, Left, Right, 0, SampleCount,
+                         Voice->Gain[0], Voice->Gain[1], StepLeft, StepRight);
+            Voice->Phase += PhaseStep*SampleCount;
+        }
+        else
+        {
+            loaded_sound *Sound = Voice->Sound;
+            uint32 Offset = 0;
+            while (Voice->Active && Offset < SampleCount)
+            {
+                uint32 Count = glm::min(Sound->SampleCount - Voice->SamplePosition, SampleCount - Offset);
+                MixVoiceSpan(Voice, Sound->Samples + Voice->SamplePosition, 0, Left, Right, Offset, Count,
+                             Voice->Gain[0] + StepLeft*Offset, Voice->Gain[1] + StepRight*Offset, StepLeft, StepRight);
+                Voice->SamplePosition += Count;
+                Offset += Count;
+                if (Voice->SamplePosition >= Sound->SampleCount)
+                {
+                    Voice->SamplePosition = 0;
+                    if (!Voice->Looping || Sound->SampleCount == 0)
+                    {
+                        Voice->Active = false;
+                        --Mixer->ActiveVoiceCount;
+                    }
+                }
+            }
+        }
+        Voice->Gain[0] = TargetLeft;
+        Voice->Gain[1] = TargetRight;
+        ++Mixer->VoicesMixed;
+    }
+    while (Mixer->VoiceHighWater && !Mixer->Voices[Mixer->VoiceHighWater - 1].Active)
+    {
+        --Mixer->VoiceHighWater;
+    }
+    Mixer->SamplesMixed += SampleCount;
+
+    // Note(joe): Rounded, saturated to int16 and interleaved left then right.
+    float Scale = 32767.0f*Mixer->MasterVolume;
+    int16 *Output = SoundBuffer->Samples;
+    uint32 Index = 0;
+#if AQCUBE_SSE2
+    __m128 WideScale = _mm_set1_ps(Scale);
+    for (; Index + 4 <= SampleCount; Index += 4)
+    {
+        __m128i L = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(Left + Index), WideScale));
+        __m128i R = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(Right + Index), WideScale));
+        __m128i Interleaved = _mm_unpacklo_epi16(_mm_packs_epi32(L, L), _mm_packs_epi32(R, R));
+        _mm_storeu_si128((__m128i *)(Output + 2*Index), Interleaved);
+    }
+#endif
+    for (; Index < SampleCount; ++Index)
+    {
+        Output[2*Index + 0] = (int16)glm::clamp(floorf(Left[Index]*Scale + 0.5f), -32768.0f, 32767.0f);
+        Output[2*Index + 1] = (int16)glm::clamp(floorf(Right[Index]*Scale + 0.5f), -32768.0f, 32767.0f);
+    }
+
+    EndTemporaryMemory(TempMemory);
+}
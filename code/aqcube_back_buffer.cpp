@@ -0,0 +1,175 @@
+//
+// Back buffer fills
+//
+// Note(joe): The game's gradient background, written straight into a
+// game_back_buffer. Blue is x + OffsetX and green is y + OffsetY, red is their sum,
+// all wrapping at 256. So red is just blue plus green and a row is a single ramp.
+//
+// Rows are filled a cache line (16 pixels) at a time, 4 pixels a store with SSE2
+// and 8 with AVX2, after a scalar run up to the first line boundary. With Stream set
+// the stores go around the cache, which suits a frame that only the display reads.
+// Leave it off when something is about to draw over the pixels. The rows are cut
+// into bands for the work queue.
+//
+
+#include "aqcube_simd.h"
+
+#define FILL_BAND_MIN_ROWS 16
+#define FILL_MAX_BANDS 128
+
+struct fill_band
+{
+    game_back_buffer *Target;
+    int FirstRow;
+    int RowCount;
+    int OffsetX;
+    int OffsetY;
+    bool Stream;
+};
+
+inline uint32 GetGradientPixel(int X, int Y, int OffsetX, int OffsetY)
+{
+    uint32 Blue = (uint8)(OffsetX + X);
+    uint32 Green = (uint8)(OffsetY + Y);
+    uint32 Red = (uint8)(Blue + Green);
+    return (Blue << 0) | (Green << 8) | (Red << 16);
+}
+
+// Note(joe): A pixel at a time, what the fast path is checked and timed against.
+static void FillGradientRowScalar(uint32 *Row, int Width, int Y, int OffsetX, int OffsetY)
+{
+    for (int X = 0; X < Width; ++X)
+    {
+        Row[X] = GetGradientPixel(X, Y, OffsetX, OffsetY);
+    }
+}
+
+static void FillGradientRow(uint32 *Row, int Width, int Y, int OffsetX, int OffsetY, bool Stream)
+{
+    int X = 0;
+    while (X < Width && ((uintptr_t)(Row + X) & 63))
+    {
+        Row[X] = GetGradientPixel(X, Y, OffsetX, OffsetY);
+        ++X;
+    }
+
+#if AQCUBE_AVX2
+    __m256i Blue = _mm256_add_epi32(_mm256_set1_epi32(OffsetX + X), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i Green = _mm256_set1_epi32((uint8)(OffsetY + Y));
+    __m256i GreenBits = _mm256_slli_epi32(Green, 8);
+    __m256i ByteMask = _mm256_set1_epi32(0xFF);
+    __m256i Step = _mm256_set1_epi32(8);
+    for (; X + 16 <= Width; X += 16)
+    {
+        __m256i Pixels[2];
+        for (int Half = 0; Half < 2; ++Half)
+        {
+            __m256i B = _mm256_and_si256(Blue, ByteMask);
+            __m256i R = _mm256_and_si256(_mm256_add_epi32(B, Green), ByteMask);
+            Pixels[Half] = _mm256_or_si256(_mm256_or_si256(B, GreenBits), _mm256_slli_epi32(R, 16));
+            Blue = _mm256_add_epi32(Blue, Step);
+        }
+        if (Stream)
+        {
+            _mm256_stream_si256((__m256i *)(Row + X), Pixels[0]);
+            _mm256_stream_si256((__m256i *)(Row + X + 8), Pixels[1]);
+        }
+        else
+        {
+            _mm256_store_si256((__m256i *)(Row + X), Pixels[0]);
+            _mm256_store_si256((__m256i *)(Row + X + 8), Pixels[1]);
+        }
+    }
+#elif AQCUBE_SSE2
+    __m128i Blue = _mm_add_epi32(_mm_set1_epi32(OffsetX + X), _mm_setr_epi32(0, 1, 2, 3));
+    __m128i Green = _mm_set1_epi32((uint8)(OffsetY + Y));
+    __m128i GreenBits = _mm_slli_epi32(Green, 8);
+    __m128i ByteMask = _mm_set1_epi32(0xFF);
+    __m128i Step = _mm_set1_epi32(4);
+    for (; X + 16 <= Width; X += 16)
+    {
+        __m128i Pixels[4];
+        for (int Quarter = 0; Quarter < 4; ++Quarter)
+        {
+            __m128i B = _mm_and_si128(Blue, ByteMask);
+            __m128i R = _mm_and_si128(_mm_add_epi32(B, Green), ByteMask);
+            Pixels[Quarter] = _mm_or_si128(_mm_or_si128(B, GreenBits), _mm_slli_epi32(R, 16));
+            Blue = _mm_add_epi32(Blue, Step);
+        }
+        if (Stream)
+        {
+            for (int Quarter = 0; Quarter < 4; ++Quarter)
+            {
+                _mm_stream_si128((__m128i *)(Row + X + 4*Quarter), Pixels[Quarter]);
+            }
+        }
+        else
+        {
+            for (int Quarter = 0; Quarter < 4; ++Quarter)
+            {
+                _mm_store_si128((__m128i *)(Row + X + 4*Quarter), Pixels[Quarter]);
+            }
+        }
+    }
+#endif
+
+    for (; X < Width; ++X)
+    {
+        Row[X] = GetGradientPixel(X, Y, OffsetX, OffsetY);
+    }
+}
+
+static PLATFORM_WORK_QUEUE_CALLBACK(FillGradientBand)
+{
+    TIMED_FUNCTION();
+
+    fill_band *Band = (fill_band *)Data;
+    game_back_buffer *Target = Band->Target;
+    for (int Y = Band->FirstRow; Y < Band->FirstRow + Band->RowCount; ++Y)
+    {
+        uint32 *Row = (uint32 *)((uint8 *)Target->Memory + (intptr_t)Y*Target->Pitch);
+        FillGradientRow(Row, Target->Width, Y, Band->OffsetX, Band->OffsetY, Band->Stream);
+    }
+#if AQCUBE_SSE2
+    // Note(joe): Streamed stores aren't ordered with the rest, this makes them visible
+    // before the job counts as done.
+    if (Band->Stream)
+    {
+        _mm_sfence();
+    }
+#endif
+}
+
+// Note(joe): Queue can be 0, the bands are done in turn then.
+static void FillBackBufferGradient(game_back_buffer *Target, int OffsetX, int OffsetY, platform_work_queue *Queue, bool Stream)
+{
+    TIMED_FUNCTION();
+
+    assert(Target->BytesPerPixel == 4);
+
+    fill_band Bands[FILL_MAX_BANDS];
+    int BandRows = glm::max(FILL_BAND_MIN_ROWS, (Target->Height + FILL_MAX_BANDS - 1) / FILL_MAX_BANDS);
+    int BandCount = 0;
+    for (int FirstRow = 0; FirstRow < Target->Height; FirstRow += BandRows)
+    {
+        fill_band *Band = Bands + BandCount++;
+        Band->Target = Target;
+        Band->FirstRow = FirstRow;
+        Band->RowCount = glm::min(BandRows, Target->Height - FirstRow);
+        Band->OffsetX = OffsetX;
+        Band->OffsetY = OffsetY;
+        Band->Stream = Stream;
+        if (Queue)
+        {
+            AddWorkQueueEntry(Queue, FillGradientBand, Band);
+        }
+        else
+        {
+            FillGradientBand(0, Band);
+        }
+    }
+    if (Queue)
+    {
+        CompleteAllWork(Queue);
+    }
+}
@@ -0,0 +1,326 @@
+// Note(joe): Block compression encoders for the cooker. All of them take a 4x4 block
+// of RGBA8 pixels (64 bytes, row major) and write one compressed block.
+//
+// These are range fit encoders: the endpoints come from the block's bounding box,
+// pulled in a little so the interpolated colours land on the pixels more often, and
+// each pixel then picks the closest palette entry. That's a lot faster than a
+// cluster fit and plenty good for these textures. The bounding box and the index
+// search are SSE2, with a scalar fallback for other targets.
+
+#include "aqcube_simd.h"
+
+inline static uint16 PackRGB565(uint8 *Color)
+{
+    uint16 Result = (uint16)(((Color[0] >> 3) << 11) | ((Color[1] >> 2) << 5) | (Color[2] >> 3));
+    return Result;
+}
+
+inline static void UnpackRGB565(uint16 Packed, uint8 *Color)
+{
+    uint8 R = (uint8)((Packed >> 11) & 31);
+    uint8 G = (uint8)((Packed >> 5) & 63);
+    uint8 B = (uint8)(Packed & 31);
+    Color[0] = (uint8)((R << 3) | (R >> 2));
+    Color[1] = (uint8)((G << 2) | (G >> 4));
+    Color[2] = (uint8)((B << 3) | (B >> 2));
+    Color[3] = 255;
+}
+
+// Note(joe): Min and max of every channel over the 16 pixels.
+static void GetBlockBounds(uint8 *Block, uint8 *Min, uint8 *Max)
+{
+#if AQCUBE_SSE2
+    __m128i Row0 = _mm_loadu_si128((__m128i *)(Block + 0));
+    __m128i Row1 = _mm_loadu_si128((__m128i *)(Block + 16));
+    __m128i Row2 = _mm_loadu_si128((__m128i *)(Block + 32));
+    __m128i Row3 = _mm_loadu_si128((__m128i *)(Block + 48));
+
+    __m128i MinColor = _mm_min_epu8(_mm_min_epu8(Row0, Row1), _mm_min_epu8(Row2, Row3));
+    __m128i MaxColor = _mm_max_epu8(_mm_max_epu8(Row0, Row1), _mm_max_epu8(Row2, Row3));
+
+    // Note(joe): Fold the four pixels left in each register down to one.
+    MinColor = _mm_min_epu8(MinColor, _mm_shuffle_epi32(MinColor, _MM_SHUFFLE(1, 0, 3, 2)));
+    MinColor = _mm_min_epu8(MinColor, _mm_shuffle_epi32(MinColor, _MM_SHUFFLE(2, 3, 0, 1)));
+    MaxColor = _mm_max_epu8(MaxColor, _mm_shuffle_epi32(MaxColor, _MM_SHUFFLE(1, 0, 3, 2)));
+    MaxColor = _mm_max_epu8(MaxColor, _mm_shuffle_epi32(MaxColor, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    uint32 PackedMin = (uint32)_mm_cvtsi128_si32(MinColor);
+    uint32 PackedMax = (uint32)_mm_cvtsi128_si32(MaxColor);
+    memcpy(Min, &PackedMin, 4);
+    memcpy(Max, &PackedMax, 4);
+#else
+    for (int Channel = 0; Channel < 4; ++Channel)
+    {
+        Min[Channel] = 255;
+        Max[Channel] = 0;
+    }
+    for (int PixelIndex = 0; PixelIndex < 16; ++PixelIndex)
+    {
+        for (int Channel = 0; Channel < 4; ++Channel)
+        {
+            uint8 Value = Block[PixelIndex*4 + Channel];
+            if (Value < Min[Channel]) Min[Channel] = Value;
+            if (Value > Max[Channel]) Max[Channel] = Value;
+        }
+    }
+#endif
+}
+
+static void InsetBounds(uint8 *Min, uint8 *Max, int ChannelCount)
+{
+    for (int Channel = 0; Channel < ChannelCount; ++Channel)
+    {
+        int Inset = (Max[Channel] - Min[Channel]) >> 4;
+        Min[Channel] = (uint8)(Min[Channel] + Inset);
+        Max[Channel] = (uint8)(Max[Channel] - Inset);
+    }
+}
+
+// Note(joe): Picks the nearest of the four palette colours for every pixel and
+// packs the 2 bit indices, pixel 0 in the low bits.
+static uint32 SelectColorIndices(uint8 *Block, uint8 Palette[4][4])
+{
+    uint32 Result = 0;
+
+#if AQCUBE_SSE2
+    __m128 PaletteR[4], PaletteG[4], PaletteB[4];
+    for (int Entry = 0; Entry < 4; ++Entry)
+    {
+        PaletteR[Entry] = _mm_set1_ps(Palette[Entry][0]);
+        PaletteG[Entry] = _mm_set1_ps(Palette[Entry][1]);
+        PaletteB[Entry] = _mm_set1_ps(Palette[Entry][2]);
+    }
+
+    __m128i Zero = _mm_setzero_si128();
+    for (int Quad = 0; Quad < 4; ++Quad)
+    {
+        // Note(joe): Four pixels to floats, then transposed so each register is
+        // one channel of all four.
+        __m128i Pixels = _mm_loadu_si128((__m128i *)(Block + Quad*16));
+        __m128i Lo = _mm_unpacklo_epi8(Pixels, Zero);
+        __m128i Hi = _mm_unpackhi_epi8(Pixels, Zero);
+        __m128 P0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(Lo, Zero));
+        __m128 P1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(Lo, Zero));
+        __m128 P2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(Hi, Zero));
+        __m128 P3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(Hi, Zero));
+        _MM_TRANSPOSE4_PS(P0, P1, P2, P3);
+
+        __m128 BestDistance = _mm_set1_ps(3.4e38f);
+        __m128i BestIndex = _mm_setzero_si128();
+        for (int Entry = 0; Entry < 4; ++Entry)
+        {
+            __m128 dR = _mm_sub_ps(P0, PaletteR[Entry]);
+            __m128 dG = _mm_sub_ps(P1, PaletteG[Entry]);
+            __m128 dB = _mm_sub_ps(P2, PaletteB[Entry]);
+            __m128 Distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dR, dR), _mm_mul_ps(dG, dG)), _mm_mul_ps(dB, dB));
+
+            __m128i Closer = _mm_castps_si128(_mm_cmplt_ps(Distance, BestDistance));
+            BestDistance = _mm_min_ps(Distance, BestDistance);
+            BestIndex = _mm_or_si128(_mm_and_si128(Closer, _mm_set1_epi32(Entry)),
+                                     _mm_andnot_si128(Closer, BestIndex));
+        }
+
+        uint32 Indices[4];
+        _mm_storeu_si128((__m128i *)Indices, BestIndex);
+        for (int Lane = 0; Lane < 4; ++Lane)
+        {
+            Result |= Indices[Lane] << (2*(Quad*4 + Lane));
+        }
+    }
+#else
+    for (int PixelIndex = 0; PixelIndex < 16; ++PixelIndex)
+    {
+        uint8 *Pixel = Block + PixelIndex*4;
+        int BestDistance = 0x7FFFFFFF;
+        uint32 BestIndex = 0;
+        for (int Entry = 0; Entry < 4; ++Entry)
+        {
+            int dR = Pixel[0] - Palette[Entry][0];
+            int dG = Pixel[1] - Palette[Entry][1];
+            int dB = Pixel[2] - Palette[Entry][2];
+            int Distance = dR*dR + dG*dG + dB*dB;
+            if (Distance < BestDistance)
+            {
+                BestDistance = Distance;
+                BestIndex = (uint32)Entry;
+            }
+        }
+        Result |= BestIndex << (2*PixelIndex);
+    }
+#endif
+
+    return Result;
+}
+
+// Note(joe): Always uses the four colour mode, so it's also the colour half of BC3.
+static void EncodeBC1Block(uint8 *Block, uint8 *Output)
+{
+    uint8 Min[4], Max[4];
+    GetBlockBounds(Block, Min, Max);
+    InsetBounds(Min, Max, 3);
+
+    uint16 Color0 = PackRGB565(Max);
+    uint16 Color1 = PackRGB565(Min);
+    uint32 Indices = 0;
+    if (Color0 != Color1)
+    {
+        // Note(joe): Color0 > Color1 is what selects the four colour mode.
+        if (Color0 < Color1)
+        {
+            uint16 Swap = Color0;
+            Color0 = Color1;
+            Color1 = Swap;
+        }
+
+        uint8 Palette[4][4];
+        UnpackRGB565(Color0, Palette[0]);
+        UnpackRGB565(Color1, Palette[1]);
+        for (int Channel = 0; Channel < 3; ++Channel)
+        {
+            Palette[2][Channel] = (uint8)((2*Palette[0][Channel] + Palette[1][Channel] + 1) / 3);
+            Palette[3][Channel] = (uint8)((Palette[0][Channel] + 2*Palette[1][Channel] + 1) / 3);
+        }
+        Indices = SelectColorIndices(Block, Palette);
+    }
+
+    Output[0] = (uint8)(Color0 & 0xFF);
+    Output[1] = (uint8)(Color0 >> 8);
+    Output[2] = (uint8)(Color1 & 0xFF);
+    Output[3] = (uint8)(Color1 >> 8);
+    memcpy(Output + 4, &Indices, 4);
+}
+
+// Note(joe): One channel of the block (0-3) as a BC4 block, eight value mode.
+static void EncodeBC4Channel(uint8 *Block, int Channel, uint8 *Output)
+{
+    uint8 Values[16];
+    for (int PixelIndex = 0; PixelIndex < 16; ++PixelIndex)
+    {
+        Values[PixelIndex] = Block[PixelIndex*4 + Channel];
+    }
+
+    uint8 MinValue, MaxValue;
+#if AQCUBE_SSE2
+    __m128i V = _mm_loadu_si128((__m128i *)Values);
+    __m128i MinV = _mm_min_epu8(V, _mm_srli_si128(V, 8));
+    __m128i MaxV = _mm_max_epu8(V, _mm_srli_si128(V, 8));
+    MinV = _mm_min_epu8(MinV, _mm_srli_si128(MinV, 4));
+    MaxV = _mm_max_epu8(MaxV, _mm_srli_si128(MaxV, 4));
+    MinV = _mm_min_epu8(MinV, _mm_srli_si128(MinV, 2));
+    MaxV = _mm_max_epu8(MaxV, _mm_srli_si128(MaxV, 2));
+    MinV = _mm_min_epu8(MinV, _mm_srli_si128(MinV, 1));
+    MaxV = _mm_max_epu8(MaxV, _mm_srli_si128(MaxV, 1));
+    MinValue = (uint8)(_mm_cvtsi128_si32(MinV) & 0xFF);
+    MaxValue = (uint8)(_mm_cvtsi128_si32(MaxV) & 0xFF);
+#else
+    MinValue = 255;
+    MaxValue = 0;
+    for (int PixelIndex = 0; PixelIndex < 16; ++PixelIndex)
+    {
+        if (Values[PixelIndex] < MinValue) MinValue = Values[PixelIndex];
+        if (Values[PixelIndex] > MaxValue) MaxValue = Values[PixelIndex];
+    }
+#endif
+
+    uint64 Indices = 0;
+    if (MaxValue != MinValue)
+    {
+        // Note(joe): Step 0 is Value0 (the max) and step 7 is Value1 (the min), the
+        // six in between are indices 2-7.
+        float Scale = 7.0f / (float)(MaxValue - MinValue);
+#if AQCUBE_SSE2
+        __m128i Zero = _mm_setzero_si128();
+        __m128i Lo = _mm_unpacklo_epi8(V, Zero);
+        __m128i Hi = _mm_unpackhi_epi8(V, Zero);
+        __m128i Quads[4] = {
+            _mm_unpacklo_epi16(Lo, Zero), _mm_unpackhi_epi16(Lo, Zero),
+            _mm_unpacklo_epi16(Hi, Zero), _mm_unpackhi_epi16(Hi, Zero),
+        };
+        __m128 MaxF = _mm_set1_ps((float)MaxValue);
+        __m128 ScaleF = _mm_set1_ps(Scale);
+        __m128 Half = _mm_set1_ps(0.5f);
+        __m128i One = _mm_set1_epi32(1);
+        __m128i Seven = _mm_set1_epi32(7);
+        for (int Quad = 0; Quad < 4; ++Quad)
+        {
+            __m128 Step = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(MaxF, _mm_cvtepi32_ps(Quads[Quad])), ScaleF), Half);
+            __m128i StepI = _mm_cvttps_epi32(Step);
+            __m128i Index = _mm_add_epi32(StepI, One);
+            __m128i IsFirst = _mm_cmpeq_epi32(StepI, Zero);
+            __m128i IsLast = _mm_cmpeq_epi32(StepI, Seven);
+            Index = _mm_andnot_si128(IsFirst, Index);
+            Index = _mm_or_si128(_mm_and_si128(IsLast, One), _mm_andnot_si128(IsLast, Index));
+
+            uint32 Lanes[4];
+            _mm_storeu_si128((__m128i *)Lanes, Index);
+            for (int Lane = 0; Lane < 4; ++Lane)
+            {
+                Indices |= (uint64)Lanes[Lane] << (3*(Quad*4 + Lane));
+            }
+        }
+#else
+        for (int PixelIndex = 0; PixelIndex < 16; ++PixelIndex)
+        {
+            int Step = (int)((MaxValue - Values[PixelIndex])*Scale + 0.5f);
+            uint64 Index = (Step == 0) ? 0 : (Step == 7) ? 1 : (uint64)(Step + 1);
+            Indices |= Index << (3*PixelIndex);
+        }
+#endif
+    }
+
+    Output[0] = MaxValue;
+    Output[1] = MinValue;
+    for (int Byte = 0; Byte < 6; ++Byte)
+    {
+        Output[2 + Byte] = (uint8)(Indices >> (8*Byte));
+    }
+}
+
+static void EncodeBC3Block(uint8 *Block, uint8 *Output)
+{
+    EncodeBC4Channel(Block, 3, Output);
+    EncodeBC1Block(Block, Output + 8);
+}
+
+static void EncodeBC4Block(uint8 *Block, uint8 *Output)
+{
+    EncodeBC4Channel(Block, 0, Output);
+}
+
+static void EncodeBC5Block(uint8 *Block, uint8 *Output)
+{
+    EncodeBC4Channel(Block, 0, Output);
+    EncodeBC4Channel(Block, 1, Output + 8);
+}
+
+// Note(joe): Compresses a whole RGBA8 image. Edge blocks of images that aren't a
+// multiple of four repeat the last row and column.
+static void CompressImage(texture_block_format Format, uint8 *Pixels, uint32 Width, uint32 Height, uint8 *Output)
+{
+    uint32 BlockSize = GetBlockSize(Format);
+    for (uint32 BlockY = 0; BlockY < Height; BlockY += 4)
+    {
+        for (uint32 BlockX = 0; BlockX < Width; BlockX += 4)
+        {
+            uint8 Block[64];
+            for (uint32 y = 0; y < 4; ++y)
+            {
+                uint32 SourceY = (BlockY + y < Height) ? BlockY + y : Height - 1;
+                for (uint32 x = 0; x < 4; ++x)
+                {
+                    uint32 SourceX = (BlockX + x < Width) ? BlockX + x : Width - 1;
+                    memcpy(Block + (y*4 + x)*4, Pixels + (SourceY*Width + SourceX)*4, 4);
+                }
+            }
+
+            switch (Format)
+            {
+                case BlockFormat_BC1: { EncodeBC1Block(Block, Output); } break;
+                case BlockFormat_BC3: { EncodeBC3Block(Block, Output); } break;
+                case BlockFormat_BC4: { EncodeBC4Block(Block, Output); } break;
+                case BlockFormat_BC5: { EncodeBC5Block(Block, Output); } break;
+            }
+            Output += BlockSize;
+        }
+    }
+}
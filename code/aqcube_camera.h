@@ -0,0 +1,55 @@
+#pragma once
+
+struct camera
+{
+    glm::vec3 Position;
+    glm::vec3 Front;
+    glm::vec3 Up;
+};
+struct camera_angles
+{
+    float Pitch;
+    float Yaw;
+};
+static void UpdateCamera(camera *Camera, camera_angles *CameraAngles, game_controller_input *Input, float CameraSpeed, int WindowCenterX, int WindowCenterY)
+{
+    TIMED_FUNCTION();
+
+    if (Input->Up.IsDown)
+    {
+        Camera->Position += CameraSpeed * Camera->Front;
+    }
+    if (Input->Down.IsDown)
+    {
+        Camera->Position -= CameraSpeed * Camera->Front;
+    }
+    if (Input->Left.IsDown)
+    {
+        Camera->Position -= glm::normalize(glm::cross(Camera->Front, Camera->Up)) * CameraSpeed;
+    }
+    if (Input->Right.IsDown)
+    {
+        Camera->Position += glm::normalize(glm::cross(Camera->Front, Camera->Up)) * CameraSpeed;
+    }
+
+    float Sensitivity = 0.1f;
+    float XOffset = (Input->Mouse.x - WindowCenterX) * Sensitivity;
+    float YOffset = (WindowCenterY - Input->Mouse.y) * Sensitivity;
+
+    CameraAngles->Yaw += XOffset;
+    CameraAngles->Pitch += YOffset;
+    if (CameraAngles->Pitch > 89.0f)
+    {
+        CameraAngles->Pitch = 89.0f;
+    }
+    if (CameraAngles->Pitch < -89.0f)
+    {
+        CameraAngles->Pitch = -89.0f;
+    }
+
+    glm::vec3 Front;
+    Front.x = cos(DEG_TO_RAD(CameraAngles->Pitch)) * cos(DEG_TO_RAD(CameraAngles->Yaw));
+    Front.y = sin(DEG_TO_RAD(CameraAngles->Pitch));
+    Front.z = cos(DEG_TO_RAD(CameraAngles->Pitch)) * sin(DEG_TO_RAD(CameraAngles->Yaw));
+    Camera->Front = glm::normalize(Front);
+}
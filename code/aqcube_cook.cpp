@@ -0,0 +1,1002 @@
+// Note(joe): Offline asset cooker. Turns source assets into the formats the runtime
+// loads without any importer work:
+//
+//   aqcube_cook mesh <input model> <output.aqmesh> [--vertex-format packed|float] [--no-optimize]
+//                                                 [--lods N] [--lod-ratio R]
+//   aqcube_cook texture <input image> <output.dds> [--format auto|bc1|bc3|bc4|bc5]
+//                                                   [--filter box|kaiser|lanczos] [--srgb] [--normal] [--linear]
+//
+// This is the only thing that links Assimp now. Build with COOK_MESHES=0 to get
+// just the texture cooker where Assimp isn't around.
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+
+#ifndef COOK_MESHES
+#define COOK_MESHES 1
+#endif
+
+#if COOK_MESHES
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+#endif
+
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+
+#define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
+
+#include "aqcube_mesh_format.h"
+#include "aqcube_texture_format.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "aqcube_bcn.cpp"
+#include "aqcube_mips.cpp"
+#include "aqcube_mesh_optimize.cpp"
+#include "aqcube_mesh_simplify.cpp"
+
+inline static uint64 AlignUp(uint64 Value, uint64 Alignment)
+{
+    uint64 Result = (Value + Alignment - 1) & ~(Alignment - 1);
+    return Result;
+}
+
+inline static void GrowBounds(float *Min, float *Max, float *Point)
+{
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        if (Point[Axis] < Min[Axis]) Min[Axis] = Point[Axis];
+        if (Point[Axis] > Max[Axis]) Max[Axis] = Point[Axis];
+    }
+}
+
+static bool WritePadding(FILE *File, uint64 Offset)
+{
+    static uint8 Zeros[AQMESH_BLOB_ALIGNMENT];
+
+    bool Result = true;
+    long Current = ftell(File);
+    assert((uint64)Current <= Offset);
+    uint64 PadSize = Offset - (uint64)Current;
+    if (PadSize)
+    {
+        assert(PadSize <= sizeof(Zeros));
+        Result = (fwrite(Zeros, 1, (size_t)PadSize, File) == PadSize);
+    }
+    return Result;
+}
+
+//
+// Vertex packing
+//
+// Note(joe): Doesn't need Assimp, it only works on already cooked vertices.
+//
+
+// Note(joe): Rounds to nearest even. Anything too big for a half becomes infinity,
+// too small flushes through the denormals to zero.
+static uint16 FloatToHalf(float Value)
+{
+    uint32 Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+
+    uint32 Sign = (Bits >> 16) & 0x8000;
+    int32 Exponent = (int32)((Bits >> 23) & 0xFF);
+    uint32 Mantissa = Bits & 0x7FFFFF;
+
+    uint32 Result = Sign;
+    if (Exponent == 0xFF)
+    {
+        Result |= 0x7C00 | (Mantissa ? 0x200 : 0);
+    }
+    else
+    {
+        int32 HalfExponent = Exponent - 127 + 15;
+        if (HalfExponent >= 31)
+        {
+            Result |= 0x7C00;
+        }
+        else if (HalfExponent <= 0)
+        {
+            if (HalfExponent >= -10)
+            {
+                Mantissa |= 0x800000;
+                uint32 Shift = (uint32)(14 - HalfExponent);
+                uint32 Half = Mantissa >> Shift;
+                uint32 Remainder = Mantissa & ((1u << Shift) - 1);
+                uint32 Halfway = 1u << (Shift - 1);
+                if (Remainder > Halfway || (Remainder == Halfway && (Half & 1)))
+                {
+                    ++Half;
+                }
+                Result |= Half;
+            }
+        }
+        else
+        {
+            // Note(joe): A round up that carries out of the mantissa bumps the
+            // exponent, which is what it should do.
+            uint32 Half = ((uint32)HalfExponent << 10) | (Mantissa >> 13);
+            uint32 Remainder = Mantissa & 0x1FFF;
+            if (Remainder > 0x1000 || (Remainder == 0x1000 && (Half & 1)))
+            {
+                ++Half;
+            }
+            Result |= Half;
+        }
+    }
+
+    return (uint16)Result;
+}
+
+static float HalfToFloat(uint16 Value)
+{
+    uint32 Sign = (uint32)(Value & 0x8000) << 16;
+    uint32 Exponent = (Value >> 10) & 0x1F;
+    uint32 Mantissa = Value & 0x3FF;
+
+    float Result;
+    if (Exponent == 0)
+    {
+        Result = (float)Mantissa*(1.0f / 16777216.0f);
+        Result = Sign ? -Result : Result;
+    }
+    else
+    {
+        uint32 Bits = Sign | (Mantissa << 13) | ((Exponent == 31) ? 0x7F800000 : ((Exponent + 112) << 23));
+        memcpy(&Result, &Bits, sizeof(Result));
+    }
+
+    return Result;
+}
+
+inline float SignNotZero(float Value)
+{
+    float Result = (Value >= 0.0f) ? 1.0f : -1.0f;
+    return Result;
+}
+
+// Note(joe): Same as OctDecode in model.vert, snorm16 is max(x/32767, -1) there too.
+static void OctDecodeNormal(int16 *Encoded, float *Normal)
+{
+    float u = (float)Encoded[0] / 32767.0f;
+    float v = (float)Encoded[1] / 32767.0f;
+    u = (u < -1.0f) ? -1.0f : u;
+    v = (v < -1.0f) ? -1.0f : v;
+
+    float z = 1.0f - fabsf(u) - fabsf(v);
+    if (z < 0.0f)
+    {
+        float OldU = u;
+        u = (1.0f - fabsf(v))*SignNotZero(OldU);
+        v = (1.0f - fabsf(OldU))*SignNotZero(v);
+    }
+
+    float Length = sqrtf(u*u + v*v + z*z);
+    Normal[0] = u / Length;
+    Normal[1] = v / Length;
+    Normal[2] = z / Length;
+}
+
+// Note(joe): Octahedral mapping, the unit sphere folded onto a square. Plain rounding
+// can be a step off the closest code, so all four neighbours get decoded and the one
+// nearest the real normal wins. Zero length normals come out as +z.
+static void OctEncodeNormal(float *Normal, int16 *Encoded)
+{
+    Encoded[0] = 0;
+    Encoded[1] = 0;
+
+    float L1 = fabsf(Normal[0]) + fabsf(Normal[1]) + fabsf(Normal[2]);
+    if (L1 > 0.0f)
+    {
+        float u = Normal[0] / L1;
+        float v = Normal[1] / L1;
+        if (Normal[2] < 0.0f)
+        {
+            float OldU = u;
+            u = (1.0f - fabsf(v))*SignNotZero(OldU);
+            v = (1.0f - fabsf(OldU))*SignNotZero(v);
+        }
+
+        float Length = sqrtf(Normal[0]*Normal[0] + Normal[1]*Normal[1] + Normal[2]*Normal[2]);
+        float BestDot = -2.0f;
+        for (int Candidate = 0; Candidate < 4; ++Candidate)
+        {
+            float Codes[2] = { floorf(u*32767.0f) + (float)(Candidate & 1), floorf(v*32767.0f) + (float)(Candidate >> 1) };
+            int16 Try[2];
+            for (int Component = 0; Component < 2; ++Component)
+            {
+                float Code = (Codes[Component] < -32767.0f) ? -32767.0f : ((Codes[Component] > 32767.0f) ? 32767.0f : Codes[Component]);
+                Try[Component] = (int16)Code;
+            }
+
+            float Decoded[3];
+            OctDecodeNormal(Try, Decoded);
+            float Dot = (Decoded[0]*Normal[0] + Decoded[1]*Normal[1] + Decoded[2]*Normal[2]) / Length;
+            if (Dot > BestDot)
+            {
+                BestDot = Dot;
+                Encoded[0] = Try[0];
+                Encoded[1] = Try[1];
+            }
+        }
+    }
+}
+
+// Note(joe): Largest round trip error over a mesh's vertices. Position is in model
+// units, normal in degrees.
+struct vertex_packing_error
+{
+    float Position;
+    float Normal;
+    float TexCoord;
+};
+
+// Note(joe): Positions are quantised over the model's bounds rather than each mesh's.
+// Every mesh in a model shares its instance transform, which is where the decode goes,
+// and a cube instead of the box keeps that a uniform scale.
+static void PackVertices(aqmesh_header *Header, aqmesh_mesh *Meshes, aqmesh_vertex *Vertices,
+                         aqmesh_packed_vertex *Packed, vertex_packing_error *Errors)
+{
+    float Extent = 0.0f;
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        float AxisExtent = Header->BoundsMax[Axis] - Header->BoundsMin[Axis];
+        Extent = (AxisExtent > Extent) ? AxisExtent : Extent;
+    }
+    Extent = (Extent > 0.0f) ? Extent : 1.0f;
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        Header->PositionOrigin[Axis] = Header->BoundsMin[Axis];
+    }
+    Header->PositionScale = Extent;
+
+    for (uint32 MeshIndex = 0; MeshIndex < Header->MeshCount; ++MeshIndex)
+    {
+        aqmesh_mesh *Mesh = Meshes + MeshIndex;
+        vertex_packing_error *Error = Errors + MeshIndex;
+        *Error = {};
+
+        for (uint32 VertexIndex = Mesh->FirstVertex; VertexIndex < Mesh->FirstVertex + Mesh->VertexCount; ++VertexIndex)
+        {
+            aqmesh_vertex *Source = Vertices + VertexIndex;
+            aqmesh_packed_vertex *Dest = Packed + VertexIndex;
+
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                float Normalised = (Source->Position[Axis] - Header->PositionOrigin[Axis]) / Extent;
+                float Code = floorf(Normalised*65535.0f + 0.5f);
+                Code = (Code < 0.0f) ? 0.0f : ((Code > 65535.0f) ? 65535.0f : Code);
+                Dest->Position[Axis] = (uint16)Code;
+
+                float Decoded = Header->PositionOrigin[Axis] + Extent*(Code / 65535.0f);
+                float PositionError = fabsf(Decoded - Source->Position[Axis]);
+                Error->Position = (PositionError > Error->Position) ? PositionError : Error->Position;
+            }
+            Dest->Padding = 0;
+
+            OctEncodeNormal(Source->Normal, Dest->Normal);
+            float Length = sqrtf(Source->Normal[0]*Source->Normal[0] + Source->Normal[1]*Source->Normal[1] + Source->Normal[2]*Source->Normal[2]);
+            if (Length > 0.0f)
+            {
+                float Decoded[3];
+                OctDecodeNormal(Dest->Normal, Decoded);
+                float Dot = (Decoded[0]*Source->Normal[0] + Decoded[1]*Source->Normal[1] + Decoded[2]*Source->Normal[2]) / Length;
+                Dot = (Dot > 1.0f) ? 1.0f : Dot;
+                float NormalError = acosf(Dot)*(180.0f / 3.14159265f);
+                Error->Normal = (NormalError > Error->Normal) ? NormalError : Error->Normal;
+            }
+
+            for (int Component = 0; Component < 2; ++Component)
+            {
+                Dest->TexCoords[Component] = FloatToHalf(Source->TexCoords[Component]);
+                float TexCoordError = fabsf(HalfToFloat(Dest->TexCoords[Component]) - Source->TexCoords[Component]);
+                Error->TexCoord = (TexCoordError > Error->TexCoord) ? TexCoordError : Error->TexCoord;
+            }
+        }
+    }
+}
+
+//
+// Mesh cooking
+//
+
+#if COOK_MESHES
+
+struct mesh_cooker
+{
+    const aiScene *Scene;
+
+    aqmesh_header Header;
+    aqmesh_texture *Textures;
+    aqmesh_material *Materials;
+    aqmesh_mesh *Meshes;
+    aqmesh_vertex *Vertices;
+    uint32 *Indices;
+
+    // Note(joe): What actually goes in the file, either the arrays above or their
+    // packed versions.
+    void *VertexData;
+    void *IndexData;
+
+    uint32 TotalVertexCount;
+    uint32 TotalIndexCount;
+};
+
+static void CountNodeGeometry(mesh_cooker *Cooker, aiNode *Node)
+{
+    for (uint32 i = 0; i < Node->mNumMeshes; ++i)
+    {
+        aiMesh *Mesh = Cooker->Scene->mMeshes[Node->mMeshes[i]];
+        ++Cooker->Header.MeshCount;
+        Cooker->TotalVertexCount += Mesh->mNumVertices;
+        for (uint32 FaceIndex = 0; FaceIndex < Mesh->mNumFaces; ++FaceIndex)
+        {
+            Cooker->TotalIndexCount += Mesh->mFaces[FaceIndex].mNumIndices;
+        }
+    }
+
+    for (uint32 i = 0; i < Node->mNumChildren; ++i)
+    {
+        CountNodeGeometry(Cooker, Node->mChildren[i]);
+    }
+}
+
+// Note(joe): Shared textures are stored once, materials refer to them by index.
+static uint32 AddTexture(mesh_cooker *Cooker, aqmesh_texture_type Type, const char *Path)
+{
+    for (uint32 i = 0; i < Cooker->Header.TextureCount; ++i)
+    {
+        if (strcmp(Cooker->Textures[i].Path, Path) == 0)
+        {
+            return i;
+        }
+    }
+
+    uint32 Result = Cooker->Header.TextureCount++;
+    aqmesh_texture *Texture = Cooker->Textures + Result;
+    Texture->Type = Type;
+    if (strlen(Path) >= AQMESH_MAX_PATH)
+    {
+        fprintf(stderr, "aqcube_cook: texture path too long, truncating: %s\n", Path);
+    }
+    strncpy(Texture->Path, Path, AQMESH_MAX_PATH - 1);
+
+    return Result;
+}
+
+static void CookMaterials(mesh_cooker *Cooker)
+{
+    const aiScene *Scene = Cooker->Scene;
+
+    aiTextureType SourceTypes[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR };
+    aqmesh_texture_type CookedTypes[] = { AQMeshTexture_Diffuse, AQMeshTexture_Specular };
+
+    Cooker->Header.MaterialCount = Scene->mNumMaterials;
+    for (uint32 MaterialIndex = 0; MaterialIndex < Scene->mNumMaterials; ++MaterialIndex)
+    {
+        aiMaterial *Material = Scene->mMaterials[MaterialIndex];
+        aqmesh_material *Cooked = Cooker->Materials + MaterialIndex;
+
+        for (uint32 TypeIndex = 0; TypeIndex < ArrayCount(SourceTypes); ++TypeIndex)
+        {
+            for (uint32 i = 0; i < Material->GetTextureCount(SourceTypes[TypeIndex]); ++i)
+            {
+                aiString Path;
+                Material->GetTexture(SourceTypes[TypeIndex], i, &Path);
+                if (Cooked->TextureCount < AQMESH_MAX_MATERIAL_TEXTURES)
+                {
+                    Cooked->TextureIndices[Cooked->TextureCount++] = AddTexture(Cooker, CookedTypes[TypeIndex], Path.C_Str());
+                }
+                else
+                {
+                    fprintf(stderr, "aqcube_cook: material %u has too many textures, dropping %s\n", MaterialIndex, Path.C_Str());
+                }
+            }
+        }
+    }
+}
+
+// Note(joe): Same walk as the old runtime loader, so meshes keep their draw order.
+static void CookNode(mesh_cooker *Cooker, aiNode *Node, uint32 *MeshCount, uint32 *VertexCount, uint32 *IndexCount)
+{
+    for (uint32 i = 0; i < Node->mNumMeshes; ++i)
+    {
+        aiMesh *Mesh = Cooker->Scene->mMeshes[Node->mMeshes[i]];
+        aqmesh_mesh *Cooked = Cooker->Meshes + (*MeshCount)++;
+
+        Cooked->FirstVertex = *VertexCount;
+        Cooked->VertexCount = Mesh->mNumVertices;
+        Cooked->MaterialIndex = Mesh->mMaterialIndex;
+        Cooked->LodCount = 1;
+        aqmesh_lod *Lod = Cooked->Lods;
+        Lod->FirstIndex = *IndexCount;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Cooked->BoundsMin[Axis] = 3.4e38f;
+            Cooked->BoundsMax[Axis] = -3.4e38f;
+        }
+
+        for (uint32 VertexIndex = 0; VertexIndex < Mesh->mNumVertices; ++VertexIndex)
+        {
+            aqmesh_vertex *Vertex = Cooker->Vertices + Cooked->FirstVertex + VertexIndex;
+
+            Vertex->Position[0] = Mesh->mVertices[VertexIndex].x;
+            Vertex->Position[1] = Mesh->mVertices[VertexIndex].y;
+            Vertex->Position[2] = Mesh->mVertices[VertexIndex].z;
+
+            if (Mesh->mNormals)
+            {
+                Vertex->Normal[0] = Mesh->mNormals[VertexIndex].x;
+                Vertex->Normal[1] = Mesh->mNormals[VertexIndex].y;
+                Vertex->Normal[2] = Mesh->mNormals[VertexIndex].z;
+            }
+
+            if (Mesh->mTextureCoords[0])
+            {
+                Vertex->TexCoords[0] = Mesh->mTextureCoords[0][VertexIndex].x;
+                Vertex->TexCoords[1] = Mesh->mTextureCoords[0][VertexIndex].y;
+            }
+
+            GrowBounds(Cooked->BoundsMin, Cooked->BoundsMax, Vertex->Position);
+        }
+
+        uint32 *Index = Cooker->Indices + Lod->FirstIndex;
+        for (uint32 FaceIndex = 0; FaceIndex < Mesh->mNumFaces; ++FaceIndex)
+        {
+            aiFace *Face = Mesh->mFaces + FaceIndex;
+            for (uint32 j = 0; j < Face->mNumIndices; ++j)
+            {
+                *Index++ = Face->mIndices[j];
+            }
+            Lod->IndexCount += Face->mNumIndices;
+        }
+        *IndexCount += Lod->IndexCount;
+
+        // Note(joe): Assimp hands every face corner its own vertex unless it's asked
+        // to join them, and the cooker shouldn't care which importer it got.
+        Cooked->VertexCount = WeldVertices(Cooker->Vertices + Cooked->FirstVertex, Mesh->mNumVertices,
+                                           Cooker->Indices + Lod->FirstIndex, Lod->IndexCount);
+        *VertexCount += Cooked->VertexCount;
+
+        GrowBounds(Cooker->Header.BoundsMin, Cooker->Header.BoundsMax, Cooked->BoundsMin);
+        GrowBounds(Cooker->Header.BoundsMin, Cooker->Header.BoundsMax, Cooked->BoundsMax);
+    }
+
+    for (uint32 i = 0; i < Node->mNumChildren; ++i)
+    {
+        CookNode(Cooker, Node->mChildren[i], MeshCount, VertexCount, IndexCount);
+    }
+}
+
+static bool WriteMeshFile(mesh_cooker *Cooker, char *OutputPath)
+{
+    bool Result = false;
+
+    aqmesh_header *Header = &Cooker->Header;
+    Header->TexturesOffset = sizeof(aqmesh_header);
+    Header->MaterialsOffset = Header->TexturesOffset + Header->TextureCount*sizeof(aqmesh_texture);
+    Header->MeshesOffset = Header->MaterialsOffset + Header->MaterialCount*sizeof(aqmesh_material);
+    Header->VertexDataOffset = AlignUp(Header->MeshesOffset + Header->MeshCount*sizeof(aqmesh_mesh), AQMESH_BLOB_ALIGNMENT);
+    Header->VertexDataSize = (uint64)Cooker->TotalVertexCount*Header->VertexStride;
+    Header->IndexDataOffset = AlignUp(Header->VertexDataOffset + Header->VertexDataSize, AQMESH_BLOB_ALIGNMENT);
+    Header->IndexDataSize = (uint64)Cooker->TotalIndexCount*Header->IndexSize;
+
+    FILE *File = fopen(OutputPath, "wb");
+    if (File)
+    {
+        Result = (fwrite(Header, sizeof(*Header), 1, File) == 1);
+        Result = Result && (fwrite(Cooker->Textures, sizeof(aqmesh_texture), Header->TextureCount, File) == Header->TextureCount);
+        Result = Result && (fwrite(Cooker->Materials, sizeof(aqmesh_material), Header->MaterialCount, File) == Header->MaterialCount);
+        Result = Result && (fwrite(Cooker->Meshes, sizeof(aqmesh_mesh), Header->MeshCount, File) == Header->MeshCount);
+        Result = Result && WritePadding(File, Header->VertexDataOffset);
+        Result = Result && (fwrite(Cooker->VertexData, 1, (size_t)Header->VertexDataSize, File) == Header->VertexDataSize);
+        Result = Result && WritePadding(File, Header->IndexDataOffset);
+        Result = Result && (fwrite(Cooker->IndexData, 1, (size_t)Header->IndexDataSize, File) == Header->IndexDataSize);
+        Result = (fclose(File) == 0) && Result;
+    }
+
+    return Result;
+}
+
+static int CookMesh(char *InputPath, char *OutputPath, aqmesh_vertex_format VertexFormat, bool Optimize,
+                    uint32 MaxLods, float LodRatio)
+{
+    int Result = 1;
+
+    Assimp::Importer Import;
+    const aiScene *Scene = Import.ReadFile(InputPath, aiProcess_Triangulate | aiProcess_FlipUVs);
+    if (!Scene || (Scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !Scene->mRootNode)
+    {
+        fprintf(stderr, "aqcube_cook: Assimp can't read %s: %s\n", InputPath, Import.GetErrorString());
+        return Result;
+    }
+
+    mesh_cooker Cooker = {};
+    Cooker.Scene = Scene;
+    Cooker.Header.Magic = AQMESH_MAGIC;
+    Cooker.Header.Version = AQMESH_VERSION;
+    Cooker.Header.VertexFormat = VertexFormat;
+    Cooker.Header.VertexStride = GetVertexStride(VertexFormat);
+    Cooker.Header.PositionScale = 1.0f;
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        Cooker.Header.BoundsMin[Axis] = 3.4e38f;
+        Cooker.Header.BoundsMax[Axis] = -3.4e38f;
+    }
+
+    CountNodeGeometry(&Cooker, Scene->mRootNode);
+
+    uint32 MaxTextureCount = Scene->mNumMaterials*AQMESH_MAX_MATERIAL_TEXTURES;
+    Cooker.Textures = (aqmesh_texture *)calloc(MaxTextureCount + 1, sizeof(aqmesh_texture));
+    Cooker.Materials = (aqmesh_material *)calloc(Scene->mNumMaterials + 1, sizeof(aqmesh_material));
+    Cooker.Meshes = (aqmesh_mesh *)calloc(Cooker.Header.MeshCount + 1, sizeof(aqmesh_mesh));
+    Cooker.Vertices = (aqmesh_vertex *)calloc(Cooker.TotalVertexCount + 1, sizeof(aqmesh_vertex));
+    Cooker.Indices = (uint32 *)calloc(Cooker.TotalIndexCount + 1, sizeof(uint32));
+
+    CookMaterials(&Cooker);
+
+    uint32 MeshCount = 0;
+    uint32 VertexCount = 0;
+    uint32 IndexCount = 0;
+    CookNode(&Cooker, Scene->mRootNode, &MeshCount, &VertexCount, &IndexCount);
+    assert(MeshCount == Cooker.Header.MeshCount);
+    assert(VertexCount <= Cooker.TotalVertexCount);
+    assert(IndexCount == Cooker.TotalIndexCount);
+    uint32 ImportedVertexCount = Cooker.TotalVertexCount;
+    Cooker.TotalVertexCount = VertexCount;
+
+    // Note(joe): Has to happen before packing, it moves vertices around.
+    mesh_stats *StatsBefore = 0;
+    mesh_stats *StatsAfter = 0;
+    if (Optimize)
+    {
+        StatsBefore = (mesh_stats *)calloc(Cooker.Header.MeshCount + 1, sizeof(mesh_stats));
+        StatsAfter = (mesh_stats *)calloc(Cooker.Header.MeshCount + 1, sizeof(mesh_stats));
+        for (uint32 i = 0; i < Cooker.Header.MeshCount; ++i)
+        {
+            aqmesh_mesh *Mesh = Cooker.Meshes + i;
+            aqmesh_vertex *MeshVertices = Cooker.Vertices + Mesh->FirstVertex;
+            uint32 *MeshIndices = Cooker.Indices + Mesh->Lods[0].FirstIndex;
+            uint32 MeshIndexCount = Mesh->Lods[0].IndexCount;
+            StatsBefore[i] = AnalyzeMesh(MeshVertices, Mesh->VertexCount, MeshIndices, MeshIndexCount);
+            OptimizeMesh(MeshVertices, Mesh->VertexCount, MeshIndices, MeshIndexCount);
+            StatsAfter[i] = AnalyzeMesh(MeshVertices, Mesh->VertexCount, MeshIndices, MeshIndexCount);
+        }
+    }
+
+    // Note(joe): The LODs go after their own mesh's LOD 0 in the index blob. This comes
+    // after the vertex fetch reorder, every LOD uses LOD 0's vertices.
+    if (MaxLods > 1)
+    {
+        uint32 *LodIndices = (uint32 *)calloc((size_t)Cooker.TotalIndexCount*MaxLods + 1, sizeof(uint32));
+        uint32 LodIndexCount = 0;
+        for (uint32 i = 0; i < Cooker.Header.MeshCount; ++i)
+        {
+            aqmesh_mesh *Mesh = Cooker.Meshes + i;
+            aqmesh_lod *Full = Mesh->Lods;
+            Mesh->LodCount = BuildLodChain(Cooker.Vertices + Mesh->FirstVertex, Mesh->VertexCount,
+                                           Cooker.Indices + Full->FirstIndex, Full->IndexCount,
+                                           MaxLods, LodRatio, LodIndices + LodIndexCount, Mesh->Lods);
+            for (uint32 LodIndex = 0; LodIndex < Mesh->LodCount; ++LodIndex)
+            {
+                Mesh->Lods[LodIndex].FirstIndex += LodIndexCount;
+            }
+            LodIndexCount = Mesh->Lods[Mesh->LodCount - 1].FirstIndex + Mesh->Lods[Mesh->LodCount - 1].IndexCount;
+        }
+
+        free(Cooker.Indices);
+        Cooker.Indices = LodIndices;
+        Cooker.TotalIndexCount = LodIndexCount;
+    }
+
+    Cooker.VertexData = Cooker.Vertices;
+    aqmesh_packed_vertex *PackedVertices = 0;
+    vertex_packing_error *PackingErrors = 0;
+    if (VertexFormat == AQMeshVertex_Packed)
+    {
+        PackedVertices = (aqmesh_packed_vertex *)calloc(Cooker.TotalVertexCount + 1, sizeof(aqmesh_packed_vertex));
+        PackingErrors = (vertex_packing_error *)calloc(Cooker.Header.MeshCount + 1, sizeof(vertex_packing_error));
+        PackVertices(&Cooker.Header, Cooker.Meshes, Cooker.Vertices, PackedVertices, PackingErrors);
+        Cooker.VertexData = PackedVertices;
+    }
+
+    // Note(joe): Indices only ever reach as far as their own mesh.
+    Cooker.Header.IndexSize = sizeof(uint16);
+    for (uint32 i = 0; i < Cooker.Header.MeshCount; ++i)
+    {
+        if (Cooker.Meshes[i].VertexCount >= 65536)
+        {
+            Cooker.Header.IndexSize = sizeof(uint32);
+        }
+    }
+    Cooker.IndexData = Cooker.Indices;
+    uint16 *ShortIndices = 0;
+    if (Cooker.Header.IndexSize == sizeof(uint16))
+    {
+        ShortIndices = (uint16 *)calloc(Cooker.TotalIndexCount + 1, sizeof(uint16));
+        for (uint32 i = 0; i < Cooker.TotalIndexCount; ++i)
+        {
+            ShortIndices[i] = (uint16)Cooker.Indices[i];
+        }
+        Cooker.IndexData = ShortIndices;
+    }
+
+    if (WriteMeshFile(&Cooker, OutputPath))
+    {
+        uint64 FloatSize = (uint64)Cooker.TotalVertexCount*sizeof(aqmesh_vertex) + (uint64)Cooker.TotalIndexCount*sizeof(uint32);
+        uint64 CookedSize = Cooker.Header.VertexDataSize + Cooker.Header.IndexDataSize;
+        printf("%s: %u meshes, %u materials, %u textures, %u vertices (%u imported), %u indices\n",
+               OutputPath, Cooker.Header.MeshCount, Cooker.Header.MaterialCount, Cooker.Header.TextureCount,
+               Cooker.TotalVertexCount, ImportedVertexCount, Cooker.TotalIndexCount);
+        printf("  %s vertices (%u bytes), %u bit indices, %llu KB of geometry (%.2fx smaller than float)\n",
+               (VertexFormat == AQMeshVertex_Packed) ? "packed" : "float", Cooker.Header.VertexStride,
+               Cooker.Header.IndexSize*8, (unsigned long long)(CookedSize / 1024), (double)FloatSize / (double)CookedSize);
+        if (StatsBefore)
+        {
+            for (uint32 i = 0; i < Cooker.Header.MeshCount; ++i)
+            {
+                printf("  mesh %u: %u triangles, acmr %.3f -> %.3f, atvr %.3f -> %.3f, overdraw %.3f -> %.3f\n",
+                       i, Cooker.Meshes[i].Lods[0].IndexCount / 3, StatsBefore[i].ACMR, StatsAfter[i].ACMR,
+                       StatsBefore[i].ATVR, StatsAfter[i].ATVR, StatsBefore[i].Overdraw, StatsAfter[i].Overdraw);
+            }
+        }
+        for (uint32 i = 0; i < Cooker.Header.MeshCount; ++i)
+        {
+            aqmesh_mesh *Mesh = Cooker.Meshes + i;
+            if (Mesh->LodCount > 1)
+            {
+                printf("  mesh %u lods:", i);
+                for (uint32 LodIndex = 0; LodIndex < Mesh->LodCount; ++LodIndex)
+                {
+                    printf(" %u (%.5f)", Mesh->Lods[LodIndex].IndexCount / 3, Mesh->Lods[LodIndex].Error);
+                }
+                printf("\n");
+            }
+        }
+        if (PackingErrors)
+        {
+            for (uint32 i = 0; i < Cooker.Header.MeshCount; ++i)
+            {
+                printf("  mesh %u: %u vertices, max error position %.6f (step %.6f), normal %.4f deg, uv %.6f\n",
+                       i, Cooker.Meshes[i].VertexCount, PackingErrors[i].Position, Cooker.Header.PositionScale / 65535.0f,
+                       PackingErrors[i].Normal, PackingErrors[i].TexCoord);
+            }
+        }
+        Result = 0;
+    }
+    else
+    {
+        fprintf(stderr, "aqcube_cook: can't write %s\n", OutputPath);
+    }
+
+    free(Cooker.Textures);
+    free(Cooker.Materials);
+    free(Cooker.Meshes);
+    free(Cooker.Vertices);
+    free(Cooker.Indices);
+    free(PackedVertices);
+    free(PackingErrors);
+    free(StatsBefore);
+    free(StatsAfter);
+    free(ShortIndices);
+
+    return Result;
+}
+
+#endif
+
+//
+// Texture cooking
+//
+
+static texture_block_format ChooseBlockFormat(uint8 *Pixels, uint32 PixelCount, int SourceComponentCount)
+{
+    texture_block_format Result = BlockFormat_BC1;
+
+    // Note(joe): Pixels always come in as RGBA, grey + alpha sources as grey copied
+    // into RGB. A grey + alpha file with nothing in the alpha channel is just grey.
+    if (SourceComponentCount == 1 || SourceComponentCount == 2)
+    {
+        Result = BlockFormat_BC4;
+    }
+    if (SourceComponentCount == 2 || SourceComponentCount == 4)
+    {
+        // Note(joe): Plenty of RGBA files have nothing in the alpha channel.
+        for (uint32 PixelIndex = 0; PixelIndex < PixelCount; ++PixelIndex)
+        {
+            if (Pixels[PixelIndex*4 + 3] != 255)
+            {
+                Result = BlockFormat_BC3;
+                break;
+            }
+        }
+    }
+
+    return Result;
+}
+
+static bool WriteDDSFile(char *OutputPath, texture_block_format Format, bool IsSRGB, uint32 Width, uint32 Height,
+                         uint32 LevelCount, uint8 *Data, uint64 DataSize)
+{
+    bool Result = false;
+
+    dds_header Header = {};
+    Header.Size = sizeof(dds_header);
+    Header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    Header.Height = Height;
+    Header.Width = Width;
+    Header.PitchOrLinearSize = GetCompressedLevelSize(Format, Width, Height);
+    Header.MipMapCount = LevelCount;
+    Header.PixelFormat.Size = sizeof(dds_pixel_format);
+    Header.PixelFormat.Flags = DDPF_FOURCC;
+    Header.Caps = DDSCAPS_TEXTURE | ((LevelCount > 1) ? (DDSCAPS_MIPMAP | DDSCAPS_COMPLEX) : 0);
+
+    // Note(joe): The legacy FourCCs can't say sRGB, those need the DX10 header.
+    dds_header_dx10 HeaderDX10 = {};
+    if (IsSRGB)
+    {
+        Header.PixelFormat.FourCC = DDS_FOURCC('D', 'X', '1', '0');
+        HeaderDX10.DXGIFormat = (Format == BlockFormat_BC3) ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM_SRGB;
+        HeaderDX10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+        HeaderDX10.ArraySize = 1;
+    }
+    else
+    {
+        switch (Format)
+        {
+            case BlockFormat_BC1: { Header.PixelFormat.FourCC = DDS_FOURCC('D', 'X', 'T', '1'); } break;
+            case BlockFormat_BC3: { Header.PixelFormat.FourCC = DDS_FOURCC('D', 'X', 'T', '5'); } break;
+            case BlockFormat_BC4: { Header.PixelFormat.FourCC = DDS_FOURCC('A', 'T', 'I', '1'); } break;
+            case BlockFormat_BC5: { Header.PixelFormat.FourCC = DDS_FOURCC('A', 'T', 'I', '2'); } break;
+        }
+    }
+
+    FILE *File = fopen(OutputPath, "wb");
+    if (File)
+    {
+        uint32 Magic = DDS_MAGIC;
+        Result = (fwrite(&Magic, sizeof(Magic), 1, File) == 1);
+        Result = Result && (fwrite(&Header, sizeof(Header), 1, File) == 1);
+        if (IsSRGB)
+        {
+            Result = Result && (fwrite(&HeaderDX10, sizeof(HeaderDX10), 1, File) == 1);
+        }
+        Result = Result && (fwrite(Data, 1, (size_t)DataSize, File) == DataSize);
+        Result = (fclose(File) == 0) && Result;
+    }
+
+    return Result;
+}
+
+static int CookTexture(char *InputPath, char *OutputPath, char *FormatName, char *FilterName,
+                       bool IsSRGB, bool IsNormalMap, bool IsLinear)
+{
+    int Result = 1;
+
+    int Width, Height, SourceComponentCount;
+    uint8 *Pixels = stbi_load(InputPath, &Width, &Height, &SourceComponentCount, 4);
+    if (!Pixels)
+    {
+        fprintf(stderr, "aqcube_cook: can't read %s: %s\n", InputPath, stbi_failure_reason());
+        return Result;
+    }
+
+    texture_block_format Format = IsNormalMap ? BlockFormat_BC5 : ChooseBlockFormat(Pixels, (uint32)(Width*Height), SourceComponentCount);
+    if (strcmp(FormatName, "bc1") == 0) Format = BlockFormat_BC1;
+    else if (strcmp(FormatName, "bc3") == 0) Format = BlockFormat_BC3;
+    else if (strcmp(FormatName, "bc4") == 0) Format = BlockFormat_BC4;
+    else if (strcmp(FormatName, "bc5") == 0) Format = BlockFormat_BC5;
+    else if (strcmp(FormatName, "auto") != 0)
+    {
+        fprintf(stderr, "aqcube_cook: unknown texture format %s\n", FormatName);
+        stbi_image_free(Pixels);
+        return Result;
+    }
+
+    mip_filter Filter = MipFilter_Kaiser;
+    if (strcmp(FilterName, "box") == 0) Filter = MipFilter_Box;
+    else if (strcmp(FilterName, "lanczos") == 0) Filter = MipFilter_Lanczos;
+    else if (strcmp(FilterName, "kaiser") != 0)
+    {
+        fprintf(stderr, "aqcube_cook: unknown mip filter %s\n", FilterName);
+        stbi_image_free(Pixels);
+        return Result;
+    }
+
+    // Note(joe): Colour maps are assumed to be authored in sRGB whether or not the
+    // GL format says so, and get filtered in linear light. BC4/BC5 only ever hold
+    // data, as does anything cooked with --linear.
+    mip_content Content = MipContent_SRGB;
+    if (IsNormalMap)
+    {
+        Content = MipContent_Normal;
+    }
+    else if (IsLinear || (!IsSRGB && (Format == BlockFormat_BC4 || Format == BlockFormat_BC5)))
+    {
+        Content = MipContent_Linear;
+    }
+
+    if (IsSRGB && (Format == BlockFormat_BC4 || Format == BlockFormat_BC5))
+    {
+        fprintf(stderr, "aqcube_cook: BC4/BC5 have no sRGB variant, writing linear\n");
+        IsSRGB = false;
+    }
+
+    // Note(joe): Build every level up front, then compress them one at a time.
+    uint32 LevelCount = GetMipLevelCount((uint32)Width, (uint32)Height);
+    uint8 *Levels = (uint8 *)malloc((size_t)GetMipChainSize((uint32)Width, (uint32)Height, 4));
+    void *Scratch = malloc((size_t)GetMipScratchSize((uint32)Width, (uint32)Height));
+    BuildMipChain(Pixels, (uint32)Width, (uint32)Height, 4, Filter, Content, Levels, Scratch);
+
+    uint64 CompressedSize = 0;
+    for (uint32 LevelIndex = 0, LevelWidth = (uint32)Width, LevelHeight = (uint32)Height;
+         LevelIndex < LevelCount;
+         ++LevelIndex, LevelWidth = GetNextMipSize(LevelWidth), LevelHeight = GetNextMipSize(LevelHeight))
+    {
+        CompressedSize += GetCompressedLevelSize(Format, LevelWidth, LevelHeight);
+    }
+
+    uint8 *Compressed = (uint8 *)malloc((size_t)CompressedSize);
+    uint8 *Level = Levels;
+    uint8 *Output = Compressed;
+    for (uint32 LevelIndex = 0, LevelWidth = (uint32)Width, LevelHeight = (uint32)Height;
+         LevelIndex < LevelCount;
+         ++LevelIndex, LevelWidth = GetNextMipSize(LevelWidth), LevelHeight = GetNextMipSize(LevelHeight))
+    {
+        CompressImage(Format, Level, LevelWidth, LevelHeight, Output);
+        Level += LevelWidth*LevelHeight*4;
+        Output += GetCompressedLevelSize(Format, LevelWidth, LevelHeight);
+    }
+    assert(Output == Compressed + CompressedSize);
+
+    if (WriteDDSFile(OutputPath, Format, IsSRGB, (uint32)Width, (uint32)Height, LevelCount, Compressed, CompressedSize))
+    {
+        char *FormatNames[] = { "BC1", "BC3", "BC4", "BC5" };
+        char *ContentNames[] = { "linear", "sRGB", "normal" };
+        printf("%s: %dx%d %s%s, %u levels (%s, %s), %llu bytes (%.1fx smaller than RGBA8)\n",
+               OutputPath, Width, Height, FormatNames[Format], IsSRGB ? " sRGB" : "", LevelCount,
+               FilterName, ContentNames[Content],
+               (unsigned long long)CompressedSize, (double)Width*Height*4*4/3 / (double)CompressedSize);
+        Result = 0;
+    }
+    else
+    {
+        fprintf(stderr, "aqcube_cook: can't write %s\n", OutputPath);
+    }
+
+    free(Scratch);
+    free(Levels);
+    free(Compressed);
+    stbi_image_free(Pixels);
+
+    return Result;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: aqcube_cook mesh <input model> <output.aqmesh> [--vertex-format packed|float] [--no-optimize]\n"
+            "                        [--lods N] [--lod-ratio R]\n"
+            "       aqcube_cook texture <input image> <output.dds> [--format auto|bc1|bc3|bc4|bc5]\n"
+            "                           [--filter box|kaiser|lanczos] [--srgb] [--normal] [--linear]\n");
+}
+
+int main(int ArgCount, char **Args)
+{
+    int Result = 1;
+
+    if (ArgCount >= 4 && strcmp(Args[1], "mesh") == 0)
+    {
+#if COOK_MESHES
+        aqmesh_vertex_format VertexFormat = AQMeshVertex_Packed;
+        bool Optimize = true;
+        uint32 MaxLods = 4;
+        float LodRatio = 0.5f;
+        bool ValidArgs = true;
+        for (int ArgIndex = 4; ArgIndex < ArgCount; ++ArgIndex)
+        {
+            if (strcmp(Args[ArgIndex], "--vertex-format") == 0 && ArgIndex + 1 < ArgCount)
+            {
+                char *FormatName = Args[++ArgIndex];
+                if (strcmp(FormatName, "float") == 0) VertexFormat = AQMeshVertex_Float;
+                else if (strcmp(FormatName, "packed") != 0) ValidArgs = false;
+            }
+            else if (strcmp(Args[ArgIndex], "--no-optimize") == 0)
+            {
+                Optimize = false;
+            }
+            else if (strcmp(Args[ArgIndex], "--lods") == 0 && ArgIndex + 1 < ArgCount)
+            {
+                int LodCount = atoi(Args[++ArgIndex]);
+                ValidArgs = ValidArgs && (LodCount >= 1 && LodCount <= AQMESH_MAX_LODS);
+                MaxLods = (uint32)LodCount;
+            }
+            else if (strcmp(Args[ArgIndex], "--lod-ratio") == 0 && ArgIndex + 1 < ArgCount)
+            {
+                LodRatio = (float)atof(Args[++ArgIndex]);
+                ValidArgs = ValidArgs && (LodRatio > 0.0f && LodRatio < 1.0f);
+            }
+            else
+            {
+                ValidArgs = false;
+            }
+        }
+
+        if (ValidArgs)
+        {
+            Result = CookMesh(Args[2], Args[3], VertexFormat, Optimize, MaxLods, LodRatio);
+        }
+        else
+        {
+            PrintUsage();
+        }
+#else
+        fprintf(stderr, "aqcube_cook: built without mesh cooking (COOK_MESHES=0)\n");
+#endif
+    }
+    else if (ArgCount >= 4 && strcmp(Args[1], "texture") == 0)
+    {
+        char *FormatName = "auto";
+        char *FilterName = "kaiser";
+        bool IsSRGB = false;
+        bool IsNormalMap = false;
+        bool IsLinear = false;
+        bool ValidArgs = true;
+        for (int ArgIndex = 4; ArgIndex < ArgCount; ++ArgIndex)
+        {
+            if (strcmp(Args[ArgIndex], "--format") == 0 && ArgIndex + 1 < ArgCount)
+            {
+                FormatName = Args[++ArgIndex];
+            }
+            else if (strcmp(Args[ArgIndex], "--filter") == 0 && ArgIndex + 1 < ArgCount)
+            {
+                FilterName = Args[++ArgIndex];
+            }
+            else if (strcmp(Args[ArgIndex], "--srgb") == 0)
+            {
+                IsSRGB = true;
+            }
+            else if (strcmp(Args[ArgIndex], "--normal") == 0)
+            {
+                IsNormalMap = true;
+            }
+            else if (strcmp(Args[ArgIndex], "--linear") == 0)
+            {
+                IsLinear = true;
+            }
+            else
+            {
+                ValidArgs = false;
+            }
+        }
+
+        if (ValidArgs)
+        {
+            Result = CookTexture(Args[2], Args[3], FormatName, FilterName, IsSRGB, IsNormalMap, IsLinear);
+        }
+        else
+        {
+            PrintUsage();
+        }
+    }
+    else
+    {
+        PrintUsage();
+    }
+
+    return Result;
+}
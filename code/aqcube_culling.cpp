@@ -0,0 +1,250 @@
+//
+// Frustum culling
+//
+// Note(joe): Everything a scene might draw goes into a cull_bounds each frame as a
+// world space box, its centre and half extents, plus the radius of a sphere around
+// the same centre. The radius comes from the real vertices at load time, so for
+// something rotated it's usually tighter than the box, which has to grow to stay
+// axis aligned. Against each plane an object reaches whichever of the two is less.
+//
+// The bounds are kept structure of arrays so the test runs down 8 objects at a time
+// with AVX or 4 with SSE2, every plane's coefficients broadcast across the lanes.
+// What's left is written out as a list of indices, in order.
+//
+
+#include "aqcube_simd.h"
+
+// Note(joe): Arrays are padded to this many objects, enough for the widest path.
+#define CULL_LANE_COUNT 8
+
+struct frustum
+{
+    // Note(joe): ax + by + cz + d >= 0 is inside. Normalised, so d is a distance.
+    glm::vec4 Planes[6];
+};
+
+// Note(joe): Gribb and Hartmann, the planes are sums and differences of the rows of
+// the view projection matrix. They come out in whatever space the matrix takes
+// points from, world space for Projection*View.
+static frustum ExtractFrustum(glm::mat4 &ViewProjection)
+{
+    frustum Result;
+    glm::vec4 Rows[4];
+    for (int Row = 0; Row < 4; ++Row)
+    {
+        Rows[Row] = glm::vec4(ViewProjection[0][Row], ViewProjection[1][Row], ViewProjection[2][Row], ViewProjection[3][Row]);
+    }
+
+    Result.Planes[0] = Rows[3] + Rows[0]; // Left
+    Result.Planes[1] = Rows[3] - Rows[0]; // Right
+    Result.Planes[2] = Rows[3] + Rows[1]; // Bottom
+    Result.Planes[3] = Rows[3] - Rows[1]; // Top
+    Result.Planes[4] = Rows[3] + Rows[2]; // Near
+    Result.Planes[5] = Rows[3] - Rows[2]; // Far
+    for (int PlaneIndex = 0; PlaneIndex < 6; ++PlaneIndex)
+    {
+        Result.Planes[PlaneIndex] /= glm::length(glm::vec3(Result.Planes[PlaneIndex]));
+    }
+
+    return Result;
+}
+
+struct cull_bounds
+{
+    uint32 Count;
+    uint32 MaxCount;
+
+    float *CenterX;
+    float *CenterY;
+    float *CenterZ;
+    float *ExtentX;
+    float *ExtentY;
+    float *ExtentZ;
+    float *Radius;
+};
+
+inline uint32 GetCullPaddedCount(uint32 Count)
+{
+    return (Count + CULL_LANE_COUNT - 1) & ~(CULL_LANE_COUNT - 1);
+}
+
+// Note(joe): Room for MaxCount objects. A visible list to go with it needs
+// GetCullPaddedCount(MaxCount) entries, the SIMD paths write a whole group at once.
+static void BeginCullBounds(cull_bounds *Bounds, memory_arena *Arena, uint32 MaxCount)
+{
+    uint32 PaddedCount = GetCullPaddedCount(MaxCount);
+    float **Arrays[] = { &Bounds->CenterX, &Bounds->CenterY, &Bounds->CenterZ,
+                         &Bounds->ExtentX, &Bounds->ExtentY, &Bounds->ExtentZ, &Bounds->Radius };
+    for (int ArrayIndex = 0; ArrayIndex < ArrayCount(Arrays); ++ArrayIndex)
+    {
+        *Arrays[ArrayIndex] = (float *)PushSizeAligned(Arena, PaddedCount*sizeof(float), 32);
+    }
+    Bounds->Count = 0;
+    Bounds->MaxCount = MaxCount;
+}
+
+inline void PushCullBounds(cull_bounds *Bounds, glm::vec3 Center, glm::vec3 Extent, float Radius)
+{
+    assert(Bounds->Count < Bounds->MaxCount);
+    uint32 Index = Bounds->Count++;
+    Bounds->CenterX[Index] = Center.x;
+    Bounds->CenterY[Index] = Center.y;
+    Bounds->CenterZ[Index] = Center.z;
+    Bounds->ExtentX[Index] = Extent.x;
+    Bounds->ExtentY[Index] = Extent.y;
+    Bounds->ExtentZ[Index] = Extent.z;
+    Bounds->Radius[Index] = Radius;
+}
+
+// Note(joe): Takes local bounds through Transform. The box grows to hold the
+// transformed one, the sphere scales by the largest axis scale.
+inline void PushCullBounds(cull_bounds *Bounds, glm::mat4 &Transform, glm::vec3 BoundsMin, glm::vec3 BoundsMax, float Radius)
+{
+    glm::vec3 LocalCenter = 0.5f*(BoundsMin + BoundsMax);
+    glm::vec3 LocalExtent = 0.5f*(BoundsMax - BoundsMin);
+    glm::vec3 Center = glm::vec3(Transform*glm::vec4(LocalCenter, 1.0f));
+
+    glm::vec3 X(Transform[0]);
+    glm::vec3 Y(Transform[1]);
+    glm::vec3 Z(Transform[2]);
+    glm::vec3 Extent = glm::abs(X)*LocalExtent.x + glm::abs(Y)*LocalExtent.y + glm::abs(Z)*LocalExtent.z;
+    float Scale = glm::max(glm::length(X), glm::max(glm::length(Y), glm::length(Z)));
+
+    PushCullBounds(Bounds, Center, Extent, Scale*Radius);
+}
+
+// Note(joe): One object against every plane, the SIMD paths do exactly this in the
+// same order so they agree to the bit.
+inline bool IsInFrustum(frustum *Frustum, cull_bounds *Bounds, uint32 Index)
+{
+    bool Result = true;
+    for (int PlaneIndex = 0; PlaneIndex < 6; ++PlaneIndex)
+    {
+        glm::vec4 Plane = Frustum->Planes[PlaneIndex];
+        float Distance = Plane.x*Bounds->CenterX[Index] + Plane.y*Bounds->CenterY[Index] + Plane.z*Bounds->CenterZ[Index] + Plane.w;
+        float BoxReach = fabsf(Plane.x)*Bounds->ExtentX[Index] + fabsf(Plane.y)*Bounds->ExtentY[Index] + fabsf(Plane.z)*Bounds->ExtentZ[Index];
+        float Reach = (BoxReach < Bounds->Radius[Index]) ? BoxReach : Bounds->Radius[Index];
+        Result = Result && (Distance + Reach >= 0.0f);
+    }
+    return Result;
+}
+
+static uint32 CullBoundsScalar(frustum *Frustum, cull_bounds *Bounds, uint32 *Visible)
+{
+    uint32 VisibleCount = 0;
+    for (uint32 Index = 0; Index < Bounds->Count; ++Index)
+    {
+        if (IsInFrustum(Frustum, Bounds, Index))
+        {
+            Visible[VisibleCount++] = Index;
+        }
+    }
+    return VisibleCount;
+}
+
+// Note(joe): How many objects the cull below does at once.
+inline uint32 GetCullWidth()
+{
+#if AQCUBE_AVX
+    return 8;
+#elif AQCUBE_SSE2
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+// Note(joe): Writes the indices of everything that might be in view to Visible, in
+// order, and returns how many there are. Each group's indices get written whether
+// they're in or not and the count only moves past the ones that are, so there's no
+// branch per object.
+static uint32 CullBounds(frustum *Frustum, cull_bounds *Bounds, uint32 *Visible)
+{
+    TIMED_FUNCTION();
+
+    uint32 VisibleCount = 0;
+    uint32 Count = Bounds->Count;
+
+#if AQCUBE_AVX
+    for (uint32 First = 0; First < Count; First += 8)
+    {
+        __m256 CenterX = _mm256_load_ps(Bounds->CenterX + First);
+        __m256 CenterY = _mm256_load_ps(Bounds->CenterY + First);
+        __m256 CenterZ = _mm256_load_ps(Bounds->CenterZ + First);
+        __m256 ExtentX = _mm256_load_ps(Bounds->ExtentX + First);
+        __m256 ExtentY = _mm256_load_ps(Bounds->ExtentY + First);
+        __m256 ExtentZ = _mm256_load_ps(Bounds->ExtentZ + First);
+        __m256 Radius = _mm256_load_ps(Bounds->Radius + First);
+
+        __m256 Inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int PlaneIndex = 0; PlaneIndex < 6; ++PlaneIndex)
+        {
+            glm::vec4 Plane = Frustum->Planes[PlaneIndex];
+            __m256 Distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(Plane.x), CenterX),
+                                                                        _mm256_mul_ps(_mm256_set1_ps(Plane.y), CenterY)),
+                                                          _mm256_mul_ps(_mm256_set1_ps(Plane.z), CenterZ)),
+                                            _mm256_set1_ps(Plane.w));
+            __m256 BoxReach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fabsf(Plane.x)), ExtentX),
+                                                          _mm256_mul_ps(_mm256_set1_ps(fabsf(Plane.y)), ExtentY)),
+                                            _mm256_mul_ps(_mm256_set1_ps(fabsf(Plane.z)), ExtentZ));
+            __m256 Reach = _mm256_min_ps(BoxReach, Radius);
+            Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(_mm256_add_ps(Distance, Reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        uint32 Mask = (uint32)_mm256_movemask_ps(Inside);
+        if (Count - First < 8)
+        {
+            Mask &= (1u << (Count - First)) - 1;
+        }
+        for (uint32 Lane = 0; Lane < 8; ++Lane)
+        {
+            Visible[VisibleCount] = First + Lane;
+            VisibleCount += (Mask >> Lane) & 1;
+        }
+    }
+#elif AQCUBE_SSE2
+    for (uint32 First = 0; First < Count; First += 4)
+    {
+        __m128 CenterX = _mm_load_ps(Bounds->CenterX + First);
+        __m128 CenterY = _mm_load_ps(Bounds->CenterY + First);
+        __m128 CenterZ = _mm_load_ps(Bounds->CenterZ + First);
+        __m128 ExtentX = _mm_load_ps(Bounds->ExtentX + First);
+        __m128 ExtentY = _mm_load_ps(Bounds->ExtentY + First);
+        __m128 ExtentZ = _mm_load_ps(Bounds->ExtentZ + First);
+        __m128 Radius = _mm_load_ps(Bounds->Radius + First);
+
+        __m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int PlaneIndex = 0; PlaneIndex < 6; ++PlaneIndex)
+        {
+            glm::vec4 Plane = Frustum->Planes[PlaneIndex];
+            __m128 Distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Plane.x), CenterX),
+                                                               _mm_mul_ps(_mm_set1_ps(Plane.y), CenterY)),
+                                                    _mm_mul_ps(_mm_set1_ps(Plane.z), CenterZ)),
+                                         _mm_set1_ps(Plane.w));
+            __m128 BoxReach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(Plane.x)), ExtentX),
+                                                    _mm_mul_ps(_mm_set1_ps(fabsf(Plane.y)), ExtentY)),
+                                         _mm_mul_ps(_mm_set1_ps(fabsf(Plane.z)), ExtentZ));
+            __m128 Reach = _mm_min_ps(BoxReach, Radius);
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(Distance, Reach), _mm_setzero_ps()));
+        }
+
+        uint32 Mask = (uint32)_mm_movemask_ps(Inside);
+        if (Count - First < 4)
+        {
+            Mask &= (1u << (Count - First)) - 1;
+        }
+        for (uint32 Lane = 0; Lane < 4; ++Lane)
+        {
+            Visible[VisibleCount] = First + Lane;
+            VisibleCount += (Mask >> Lane) & 1;
+        }
+    }
+#else
+    VisibleCount = CullBoundsScalar(Frustum, Bounds, Visible);
+#endif
+
+    GlobalRenderStats.ObjectsTested += Count;
+    GlobalRenderStats.ObjectsVisible += VisibleCount;
+
+    return VisibleCount;
+}
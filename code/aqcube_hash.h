@@ -0,0 +1,99 @@
+#pragma once
+
+// Note(joe): Content hashing for the caches that key on what's in a file rather
+// than its name or timestamp.
+
+inline uint64 RotateLeft64(uint64 Value, int Shift)
+{
+    uint64 Result = (Value << Shift) | (Value >> (64 - Shift));
+    return Result;
+}
+
+#define HASH_PRIME64_1 11400714785074694791ULL
+#define HASH_PRIME64_2 14029467366897019727ULL
+#define HASH_PRIME64_3 1609587929392839161ULL
+#define HASH_PRIME64_4 9650029242287828579ULL
+#define HASH_PRIME64_5 2870177450012600261ULL
+
+inline uint64 HashRound(uint64 Accumulator, uint64 Input)
+{
+    Accumulator += Input*HASH_PRIME64_2;
+    Accumulator = RotateLeft64(Accumulator, 31);
+    Accumulator *= HASH_PRIME64_1;
+    return Accumulator;
+}
+
+inline uint64 HashMerge(uint64 Accumulator, uint64 Value)
+{
+    Accumulator ^= HashRound(0, Value);
+    Accumulator = Accumulator*HASH_PRIME64_1 + HASH_PRIME64_4;
+    return Accumulator;
+}
+
+// Note(joe): xxHash64. Runs at several GB/s, so hashing a whole source file to use
+// as a cache key costs next to nothing. Chain calls through Seed to hash several
+// pieces into one key.
+inline uint64 HashBytes(void *Memory, uint64 Size, uint64 Seed)
+{
+    uint8 *At = (uint8 *)Memory;
+    uint8 *End = At + Size;
+    uint64 Result;
+
+    if (Size >= 32)
+    {
+        uint64 V1 = Seed + HASH_PRIME64_1 + HASH_PRIME64_2;
+        uint64 V2 = Seed + HASH_PRIME64_2;
+        uint64 V3 = Seed;
+        uint64 V4 = Seed - HASH_PRIME64_1;
+        while (At + 32 <= End)
+        {
+            uint64 Lanes[4];
+            memcpy(Lanes, At, 32);
+            V1 = HashRound(V1, Lanes[0]);
+            V2 = HashRound(V2, Lanes[1]);
+            V3 = HashRound(V3, Lanes[2]);
+            V4 = HashRound(V4, Lanes[3]);
+            At += 32;
+        }
+        Result = RotateLeft64(V1, 1) + RotateLeft64(V2, 7) + RotateLeft64(V3, 12) + RotateLeft64(V4, 18);
+        Result = HashMerge(Result, V1);
+        Result = HashMerge(Result, V2);
+        Result = HashMerge(Result, V3);
+        Result = HashMerge(Result, V4);
+    }
+    else
+    {
+        Result = Seed + HASH_PRIME64_5;
+    }
+
+    Result += Size;
+    while (At + 8 <= End)
+    {
+        uint64 Lane;
+        memcpy(&Lane, At, 8);
+        Result ^= HashRound(0, Lane);
+        Result = RotateLeft64(Result, 27)*HASH_PRIME64_1 + HASH_PRIME64_4;
+        At += 8;
+    }
+    if (At + 4 <= End)
+    {
+        uint32 Lane;
+        memcpy(&Lane, At, 4);
+        Result ^= (uint64)Lane*HASH_PRIME64_1;
+        Result = RotateLeft64(Result, 23)*HASH_PRIME64_2 + HASH_PRIME64_3;
+        At += 4;
+    }
+    while (At < End)
+    {
+        Result ^= (*At++)*HASH_PRIME64_5;
+        Result = RotateLeft64(Result, 11)*HASH_PRIME64_1;
+    }
+
+    Result ^= Result >> 33;
+    Result *= HASH_PRIME64_2;
+    Result ^= Result >> 29;
+    Result *= HASH_PRIME64_3;
+    Result ^= Result >> 32;
+
+    return Result;
+}
@@ -0,0 +1,256 @@
+// Note(joe): Image loading shared by the hosts. stb_image allocates out of the arena
+// handed to DEBUGLoadImage, so a decode never touches the heap. Whatever it leaves
+// behind (including the pixels) goes away when the caller's temporary memory ends,
+// which is why STBI_FREE does nothing.
+//
+// Decodes can run on the worker threads, each with its own arena, so the arena
+// stb allocates from is per thread. stb's failure reason is still one global, so
+// with several decodes going the message may belong to a different file.
+
+static thread_local memory_arena *GlobalImageArena;
+
+static void *ImageAlloc(size_t Size)
+{
+    void *Result = PushSize(GlobalImageArena, Size);
+    return Result;
+}
+
+static void *ImageRealloc(void *Memory, size_t OldSize, size_t NewSize)
+{
+    void *Result = 0;
+
+    if (!Memory)
+    {
+        Result = ImageAlloc(NewSize);
+    }
+    else if (GrowLastPush(GlobalImageArena, Memory, OldSize, NewSize))
+    {
+        Result = Memory;
+    }
+    else
+    {
+        Result = ImageAlloc(NewSize);
+        if (Result)
+        {
+            memcpy(Result, Memory, (OldSize < NewSize) ? OldSize : NewSize);
+        }
+    }
+
+    return Result;
+}
+
+#define STBI_MALLOC(Size) ImageAlloc(Size)
+#define STBI_REALLOC_SIZED(Memory, OldSize, NewSize) ImageRealloc(Memory, OldSize, NewSize)
+#define STBI_FREE(Memory) ((void)(Memory))
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Note(joe): stb_image builds its fixed Huffman tables the first time it sees a
+// deflate block that uses them. Do that up front so the workers don't race on it.
+static void PrepareImageDecodeForThreads()
+{
+    if (!stbi__zdefault_distance[31])
+    {
+        stbi__init_zdefaults();
+    }
+}
+
+// Note(joe): This stb has no stbi_is_16_bit, so ask its PNG header parser directly.
+// It reads IHDR without allocating, anything that isn't a PNG just fails the check.
+static bool IsSixteenBitPNG(mapped_file *File)
+{
+    stbi__context Context;
+    stbi__start_mem(&Context, (stbi_uc *)File->Memory, (int)File->Size);
+    stbi__png PNG;
+    PNG.s = &Context;
+    bool Result = stbi__png_info_raw(&PNG, 0, 0, 0) && (PNG.depth == 16);
+    return Result;
+}
+
+// Note(joe): How much arena a decode of File can use, worked out from the header.
+// The 8 bit PNG and JPEG paths peak at the compressed data plus about three copies
+// of the pixels, so this leaves some slack on top. 16 bit PNGs inflate and unfilter
+// at two bytes a component before stb narrows them, so they get twice the pixels.
+// 0 means stb can't read it.
+static uint64 GetImageDecodeSize(memory_arena *Arena, mapped_file *File)
+{
+    uint64 Result = 0;
+
+    if (File->Memory)
+    {
+        // Note(joe): The JPEG header parser allocates its decoder state.
+        temporary_memory InfoMemory = BeginTemporaryMemory(Arena);
+        GlobalImageArena = Arena;
+        int Width, Height, ComponentCount;
+        if (stbi_info_from_memory((stbi_uc *)File->Memory, (int)File->Size, &Width, &Height, &ComponentCount))
+        {
+            uint64 BytesPerComponent = IsSixteenBitPNG(File) ? 2 : 1;
+            Result = File->Size + 4*BytesPerComponent*(uint64)Width*(uint64)Height*(uint64)ComponentCount + Kilobytes(256);
+        }
+        GlobalImageArena = 0;
+        EndTemporaryMemory(InfoMemory);
+    }
+
+    return Result;
+}
+
+static loaded_image DecodeImage(memory_arena *Arena, mapped_file *File)
+{
+    TIMED_FUNCTION();
+
+    loaded_image Result = {};
+
+    GlobalImageArena = Arena;
+    assert(File->Size <= 0x7FFFFFFF);
+    Result.Data = stbi_load_from_memory((stbi_uc *)File->Memory, (int)File->Size, &Result.Width, &Result.Height, &Result.PixelComponentCount, 0);
+    GlobalImageArena = 0;
+
+    if (!Result.Data)
+    {
+        OutputDebugStringA(stbi_failure_reason());
+    }
+
+    return Result;
+}
+
+// Note(joe): The flip flag is global in stb, so only load flipped images when no
+// decodes are running on the workers. Main thread only when GlobalTextureCache is set.
+loaded_image DEBUGLoadImage(memory_arena *Arena, char *FileName, bool FlipVertically = false)
+{
+    TIMED_FUNCTION();
+
+    loaded_image Result = {};
+
+    if (FlipVertically)
+    {
+        stbi_set_flip_vertically_on_load(1);
+    }
+    mapped_file File = MapFile(FileName, FileAccess_Sequential);
+    if (File.Memory)
+    {
+        texture_cache *Cache = GlobalTextureCache;
+        uint64 CacheKey = Cache ? GetTextureCacheKey(&File, FlipVertically, 0) : 0;
+        mapped_file Blob;
+        loaded_image Cached;
+        if (Cache && LookupCachedImage(Cache, CacheKey, &File, &Blob, &Cached))
+        {
+            // Note(joe): Copied out so the pixels live in the arena like a decode's do.
+            uint64 Size = (uint64)Cached.Width*Cached.Height*Cached.PixelComponentCount;
+            uint8 *Pixels = PushArray(Arena, Size, uint8);
+            if (Pixels)
+            {
+                memcpy(Pixels, Cached.Data, (size_t)Size);
+                Result = Cached;
+                Result.Data = Pixels;
+            }
+            UnmapFile(&Blob);
+        }
+        else
+        {
+            Result = DecodeImage(Arena, &File);
+            if (Cache)
+            {
+                RecordCachedImageWrite(Cache, CacheKey, WriteCachedImage(Cache, CacheKey, Result));
+            }
+        }
+        UnmapFile(&File);
+    }
+    if (FlipVertically)
+    {
+        stbi_set_flip_vertically_on_load(0);
+    }
+
+    return Result;
+}
+
+// Note(joe): Fills in Result with pointers into Memory, nothing is copied. Returns
+// false for anything aqcube_cook wouldn't have written or that runs past the end.
+static bool ParseDDS(void *Memory, uint64 Size, compressed_texture *Result)
+{
+    uint8 *At = (uint8 *)Memory;
+    uint8 *End = At + Size;
+
+    if (Size < sizeof(uint32) + sizeof(dds_header) || *(uint32 *)At != DDS_MAGIC)
+    {
+        return false;
+    }
+    At += sizeof(uint32);
+
+    dds_header *Header = (dds_header *)At;
+    At += sizeof(dds_header);
+    if (Header->Size != sizeof(dds_header) || !(Header->PixelFormat.Flags & DDPF_FOURCC) ||
+        Header->Width == 0 || Header->Height == 0)
+    {
+        return false;
+    }
+
+    Result->IsSRGB = false;
+    uint32 FourCC = Header->PixelFormat.FourCC;
+    if (FourCC == DDS_FOURCC('D', 'X', 'T', '1'))
+    {
+        Result->Format = BlockFormat_BC1;
+    }
+    else if (FourCC == DDS_FOURCC('D', 'X', 'T', '5'))
+    {
+        Result->Format = BlockFormat_BC3;
+    }
+    else if (FourCC == DDS_FOURCC('A', 'T', 'I', '1') || FourCC == DDS_FOURCC('B', 'C', '4', 'U'))
+    {
+        Result->Format = BlockFormat_BC4;
+    }
+    else if (FourCC == DDS_FOURCC('A', 'T', 'I', '2') || FourCC == DDS_FOURCC('B', 'C', '5', 'U'))
+    {
+        Result->Format = BlockFormat_BC5;
+    }
+    else if (FourCC == DDS_FOURCC('D', 'X', '1', '0') && (uint64)(End - At) >= sizeof(dds_header_dx10))
+    {
+        dds_header_dx10 *HeaderDX10 = (dds_header_dx10 *)At;
+        At += sizeof(dds_header_dx10);
+        if (HeaderDX10->ResourceDimension != DDS_DIMENSION_TEXTURE2D || HeaderDX10->ArraySize > 1)
+        {
+            return false;
+        }
+
+        switch (HeaderDX10->DXGIFormat)
+        {
+            case DXGI_FORMAT_BC1_UNORM_SRGB: { Result->IsSRGB = true; } // fallthrough
+            case DXGI_FORMAT_BC1_UNORM: { Result->Format = BlockFormat_BC1; } break;
+            case DXGI_FORMAT_BC3_UNORM_SRGB: { Result->IsSRGB = true; } // fallthrough
+            case DXGI_FORMAT_BC3_UNORM: { Result->Format = BlockFormat_BC3; } break;
+            case DXGI_FORMAT_BC4_UNORM: { Result->Format = BlockFormat_BC4; } break;
+            case DXGI_FORMAT_BC5_UNORM: { Result->Format = BlockFormat_BC5; } break;
+            default: { return false; }
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    Result->Width = Header->Width;
+    Result->Height = Header->Height;
+    Result->LevelCount = (Header->Flags & DDSD_MIPMAPCOUNT) && Header->MipMapCount ? Header->MipMapCount : 1;
+    if (Result->LevelCount > MAX_TEXTURE_LEVELS)
+    {
+        return false;
+    }
+
+    uint32 LevelWidth = Result->Width;
+    uint32 LevelHeight = Result->Height;
+    for (uint32 LevelIndex = 0; LevelIndex < Result->LevelCount; ++LevelIndex)
+    {
+        uint32 LevelSize = GetCompressedLevelSize(Result->Format, LevelWidth, LevelHeight);
+        if ((uint64)(End - At) < LevelSize)
+        {
+            return false;
+        }
+        Result->Levels[LevelIndex] = At;
+        Result->LevelSizes[LevelIndex] = LevelSize;
+        At += LevelSize;
+
+        LevelWidth = (LevelWidth > 1) ? LevelWidth / 2 : 1;
+        LevelHeight = (LevelHeight > 1) ? LevelHeight / 2 : 1;
+    }
+
+    return true;
+}
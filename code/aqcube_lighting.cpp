@@ -0,0 +1,349 @@
+//
+// Lighting chapter scene, shared by win32_lighting.cpp and the headless host.
+//
+
+static glm::vec3 CubePositions[] = {
+    glm::vec3( 0.0f,  0.0f,  0.0f),
+    glm::vec3( 2.0f,  5.0f, -15.0f),
+    glm::vec3(-1.5f, -2.2f, -2.5f),
+    glm::vec3(-3.8f, -2.0f, -12.3f),
+    glm::vec3( 2.4f, -0.4f, -3.5f),
+    glm::vec3(-1.7f,  3.0f, -7.5f),
+    glm::vec3( 1.3f, -2.0f, -2.5f),
+    glm::vec3( 1.5f,  2.0f, -2.5f),
+    glm::vec3( 1.5f,  0.2f, -1.5f),
+    glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+
+static glm::vec3 PointLightPositions[] = {
+    glm::vec3( 0.7f,  0.2f,  2.0f),
+    glm::vec3( 2.3f, -3.3f, -4.0f),
+    glm::vec3(-4.0f,  2.0f, -12.0f),
+    glm::vec3( 0.0f,  0.0f, -3.0f)
+};
+
+#define NR_POINT_LIGHTS 4
+
+// Note(joe): std140 mirror of the Lights block in lighting.frag.
+struct dir_light_block
+{
+    glm::vec4 Direction;
+
+    glm::vec4 Ambient;
+    glm::vec4 Diffuse;
+    glm::vec4 Specular;
+};
+
+struct point_light_block
+{
+    glm::vec3 Position;
+
+    float Constant;
+    float Linear;
+    float Quadratic;
+    float Pad[2];
+
+    glm::vec4 Ambient;
+    glm::vec4 Diffuse;
+    glm::vec4 Specular;
+};
+
+struct lights_block
+{
+    dir_light_block DirLight;
+    point_light_block PointLights[NR_POINT_LIGHTS];
+};
+
+struct lighting_scene
+{
+    GLuint VAO;
+    GLuint LightVAO;
+
+    GLuint DiffuseMap;
+    GLuint SpecularMap;
+
+    shader_program LightingProgram;
+    shader_program LampProgram;
+
+    uniform_blocks Blocks;
+    instance_buffer Instances;
+
+    // Note(joe): Extra cubes on a grid behind the usual ten, for loading up the
+    // instancing path. The host sets it before InitLightingScene.
+    int ExtraCubeCount;
+
+    // Note(joe): The cube's own bounds, from its vertices.
+    glm::vec3 CubeBoundsMin;
+    glm::vec3 CubeBoundsMax;
+    float CubeRadius;
+
+    // Note(joe): The cubes never move, so they go in once and get a SAH rebuild.
+    aabb_tree CubeTree;
+};
+
+static glm::vec3 GetCubePosition(int CubeIndex)
+{
+    if (CubeIndex < ArrayCount(CubePositions))
+    {
+        return CubePositions[CubeIndex];
+    }
+
+    int GridIndex = CubeIndex - ArrayCount(CubePositions);
+    return glm::vec3(2.0f*(GridIndex % 32) - 31.0f, 2.0f*((GridIndex / 32) % 32) - 31.0f, -20.0f - 2.0f*(GridIndex / 1024));
+}
+
+static glm::mat4 GetCubeTransform(int CubeIndex)
+{
+    glm::mat4 Model;
+    Model = glm::translate(Model, GetCubePosition(CubeIndex));
+    GLfloat angle = 20.0f * CubeIndex;
+    Model = glm::rotate(Model, DEG_TO_RAD(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    return Model;
+}
+
+static void InitLightingScene(lighting_scene *Scene, memory_arena *AssetArena, memory_arena *LoadArena)
+{
+    TIMED_FUNCTION();
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    Win32Enable(GL_DEPTH_TEST);
+
+    // Initialize the cube.
+    GLfloat Vertices[] = {
+        // Positions           // Normals           // Texture Coords
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+    };
+
+    Scene->CubeBoundsMin = glm::vec3(Vertices[0], Vertices[1], Vertices[2]);
+    Scene->CubeBoundsMax = Scene->CubeBoundsMin;
+    for (int Vertex = 1; Vertex < ArrayCount(Vertices) / 8; ++Vertex)
+    {
+        glm::vec3 Position(Vertices[Vertex*8 + 0], Vertices[Vertex*8 + 1], Vertices[Vertex*8 + 2]);
+        Scene->CubeBoundsMin = glm::min(Scene->CubeBoundsMin, Position);
+        Scene->CubeBoundsMax = glm::max(Scene->CubeBoundsMax, Position);
+    }
+    glm::vec3 CubeCenter = 0.5f*(Scene->CubeBoundsMin + Scene->CubeBoundsMax);
+    Scene->CubeRadius = 0.0f;
+    for (int Vertex = 0; Vertex < ArrayCount(Vertices) / 8; ++Vertex)
+    {
+        glm::vec3 Position(Vertices[Vertex*8 + 0], Vertices[Vertex*8 + 1], Vertices[Vertex*8 + 2]);
+        Scene->CubeRadius = glm::max(Scene->CubeRadius, glm::length(Position - CubeCenter));
+    }
+
+    int CubeCount = ArrayCount(CubePositions) + Scene->ExtraCubeCount;
+    aabb CubeBounds = { Scene->CubeBoundsMin, Scene->CubeBoundsMax };
+    InitAabbTree(&Scene->CubeTree, AssetArena, CubeCount);
+    for (int CubeIndex = 0; CubeIndex < CubeCount; ++CubeIndex)
+    {
+        glm::mat4 Model = GetCubeTransform(CubeIndex);
+        CreateAabbTreeProxy(&Scene->CubeTree, TransformAabb(CubeBounds, Model), CubeIndex);
+    }
+    RebuildAabbTree(&Scene->CubeTree, LoadArena);
+
+    temporary_memory ImageMemory = BeginTemporaryMemory(LoadArena);
+
+    loaded_image DiffuseImage = DEBUGLoadImage(LoadArena, "container2.png");
+    Scene->DiffuseMap = Win32CreateTexture(DiffuseImage, GL_RGBA);
+
+    loaded_image SpecularImage = DEBUGLoadImage(LoadArena, "container2_specular.png");
+    Scene->SpecularMap = Win32CreateTexture(SpecularImage, GL_RGBA);
+
+    EndTemporaryMemory(ImageMemory);
+
+    glGenVertexArrays(1, &Scene->VAO);
+    Win32BindVertexArray(Scene->VAO);
+
+    // VBO: Vertex Buffer Object
+    GLuint VBO;
+    glGenBuffers(1, &VBO);
+    Win32BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices), Vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), 0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void *)(3*sizeof(GLfloat)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void *)(6*sizeof(GLfloat)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    Win32EnableInstanceAttributes();
+
+    glGenVertexArrays(1, &Scene->LightVAO);
+    Win32BindVertexArray(Scene->LightVAO);
+    Win32BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), 0);
+    glEnableVertexAttribArray(0);
+    Win32EnableInstanceAttributes();
+    Win32BindVertexArray(0);
+
+    Win32InitUniformBlocks(&Scene->Blocks, sizeof(lights_block));
+
+    shader_file LightingShaders[] = { { GL_VERTEX_SHADER, "lighting.vert" }, { GL_FRAGMENT_SHADER, "lighting.frag" } };
+    Win32ReflectProgram(&Scene->LightingProgram, Win32LoadProgram(LoadArena, LightingShaders, ArrayCount(LightingShaders)));
+
+    shader_file LampShaders[] = { { GL_VERTEX_SHADER, "lamp.vert" }, { GL_FRAGMENT_SHADER, "lamp.frag" } };
+    Win32ReflectProgram(&Scene->LampProgram, Win32LoadProgram(LoadArena, LampShaders, ArrayCount(LampShaders)));
+
+    // Note(joe): The material never changes, and uniform values stick to the program.
+    shader_program *Program = &Scene->LightingProgram;
+    Win32UseProgram(Program->Id);
+    SetUniform(GetUniformSampler(Program, "material.diffuse"),   0);
+    SetUniform(GetUniformSampler(Program, "material.specular"),  1);
+    SetUniform(GetUniformFloat(Program, "material.shininess"), 32.0f);
+
+    Win32InitInstanceBuffer(&Scene->Instances, ArrayCount(CubePositions) + Scene->ExtraCubeCount + ArrayCount(PointLightPositions));
+
+    // Note(joe): Nor do the lights, so they go up once.
+    glm::vec3 LightColor(1.0f, 1.0f, 1.0f);
+    glm::vec3 DiffuseColor = LightColor * glm::vec3(0.5f); // Decrease the influence.
+    glm::vec3 AmbientColor = DiffuseColor * glm::vec3(0.2f); // Low influence.
+
+    lights_block Lights = {};
+
+    // Set the direction light properties (ambient, diffuse, specular).
+    Lights.DirLight.Direction = glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f);
+    Lights.DirLight.Ambient = glm::vec4(AmbientColor, 1.0f);
+    Lights.DirLight.Diffuse = glm::vec4(DiffuseColor, 1.0f);
+    Lights.DirLight.Specular = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+    // Set the point light properties.
+    for (int LightIndex = 0; LightIndex < NR_POINT_LIGHTS; ++LightIndex)
+    {
+        point_light_block *Light = Lights.PointLights + LightIndex;
+
+        // Position
+        Light->Position = PointLightPositions[LightIndex];
+
+        // Attenuation
+        Light->Constant = 1.0f;
+        Light->Linear = 0.09f;
+        Light->Quadratic = 0.032f;
+
+        // Light properties
+        Light->Ambient = glm::vec4(AmbientColor, 1.0f);
+        Light->Diffuse = glm::vec4(DiffuseColor, 1.0f);
+        Light->Specular = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+
+    Win32UpdateUniformBuffer(Scene->Blocks.Lights, &Lights, sizeof(Lights));
+}
+
+static void RenderLightingScene(lighting_scene *Scene, camera *Camera, memory_arena *FrameArena, int ScreenWidth, int ScreenHeight, float t)
+{
+    TIMED_FUNCTION();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 View;
+    View = glm::lookAt(Camera->Position, Camera->Position + Camera->Front, Camera->Up);
+
+    glm::mat4 Projection;
+    Projection = glm::perspective(DEG_TO_RAD(45), (float)ScreenWidth/(float)ScreenHeight, 0.01f, 100.0f);
+
+    float LampX = cos(DEG_TO_RAD(t*25.0f));
+    float LampZ = sin(DEG_TO_RAD(t*25.0f));
+#if 0
+    glm::vec3 LightPos(LampX, 1.2f, LampZ);
+#else
+    glm::vec3 LightPos(1.2f, 1.0f, 2.0f);
+#endif
+
+    Win32SetCameraBlock(&Scene->Blocks, View, Projection, Camera->Position);
+
+    Win32UseProgram(Scene->LightingProgram.Id);
+
+#if 0
+    // Spotlight
+    GLint LightSpotDirLoc = glGetUniformLocation(Scene->LightingProgram, "light.direction");
+    GLint LightSpotCutOffLoc = glGetUniformLocation(Scene->LightingProgram, "light.cutOff");
+    GLint LightSpotOuterCutOffLoc = glGetUniformLocation(Scene->LightingProgram, "light.outerCutOff");
+
+    glUniform3f(LightPosLoc, Camera->Position.x, Camera->Position.y, Camera->Position.z);
+    glUniform3f(LightSpotDirLoc, Camera->Front.x, Camera->Front.y, Camera->Front.z);
+    glUniform1f(LightSpotCutOffLoc, glm::cos(DEG_TO_RAD(12.5f)));
+    glUniform1f(LightSpotOuterCutOffLoc, glm::cos(DEG_TO_RAD(17.5f)));
+#endif
+
+    Win32BindVertexArray(Scene->VAO);
+    Win32BindTexture(0, Scene->DiffuseMap);
+    Win32BindTexture(1, Scene->SpecularMap);
+
+    // Note(joe): Every transform goes up in one upload, then the cubes and the lamps
+    // are a single instanced draw each however many of them there are. Only the
+    // cubes the tree finds in view go in, and only they get a transform built.
+    int CubeCount = ArrayCount(CubePositions) + Scene->ExtraCubeCount;
+    int LampCount = ArrayCount(PointLightPositions);
+
+    glm::mat4 ViewProjection = Projection*View;
+    frustum Frustum = ExtractFrustum(ViewProjection);
+    uint32 *Visible = PushArray(FrameArena, CubeCount, uint32);
+    int VisibleCubeCount = (int)QueryAabbTreeFrustum(&Scene->CubeTree, &Frustum, Visible, CubeCount);
+
+    glm::mat4 *Transforms = PushArray(FrameArena, VisibleCubeCount + LampCount, glm::mat4);
+    for (int VisibleIndex = 0; VisibleIndex < VisibleCubeCount; ++VisibleIndex)
+    {
+        Transforms[VisibleIndex] = GetCubeTransform(Visible[VisibleIndex]);
+    }
+
+    glm::mat4 *LampTransforms = Transforms + VisibleCubeCount;
+    for (int PositionIndex = 0; PositionIndex < LampCount; ++PositionIndex)
+    {
+        glm::mat4 Model;
+        Model = glm::translate(Model, PointLightPositions[PositionIndex]);
+        Model = glm::scale(Model, glm::vec3(0.2f));
+        LampTransforms[PositionIndex] = Model;
+    }
+
+    Win32BeginInstances(&Scene->Instances);
+    uint32 FirstCube = Win32PushInstances(&Scene->Instances, Transforms, VisibleCubeCount + LampCount);
+
+    if (VisibleCubeCount)
+    {
+        Win32DrawArraysInstanced(&Scene->Instances, FirstCube, VisibleCubeCount, GL_TRIANGLES, 0, 36);
+    }
+
+#if 1
+    Win32UseProgram(Scene->LampProgram.Id);
+    Win32BindVertexArray(Scene->LightVAO);
+
+    Win32DrawArraysInstanced(&Scene->Instances, FirstCube + VisibleCubeCount, LampCount, GL_TRIANGLES, 0, 36);
+#endif
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+// Note(joe): Push allocators carved out of game_memory. Anything that lives for the
+// whole run goes in the permanent block. Load-time and per-frame scratch go in the
+// transient block and get popped again with temporary_memory.
+
+#define DEFAULT_ARENA_ALIGNMENT 16
+
+struct memory_arena
+{
+    char *Name;
+    uint8 *Base;
+    uint64 Size;
+    uint64 Used;
+
+    // Note(joe): Diagnostics, these are what to look at when sizing the blocks.
+    uint64 HighWater;
+    uint32 OverflowCount;
+    uint64 LargestOverflow;
+
+    int TempCount;
+};
+
+struct temporary_memory
+{
+    memory_arena *Arena;
+    uint64 Used;
+};
+
+inline void InitializeArena(memory_arena *Arena, char *Name, uint64 Size, void *Base)
+{
+    Arena->Name = Name;
+    Arena->Base = (uint8 *)Base;
+    Arena->Size = Size;
+    Arena->Used = 0;
+    Arena->HighWater = 0;
+    Arena->OverflowCount = 0;
+    Arena->LargestOverflow = 0;
+    Arena->TempCount = 0;
+}
+
+inline uint64 GetAlignmentOffset(memory_arena *Arena, uint64 Alignment)
+{
+    uint64 Result = 0;
+
+    uint64 Pointer = (uint64)(uintptr_t)(Arena->Base + Arena->Used);
+    uint64 Mask = Alignment - 1;
+    if (Pointer & Mask)
+    {
+        Result = Alignment - (Pointer & Mask);
+    }
+
+    return Result;
+}
+
+inline uint64 GetArenaSizeRemaining(memory_arena *Arena, uint64 Alignment = DEFAULT_ARENA_ALIGNMENT)
+{
+    uint64 Result = 0;
+
+    uint64 Offset = GetAlignmentOffset(Arena, Alignment);
+    if (Arena->Used + Offset < Arena->Size)
+    {
+        Result = Arena->Size - (Arena->Used + Offset);
+    }
+
+    return Result;
+}
+
+#define PushStruct(Arena, type) (type *)PushSize_(Arena, sizeof(type), alignof(type))
+#define PushArray(Arena, Count, type) (type *)PushSize_(Arena, (Count)*sizeof(type), alignof(type))
+#define PushSize(Arena, Size) PushSize_(Arena, Size)
+#define PushSizeAligned(Arena, Size, Alignment) PushSize_(Arena, Size, Alignment)
+
+// Note(joe): Returns 0 when the arena is full. Overflows are counted on the arena
+// so a release build can still report which block needs to grow.
+inline void *PushSize_(memory_arena *Arena, uint64 Size, uint64 Alignment = DEFAULT_ARENA_ALIGNMENT)
+{
+    void *Result = 0;
+
+    assert(Alignment && ((Alignment & (Alignment - 1)) == 0));
+
+    uint64 Offset = GetAlignmentOffset(Arena, Alignment);
+    if (Arena->Used + Offset + Size <= Arena->Size)
+    {
+        Result = Arena->Base + Arena->Used + Offset;
+        Arena->Used += Offset + Size;
+        if (Arena->Used > Arena->HighWater)
+        {
+            Arena->HighWater = Arena->Used;
+        }
+    }
+    else
+    {
+        ++Arena->OverflowCount;
+        if (Size > Arena->LargestOverflow)
+        {
+            Arena->LargestOverflow = Size;
+        }
+        assert(!"Memory arena overflow");
+    }
+
+    return Result;
+}
+
+// Note(joe): Grows the most recent push in place, used for realloc style callers.
+inline bool GrowLastPush(memory_arena *Arena, void *Memory, uint64 OldSize, uint64 NewSize)
+{
+    bool Result = false;
+
+    uint8 *End = (uint8 *)Memory + OldSize;
+    if (End == Arena->Base + Arena->Used)
+    {
+        uint64 Start = (uint64)((uint8 *)Memory - Arena->Base);
+        if (Start + NewSize <= Arena->Size)
+        {
+            Arena->Used = Start + NewSize;
+            if (Arena->Used > Arena->HighWater)
+            {
+                Arena->HighWater = Arena->Used;
+            }
+            Result = true;
+        }
+    }
+
+    return Result;
+}
+
+inline void SubArena(memory_arena *Result, char *Name, memory_arena *Arena, uint64 Size, uint64 Alignment = DEFAULT_ARENA_ALIGNMENT)
+{
+    void *Base = PushSizeAligned(Arena, Size, Alignment);
+    InitializeArena(Result, Name, Base ? Size : 0, Base);
+}
+
+inline temporary_memory BeginTemporaryMemory(memory_arena *Arena)
+{
+    temporary_memory Result;
+
+    Result.Arena = Arena;
+    Result.Used = Arena->Used;
+
+    ++Arena->TempCount;
+
+    return Result;
+}
+
+inline void EndTemporaryMemory(temporary_memory TempMem)
+{
+    memory_arena *Arena = TempMem.Arena;
+    assert(Arena->Used >= TempMem.Used);
+    Arena->Used = TempMem.Used;
+    assert(Arena->TempCount > 0);
+    --Arena->TempCount;
+}
+
+inline void CheckArena(memory_arena *Arena)
+{
+    assert(Arena->TempCount == 0);
+}
+
+// Note(joe): The split the scenes use. Assets live in PermanentStorage; the
+// transient block is cut into a per-frame scratch arena and a load scratch arena
+// that gets everything else.
+struct scene_arenas
+{
+    memory_arena Assets;
+    memory_arena Load;
+    memory_arena Frame;
+};
+
+inline void InitializeSceneArenas(scene_arenas *Arenas, game_memory *Memory, uint64 FrameSize)
+{
+    InitializeArena(&Arenas->Assets, "Assets", Memory->PermanentStorageSize, Memory->PermanentStorage);
+    InitializeArena(&Arenas->Load, "Load", Memory->TransientStorageSize, Memory->TransientStorage);
+    SubArena(&Arenas->Frame, "Frame", &Arenas->Load, FrameSize);
+}
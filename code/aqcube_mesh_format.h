@@ -0,0 +1,126 @@
+#pragma once
+
+// Note(joe): The cooked mesh format (.aqmesh) written by aqcube_cook. Everything is
+// little endian and laid out so the runtime can hand the blobs straight to GL out
+// of the mapped file:
+//
+//   aqmesh_header
+//   aqmesh_texture[TextureCount]    unique texture paths
+//   aqmesh_material[MaterialCount]
+//   aqmesh_mesh[MeshCount]
+//   vertex blob                     aqmesh_vertex[] or aqmesh_packed_vertex[], AQMESH_BLOB_ALIGNMENT aligned
+//   index blob                      uint16[] or uint32[], AQMESH_BLOB_ALIGNMENT aligned
+//
+// Indices are relative to their mesh's first vertex, so they're 16 bit whenever every
+// mesh in the file has fewer than 65536 vertices. A mesh's LODs are just more index
+// ranges over the same vertices. Bump AQMESH_VERSION whenever any of
+// these structs change, old files are rejected rather than misread.
+
+#define AQMESH_MAGIC (((uint32)'A' << 0) | ((uint32)'Q' << 8) | ((uint32)'M' << 16) | ((uint32)'S' << 24))
+#define AQMESH_VERSION 3
+
+#define AQMESH_BLOB_ALIGNMENT 64
+#define AQMESH_MAX_MATERIAL_TEXTURES 8
+#define AQMESH_MAX_PATH 120
+#define AQMESH_MAX_LODS 6
+
+enum aqmesh_vertex_format
+{
+    AQMeshVertex_Float,  // aqmesh_vertex
+    AQMeshVertex_Packed, // aqmesh_packed_vertex
+};
+
+enum aqmesh_texture_type
+{
+    AQMeshTexture_Diffuse,
+    AQMeshTexture_Specular,
+};
+
+struct aqmesh_header
+{
+    uint32 Magic;
+    uint32 Version;
+
+    uint32 TextureCount;
+    uint32 MaterialCount;
+    uint32 MeshCount;
+    uint32 VertexFormat;
+    uint32 VertexStride;
+    uint32 IndexSize; // 2 or 4 bytes.
+
+    uint64 TexturesOffset;
+    uint64 MaterialsOffset;
+    uint64 MeshesOffset;
+    uint64 VertexDataOffset;
+    uint64 VertexDataSize;
+    uint64 IndexDataOffset;
+    uint64 IndexDataSize;
+
+    float BoundsMin[3];
+    float BoundsMax[3];
+
+    // Note(joe): Packed positions decode to PositionOrigin + PositionScale*p, where p
+    // is the unorm16 position GL hands the shader. The scale is the same on every
+    // axis so the decode can ride along in the model matrix without skewing normals.
+    // Float files have a zero origin and a scale of one.
+    float PositionOrigin[3];
+    float PositionScale;
+};
+
+struct aqmesh_texture
+{
+    uint32 Type;
+    char Path[AQMESH_MAX_PATH]; // Relative to the .aqmesh, null terminated.
+};
+
+struct aqmesh_material
+{
+    uint32 TextureCount;
+    uint32 TextureIndices[AQMESH_MAX_MATERIAL_TEXTURES];
+};
+
+struct aqmesh_lod
+{
+    uint32 FirstIndex;
+    uint32 IndexCount;
+    float Error; // How far the surface can be from LOD 0's, in model units.
+};
+
+struct aqmesh_mesh
+{
+    uint32 FirstVertex;
+    uint32 VertexCount;
+    uint32 MaterialIndex;
+
+    // Note(joe): LOD 0 is the full mesh, there's always at least that one. Errors
+    // never go down along the chain.
+    uint32 LodCount;
+    aqmesh_lod Lods[AQMESH_MAX_LODS];
+
+    float BoundsMin[3];
+    float BoundsMax[3];
+};
+
+struct aqmesh_vertex
+{
+    float Position[3];
+    float Normal[3];
+    float TexCoords[2];
+};
+
+// Note(joe): Half the size of aqmesh_vertex. Positions are unorm16 over the model's
+// bounds (see PositionOrigin), normals are octahedral snorm16 and texture coordinates
+// are half floats.
+struct aqmesh_packed_vertex
+{
+    uint16 Position[3];
+    uint16 Padding;
+    int16 Normal[2];
+    uint16 TexCoords[2];
+};
+
+inline uint32 GetVertexStride(uint32 VertexFormat)
+{
+    uint32 Result = (VertexFormat == AQMeshVertex_Packed) ? sizeof(aqmesh_packed_vertex) : sizeof(aqmesh_vertex);
+    return Result;
+}
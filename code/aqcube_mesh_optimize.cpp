@@ -0,0 +1,705 @@
+// Note(joe): Reorders a cooked mesh's triangles and vertices so the GPU does less
+// work drawing it, without changing what gets drawn. Before any of it, WeldVertices
+// merges vertices that are bit for bit the same. Importers tend to give every face
+// corner its own vertex, and with nothing shared there's nothing for a cache to reuse.
+// Then three passes, in this order:
+//
+//   1. Vertex cache. Tom Forsyth's linear speed greedy ordering: always emit the
+//      triangle whose vertices score best against a simulated LRU cache, so each
+//      transformed vertex gets reused as much as possible before it falls out.
+//   2. Overdraw. The cache friendly order is cut into clusters wherever doing so
+//      barely hurts the cache (Sander, Nehab and Barczak's "Fast triangle
+//      reordering for vertex locality and reduced overdraw"), then the clusters are
+//      sorted so the ones facing out from the middle of the mesh go first. Those
+//      tend to be in front from whichever side you look, so early-z gets to throw
+//      more of the rest away.
+//   3. Vertex fetch. Vertices are renumbered in the order the indices first touch
+//      them, so fetching them walks the vertex buffer front to back.
+//
+// Everything is per mesh, indices are relative to the mesh's first vertex like
+// they are in the file. AnalyzeMesh is there to check the passes paid off.
+//
+// This is cooker only code, it allocates as it likes.
+
+#include <math.h>
+#include <stdlib.h>
+
+// Note(joe): The FIFO size the statistics model. Real post-transform caches vary
+// by vendor and aren't FIFOs any more, but 16 is a fair middle ground and it's what
+// the published ACMR numbers usually use.
+#define MESH_STATS_CACHE_SIZE 16
+
+// Note(joe): The LRU size the ordering plans for. Bigger than any real cache is
+// fine, the scoring falls off towards the end anyway.
+#define FORSYTH_CACHE_SIZE 32
+
+// Note(joe): A cluster is split off when its running ACMR gets within this factor
+// of the ACMR of the whole hard cluster it's part of.
+#define OVERDRAW_THRESHOLD 1.05f
+
+// Note(joe): Overdraw is measured by rasterising the mesh from all six axis
+// directions at this resolution.
+#define OVERDRAW_VIEW_SIZE 256
+
+struct mesh_stats
+{
+    float ACMR; // Vertices transformed per triangle. 0.5 is the ideal for a big regular grid, 3 the worst.
+    float ATVR; // Vertices transformed over unique vertices. 1 is ideal.
+    float Overdraw; // Pixels shaded over pixels covered, averaged over the views. 1 is ideal.
+};
+
+//
+// Welding
+//
+
+// Note(joe): Open addressed, sized to at least twice the number of keys.
+inline uint32 GetHashTableSize(uint32 KeyCount)
+{
+    uint32 Result = 16;
+    while (Result < KeyCount*2)
+    {
+        Result *= 2;
+    }
+    return Result;
+}
+
+inline uint32 HashVertex(aqmesh_vertex *Vertex)
+{
+    uint32 Words[sizeof(aqmesh_vertex) / sizeof(uint32)];
+    memcpy(Words, Vertex, sizeof(Words));
+    uint32 Result = 2166136261u;
+    for (uint32 Word = 0; Word < ArrayCount(Words); ++Word)
+    {
+        Result = (Result ^ Words[Word])*16777619u;
+    }
+    return Result;
+}
+
+// Note(joe): Duplicates[v] is the first vertex that's bit for bit the same as v, v
+// itself when there isn't an earlier one. So it's never more than v.
+static void FindDuplicateVertices(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Duplicates)
+{
+    uint32 TableSize = GetHashTableSize(VertexCount);
+    uint32 *Table = (uint32 *)malloc(TableSize*sizeof(uint32));
+    memset(Table, 0xFF, TableSize*sizeof(uint32));
+    for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+    {
+        uint32 Slot = HashVertex(Vertices + Vertex) & (TableSize - 1);
+        while (Table[Slot] != 0xFFFFFFFF && memcmp(Vertices + Table[Slot], Vertices + Vertex, sizeof(aqmesh_vertex)) != 0)
+        {
+            Slot = (Slot + 1) & (TableSize - 1);
+        }
+        if (Table[Slot] == 0xFFFFFFFF)
+        {
+            Table[Slot] = Vertex;
+        }
+        Duplicates[Vertex] = Table[Slot];
+    }
+    free(Table);
+}
+
+// Note(joe): Keeps the first of each set of duplicates, packed to the front in their
+// old order, and points the indices at them. Returns how many are left, past that
+// Vertices is garbage.
+static uint32 WeldVertices(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount)
+{
+    uint32 *Remap = (uint32 *)malloc((VertexCount + 1)*sizeof(uint32));
+    FindDuplicateVertices(Vertices, VertexCount, Remap);
+
+    uint32 Result = 0;
+    for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+    {
+        if (Remap[Vertex] == Vertex)
+        {
+            Vertices[Result] = Vertices[Vertex];
+            Remap[Vertex] = Result++;
+        }
+        else
+        {
+            Remap[Vertex] = Remap[Remap[Vertex]];
+        }
+    }
+    for (uint32 Index = 0; Index < IndexCount; ++Index)
+    {
+        Indices[Index] = Remap[Indices[Index]];
+    }
+
+    free(Remap);
+    return Result;
+}
+
+//
+// Statistics
+//
+
+static void SimulateVertexCache(uint32 *Indices, uint32 IndexCount, uint32 VertexCount, uint32 CacheSize,
+                                uint32 *Misses, uint8 *TriangleMisses)
+{
+    // Note(joe): Timestamps rather than a real queue, a vertex is still in the FIFO
+    // if fewer than CacheSize misses have happened since it went in.
+    uint32 *InsertedAt = (uint32 *)calloc(VertexCount + 1, sizeof(uint32));
+    uint32 Time = CacheSize + 1;
+
+    *Misses = 0;
+    for (uint32 TriangleIndex = 0; TriangleIndex < IndexCount / 3; ++TriangleIndex)
+    {
+        uint8 TriangleMissCount = 0;
+        for (uint32 Corner = 0; Corner < 3; ++Corner)
+        {
+            uint32 Vertex = Indices[TriangleIndex*3 + Corner];
+            if (Time - InsertedAt[Vertex] > CacheSize)
+            {
+                InsertedAt[Vertex] = Time++;
+                ++TriangleMissCount;
+            }
+        }
+
+        *Misses += TriangleMissCount;
+        if (TriangleMisses)
+        {
+            TriangleMisses[TriangleIndex] = TriangleMissCount;
+        }
+    }
+
+    free(InsertedAt);
+}
+
+struct overdraw_view
+{
+    float *Depth;
+    uint32 Shaded;
+};
+
+// Note(joe): Plain half-space rasteriser with pixel centres at +0.5. Back faces are
+// culled, FrontSign is the sign of the screen space area of a triangle facing the
+// view.
+static void RasterizeOverdrawTriangle(overdraw_view *View, float FrontSign, float *A, float *B, float *C)
+{
+    float Area = FrontSign*((B[0] - A[0])*(C[1] - A[1]) - (B[1] - A[1])*(C[0] - A[0]));
+    if (Area <= 0.0f)
+    {
+        return;
+    }
+    if (FrontSign < 0.0f)
+    {
+        float *Swap = B;
+        B = C;
+        C = Swap;
+    }
+
+    float MinX = fminf(A[0], fminf(B[0], C[0]));
+    float MaxX = fmaxf(A[0], fmaxf(B[0], C[0]));
+    float MinY = fminf(A[1], fminf(B[1], C[1]));
+    float MaxY = fmaxf(A[1], fmaxf(B[1], C[1]));
+    int32 X0 = (int32)fmaxf(0.0f, ceilf(MinX - 0.5f));
+    int32 X1 = (int32)fminf((float)(OVERDRAW_VIEW_SIZE - 1), floorf(MaxX - 0.5f));
+    int32 Y0 = (int32)fmaxf(0.0f, ceilf(MinY - 0.5f));
+    int32 Y1 = (int32)fminf((float)(OVERDRAW_VIEW_SIZE - 1), floorf(MaxY - 0.5f));
+
+    float InvArea = 1.0f / Area;
+    for (int32 Y = Y0; Y <= Y1; ++Y)
+    {
+        float PY = (float)Y + 0.5f;
+        for (int32 X = X0; X <= X1; ++X)
+        {
+            float PX = (float)X + 0.5f;
+            float W0 = (C[0] - B[0])*(PY - B[1]) - (C[1] - B[1])*(PX - B[0]);
+            float W1 = (A[0] - C[0])*(PY - C[1]) - (A[1] - C[1])*(PX - C[0]);
+            float W2 = (B[0] - A[0])*(PY - A[1]) - (B[1] - A[1])*(PX - A[0]);
+            if (W0 >= 0.0f && W1 >= 0.0f && W2 >= 0.0f)
+            {
+                float Z = (W0*A[2] + W1*B[2] + W2*C[2])*InvArea;
+                float *Depth = View->Depth + Y*OVERDRAW_VIEW_SIZE + X;
+                if (Z < *Depth)
+                {
+                    *Depth = Z;
+                    ++View->Shaded;
+                }
+            }
+        }
+    }
+}
+
+// Note(joe): How much a depth tested GPU with back face culling would shade drawing
+// the mesh in index order, looking down +x, -x, +y, -y, +z and -z in turn.
+static float MeasureOverdraw(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount)
+{
+    float Min[3] = { 3.4e38f, 3.4e38f, 3.4e38f };
+    float Max[3] = { -3.4e38f, -3.4e38f, -3.4e38f };
+    for (uint32 VertexIndex = 0; VertexIndex < VertexCount; ++VertexIndex)
+    {
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Min[Axis] = fminf(Min[Axis], Vertices[VertexIndex].Position[Axis]);
+            Max[Axis] = fmaxf(Max[Axis], Vertices[VertexIndex].Position[Axis]);
+        }
+    }
+    float Extent = fmaxf(Max[0] - Min[0], fmaxf(Max[1] - Min[1], Max[2] - Min[2]));
+    float Scale = (Extent > 0.0f) ? ((float)OVERDRAW_VIEW_SIZE / Extent) : 0.0f;
+
+    overdraw_view View;
+    View.Depth = (float *)malloc(OVERDRAW_VIEW_SIZE*OVERDRAW_VIEW_SIZE*sizeof(float));
+    float *Projected = (float *)malloc((VertexCount + 1)*3*sizeof(float));
+
+    uint64 TotalShaded = 0;
+    uint64 TotalCovered = 0;
+    for (int ViewIndex = 0; ViewIndex < 6; ++ViewIndex)
+    {
+        int DepthAxis = ViewIndex / 2;
+        int XAxis = (DepthAxis + 1) % 3;
+        int YAxis = (DepthAxis + 2) % 3;
+        float DepthSign = (ViewIndex & 1) ? -1.0f : 1.0f;
+
+        // Note(joe): x, y and depth are a right handed frame looking down +depth, so
+        // counter clockwise faces towards the view have a negative area. Looking the
+        // other way mirrors it.
+        float FrontSign = -DepthSign;
+
+        for (uint32 VertexIndex = 0; VertexIndex < VertexCount; ++VertexIndex)
+        {
+            float *Position = Vertices[VertexIndex].Position;
+            Projected[VertexIndex*3 + 0] = (Position[XAxis] - Min[XAxis])*Scale;
+            Projected[VertexIndex*3 + 1] = (Position[YAxis] - Min[YAxis])*Scale;
+            Projected[VertexIndex*3 + 2] = DepthSign*Position[DepthAxis];
+        }
+
+        for (uint32 PixelIndex = 0; PixelIndex < OVERDRAW_VIEW_SIZE*OVERDRAW_VIEW_SIZE; ++PixelIndex)
+        {
+            View.Depth[PixelIndex] = 3.4e38f;
+        }
+        View.Shaded = 0;
+
+        for (uint32 Index = 0; Index + 2 < IndexCount; Index += 3)
+        {
+            RasterizeOverdrawTriangle(&View, FrontSign, Projected + Indices[Index]*3, Projected + Indices[Index + 1]*3,
+                                      Projected + Indices[Index + 2]*3);
+        }
+
+        TotalShaded += View.Shaded;
+        for (uint32 PixelIndex = 0; PixelIndex < OVERDRAW_VIEW_SIZE*OVERDRAW_VIEW_SIZE; ++PixelIndex)
+        {
+            TotalCovered += (View.Depth[PixelIndex] != 3.4e38f);
+        }
+    }
+
+    free(Projected);
+    free(View.Depth);
+
+    float Result = TotalCovered ? (float)((double)TotalShaded / (double)TotalCovered) : 1.0f;
+    return Result;
+}
+
+static mesh_stats AnalyzeMesh(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount)
+{
+    mesh_stats Result = {};
+
+    uint32 Misses = 0;
+    SimulateVertexCache(Indices, IndexCount, VertexCount, MESH_STATS_CACHE_SIZE, &Misses, 0);
+    Result.ACMR = (IndexCount >= 3) ? (float)Misses / (float)(IndexCount / 3) : 0.0f;
+    Result.ATVR = VertexCount ? (float)Misses / (float)VertexCount : 0.0f;
+    Result.Overdraw = MeasureOverdraw(Vertices, VertexCount, Indices, IndexCount);
+
+    return Result;
+}
+
+//
+// Vertex cache
+//
+
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+// Note(joe): The three vertices of the last triangle score the same whatever order
+// they went in, otherwise it favours the strip-like ones just behind. Vertices with
+// few triangles left get a boost so stragglers don't get stranded.
+static float ScoreVertex(int32 CachePosition, uint32 RemainingTriangles)
+{
+    float Result = -1.0f;
+    if (RemainingTriangles)
+    {
+        Result = 0.0f;
+        if (CachePosition >= 0)
+        {
+            if (CachePosition < 3)
+            {
+                Result = FORSYTH_LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                float Scaler = 1.0f / (float)(FORSYTH_CACHE_SIZE - 3);
+                Result = powf(1.0f - (float)(CachePosition - 3)*Scaler, FORSYTH_CACHE_DECAY_POWER);
+            }
+        }
+        Result += FORSYTH_VALENCE_BOOST_SCALE*powf((float)RemainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+    return Result;
+}
+
+static void OptimizeVertexCache(uint32 *Indices, uint32 IndexCount, uint32 VertexCount)
+{
+    uint32 TriangleCount = IndexCount / 3;
+    if (TriangleCount == 0)
+    {
+        return;
+    }
+
+    // Note(joe): Each vertex's triangles, packed. The first Remaining[v] entries of a
+    // vertex's list are the ones not emitted yet.
+    uint32 *Remaining = (uint32 *)calloc(VertexCount + 1, sizeof(uint32));
+    uint32 *FirstAdjacent = (uint32 *)calloc(VertexCount + 1, sizeof(uint32));
+    uint32 *Adjacent = (uint32 *)calloc(IndexCount, sizeof(uint32));
+    for (uint32 Index = 0; Index < TriangleCount*3; ++Index)
+    {
+        ++Remaining[Indices[Index]];
+    }
+    for (uint32 Vertex = 0, Offset = 0; Vertex < VertexCount; ++Vertex)
+    {
+        FirstAdjacent[Vertex] = Offset;
+        Offset += Remaining[Vertex];
+        Remaining[Vertex] = 0;
+    }
+    for (uint32 Index = 0; Index < TriangleCount*3; ++Index)
+    {
+        uint32 Vertex = Indices[Index];
+        Adjacent[FirstAdjacent[Vertex] + Remaining[Vertex]++] = Index / 3;
+    }
+
+    int32 *CachePosition = (int32 *)malloc((VertexCount + 1)*sizeof(int32));
+    float *VertexScore = (float *)malloc((VertexCount + 1)*sizeof(float));
+    for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+    {
+        CachePosition[Vertex] = -1;
+        VertexScore[Vertex] = ScoreVertex(-1, Remaining[Vertex]);
+    }
+
+    float *TriangleScore = (float *)malloc(TriangleCount*sizeof(float));
+    uint8 *Emitted = (uint8 *)calloc(TriangleCount, sizeof(uint8));
+    for (uint32 Triangle = 0; Triangle < TriangleCount; ++Triangle)
+    {
+        uint32 *Corners = Indices + Triangle*3;
+        TriangleScore[Triangle] = VertexScore[Corners[0]] + VertexScore[Corners[1]] + VertexScore[Corners[2]];
+    }
+
+    uint32 *Output = (uint32 *)malloc(TriangleCount*3*sizeof(uint32));
+    uint32 Cache[FORSYTH_CACHE_SIZE + 3];
+    uint32 NewCache[FORSYTH_CACHE_SIZE + 3];
+    uint32 CacheCount = 0;
+    uint32 ScanCursor = 0;
+
+    uint32 BestTriangle = 0;
+    for (uint32 Triangle = 1; Triangle < TriangleCount; ++Triangle)
+    {
+        if (TriangleScore[Triangle] > TriangleScore[BestTriangle])
+        {
+            BestTriangle = Triangle;
+        }
+    }
+
+    for (uint32 OutputTriangle = 0; OutputTriangle < TriangleCount; ++OutputTriangle)
+    {
+        if (BestTriangle == 0xFFFFFFFF)
+        {
+            // Note(joe): Nothing in the cache touches a triangle that's left, so carry
+            // on from the first one that hasn't gone out. Everything before the cursor
+            // has, which keeps this linear overall.
+            while (Emitted[ScanCursor])
+            {
+                ++ScanCursor;
+            }
+            BestTriangle = ScanCursor;
+        }
+
+        uint32 *Corners = Indices + BestTriangle*3;
+        Emitted[BestTriangle] = 1;
+        Output[OutputTriangle*3 + 0] = Corners[0];
+        Output[OutputTriangle*3 + 1] = Corners[1];
+        Output[OutputTriangle*3 + 2] = Corners[2];
+
+        // Note(joe): Take the triangle off its vertices' lists and put its vertices
+        // at the front of the cache.
+        uint32 NewCacheCount = 0;
+        for (uint32 Corner = 0; Corner < 3; ++Corner)
+        {
+            uint32 Vertex = Corners[Corner];
+            uint32 *List = Adjacent + FirstAdjacent[Vertex];
+            for (uint32 i = 0; i < Remaining[Vertex]; ++i)
+            {
+                if (List[i] == BestTriangle)
+                {
+                    List[i] = List[--Remaining[Vertex]];
+                    break;
+                }
+            }
+            NewCache[NewCacheCount++] = Vertex;
+        }
+        for (uint32 i = 0; i < CacheCount; ++i)
+        {
+            uint32 Vertex = Cache[i];
+            if (Vertex != Corners[0] && Vertex != Corners[1] && Vertex != Corners[2])
+            {
+                NewCache[NewCacheCount++] = Vertex;
+            }
+        }
+
+        // Note(joe): Anything pushed past the end has fallen out, it still needs its
+        // score updating though.
+        for (uint32 i = 0; i < NewCacheCount; ++i)
+        {
+            uint32 Vertex = NewCache[i];
+            CachePosition[Vertex] = (i < FORSYTH_CACHE_SIZE) ? (int32)i : -1;
+            VertexScore[Vertex] = ScoreVertex(CachePosition[Vertex], Remaining[Vertex]);
+        }
+
+        BestTriangle = 0xFFFFFFFF;
+        float BestScore = -1.0f;
+        for (uint32 i = 0; i < NewCacheCount; ++i)
+        {
+            uint32 Vertex = NewCache[i];
+            uint32 *List = Adjacent + FirstAdjacent[Vertex];
+            for (uint32 j = 0; j < Remaining[Vertex]; ++j)
+            {
+                uint32 Triangle = List[j];
+                uint32 *TriangleCorners = Indices + Triangle*3;
+                float Score = VertexScore[TriangleCorners[0]] + VertexScore[TriangleCorners[1]] + VertexScore[TriangleCorners[2]];
+                TriangleScore[Triangle] = Score;
+                if (Score > BestScore)
+                {
+                    BestScore = Score;
+                    BestTriangle = Triangle;
+                }
+            }
+        }
+
+        CacheCount = (NewCacheCount < FORSYTH_CACHE_SIZE) ? NewCacheCount : FORSYTH_CACHE_SIZE;
+        memcpy(Cache, NewCache, CacheCount*sizeof(uint32));
+    }
+
+    memcpy(Indices, Output, TriangleCount*3*sizeof(uint32));
+
+    free(Output);
+    free(Emitted);
+    free(TriangleScore);
+    free(VertexScore);
+    free(CachePosition);
+    free(Adjacent);
+    free(FirstAdjacent);
+    free(Remaining);
+}
+
+//
+// Overdraw
+//
+
+struct overdraw_cluster
+{
+    uint32 FirstTriangle;
+    uint32 TriangleCount;
+    float SortKey;
+};
+
+static int CompareOverdrawClusters(const void *A, const void *B)
+{
+    overdraw_cluster *ClusterA = (overdraw_cluster *)A;
+    overdraw_cluster *ClusterB = (overdraw_cluster *)B;
+
+    // Note(joe): Highest key first, ties stay in cache order so the sort is stable.
+    int Result = (ClusterA->SortKey < ClusterB->SortKey) - (ClusterA->SortKey > ClusterB->SortKey);
+    if (Result == 0)
+    {
+        Result = (ClusterA->FirstTriangle > ClusterB->FirstTriangle) - (ClusterA->FirstTriangle < ClusterB->FirstTriangle);
+    }
+    return Result;
+}
+
+// Note(joe): Expects the indices to already be in vertex cache order.
+static void OptimizeOverdraw(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount)
+{
+    uint32 TriangleCount = IndexCount / 3;
+    if (TriangleCount < 2)
+    {
+        return;
+    }
+
+    // Note(joe): A hard boundary is a triangle that misses on every vertex, the cache
+    // had nothing to give it anyway so cutting there costs nothing.
+    uint8 *TriangleMisses = (uint8 *)malloc(TriangleCount);
+    uint32 Misses = 0;
+    SimulateVertexCache(Indices, IndexCount, VertexCount, MESH_STATS_CACHE_SIZE, &Misses, TriangleMisses);
+
+    overdraw_cluster *Clusters = (overdraw_cluster *)malloc(TriangleCount*sizeof(overdraw_cluster));
+    uint32 ClusterCount = 0;
+
+    // Note(joe): Same timestamp trick as SimulateVertexCache. Jumping the clock by
+    // more than the cache size empties it, every soft cluster is measured starting
+    // cold since once they're sorted nothing useful will be in the cache before them.
+    uint32 *InsertedAt = (uint32 *)calloc(VertexCount + 1, sizeof(uint32));
+    uint32 Time = 0;
+
+    for (uint32 HardStart = 0; HardStart < TriangleCount;)
+    {
+        uint32 HardEnd = HardStart + 1;
+        uint32 HardMisses = TriangleMisses[HardStart];
+        while (HardEnd < TriangleCount && TriangleMisses[HardEnd] != 3)
+        {
+            HardMisses += TriangleMisses[HardEnd++];
+        }
+        float HardACMR = (float)HardMisses / (float)(HardEnd - HardStart);
+
+        // Note(joe): Soft boundaries inside it, wherever the piece so far is already
+        // about as cache efficient on its own as the whole.
+        uint32 SoftStart = HardStart;
+        uint32 SoftMisses = 0;
+        Time += MESH_STATS_CACHE_SIZE + 1;
+        for (uint32 Triangle = HardStart; Triangle < HardEnd; ++Triangle)
+        {
+            for (uint32 Corner = 0; Corner < 3; ++Corner)
+            {
+                uint32 Vertex = Indices[Triangle*3 + Corner];
+                if (Time - InsertedAt[Vertex] > MESH_STATS_CACHE_SIZE)
+                {
+                    InsertedAt[Vertex] = Time++;
+                    ++SoftMisses;
+                }
+            }
+
+            uint32 SoftCount = Triangle + 1 - SoftStart;
+            bool AtEnd = (Triangle + 1 == HardEnd);
+            if (AtEnd || (float)SoftMisses <= OVERDRAW_THRESHOLD*HardACMR*(float)SoftCount)
+            {
+                overdraw_cluster *Cluster = Clusters + ClusterCount++;
+                Cluster->FirstTriangle = SoftStart;
+                Cluster->TriangleCount = SoftCount;
+                SoftStart = Triangle + 1;
+                SoftMisses = 0;
+                Time += MESH_STATS_CACHE_SIZE + 1;
+            }
+        }
+
+        HardStart = HardEnd;
+    }
+    free(InsertedAt);
+
+    // Note(joe): Area weighted centroids and normals.
+    float MeshCentroid[3] = {};
+    float MeshArea = 0.0f;
+    float *ClusterCentroids = (float *)calloc(ClusterCount, 3*sizeof(float));
+    float *ClusterNormals = (float *)calloc(ClusterCount, 3*sizeof(float));
+    for (uint32 ClusterIndex = 0; ClusterIndex < ClusterCount; ++ClusterIndex)
+    {
+        overdraw_cluster *Cluster = Clusters + ClusterIndex;
+        float *Centroid = ClusterCentroids + ClusterIndex*3;
+        float *Normal = ClusterNormals + ClusterIndex*3;
+        float ClusterArea = 0.0f;
+
+        for (uint32 Triangle = Cluster->FirstTriangle; Triangle < Cluster->FirstTriangle + Cluster->TriangleCount; ++Triangle)
+        {
+            float *A = Vertices[Indices[Triangle*3 + 0]].Position;
+            float *B = Vertices[Indices[Triangle*3 + 1]].Position;
+            float *C = Vertices[Indices[Triangle*3 + 2]].Position;
+
+            float AB[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+            float AC[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+            float Cross[3] = { AB[1]*AC[2] - AB[2]*AC[1], AB[2]*AC[0] - AB[0]*AC[2], AB[0]*AC[1] - AB[1]*AC[0] };
+            float Area = 0.5f*sqrtf(Cross[0]*Cross[0] + Cross[1]*Cross[1] + Cross[2]*Cross[2]);
+
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                float Center = (A[Axis] + B[Axis] + C[Axis]) / 3.0f;
+                Centroid[Axis] += Center*Area;
+                MeshCentroid[Axis] += Center*Area;
+                Normal[Axis] += Cross[Axis];
+            }
+            ClusterArea += Area;
+        }
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Centroid[Axis] = (ClusterArea > 0.0f) ? Centroid[Axis] / ClusterArea : Vertices[Indices[Cluster->FirstTriangle*3]].Position[Axis];
+        }
+        float NormalLength = sqrtf(Normal[0]*Normal[0] + Normal[1]*Normal[1] + Normal[2]*Normal[2]);
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Normal[Axis] = (NormalLength > 0.0f) ? Normal[Axis] / NormalLength : 0.0f;
+        }
+        MeshArea += ClusterArea;
+    }
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        MeshCentroid[Axis] = (MeshArea > 0.0f) ? MeshCentroid[Axis] / MeshArea : 0.0f;
+    }
+
+    for (uint32 ClusterIndex = 0; ClusterIndex < ClusterCount; ++ClusterIndex)
+    {
+        float *Centroid = ClusterCentroids + ClusterIndex*3;
+        float *Normal = ClusterNormals + ClusterIndex*3;
+        Clusters[ClusterIndex].SortKey = (Centroid[0] - MeshCentroid[0])*Normal[0] +
+                                         (Centroid[1] - MeshCentroid[1])*Normal[1] +
+                                         (Centroid[2] - MeshCentroid[2])*Normal[2];
+    }
+    qsort(Clusters, ClusterCount, sizeof(overdraw_cluster), CompareOverdrawClusters);
+
+    uint32 *Output = (uint32 *)malloc(TriangleCount*3*sizeof(uint32));
+    uint32 *Dest = Output;
+    for (uint32 ClusterIndex = 0; ClusterIndex < ClusterCount; ++ClusterIndex)
+    {
+        overdraw_cluster *Cluster = Clusters + ClusterIndex;
+        memcpy(Dest, Indices + Cluster->FirstTriangle*3, Cluster->TriangleCount*3*sizeof(uint32));
+        Dest += Cluster->TriangleCount*3;
+    }
+    memcpy(Indices, Output, TriangleCount*3*sizeof(uint32));
+
+    free(Output);
+    free(ClusterNormals);
+    free(ClusterCentroids);
+    free(Clusters);
+    free(TriangleMisses);
+}
+
+//
+// Vertex fetch
+//
+
+// Note(joe): Vertices nothing refers to end up at the back, in their old order.
+static void OptimizeVertexFetch(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount)
+{
+    uint32 *Remap = (uint32 *)malloc((VertexCount + 1)*sizeof(uint32));
+    for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+    {
+        Remap[Vertex] = 0xFFFFFFFF;
+    }
+
+    uint32 NextVertex = 0;
+    for (uint32 Index = 0; Index < IndexCount; ++Index)
+    {
+        uint32 *Vertex = Indices + Index;
+        if (Remap[*Vertex] == 0xFFFFFFFF)
+        {
+            Remap[*Vertex] = NextVertex++;
+        }
+        *Vertex = Remap[*Vertex];
+    }
+
+    aqmesh_vertex *Reordered = (aqmesh_vertex *)malloc((VertexCount + 1)*sizeof(aqmesh_vertex));
+    for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+    {
+        if (Remap[Vertex] == 0xFFFFFFFF)
+        {
+            Remap[Vertex] = NextVertex++;
+        }
+        Reordered[Remap[Vertex]] = Vertices[Vertex];
+    }
+    memcpy(Vertices, Reordered, VertexCount*sizeof(aqmesh_vertex));
+
+    free(Reordered);
+    free(Remap);
+}
+
+// Note(joe): All three passes on one mesh, in place.
+static void OptimizeMesh(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount)
+{
+    OptimizeVertexCache(Indices, IndexCount, VertexCount);
+    OptimizeOverdraw(Vertices, VertexCount, Indices, IndexCount);
+    OptimizeVertexFetch(Vertices, VertexCount, Indices, IndexCount);
+}
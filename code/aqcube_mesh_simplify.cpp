@@ -0,0 +1,447 @@
+// Note(joe): Builds the LOD chain for a cooked mesh. Each LOD is made by edge
+// collapses ordered by Garland and Heckbert's quadric error metric: every vertex
+// carries the sum of the planes of the triangles that have ever touched it,
+// weighted by their area, and collapsing an edge costs the mean squared distance
+// of the surviving vertex from all of those planes.
+//
+// Collapses are half-edge, one end of the edge moves onto the other, so a LOD is
+// nothing but a new index list over the mesh's existing vertices. The LODs all
+// share the full mesh's vertex range.
+//
+// A vertex only moves if it's safe to move it:
+//
+//   - Vertices on a seam (the same position in more than one different vertex,
+//     where UVs or normals are split) stay put, so the seam stays exactly where it
+//     was. Vertices that are exact copies are treated as one, they're no seam.
+//   - Vertices on an open edge stay put. A mesh has one material, so this is what
+//     keeps material boundaries, and the edges other meshes butt up against,
+//     from opening cracks.
+//   - A collapse that would flip any of the triangles around it is skipped.
+//
+// This is cooker only code, it allocates as it likes.
+
+#include <math.h>
+#include <stdlib.h>
+
+// Note(joe): A LOD that doesn't get rid of at least this much of the one before it
+// isn't worth its indices, the chain stops there.
+#define LOD_MIN_REDUCTION 0.9f
+
+// Note(joe): Symmetric 4x4, upper triangle only. Doubles, the plane products lose
+// too much in float once a few hundred have been summed.
+struct quadric
+{
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double Weight; // Total area of the planes.
+};
+
+inline void AddPlaneQuadric(quadric *Q, double a, double b, double c, double d, double Weight)
+{
+    Q->a2 += Weight*a*a; Q->ab += Weight*a*b; Q->ac += Weight*a*c; Q->ad += Weight*a*d;
+    Q->b2 += Weight*b*b; Q->bc += Weight*b*c; Q->bd += Weight*b*d;
+    Q->c2 += Weight*c*c; Q->cd += Weight*c*d;
+    Q->d2 += Weight*d*d;
+    Q->Weight += Weight;
+}
+
+inline void AddQuadric(quadric *Dest, quadric *Source)
+{
+    Dest->a2 += Source->a2; Dest->ab += Source->ab; Dest->ac += Source->ac; Dest->ad += Source->ad;
+    Dest->b2 += Source->b2; Dest->bc += Source->bc; Dest->bd += Source->bd;
+    Dest->c2 += Source->c2; Dest->cd += Source->cd;
+    Dest->d2 += Source->d2;
+    Dest->Weight += Source->Weight;
+}
+
+// Note(joe): Area weighted mean of the squared distances from P to the planes in
+// A + B, so its square root is in model units whatever the triangle count.
+inline double EvaluateQuadricSum(quadric *A, quadric *B, float *P)
+{
+    double x = P[0], y = P[1], z = P[2];
+    double a2 = A->a2 + B->a2, ab = A->ab + B->ab, ac = A->ac + B->ac, ad = A->ad + B->ad;
+    double b2 = A->b2 + B->b2, bc = A->bc + B->bc, bd = A->bd + B->bd;
+    double c2 = A->c2 + B->c2, cd = A->cd + B->cd;
+    double d2 = A->d2 + B->d2;
+
+    double Result = a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x +
+                    b2*y*y + 2.0*bc*y*z + 2.0*bd*y +
+                    c2*z*z + 2.0*cd*z +
+                    d2;
+    double Weight = A->Weight + B->Weight;
+    return (Result > 0.0 && Weight > 0.0) ? Result / Weight : 0.0;
+}
+
+inline void TriangleNormal(float *A, float *B, float *C, float *Normal)
+{
+    float AB[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+    float AC[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+    Normal[0] = AB[1]*AC[2] - AB[2]*AC[1];
+    Normal[1] = AB[2]*AC[0] - AB[0]*AC[2];
+    Normal[2] = AB[0]*AC[1] - AB[1]*AC[0];
+}
+
+inline uint32 HashPosition(float *Position)
+{
+    uint32 Bits[3];
+    memcpy(Bits, Position, sizeof(Bits));
+    uint32 Result = (Bits[0]*73856093u) ^ (Bits[1]*19349663u) ^ (Bits[2]*83492791u);
+    return Result;
+}
+
+inline uint64 HashEdge(uint32 A, uint32 B)
+{
+    uint64 Key = (A < B) ? (((uint64)A << 32) | B) : (((uint64)B << 32) | A);
+    Key ^= Key >> 33;
+    Key *= 0xff51afd7ed558ccdull;
+    Key ^= Key >> 33;
+    return Key;
+}
+
+struct edge_collapse
+{
+    uint32 From;
+    uint32 To;
+    float Cost;
+};
+
+static int CompareEdgeCollapses(const void *A, const void *B)
+{
+    float CostA = ((edge_collapse *)A)->Cost;
+    float CostB = ((edge_collapse *)B)->Cost;
+    int Result = (CostA > CostB) - (CostA < CostB);
+    return Result;
+}
+
+// Note(joe): Simplifies towards TargetIndexCount and writes what's left to Dest,
+// which has to have room for IndexCount indices. Returns the index count it got to,
+// which is more than asked for when it ran out of safe collapses. Error is how far,
+// in model units, the result can be from the original surface.
+static uint32 SimplifyMesh(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount,
+                           uint32 TargetIndexCount, uint32 *Dest, float *Error)
+{
+    IndexCount -= IndexCount % 3;
+    memcpy(Dest, Indices, IndexCount*sizeof(uint32));
+    *Error = 0.0f;
+    if (IndexCount <= TargetIndexCount || VertexCount == 0)
+    {
+        return IndexCount;
+    }
+
+    // Note(joe): Exact copies become the first of them, so the edges between them
+    // are shared and nothing is mistaken for a seam.
+    uint32 *Duplicates = (uint32 *)malloc(VertexCount*sizeof(uint32));
+    FindDuplicateVertices(Vertices, VertexCount, Duplicates);
+    for (uint32 Index = 0; Index < IndexCount; ++Index)
+    {
+        Dest[Index] = Duplicates[Dest[Index]];
+    }
+
+    // Note(joe): Weld by exact position. Position[v] is the first vertex with v's
+    // position, Wedges counts how many different vertices share it.
+    uint32 *Position = (uint32 *)malloc(VertexCount*sizeof(uint32));
+    uint32 *Wedges = (uint32 *)calloc(VertexCount, sizeof(uint32));
+    {
+        uint32 TableSize = GetHashTableSize(VertexCount);
+        uint32 *Table = (uint32 *)malloc(TableSize*sizeof(uint32));
+        memset(Table, 0xFF, TableSize*sizeof(uint32));
+        for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+        {
+            if (Duplicates[Vertex] != Vertex)
+            {
+                Position[Vertex] = Position[Duplicates[Vertex]];
+                continue;
+            }
+
+            float *P = Vertices[Vertex].Position;
+            uint32 Slot = HashPosition(P) & (TableSize - 1);
+            while (Table[Slot] != 0xFFFFFFFF && memcmp(Vertices[Table[Slot]].Position, P, 3*sizeof(float)) != 0)
+            {
+                Slot = (Slot + 1) & (TableSize - 1);
+            }
+            if (Table[Slot] == 0xFFFFFFFF)
+            {
+                Table[Slot] = Vertex;
+            }
+            Position[Vertex] = Table[Slot];
+            ++Wedges[Position[Vertex]];
+        }
+        free(Table);
+    }
+
+    // Note(joe): Count how many triangles use each welded edge. One is an open edge,
+    // more than two is non-manifold, both lock their ends.
+    uint8 *Locked = (uint8 *)calloc(VertexCount, sizeof(uint8));
+    {
+        uint32 EdgeTableSize = GetHashTableSize(IndexCount);
+        uint64 *EdgeKeys = (uint64 *)malloc(EdgeTableSize*sizeof(uint64));
+        uint32 *EdgeCounts = (uint32 *)calloc(EdgeTableSize, sizeof(uint32));
+        memset(EdgeKeys, 0xFF, EdgeTableSize*sizeof(uint64));
+        for (uint32 Index = 0; Index < IndexCount; ++Index)
+        {
+            uint32 A = Position[Dest[Index]];
+            uint32 B = Position[Dest[(Index % 3 == 2) ? Index - 2 : Index + 1]];
+            uint64 Key = (A < B) ? (((uint64)A << 32) | B) : (((uint64)B << 32) | A);
+            uint32 Slot = (uint32)HashEdge(A, B) & (EdgeTableSize - 1);
+            while (EdgeKeys[Slot] != 0xFFFFFFFFFFFFFFFFull && EdgeKeys[Slot] != Key)
+            {
+                Slot = (Slot + 1) & (EdgeTableSize - 1);
+            }
+            EdgeKeys[Slot] = Key;
+            ++EdgeCounts[Slot];
+        }
+        for (uint32 Slot = 0; Slot < EdgeTableSize; ++Slot)
+        {
+            if (EdgeCounts[Slot] && EdgeCounts[Slot] != 2)
+            {
+                Locked[(uint32)(EdgeKeys[Slot] >> 32)] = 1;
+                Locked[(uint32)(EdgeKeys[Slot] & 0xFFFFFFFF)] = 1;
+            }
+        }
+        free(EdgeCounts);
+        free(EdgeKeys);
+    }
+    for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+    {
+        if (Wedges[Position[Vertex]] > 1 || Locked[Position[Vertex]])
+        {
+            Locked[Vertex] = 1;
+        }
+    }
+
+    // Note(joe): Quadrics live on the welded position, every wedge sees the same one.
+    quadric *Quadrics = (quadric *)calloc(VertexCount, sizeof(quadric));
+    for (uint32 Index = 0; Index < IndexCount; Index += 3)
+    {
+        float *A = Vertices[Dest[Index + 0]].Position;
+        float *B = Vertices[Dest[Index + 1]].Position;
+        float *C = Vertices[Dest[Index + 2]].Position;
+        float Normal[3];
+        TriangleNormal(A, B, C, Normal);
+        double Length = sqrt((double)Normal[0]*Normal[0] + (double)Normal[1]*Normal[1] + (double)Normal[2]*Normal[2]);
+        if (Length > 0.0)
+        {
+            double a = Normal[0] / Length, b = Normal[1] / Length, c = Normal[2] / Length;
+            double d = -(a*A[0] + b*A[1] + c*A[2]);
+            for (uint32 Corner = 0; Corner < 3; ++Corner)
+            {
+                AddPlaneQuadric(Quadrics + Position[Dest[Index + Corner]], a, b, c, d, 0.5*Length);
+            }
+        }
+    }
+
+    uint32 *FirstAdjacent = (uint32 *)malloc((VertexCount + 1)*sizeof(uint32));
+    uint32 *Adjacent = (uint32 *)malloc(IndexCount*sizeof(uint32));
+    uint32 *Remap = (uint32 *)malloc(VertexCount*sizeof(uint32));
+    uint8 *Touched = (uint8 *)malloc(VertexCount);
+    // Note(joe): Both directions of every triangle edge.
+    edge_collapse *Collapses = (edge_collapse *)malloc(2*IndexCount*sizeof(edge_collapse));
+    double MaxCost = 0.0;
+
+    while (IndexCount > TargetIndexCount)
+    {
+        // Note(joe): Which triangles use each vertex, rebuilt every pass.
+        memset(FirstAdjacent, 0, (VertexCount + 1)*sizeof(uint32));
+        for (uint32 Index = 0; Index < IndexCount; ++Index)
+        {
+            ++FirstAdjacent[Dest[Index] + 1];
+        }
+        for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+        {
+            FirstAdjacent[Vertex + 1] += FirstAdjacent[Vertex];
+        }
+        for (uint32 Index = 0; Index < IndexCount; ++Index)
+        {
+            Adjacent[FirstAdjacent[Dest[Index]]++] = Index / 3;
+        }
+        for (uint32 Vertex = VertexCount; Vertex > 0; --Vertex)
+        {
+            FirstAdjacent[Vertex] = FirstAdjacent[Vertex - 1];
+        }
+        FirstAdjacent[0] = 0;
+
+        // Note(joe): Every edge out of a free vertex, cheapest first. Edges show up
+        // once per triangle, the duplicates are harmless.
+        uint32 CollapseCount = 0;
+        for (uint32 Index = 0; Index < IndexCount; ++Index)
+        {
+            uint32 From = Dest[Index];
+            uint32 To = Dest[(Index % 3 == 2) ? Index - 2 : Index + 1];
+            for (uint32 Direction = 0; Direction < 2; ++Direction)
+            {
+                if (!Locked[From])
+                {
+                    edge_collapse *Collapse = Collapses + CollapseCount++;
+                    Collapse->From = From;
+                    Collapse->To = To;
+                    Collapse->Cost = (float)EvaluateQuadricSum(Quadrics + Position[From], Quadrics + Position[To], Vertices[To].Position);
+                }
+                uint32 Swap = From;
+                From = To;
+                To = Swap;
+            }
+        }
+        if (CollapseCount == 0)
+        {
+            break;
+        }
+        qsort(Collapses, CollapseCount, sizeof(edge_collapse), CompareEdgeCollapses);
+
+        // Note(joe): Each vertex can only be in one collapse a pass, neighbours
+        // included, so the flip checks stay valid while the pass goes on.
+        for (uint32 Vertex = 0; Vertex < VertexCount; ++Vertex)
+        {
+            Remap[Vertex] = Vertex;
+        }
+        memset(Touched, 0, VertexCount);
+
+        uint32 RemovedIndexCount = 0;
+        uint32 CollapsesDone = 0;
+        for (uint32 CollapseIndex = 0;
+             CollapseIndex < CollapseCount && IndexCount - RemovedIndexCount > TargetIndexCount;
+             ++CollapseIndex)
+        {
+            edge_collapse *Collapse = Collapses + CollapseIndex;
+            uint32 From = Collapse->From;
+            uint32 To = Collapse->To;
+            if (Touched[From] || Touched[To])
+            {
+                continue;
+            }
+
+            bool Flips = false;
+            uint32 SharedCount = 0;
+            float *Target = Vertices[To].Position;
+            for (uint32 i = FirstAdjacent[From]; !Flips && i < FirstAdjacent[From + 1]; ++i)
+            {
+                uint32 *Triangle = Dest + Adjacent[i]*3;
+                if (Triangle[0] == To || Triangle[1] == To || Triangle[2] == To)
+                {
+                    ++SharedCount;
+                    continue;
+                }
+
+                float *Corners[3];
+                float *Moved[3];
+                for (uint32 Corner = 0; Corner < 3; ++Corner)
+                {
+                    Corners[Corner] = Vertices[Triangle[Corner]].Position;
+                    Moved[Corner] = (Triangle[Corner] == From) ? Target : Corners[Corner];
+                }
+                float Before[3], After[3];
+                TriangleNormal(Corners[0], Corners[1], Corners[2], Before);
+                TriangleNormal(Moved[0], Moved[1], Moved[2], After);
+                float Dot = Before[0]*After[0] + Before[1]*After[1] + Before[2]*After[2];
+                float LengthProduct = sqrtf((Before[0]*Before[0] + Before[1]*Before[1] + Before[2]*Before[2])*
+                                            (After[0]*After[0] + After[1]*After[1] + After[2]*After[2]));
+                Flips = (Dot <= 0.25f*LengthProduct);
+            }
+            if (Flips || SharedCount == 0)
+            {
+                continue;
+            }
+
+            Remap[From] = To;
+            Touched[From] = 1;
+            Touched[To] = 1;
+            for (uint32 i = FirstAdjacent[From]; i < FirstAdjacent[From + 1]; ++i)
+            {
+                uint32 *Triangle = Dest + Adjacent[i]*3;
+                Touched[Triangle[0]] = 1;
+                Touched[Triangle[1]] = 1;
+                Touched[Triangle[2]] = 1;
+            }
+
+            AddQuadric(Quadrics + Position[To], Quadrics + Position[From]);
+            MaxCost = (Collapse->Cost > MaxCost) ? Collapse->Cost : MaxCost;
+            RemovedIndexCount += SharedCount*3;
+            ++CollapsesDone;
+        }
+        if (CollapsesDone == 0)
+        {
+            break;
+        }
+
+        // Note(joe): Apply the pass and drop whatever collapsed to nothing, which
+        // includes triangles whose corners are different wedges of one position.
+        uint32 KeptIndexCount = 0;
+        for (uint32 Index = 0; Index < IndexCount; Index += 3)
+        {
+            uint32 A = Remap[Dest[Index + 0]];
+            uint32 B = Remap[Dest[Index + 1]];
+            uint32 C = Remap[Dest[Index + 2]];
+            if (Position[A] != Position[B] && Position[B] != Position[C] && Position[C] != Position[A])
+            {
+                Dest[KeptIndexCount++] = A;
+                Dest[KeptIndexCount++] = B;
+                Dest[KeptIndexCount++] = C;
+            }
+        }
+        IndexCount = KeptIndexCount;
+    }
+
+    *Error = (float)sqrt(MaxCost);
+
+    free(Collapses);
+    free(Touched);
+    free(Remap);
+    free(Adjacent);
+    free(FirstAdjacent);
+    free(Quadrics);
+    free(Locked);
+    free(Wedges);
+    free(Position);
+    free(Duplicates);
+
+    return IndexCount;
+}
+
+// Note(joe): Fills in Lods and writes every LOD's indices one after the other into
+// Dest, which needs room for IndexCount*MaxLods. LOD 0 is the mesh as it is and each
+// one after aims for Ratio of the triangles of the one before. They're all simplified
+// from LOD 0 rather than from each other, so the errors are against the real surface.
+// Returns how many LODs were made, FirstIndex is relative to Dest. Lods holds
+// AQMESH_MAX_LODS, asking for more than that gets that many.
+static uint32 BuildLodChain(aqmesh_vertex *Vertices, uint32 VertexCount, uint32 *Indices, uint32 IndexCount,
+                            uint32 MaxLods, float Ratio, uint32 *Dest, aqmesh_lod *Lods)
+{
+    if (MaxLods > AQMESH_MAX_LODS)
+    {
+        MaxLods = AQMESH_MAX_LODS;
+    }
+
+    memcpy(Dest, Indices, IndexCount*sizeof(uint32));
+    Lods[0].FirstIndex = 0;
+    Lods[0].IndexCount = IndexCount;
+    Lods[0].Error = 0.0f;
+
+    uint32 LodCount = 1;
+    uint32 NextIndex = IndexCount;
+    float Target = (float)IndexCount;
+    while (LodCount < MaxLods)
+    {
+        aqmesh_lod *Previous = Lods + LodCount - 1;
+        Target *= Ratio;
+        uint32 TargetIndexCount = (uint32)(Target / 3.0f)*3;
+
+        float Error;
+        uint32 *LodIndices = Dest + NextIndex;
+        uint32 LodIndexCount = SimplifyMesh(Vertices, VertexCount, Indices, IndexCount, TargetIndexCount, LodIndices, &Error);
+        if (LodIndexCount == 0 || (float)LodIndexCount > LOD_MIN_REDUCTION*(float)Previous->IndexCount)
+        {
+            break;
+        }
+
+        OptimizeVertexCache(LodIndices, LodIndexCount, VertexCount);
+
+        aqmesh_lod *Lod = Lods + LodCount++;
+        Lod->FirstIndex = NextIndex;
+        Lod->IndexCount = LodIndexCount;
+        Lod->Error = (Error > Previous->Error) ? Error : Previous->Error;
+        NextIndex += LodIndexCount;
+    }
+
+    return LodCount;
+}
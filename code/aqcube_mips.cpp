@@ -0,0 +1,467 @@
+// Note(joe): Builds a full mip chain on the CPU, so the cooker can bake it into the
+// file and the runtime never has to call glGenerateMipmap.
+//
+// Every level is filtered from the float version of the level above it, never
+// from the 8 bit one, so rounding doesn't pile up down the chain. The filters are
+// separable: a horizontal pass into a scratch image and then a vertical one. Each
+// pixel is one RGBA float4, which is exactly one SSE register, and the scalar
+// path does the same thing a channel at a time.
+//
+// Colour maps are filtered in linear light (decode sRGB, filter, encode again),
+// otherwise the smaller levels come out too dark. Normal maps are filtered as
+// vectors and renormalised on every level.
+//
+// Nothing in here allocates. Callers size the output with GetMipChainSize and hand
+// in a scratch buffer of GetMipScratchSize bytes.
+
+#include <math.h>
+#include "aqcube_simd.h"
+
+enum mip_filter
+{
+    MipFilter_Box,
+    MipFilter_Kaiser,
+    MipFilter_Lanczos,
+};
+
+enum mip_content
+{
+    MipContent_Linear,
+    MipContent_SRGB,
+    MipContent_Normal,
+};
+
+// Note(joe): Worst case is 3 pixels down to 1 with a radius 3 filter.
+#define MIP_MAX_TAPS 24
+
+// Note(joe): One axis worth of weights. Every destination pixel reads TapCount
+// source pixels starting at First. Taps that fall off the edge have already been
+// folded onto the edge pixel, so the passes never need to clamp.
+struct mip_kernel
+{
+    uint32 TapCount;
+    uint32 *First;
+    float *Weights;
+};
+
+inline uint32 GetNextMipSize(uint32 Size)
+{
+    uint32 Result = (Size > 1) ? Size / 2 : 1;
+    return Result;
+}
+
+inline uint32 GetMipLevelCount(uint32 Width, uint32 Height)
+{
+    uint32 Result = 1;
+    while ((Width > 1 || Height > 1) && Result < MAX_TEXTURE_LEVELS)
+    {
+        Width = GetNextMipSize(Width);
+        Height = GetNextMipSize(Height);
+        ++Result;
+    }
+    return Result;
+}
+
+// Note(joe): Bytes needed for every level at ComponentCount bytes a pixel, packed
+// one after another with no padding.
+inline uint64 GetMipChainSize(uint32 Width, uint32 Height, uint32 ComponentCount)
+{
+    uint64 Result = 0;
+    uint32 LevelCount = GetMipLevelCount(Width, Height);
+    for (uint32 LevelIndex = 0; LevelIndex < LevelCount; ++LevelIndex)
+    {
+        Result += (uint64)Width*Height*ComponentCount;
+        Width = GetNextMipSize(Width);
+        Height = GetNextMipSize(Height);
+    }
+    return Result;
+}
+
+inline uint64 GetMipScratchSize(uint32 Width, uint32 Height)
+{
+    uint64 NextWidth = GetNextMipSize(Width);
+    uint64 NextHeight = GetNextMipSize(Height);
+    uint64 MaxDest = (NextWidth > NextHeight) ? NextWidth : NextHeight;
+
+    uint64 Result = 0;
+    Result += (uint64)Width*Height*4*sizeof(float);       // Current level
+    Result += NextWidth*NextHeight*4*sizeof(float);       // Next level
+    Result += NextWidth*Height*4*sizeof(float);           // Horizontal pass
+    Result += 2*MaxDest*MIP_MAX_TAPS*sizeof(float);       // Kernel weights
+    Result += 2*MaxDest*sizeof(uint32);                   // Kernel first taps
+    Result += 64;                                         // Alignment
+    return Result;
+}
+
+inline static float Sinc(float x)
+{
+    float Result = 1.0f;
+    if (fabsf(x) > 1e-5f)
+    {
+        float PiX = 3.14159265f*x;
+        Result = sinf(PiX) / PiX;
+    }
+    return Result;
+}
+
+// Note(joe): Zeroth order modified Bessel function, for the Kaiser window.
+static float BesselI0(float x)
+{
+    float Result = 1.0f;
+    float Term = 1.0f;
+    float HalfX = 0.5f*x;
+    for (int k = 1; k < 32; ++k)
+    {
+        Term *= (HalfX / (float)k)*(HalfX / (float)k);
+        Result += Term;
+        if (Term < 1e-8f*Result)
+        {
+            break;
+        }
+    }
+    return Result;
+}
+
+// Note(joe): Filter radius in destination pixels.
+static float GetFilterRadius(mip_filter Filter)
+{
+    float Result = (Filter == MipFilter_Box) ? 0.5f : 3.0f;
+    return Result;
+}
+
+// Note(joe): t is the distance from the destination pixel centre, in destination
+// pixels. Kaiser uses alpha 4, which trades a little sharpness for less ringing
+// than Lanczos.
+static float EvaluateFilter(mip_filter Filter, float t)
+{
+    float Result = 0.0f;
+    float Radius = GetFilterRadius(Filter);
+    float AbsT = fabsf(t);
+    if (AbsT < Radius)
+    {
+        switch (Filter)
+        {
+            case MipFilter_Box:
+            {
+                Result = 1.0f;
+            } break;
+
+            case MipFilter_Kaiser:
+            {
+                float Alpha = 4.0f;
+                float Ratio = t / Radius;
+                Result = Sinc(t)*BesselI0(Alpha*sqrtf(1.0f - Ratio*Ratio)) / BesselI0(Alpha);
+            } break;
+
+            case MipFilter_Lanczos:
+            {
+                Result = Sinc(t)*Sinc(t / Radius);
+            } break;
+        }
+    }
+    return Result;
+}
+
+static void BuildMipKernel(mip_kernel *Kernel, mip_filter Filter, uint32 SourceCount, uint32 DestCount)
+{
+    float Scale = (float)SourceCount / (float)DestCount;
+    float SourceRadius = GetFilterRadius(Filter)*Scale;
+
+    uint32 TapCount = (uint32)ceilf(2.0f*SourceRadius) + 1;
+    if (TapCount > SourceCount)
+    {
+        TapCount = SourceCount;
+    }
+    assert(TapCount <= MIP_MAX_TAPS);
+    Kernel->TapCount = TapCount;
+
+    for (uint32 DestIndex = 0; DestIndex < DestCount; ++DestIndex)
+    {
+        float Center = ((float)DestIndex + 0.5f)*Scale;
+        int32 Begin = (int32)ceilf(Center - SourceRadius - 0.5f);
+        int32 End = (int32)floorf(Center + SourceRadius - 0.5f);
+
+        int32 First = Begin;
+        if (First > (int32)(SourceCount - TapCount)) First = (int32)(SourceCount - TapCount);
+        if (First < 0) First = 0;
+        Kernel->First[DestIndex] = (uint32)First;
+
+        float *Weights = Kernel->Weights + DestIndex*TapCount;
+        for (uint32 Tap = 0; Tap < TapCount; ++Tap)
+        {
+            Weights[Tap] = 0.0f;
+        }
+
+        float WeightSum = 0.0f;
+        for (int32 SourceIndex = Begin; SourceIndex <= End; ++SourceIndex)
+        {
+            float Weight = EvaluateFilter(Filter, ((float)SourceIndex + 0.5f - Center) / Scale);
+            int32 Clamped = SourceIndex;
+            if (Clamped < 0) Clamped = 0;
+            if (Clamped > (int32)SourceCount - 1) Clamped = (int32)SourceCount - 1;
+            Weights[Clamped - First] += Weight;
+            WeightSum += Weight;
+        }
+
+        for (uint32 Tap = 0; Tap < TapCount; ++Tap)
+        {
+            Weights[Tap] /= WeightSum;
+        }
+    }
+}
+
+static void ResampleRows(float *Source, uint32 SourceWidth, uint32 Height, float *Dest, uint32 DestWidth, mip_kernel *Kernel)
+{
+    uint32 TapCount = Kernel->TapCount;
+    for (uint32 y = 0; y < Height; ++y)
+    {
+        float *SourceRow = Source + (uint64)y*SourceWidth*4;
+        float *DestRow = Dest + (uint64)y*DestWidth*4;
+        for (uint32 x = 0; x < DestWidth; ++x)
+        {
+            float *Taps = SourceRow + Kernel->First[x]*4;
+            float *Weights = Kernel->Weights + x*TapCount;
+#if AQCUBE_SSE2
+            __m128 Sum = _mm_setzero_ps();
+            for (uint32 Tap = 0; Tap < TapCount; ++Tap)
+            {
+                Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Weights[Tap]), _mm_load_ps(Taps + Tap*4)));
+            }
+            _mm_store_ps(DestRow + x*4, Sum);
+#else
+            float Sum[4] = {};
+            for (uint32 Tap = 0; Tap < TapCount; ++Tap)
+            {
+                for (int Channel = 0; Channel < 4; ++Channel)
+                {
+                    Sum[Channel] += Weights[Tap]*Taps[Tap*4 + Channel];
+                }
+            }
+            for (int Channel = 0; Channel < 4; ++Channel)
+            {
+                DestRow[x*4 + Channel] = Sum[Channel];
+            }
+#endif
+        }
+    }
+}
+
+// Note(joe): Accumulates whole source rows into each destination row, so both
+// sides stream through memory.
+static void ResampleColumns(float *Source, uint32 Width, float *Dest, uint32 DestHeight, mip_kernel *Kernel)
+{
+    uint32 TapCount = Kernel->TapCount;
+    uint32 FloatCount = Width*4;
+    for (uint32 y = 0; y < DestHeight; ++y)
+    {
+        float *DestRow = Dest + (uint64)y*FloatCount;
+        float *Weights = Kernel->Weights + y*TapCount;
+        for (uint32 Index = 0; Index < FloatCount; ++Index)
+        {
+            DestRow[Index] = 0.0f;
+        }
+
+        for (uint32 Tap = 0; Tap < TapCount; ++Tap)
+        {
+            float *SourceRow = Source + (uint64)(Kernel->First[y] + Tap)*FloatCount;
+#if AQCUBE_SSE2
+            __m128 Weight = _mm_set1_ps(Weights[Tap]);
+            for (uint32 Index = 0; Index < FloatCount; Index += 4)
+            {
+                __m128 Sum = _mm_load_ps(DestRow + Index);
+                _mm_store_ps(DestRow + Index, _mm_add_ps(Sum, _mm_mul_ps(Weight, _mm_load_ps(SourceRow + Index))));
+            }
+#else
+            float Weight = Weights[Tap];
+            for (uint32 Index = 0; Index < FloatCount; ++Index)
+            {
+                DestRow[Index] += Weight*SourceRow[Index];
+            }
+#endif
+        }
+    }
+}
+
+static void RenormalizeLevel(float *Pixels, uint32 PixelCount)
+{
+    for (uint32 PixelIndex = 0; PixelIndex < PixelCount; ++PixelIndex)
+    {
+        float *N = Pixels + PixelIndex*4;
+        float LengthSquared = N[0]*N[0] + N[1]*N[1] + N[2]*N[2];
+        if (LengthSquared > 1e-12f)
+        {
+            float InvLength = 1.0f / sqrtf(LengthSquared);
+            N[0] *= InvLength;
+            N[1] *= InvLength;
+            N[2] *= InvLength;
+        }
+        else
+        {
+            N[0] = 0.0f;
+            N[1] = 0.0f;
+            N[2] = 1.0f;
+        }
+    }
+}
+
+#define MIP_SRGB_ENCODE_SIZE 4096
+
+// Note(joe): Decode is exact off a 256 entry table. Encode goes through a 4096 entry
+// table over [0, 1], which is finer than 8 bit sRGB needs anywhere on the curve.
+struct mip_color_tables
+{
+    float Decode[256];
+    uint8 Encode[MIP_SRGB_ENCODE_SIZE];
+};
+
+static void BuildMipColorTables(mip_color_tables *Tables, mip_content Content)
+{
+    for (int Value = 0; Value < 256; ++Value)
+    {
+        float Unorm = (float)Value / 255.0f;
+        if (Content == MipContent_SRGB)
+        {
+            Unorm = (Unorm <= 0.04045f) ? Unorm / 12.92f : powf((Unorm + 0.055f) / 1.055f, 2.4f);
+        }
+        else if (Content == MipContent_Normal)
+        {
+            Unorm = 2.0f*Unorm - 1.0f;
+        }
+        Tables->Decode[Value] = Unorm;
+    }
+
+    for (int Index = 0; Index < MIP_SRGB_ENCODE_SIZE; ++Index)
+    {
+        float Linear = (float)Index / (float)(MIP_SRGB_ENCODE_SIZE - 1);
+        float Encoded = (Linear <= 0.0031308f) ? 12.92f*Linear : 1.055f*powf(Linear, 1.0f / 2.4f) - 0.055f;
+        Tables->Encode[Index] = (uint8)(Encoded*255.0f + 0.5f);
+    }
+}
+
+static void ExpandLevel(uint8 *Source, uint32 PixelCount, uint32 ComponentCount, mip_color_tables *Tables, float *Dest)
+{
+    for (uint32 PixelIndex = 0; PixelIndex < PixelCount; ++PixelIndex)
+    {
+        uint8 *In = Source + PixelIndex*ComponentCount;
+        float *Out = Dest + PixelIndex*4;
+        for (uint32 Channel = 0; Channel < 4; ++Channel)
+        {
+            if (Channel < ComponentCount)
+            {
+                // Note(joe): Alpha is coverage, never colour or a vector component.
+                Out[Channel] = (Channel == 3) ? (float)In[Channel] / 255.0f : Tables->Decode[In[Channel]];
+            }
+            else
+            {
+                Out[Channel] = (Channel == 3) ? 1.0f : 0.0f;
+            }
+        }
+    }
+}
+
+inline static uint8 QuantizeUnorm(float Value)
+{
+    if (Value < 0.0f) Value = 0.0f;
+    if (Value > 1.0f) Value = 1.0f;
+    uint8 Result = (uint8)(Value*255.0f + 0.5f);
+    return Result;
+}
+
+static void QuantizeLevel(float *Source, uint32 PixelCount, uint32 ComponentCount, mip_content Content,
+                          mip_color_tables *Tables, uint8 *Dest)
+{
+    for (uint32 PixelIndex = 0; PixelIndex < PixelCount; ++PixelIndex)
+    {
+        float *In = Source + PixelIndex*4;
+        uint8 *Out = Dest + PixelIndex*ComponentCount;
+        for (uint32 Channel = 0; Channel < ComponentCount; ++Channel)
+        {
+            float Value = In[Channel];
+            if (Channel == 3)
+            {
+                Out[Channel] = QuantizeUnorm(Value);
+            }
+            else if (Content == MipContent_SRGB)
+            {
+                // Note(joe): The sharper filters overshoot, so clamp before the lookup.
+                if (Value < 0.0f) Value = 0.0f;
+                if (Value > 1.0f) Value = 1.0f;
+                Out[Channel] = Tables->Encode[(uint32)(Value*(MIP_SRGB_ENCODE_SIZE - 1) + 0.5f)];
+            }
+            else if (Content == MipContent_Normal)
+            {
+                Out[Channel] = QuantizeUnorm(0.5f*Value + 0.5f);
+            }
+            else
+            {
+                Out[Channel] = QuantizeUnorm(Value);
+            }
+        }
+    }
+}
+
+inline static float *AlignFloats(uint8 *Memory)
+{
+    float *Result = (float *)(((uintptr_t)Memory + 15) & ~(uintptr_t)15);
+    return Result;
+}
+
+// Note(joe): Source is the top level with ComponentCount bytes a pixel (1-4). Output
+// gets every level in the same layout, level 0 copied through as is. Returns the
+// number of levels written.
+static uint32 BuildMipChain(uint8 *Source, uint32 Width, uint32 Height, uint32 ComponentCount,
+                            mip_filter Filter, mip_content Content, uint8 *Output, void *Scratch)
+{
+    uint32 LevelCount = GetMipLevelCount(Width, Height);
+
+    uint32 NextWidth = GetNextMipSize(Width);
+    uint32 NextHeight = GetNextMipSize(Height);
+    uint32 MaxDest = (NextWidth > NextHeight) ? NextWidth : NextHeight;
+
+    float *Current = AlignFloats((uint8 *)Scratch);
+    float *Next = Current + (uint64)Width*Height*4;
+    float *Horizontal = Next + (uint64)NextWidth*NextHeight*4;
+    mip_kernel RowKernel, ColumnKernel;
+    RowKernel.Weights = Horizontal + (uint64)NextWidth*Height*4;
+    ColumnKernel.Weights = RowKernel.Weights + MaxDest*MIP_MAX_TAPS;
+    RowKernel.First = (uint32 *)(ColumnKernel.Weights + MaxDest*MIP_MAX_TAPS);
+    ColumnKernel.First = RowKernel.First + MaxDest;
+
+    mip_color_tables Tables;
+    BuildMipColorTables(&Tables, Content);
+
+    uint64 LevelSize = (uint64)Width*Height*ComponentCount;
+    memcpy(Output, Source, (size_t)LevelSize);
+    ExpandLevel(Source, Width*Height, ComponentCount, &Tables, Current);
+    Output += LevelSize;
+
+    uint32 LevelWidth = Width;
+    uint32 LevelHeight = Height;
+    for (uint32 LevelIndex = 1; LevelIndex < LevelCount; ++LevelIndex)
+    {
+        NextWidth = GetNextMipSize(LevelWidth);
+        NextHeight = GetNextMipSize(LevelHeight);
+
+        BuildMipKernel(&RowKernel, Filter, LevelWidth, NextWidth);
+        BuildMipKernel(&ColumnKernel, Filter, LevelHeight, NextHeight);
+        ResampleRows(Current, LevelWidth, LevelHeight, Horizontal, NextWidth, &RowKernel);
+        ResampleColumns(Horizontal, NextWidth, Next, NextHeight, &ColumnKernel);
+
+        if (Content == MipContent_Normal)
+        {
+            RenormalizeLevel(Next, NextWidth*NextHeight);
+        }
+        QuantizeLevel(Next, NextWidth*NextHeight, ComponentCount, Content, &Tables, Output);
+        Output += (uint64)NextWidth*NextHeight*ComponentCount;
+
+        // Note(joe): Each level only needs the one above it, and Current is always
+        // big enough for anything below the top.
+        float *Swap = Current;
+        Current = Next;
+        Next = Swap;
+        LevelWidth = NextWidth;
+        LevelHeight = NextHeight;
+    }
+
+    return LevelCount;
+}
@@ -0,0 +1,753 @@
+//
+// Geometry pool
+//
+// Note(joe): Every model's vertices and indices go into one vertex buffer and one
+// index buffer behind a single VAO, so meshes from any number of models can be drawn
+// together in one multi-draw. A mesh is just its base vertex and first index in
+// there. The pool doesn't grow, size it for everything the scene loads.
+//
+
+struct geometry_pool
+{
+    GLuint VAO;
+    GLuint VertexBuffer;
+    GLuint IndexBuffer;
+    uint32 VertexFormat;
+    uint32 VertexStride;
+    uint32 MaxVertices;
+    uint32 VertexCount;
+    uint32 IndexBufferSize; // Bytes, 16 and 32 bit indices live side by side.
+    uint32 IndexBufferUsed;
+};
+
+// Note(joe): The buffers aren't made until the first model comes in, they're laid out
+// for whichever vertex format it was cooked with.
+static void InitGeometryPool(geometry_pool *Pool, uint32 MaxVertices, uint32 IndexBufferSize)
+{
+    *Pool = {};
+    Pool->MaxVertices = MaxVertices;
+    Pool->IndexBufferSize = IndexBufferSize;
+}
+
+static void CreateGeometryBuffers(geometry_pool *Pool, uint32 VertexFormat)
+{
+    Pool->VertexFormat = VertexFormat;
+    Pool->VertexStride = GetVertexStride(VertexFormat);
+
+    glGenVertexArrays(1, &Pool->VAO);
+    Win32BindVertexArray(Pool->VAO);
+
+    glGenBuffers(1, &Pool->VertexBuffer);
+    Win32BindBuffer(GL_ARRAY_BUFFER, Pool->VertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)Pool->MaxVertices*Pool->VertexStride, 0, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &Pool->IndexBuffer);
+    Win32BindBuffer(GL_ELEMENT_ARRAY_BUFFER, Pool->IndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)Pool->IndexBufferSize, 0, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    if (VertexFormat == AQMeshVertex_Packed)
+    {
+        // Note(joe): Everything but the texture coordinates comes out normalised, the
+        // shader and the instance transform take it from there.
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, Pool->VertexStride, (GLvoid *)offsetof(aqmesh_packed_vertex, Position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, Pool->VertexStride, (GLvoid *)offsetof(aqmesh_packed_vertex, Normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, Pool->VertexStride, (GLvoid *)offsetof(aqmesh_packed_vertex, TexCoords));
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Pool->VertexStride, (GLvoid *)offsetof(aqmesh_vertex, Position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, Pool->VertexStride, (GLvoid *)offsetof(aqmesh_vertex, Normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, Pool->VertexStride, (GLvoid *)offsetof(aqmesh_vertex, TexCoords));
+    }
+
+    Win32EnableInstanceAttributes();
+
+    // Note(joe): So element buffer binds after this don't land in the pool's VAO.
+    Win32BindVertexArray(0);
+}
+
+// Note(joe): Copies a model's blobs to the end of the pool and hands back where they
+// went, FirstIndex counts in IndexSize units. False if they don't fit or the model
+// wasn't cooked with the same vertex format as the ones already in there.
+static bool AddToGeometryPool(geometry_pool *Pool, uint32 VertexFormat, void *Vertices, uint32 VertexCount,
+                              void *Indices, uint32 IndexCount, uint32 IndexSize, uint32 *BaseVertex, uint32 *FirstIndex)
+{
+    if (!Pool->VAO)
+    {
+        CreateGeometryBuffers(Pool, VertexFormat);
+    }
+
+    uint32 IndexOffset = (Pool->IndexBufferUsed + IndexSize - 1) & ~(IndexSize - 1);
+    bool Result = (Pool->VertexFormat == VertexFormat) &&
+                  (Pool->VertexCount + VertexCount <= Pool->MaxVertices) &&
+                  ((uint64)IndexOffset + (uint64)IndexCount*IndexSize <= Pool->IndexBufferSize);
+    if (Result)
+    {
+        Win32BindBuffer(GL_ARRAY_BUFFER, Pool->VertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)Pool->VertexCount*Pool->VertexStride,
+                        (GLsizeiptr)VertexCount*Pool->VertexStride, Vertices);
+
+        // Note(joe): The element binding belongs to whatever VAO is bound, the copy
+        // target doesn't.
+        Win32BindBuffer(GL_COPY_WRITE_BUFFER, Pool->IndexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)IndexOffset, (GLsizeiptr)IndexCount*IndexSize, Indices);
+
+        *BaseVertex = Pool->VertexCount;
+        *FirstIndex = IndexOffset / IndexSize;
+        Pool->VertexCount += VertexCount;
+        Pool->IndexBufferUsed = IndexOffset + IndexCount*IndexSize;
+    }
+
+    return Result;
+}
+
+//
+// Mesh
+//
+
+struct mesh_lod
+{
+    GLuint FirstIndex; // In the geometry pool.
+    GLuint IndexCount;
+    float Error; // How far it can be from LOD 0, in model units.
+    uint32 *OccluderIndices; // The same range kept on the CPU, relative to the mesh's first vertex.
+};
+
+// Note(joe): What the camera says about LOD choice this frame. PixelsPerUnit is how
+// many pixels tall something one unit tall is at a distance of one, which is the
+// projection's [1][1] times half the screen height.
+struct lod_selector
+{
+    float PixelsPerUnit;
+    float Threshold; // Largest error allowed on screen, in pixels. Zero always draws LOD 0.
+};
+
+// Note(joe): A draw only drops to a coarser LOD once that LOD's error is comfortably
+// under the threshold, and only goes back when its current one is over it. Without
+// the gap a mesh sitting right at a switch distance flickers between the two.
+#define LOD_HYSTERESIS 0.75f
+
+// Note(joe): ErrorScale turns a LOD's model space error into pixels. The errors only
+// go up along the chain, so this walks from the LOD drawn last time.
+static uint32 SelectLod(mesh_lod *Lods, uint32 LodCount, uint32 CurrentLod, float ErrorScale, float Threshold)
+{
+    uint32 Result = 0;
+    if (Threshold > 0.0f)
+    {
+        Result = (CurrentLod < LodCount) ? CurrentLod : LodCount - 1;
+        while (Result > 0 && Lods[Result].Error*ErrorScale > Threshold)
+        {
+            --Result;
+        }
+        while (Result + 1 < LodCount && Lods[Result + 1].Error*ErrorScale <= LOD_HYSTERESIS*Threshold)
+        {
+            ++Result;
+        }
+    }
+    return Result;
+}
+
+// Note(joe): A mesh is its range in the geometry pool plus the material it's drawn
+// with. Its indices are relative to BaseVertex.
+class Mesh
+{
+    public:
+        uint32 LodCount;
+        mesh_lod Lods[AQMESH_MAX_LODS];
+        GLint BaseVertex;
+        GLenum IndexType;
+        render_material *Material;
+
+        glm::vec3 BoundsMin;
+        glm::vec3 BoundsMax;
+        float Radius; // Of a sphere around the centre of the bounds that holds every vertex.
+        glm::vec3 *OccluderPositions; // Model space, for the occlusion buffer.
+        uint32 OccluderVertexCount;
+
+        Mesh(aqmesh_mesh *Cooked, render_material *Material, GLuint ModelBaseVertex, GLuint ModelFirstIndex, GLenum IndexType,
+             float Radius, glm::vec3 *ModelPositions, uint32 *ModelIndices);
+        void Submit(render_queue *Queue, shader_program *Program, GLuint VAO, glm::mat4 &ModelView, float FarPlane, uint32 Instance,
+                    lod_selector *Selector, float ModelScale, uint8 *Lod);
+};
+
+Mesh::Mesh(aqmesh_mesh *Cooked, render_material *Material, GLuint ModelBaseVertex, GLuint ModelFirstIndex, GLenum IndexType,
+           float Radius, glm::vec3 *ModelPositions, uint32 *ModelIndices) :
+    LodCount(Cooked->LodCount),
+    BaseVertex(ModelBaseVertex + Cooked->FirstVertex),
+    IndexType(IndexType),
+    Material(Material),
+    BoundsMin(Cooked->BoundsMin[0], Cooked->BoundsMin[1], Cooked->BoundsMin[2]),
+    BoundsMax(Cooked->BoundsMax[0], Cooked->BoundsMax[1], Cooked->BoundsMax[2]),
+    Radius(Radius),
+    OccluderPositions(ModelPositions + Cooked->FirstVertex),
+    OccluderVertexCount(Cooked->VertexCount)
+{
+    for (uint32 i = 0; i < LodCount; ++i)
+    {
+        Lods[i].FirstIndex = ModelFirstIndex + Cooked->Lods[i].FirstIndex;
+        Lods[i].IndexCount = Cooked->Lods[i].IndexCount;
+        Lods[i].Error = Cooked->Lods[i].Error;
+        Lods[i].OccluderIndices = ModelIndices + Cooked->Lods[i].FirstIndex;
+    }
+}
+
+// Note(joe): The draw sorts by the view depth of the centre of the mesh's bounds.
+// Instance is where the model's transform went in the instance buffer. Lod is the
+// LOD this mesh on this instance was drawn with last frame, and gets the new one.
+void Mesh::Submit(render_queue *Queue, shader_program *Program, GLuint VAO, glm::mat4 &ModelView, float FarPlane, uint32 Instance,
+                  lod_selector *Selector, float ModelScale, uint8 *Lod)
+{
+    glm::vec4 Center = ModelView*glm::vec4(0.5f*(BoundsMin + BoundsMax), 1.0f);
+    uint64 Key = MakeRenderKey(RenderPass_Opaque, Program, Material, VAO, -Center.z / FarPlane);
+
+    // Note(joe): Distance to the nearest the bounding sphere gets, so a big mesh
+    // close up doesn't get judged by its far end.
+    float Distance = glm::length(glm::vec3(Center)) - Radius*ModelScale;
+    Distance = (Distance > 0.001f) ? Distance : 0.001f;
+    *Lod = (uint8)SelectLod(Lods, LodCount, *Lod, Selector->PixelsPerUnit*ModelScale / Distance, Selector->Threshold);
+    mesh_lod *DrawLod = Lods + *Lod;
+
+    render_command *Command = PushRenderCommand(Queue, Key);
+    Command->Program = Program;
+    Command->Material = Material;
+    Command->VertexArray = VAO;
+    Command->IndexCount = DrawLod->IndexCount;
+    Command->FirstIndex = DrawLod->FirstIndex;
+    Command->BaseVertex = BaseVertex;
+    Command->IndexType = IndexType;
+    Command->Instance = Instance;
+}
+
+class Model
+{
+    public:
+        Model(GLchar *Path, geometry_pool *Pool, memory_arena *AssetArena, memory_arena *LoadArena, platform_work_queue *Queue);
+
+        void Submit(render_queue *Queue, shader_program *Program, glm::mat4 &ModelView, float FarPlane, uint32 Instance,
+                    lod_selector *Selector, uint8 *Lods, uint32 *MeshIndices, uint32 MeshIndexCount);
+
+        glm::vec3 BoundsMin;
+        glm::vec3 BoundsMax;
+
+        // Note(joe): Packed positions reach the shader in [0, 1], this goes on the end
+        // of the model's transform to put them back. Identity for float files.
+        glm::mat4 VertexDecode;
+
+        Mesh *Meshes;
+        GLuint MeshCount;
+
+    private:
+        GLuint VAO; // The pool's.
+        char Directory[256];
+
+        // Note(joe): Only valid while loading.
+        geometry_pool *Pool;
+        memory_arena *AssetArena;
+        memory_arena *LoadArena;
+        platform_work_queue *Queue;
+
+        void LoadModel(const char *Path);
+};
+
+Model::Model(GLchar *Path, geometry_pool *Pool, memory_arena *AssetArena, memory_arena *LoadArena, platform_work_queue *Queue) :
+    BoundsMin(0.0f),
+    BoundsMax(0.0f),
+    VertexDecode(),
+    Meshes(0),
+    MeshCount(0),
+    VAO(0),
+    Pool(Pool),
+    AssetArena(AssetArena),
+    LoadArena(LoadArena),
+    Queue(Queue)
+{
+    memset(&Directory, 0, 256);
+    LoadModel(Path);
+    VAO = Pool->VAO;
+    this->Pool = 0;
+    this->AssetArena = 0;
+    this->LoadArena = 0;
+    this->Queue = 0;
+}
+
+// Note(joe): Only submits the meshes in MeshIndices, the ones that survived culling.
+// Lods has a byte per mesh, what each one was drawn with last time.
+void Model::Submit(render_queue *Queue, shader_program *Program, glm::mat4 &ModelView, float FarPlane, uint32 Instance,
+                   lod_selector *Selector, uint8 *Lods, uint32 *MeshIndices, uint32 MeshIndexCount)
+{
+    // Note(joe): The view part is rigid, so this is the model's own scale.
+    float ModelScale = glm::max(glm::length(glm::vec3(ModelView[0])),
+                                glm::max(glm::length(glm::vec3(ModelView[1])), glm::length(glm::vec3(ModelView[2]))));
+    for (uint32 i = 0; i < MeshIndexCount; ++i)
+    {
+        uint32 MeshIndex = MeshIndices[i];
+        assert(MeshIndex < MeshCount);
+        Meshes[MeshIndex].Submit(Queue, Program, VAO, ModelView, FarPlane, Instance, Selector, ModelScale, Lods + MeshIndex);
+    }
+}
+
+// Note(joe): Everything in the file gets checked against the file size before any of
+// it is used, and every index against its mesh's vertices, a truncated, stale or
+// corrupt cook fails here instead of crashing in the driver.
+static bool IsValidMeshFile(mapped_file *File)
+{
+    bool Result = false;
+
+    aqmesh_header *Header = (aqmesh_header *)File->Memory;
+    if (File->Size >= sizeof(aqmesh_header) &&
+        Header->Magic == AQMESH_MAGIC &&
+        Header->Version == AQMESH_VERSION &&
+        (Header->VertexFormat == AQMeshVertex_Float || Header->VertexFormat == AQMeshVertex_Packed) &&
+        Header->VertexStride == GetVertexStride(Header->VertexFormat) &&
+        (Header->IndexSize == sizeof(uint16) || Header->IndexSize == sizeof(uint32)))
+    {
+        uint64 TexturesEnd = Header->TexturesOffset + (uint64)Header->TextureCount*sizeof(aqmesh_texture);
+        uint64 MaterialsEnd = Header->MaterialsOffset + (uint64)Header->MaterialCount*sizeof(aqmesh_material);
+        uint64 MeshesEnd = Header->MeshesOffset + (uint64)Header->MeshCount*sizeof(aqmesh_mesh);
+        Result = (TexturesEnd <= File->Size) &&
+                 (MaterialsEnd <= File->Size) &&
+                 (MeshesEnd <= File->Size) &&
+                 (Header->VertexDataOffset + Header->VertexDataSize <= File->Size) &&
+                 (Header->IndexDataOffset + Header->IndexDataSize <= File->Size);
+    }
+
+    if (Result)
+    {
+        uint8 *Base = (uint8 *)File->Memory;
+        aqmesh_material *Materials = (aqmesh_material *)(Base + Header->MaterialsOffset);
+        aqmesh_mesh *Meshes = (aqmesh_mesh *)(Base + Header->MeshesOffset);
+
+        for (uint32 i = 0; Result && i < Header->MaterialCount; ++i)
+        {
+            Result = (Materials[i].TextureCount <= AQMESH_MAX_MATERIAL_TEXTURES);
+            for (uint32 j = 0; Result && j < Materials[i].TextureCount; ++j)
+            {
+                Result = (Materials[i].TextureIndices[j] < Header->TextureCount);
+            }
+        }
+
+        uint64 VertexCount = Header->VertexDataSize / Header->VertexStride;
+        uint64 IndexCount = Header->IndexDataSize / Header->IndexSize;
+        for (uint32 i = 0; Result && i < Header->MeshCount; ++i)
+        {
+            Result = ((uint64)Meshes[i].FirstVertex + Meshes[i].VertexCount <= VertexCount) &&
+                     (Meshes[i].MaterialIndex < Header->MaterialCount) &&
+                     (Meshes[i].LodCount >= 1 && Meshes[i].LodCount <= AQMESH_MAX_LODS);
+            for (uint32 j = 0; Result && j < Meshes[i].LodCount; ++j)
+            {
+                aqmesh_lod *Lod = Meshes[i].Lods + j;
+                Result = ((uint64)Lod->FirstIndex + Lod->IndexCount <= IndexCount);
+
+                // Note(joe): Indices are relative to the mesh's first vertex, one past its
+                // last would draw, and occlude with, another mesh's vertices or garbage.
+                for (uint32 k = 0; Result && k < Lod->IndexCount; ++k)
+                {
+                    uint32 Index = (Header->IndexSize == sizeof(uint16)) ?
+                        ((uint16 *)(Base + Header->IndexDataOffset))[Lod->FirstIndex + k] :
+                        ((uint32 *)(Base + Header->IndexDataOffset))[Lod->FirstIndex + k];
+                    Result = (Index < Meshes[i].VertexCount);
+                }
+            }
+        }
+    }
+
+    return Result;
+}
+
+// Note(joe): Every vertex position in model space, whatever the file's format.
+static glm::vec3 *DecodeModelPositions(aqmesh_header *Header, uint8 *Base, glm::mat4 &VertexDecode, memory_arena *Arena)
+{
+    uint32 VertexCount = (uint32)(Header->VertexDataSize / Header->VertexStride);
+    glm::vec3 *Result = PushArray(Arena, VertexCount, glm::vec3);
+    uint8 *Vertex = Base + Header->VertexDataOffset;
+    for (uint32 i = 0; i < VertexCount; ++i, Vertex += Header->VertexStride)
+    {
+        if (Header->VertexFormat == AQMeshVertex_Packed)
+        {
+            uint16 *Packed = ((aqmesh_packed_vertex *)Vertex)->Position;
+            glm::vec4 Normalized(Packed[0] / 65535.0f, Packed[1] / 65535.0f, Packed[2] / 65535.0f, 1.0f);
+            Result[i] = glm::vec3(VertexDecode*Normalized);
+        }
+        else
+        {
+            float *Float = ((aqmesh_vertex *)Vertex)->Position;
+            Result[i] = glm::vec3(Float[0], Float[1], Float[2]);
+        }
+    }
+    return Result;
+}
+
+// Note(joe): Every index widened to 32 bits.
+static uint32 *CopyModelIndices(aqmesh_header *Header, uint8 *Base, memory_arena *Arena)
+{
+    uint32 IndexCount = (uint32)(Header->IndexDataSize / Header->IndexSize);
+    uint32 *Result = PushArray(Arena, IndexCount, uint32);
+    if (Header->IndexSize == sizeof(uint16))
+    {
+        uint16 *Indices = (uint16 *)(Base + Header->IndexDataOffset);
+        for (uint32 i = 0; i < IndexCount; ++i)
+        {
+            Result[i] = Indices[i];
+        }
+    }
+    else
+    {
+        memcpy(Result, Base + Header->IndexDataOffset, (size_t)IndexCount*sizeof(uint32));
+    }
+    return Result;
+}
+
+// Note(joe): Measured from the vertices rather than taken from the box, so it's
+// often well inside the box's corners.
+static float GetMeshRadius(aqmesh_mesh *Cooked, glm::vec3 *ModelPositions)
+{
+    glm::vec3 Center(0.5f*(Cooked->BoundsMin[0] + Cooked->BoundsMax[0]),
+                     0.5f*(Cooked->BoundsMin[1] + Cooked->BoundsMax[1]),
+                     0.5f*(Cooked->BoundsMin[2] + Cooked->BoundsMax[2]));
+
+    float RadiusSquared = 0.0f;
+    for (uint32 i = 0; i < Cooked->VertexCount; ++i)
+    {
+        glm::vec3 Offset = ModelPositions[Cooked->FirstVertex + i] - Center;
+        RadiusSquared = glm::max(RadiusSquared, glm::dot(Offset, Offset));
+    }
+
+    // Note(joe): A little slack for the packed positions rounding differently on the GPU.
+    return 1.0001f*sqrtf(RadiusSquared);
+}
+
+void Model::LoadModel(const char *Path)
+{
+    TIMED_SCOPE("Model::LoadModel");
+
+    mapped_file File = MapFile((char *)Path, FileAccess_Sequential);
+    if (!File.Memory || !IsValidMeshFile(&File))
+    {
+        char ErrorString[300];
+        sprintf_s(ErrorString, 300, "Error::Model:: %s is missing, corrupt or not a version %d .aqmesh, run aqcube_cook\n", Path, AQMESH_VERSION);
+        OutputDebugStringA(ErrorString);
+        UnmapFile(&File);
+        return;
+    }
+
+    // Set the path to the directory.
+    const char *Last = strrchr(Path, '/');
+    if (Last)
+    {
+        int Count = Last-Path+1;
+        memcpy_s(Directory, 256, Path, Count);
+    }
+
+    uint8 *Base = (uint8 *)File.Memory;
+    aqmesh_header *Header = (aqmesh_header *)Base;
+    aqmesh_texture *CookedTextures = (aqmesh_texture *)(Base + Header->TexturesOffset);
+    aqmesh_material *CookedMaterials = (aqmesh_material *)(Base + Header->MaterialsOffset);
+    aqmesh_mesh *CookedMeshes = (aqmesh_mesh *)(Base + Header->MeshesOffset);
+
+    BoundsMin = glm::vec3(Header->BoundsMin[0], Header->BoundsMin[1], Header->BoundsMin[2]);
+    BoundsMax = glm::vec3(Header->BoundsMax[0], Header->BoundsMax[1], Header->BoundsMax[2]);
+    if (Header->VertexFormat == AQMeshVertex_Packed)
+    {
+        glm::vec3 Origin(Header->PositionOrigin[0], Header->PositionOrigin[1], Header->PositionOrigin[2]);
+        VertexDecode = glm::scale(glm::translate(glm::mat4(), Origin), glm::vec3(Header->PositionScale));
+    }
+
+    temporary_memory ModelMemory = BeginTemporaryMemory(LoadArena);
+    GLuint *TextureIds = PushArray(LoadArena, Header->TextureCount, GLuint);
+    render_material *Materials = PushArray(AssetArena, Header->MaterialCount, render_material);
+
+    // Note(joe): Textures decode on the work queue while the geometry uploads here.
+    texture_loader Loader = {};
+    BeginTextureLoads(&Loader, Queue, LoadArena);
+
+    for (uint32 i = 0; i < Header->TextureCount; ++i)
+    {
+        char TextureFilePath[256];
+        sprintf_s(TextureFilePath, 256, "%s%.*s", Directory, AQMESH_MAX_PATH, CookedTextures[i].Path);
+        TextureIds[i] = QueueTextureLoad(&Loader, TextureFilePath);
+    }
+
+    // Note(joe): The blobs are already in GL's layout, they go straight from the file.
+    uint32 ModelBaseVertex = 0;
+    uint32 ModelFirstIndex = 0;
+    bool AddedGeometry = AddToGeometryPool(Pool, Header->VertexFormat,
+                                           Base + Header->VertexDataOffset, (uint32)(Header->VertexDataSize / Header->VertexStride),
+                                           Base + Header->IndexDataOffset, (uint32)(Header->IndexDataSize / Header->IndexSize),
+                                           Header->IndexSize, &ModelBaseVertex, &ModelFirstIndex);
+    if (!AddedGeometry)
+    {
+        char ErrorString[300];
+        sprintf_s(ErrorString, 300, "Error::Model:: %s doesn't fit in the geometry pool, or has a different vertex format to what's in it\n", Path);
+        OutputDebugStringA(ErrorString);
+    }
+
+    // Note(joe): Meshes with the same material share it, the render queue keeps them
+    // together.
+    for (uint32 i = 0; i < Header->MaterialCount; ++i)
+    {
+        aqmesh_material *Material = CookedMaterials + i;
+        texture *Textures = PushArray(AssetArena, Material->TextureCount, texture);
+        for (uint32 j = 0; j < Material->TextureCount; ++j)
+        {
+            aqmesh_texture *CookedTexture = CookedTextures + Material->TextureIndices[j];
+            Textures[j].Id = TextureIds[Material->TextureIndices[j]];
+            Textures[j].Type = (CookedTexture->Type == AQMeshTexture_Specular) ? "texture_specular" : "texture_diffuse";
+        }
+        InitRenderMaterial(Materials + i, Textures, Material->TextureCount);
+    }
+
+    // Note(joe): Positions and indices stay on the CPU too, for the occlusion buffer.
+    MeshCount = AddedGeometry ? Header->MeshCount : 0;
+    Meshes = PushArray(AssetArena, MeshCount, Mesh);
+    glm::vec3 *ModelPositions = MeshCount ? DecodeModelPositions(Header, Base, VertexDecode, AssetArena) : 0;
+    uint32 *ModelIndices = MeshCount ? CopyModelIndices(Header, Base, AssetArena) : 0;
+    for (uint32 i = 0; i < MeshCount; ++i)
+    {
+        aqmesh_mesh *Cooked = CookedMeshes + i;
+        new (Meshes + i) Mesh(Cooked, Materials + Cooked->MaterialIndex, ModelBaseVertex, ModelFirstIndex,
+                              (Header->IndexSize == sizeof(uint16)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                              GetMeshRadius(Cooked, ModelPositions), ModelPositions, ModelIndices);
+        UploadCompletedTextures(&Loader);
+    }
+
+    EndTextureLoads(&Loader);
+    EndTemporaryMemory(ModelMemory);
+    UnmapFile(&File);
+}
+
+//
+// Model chapter scene, shared by win32_model.cpp and the headless host.
+//
+
+// Note(joe): Room for a few nanosuits worth of different models, and their LODs.
+#define MODEL_SCENE_MAX_VERTICES (256*1024)
+#define MODEL_SCENE_INDEX_BUFFER_SIZE (4*1024*1024)
+
+// Note(joe): In pixels, see lod_selector.
+#define MODEL_SCENE_LOD_THRESHOLD 1.0f
+
+// Note(joe): Meshes at least this many occlusion buffer pixels across can occlude,
+// and the nearest few of them do, drawn at a LOD whose error stays under
+// MODEL_SCENE_OCCLUDER_LOD_THRESHOLD occlusion buffer pixels.
+#define MODEL_SCENE_OCCLUDER_PIXELS 16.0f
+#define MODEL_SCENE_MAX_OCCLUDERS 32
+#define MODEL_SCENE_OCCLUDER_LOD_THRESHOLD 0.5f
+
+struct model_scene
+{
+    shader_program ModelProgram;
+    uniform_blocks Blocks;
+    geometry_pool Geometry;
+    instance_buffer Instances;
+    indirect_buffer Indirect;
+
+    Model *TestModel;
+    int ExtraModelCount;
+
+    // Note(joe): A byte per mesh per model, the LOD it was last drawn with.
+    uint8 *Lods;
+    float LodThreshold;
+
+    occlusion_buffer Occlusion;
+    bool OcclusionCulling;
+};
+
+// Note(joe): The first one is the chapter's, the extras stand in rows behind it.
+static glm::vec3 GetModelPosition(int Index)
+{
+    glm::vec3 Result(0.0f, -3.0f, 0.0f);
+    if (Index > 0)
+    {
+        int Extra = Index - 1;
+        Result.x = 4.0f*((Extra % 8) - 3.5f);
+        Result.z = -6.0f - 5.0f*(Extra / 8);
+    }
+    return Result;
+}
+
+static void InitModelScene(model_scene *Scene, memory_arena *AssetArena, memory_arena *LoadArena, platform_work_queue *Queue)
+{
+    TIMED_FUNCTION();
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    Win32Enable(GL_DEPTH_TEST);
+
+    InitGeometryPool(&Scene->Geometry, MODEL_SCENE_MAX_VERTICES, MODEL_SCENE_INDEX_BUFFER_SIZE);
+    Scene->TestModel = new (PushStruct(AssetArena, Model)) Model("nanosuit/nanosuit.aqmesh", &Scene->Geometry,
+                                                                 AssetArena, LoadArena, Queue);
+
+    // Note(joe): The vertex shader has to match the pool, which matches whatever the
+    // model was cooked as.
+    shader_file Shaders[] = { { GL_VERTEX_SHADER, "model.vert" }, { GL_FRAGMENT_SHADER, "model.frag" } };
+    char *Defines = (Scene->Geometry.VertexFormat == AQMeshVertex_Packed) ? (char *)"#define PACKED_VERTICES\n" : 0;
+    Win32InitUniformBlocks(&Scene->Blocks, 0);
+    Win32ReflectProgram(&Scene->ModelProgram, Win32LoadProgram(LoadArena, Shaders, ArrayCount(Shaders), Defines));
+
+    int ModelCount = 1 + Scene->ExtraModelCount;
+    Win32InitInstanceBuffer(&Scene->Instances, ModelCount);
+    Win32InitIndirectBuffer(&Scene->Indirect, ModelCount*Scene->TestModel->MeshCount);
+
+    Scene->Lods = PushArray(AssetArena, ModelCount*Scene->TestModel->MeshCount, uint8);
+    memset(Scene->Lods, 0, ModelCount*Scene->TestModel->MeshCount);
+    Scene->LodThreshold = MODEL_SCENE_LOD_THRESHOLD;
+
+    InitOcclusionBuffer(&Scene->Occlusion, AssetArena, Queue);
+    Scene->OcclusionCulling = true;
+}
+
+// Note(joe): Draws the nearest big meshes into the occlusion buffer and takes
+// everything behind them out of Visible, which stays in order. OcclusionPixelsPerUnit
+// is lod_selector's PixelsPerUnit for the occlusion buffer's height.
+static uint32 CullOccludedMeshes(model_scene *Scene, glm::mat4 &View, glm::mat4 &ViewProjection, glm::mat4 *Transforms,
+                                 float OcclusionPixelsPerUnit, memory_arena *FrameArena, uint32 *Visible, uint32 VisibleCount)
+{
+    TIMED_FUNCTION();
+
+    Model *TestModel = Scene->TestModel;
+    uint32 MeshCount = TestModel->MeshCount;
+    occlusion_buffer *Occlusion = &Scene->Occlusion;
+    BeginOcclusionFrame(Occlusion, FrameArena, VisibleCount);
+
+    // Note(joe): Kept sorted nearest first, the farthest falls off the end.
+    uint32 Occluders[MODEL_SCENE_MAX_OCCLUDERS];
+    float OccluderDistances[MODEL_SCENE_MAX_OCCLUDERS];
+    float OccluderScales[MODEL_SCENE_MAX_OCCLUDERS];
+    uint32 OccluderCount = 0;
+    for (uint32 VisibleIndex = 0; VisibleIndex < VisibleCount; ++VisibleIndex)
+    {
+        uint32 Object = Visible[VisibleIndex];
+        glm::mat4 &Transform = Transforms[Object / MeshCount];
+        Mesh *Part = TestModel->Meshes + (Object % MeshCount);
+
+        float Scale = glm::max(glm::length(glm::vec3(Transform[0])),
+                               glm::max(glm::length(glm::vec3(Transform[1])), glm::length(glm::vec3(Transform[2]))));
+        glm::vec4 Center = View*Transform*glm::vec4(0.5f*(Part->BoundsMin + Part->BoundsMax), 1.0f);
+        float Distance = glm::max(glm::length(glm::vec3(Center)) - Part->Radius*Scale, 0.001f);
+        float Size = 2.0f*Part->Radius*Scale*OcclusionPixelsPerUnit / Distance;
+        if (Size < MODEL_SCENE_OCCLUDER_PIXELS ||
+            (OccluderCount == MODEL_SCENE_MAX_OCCLUDERS && Distance >= OccluderDistances[OccluderCount - 1]))
+        {
+            continue;
+        }
+
+        uint32 Slot = (OccluderCount < MODEL_SCENE_MAX_OCCLUDERS) ? OccluderCount++ : OccluderCount - 1;
+        for (; Slot > 0 && OccluderDistances[Slot - 1] > Distance; --Slot)
+        {
+            Occluders[Slot] = Occluders[Slot - 1];
+            OccluderDistances[Slot] = OccluderDistances[Slot - 1];
+            OccluderScales[Slot] = OccluderScales[Slot - 1];
+        }
+        Occluders[Slot] = Object;
+        OccluderDistances[Slot] = Distance;
+        OccluderScales[Slot] = Scale;
+    }
+
+    for (uint32 OccluderIndex = 0; OccluderIndex < OccluderCount; ++OccluderIndex)
+    {
+        uint32 Object = Occluders[OccluderIndex];
+        Mesh *Part = TestModel->Meshes + (Object % MeshCount);
+        float ErrorScale = OccluderScales[OccluderIndex]*OcclusionPixelsPerUnit / OccluderDistances[OccluderIndex];
+        mesh_lod *Lod = Part->Lods + SelectLod(Part->Lods, Part->LodCount, 0, ErrorScale, MODEL_SCENE_OCCLUDER_LOD_THRESHOLD);
+
+        glm::mat4 ClipFromModel = ViewProjection*Transforms[Object / MeshCount];
+        if (!PushOccluder(Occlusion, ClipFromModel, Part->OccluderPositions, Part->OccluderVertexCount,
+                          Lod->OccluderIndices, Lod->IndexCount))
+        {
+            break;
+        }
+    }
+    RenderOcclusionBuffer(Occlusion);
+
+    uint32 Result = 0;
+    for (uint32 VisibleIndex = 0; VisibleIndex < VisibleCount; ++VisibleIndex)
+    {
+        uint32 Object = Visible[VisibleIndex];
+        Mesh *Part = TestModel->Meshes + (Object % MeshCount);
+        glm::mat4 ClipFromModel = ViewProjection*Transforms[Object / MeshCount];
+        if (!IsOccluded(Occlusion, ClipFromModel, Part->BoundsMin, Part->BoundsMax))
+        {
+            Visible[Result++] = Object;
+        }
+    }
+    return Result;
+}
+
+static void RenderModelScene(model_scene *Scene, camera *Camera, memory_arena *FrameArena, int ScreenWidth, int ScreenHeight)
+{
+    TIMED_FUNCTION();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 View;
+    View = glm::lookAt(Camera->Position, Camera->Position + Camera->Front, Camera->Up);
+
+    float FarPlane = 100.0f;
+    glm::mat4 Projection;
+    Projection = glm::perspective(DEG_TO_RAD(45), (float)ScreenWidth/(float)ScreenHeight, 0.01f, FarPlane);
+
+    Win32SetCameraBlock(&Scene->Blocks, View, Projection, Camera->Position);
+
+    int ModelCount = 1 + Scene->ExtraModelCount;
+    glm::mat4 *Transforms = PushArray(FrameArena, ModelCount, glm::mat4);
+    glm::mat4 *InstanceTransforms = PushArray(FrameArena, ModelCount, glm::mat4);
+    for (int ModelIndex = 0; ModelIndex < ModelCount; ++ModelIndex)
+    {
+        Transforms[ModelIndex] = glm::translate(glm::mat4(), GetModelPosition(ModelIndex));
+        Transforms[ModelIndex] = glm::scale(Transforms[ModelIndex], glm::vec3(0.25f, 0.25f, 0.25f));
+        InstanceTransforms[ModelIndex] = Transforms[ModelIndex]*Scene->TestModel->VertexDecode;
+    }
+    Win32BeginInstances(&Scene->Instances);
+    uint32 FirstInstance = Win32PushInstances(&Scene->Instances, InstanceTransforms, ModelCount);
+
+    // Note(joe): Every mesh of every model is culled on its own, object i is mesh
+    // i % MeshCount of model i / MeshCount.
+    Model *TestModel = Scene->TestModel;
+    uint32 MeshCount = TestModel->MeshCount;
+    cull_bounds Bounds;
+    BeginCullBounds(&Bounds, FrameArena, ModelCount*MeshCount);
+    for (int ModelIndex = 0; ModelIndex < ModelCount; ++ModelIndex)
+    {
+        for (uint32 MeshIndex = 0; MeshIndex < MeshCount; ++MeshIndex)
+        {
+            Mesh *Part = TestModel->Meshes + MeshIndex;
+            PushCullBounds(&Bounds, Transforms[ModelIndex], Part->BoundsMin, Part->BoundsMax, Part->Radius);
+        }
+    }
+    glm::mat4 ViewProjection = Projection*View;
+    frustum Frustum = ExtractFrustum(ViewProjection);
+    uint32 *Visible = PushArray(FrameArena, GetCullPaddedCount(Bounds.Count), uint32);
+    uint32 VisibleCount = CullBounds(&Frustum, &Bounds, Visible);
+    if (Scene->OcclusionCulling)
+    {
+        float OcclusionPixelsPerUnit = 0.5f*Projection[1][1]*(float)OCCLUSION_HEIGHT;
+        VisibleCount = CullOccludedMeshes(Scene, View, ViewProjection, Transforms, OcclusionPixelsPerUnit, FrameArena,
+                                          Visible, VisibleCount);
+    }
+
+    lod_selector Selector;
+    Selector.PixelsPerUnit = 0.5f*Projection[1][1]*(float)ScreenHeight;
+    Selector.Threshold = Scene->LodThreshold;
+
+    // Note(joe): The list is in order, so each model's meshes are together.
+    uint32 *MeshIndices = PushArray(FrameArena, MeshCount, uint32);
+    render_queue Queue;
+    BeginRenderQueue(&Queue, FrameArena, VisibleCount);
+    for (uint32 VisibleIndex = 0; VisibleIndex < VisibleCount;)
+    {
+        uint32 ModelIndex = Visible[VisibleIndex] / MeshCount;
+        uint32 MeshIndexCount = 0;
+        while (VisibleIndex < VisibleCount && Visible[VisibleIndex] / MeshCount == ModelIndex)
+        {
+            MeshIndices[MeshIndexCount++] = Visible[VisibleIndex++] % MeshCount;
+        }
+
+        glm::mat4 ModelView = View*Transforms[ModelIndex];
+        TestModel->Submit(&Queue, &Scene->ModelProgram, ModelView, FarPlane, FirstInstance + ModelIndex,
+                          &Selector, Scene->Lods + ModelIndex*MeshCount, MeshIndices, MeshIndexCount);
+    }
+
+    ExecuteRenderQueue(&Queue, &Scene->Instances, &Scene->Indirect, FrameArena);
+}
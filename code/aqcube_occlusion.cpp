@@ -0,0 +1,493 @@
+//
+// Software occlusion culling
+//
+// Note(joe): A few big, near things get drawn on the CPU into a small depth buffer
+// every frame, and then everything that survived the frustum cull gets its box
+// tested against it before it's submitted. Whatever is entirely behind the occluders
+// doesn't go to the GPU at all. None of it touches GL, so it runs headless the same.
+//
+// The buffer holds 1/w, which is linear across a triangle on screen, bigger is
+// nearer and 0 is nothing drawn. Every 8x8 tile also keeps the farthest depth in it,
+// so most boxes are settled a tile at a time without looking at pixels.
+//
+// Everything errs towards drawing. Occluders are only where their triangles cover a
+// pixel's centre, each pixel only claims the farthest depth the triangle could have
+// in it, and triangles that cross the near plane are left out. Boxes are tested over
+// every pixel they touch and one more all round. The cost is occlusion that a
+// finer buffer would have found.
+//
+// Triangles are set up and binned into bands of rows on the calling thread, then each
+// band is rasterised on the work queue. Bands own their rows, so nothing's shared.
+//
+
+#include <cfloat>
+
+#include "aqcube_simd.h"
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_SIZE 8
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_BAND_HEIGHT 16
+#define OCCLUSION_BAND_COUNT (OCCLUSION_HEIGHT / OCCLUSION_BAND_HEIGHT)
+
+// Note(joe): A frame's worth of occluder triangles. Past this, occluders are dropped.
+#define OCCLUSION_MAX_TRIANGLES (64*1024)
+
+struct occlusion_triangle
+{
+    // Note(joe): Edge functions, Ax + By + C, all three positive inside whichever way
+    // the triangle was wound.
+    float EdgeA[3];
+    float EdgeB[3];
+    float EdgeC[3];
+
+    // Note(joe): The 1/w plane, already pulled back by as much as it changes across
+    // half a pixel, and never less than the farthest corner.
+    float DepthA;
+    float DepthB;
+    float DepthC;
+    float DepthMin;
+
+    int MinX;
+    int MinY;
+    int MaxX;
+    int MaxY;
+};
+
+struct occlusion_buffer;
+
+struct occlusion_band
+{
+    occlusion_buffer *Buffer;
+    uint32 *Triangles;
+    uint32 TriangleCount;
+    int FirstRow;
+};
+
+// Note(joe): Kept so the host can check the verdicts against the real depth buffer.
+struct occludee_record
+{
+    glm::mat4 ClipFromModel;
+    glm::vec3 BoundsMin;
+    glm::vec3 BoundsMax;
+    bool Culled;
+};
+
+struct occlusion_buffer
+{
+    float *Depth;     // OCCLUSION_WIDTH*OCCLUSION_HEIGHT, rows bottom up like GL.
+    float *TileDepth; // OCCLUSION_TILES_X*OCCLUSION_TILES_Y, the farthest in each.
+
+    occlusion_triangle *Triangles;
+    uint32 TriangleCount;
+    occlusion_band Bands[OCCLUSION_BAND_COUNT];
+
+    platform_work_queue *Queue; // Can be 0, the bands are done in turn then.
+
+    // Note(joe): Only filled in when the host asks.
+    bool RecordOccludees;
+    occludee_record *Occludees;
+    uint32 OccludeeCount;
+    uint32 MaxOccludees;
+};
+
+static void InitOcclusionBuffer(occlusion_buffer *Buffer, memory_arena *Arena, platform_work_queue *Queue)
+{
+    Buffer->Depth = (float *)PushSizeAligned(Arena, OCCLUSION_WIDTH*OCCLUSION_HEIGHT*sizeof(float), 16);
+    Buffer->TileDepth = PushArray(Arena, OCCLUSION_TILES_X*OCCLUSION_TILES_Y, float);
+    Buffer->Triangles = PushArray(Arena, OCCLUSION_MAX_TRIANGLES, occlusion_triangle);
+    Buffer->TriangleCount = 0;
+    for (int BandIndex = 0; BandIndex < OCCLUSION_BAND_COUNT; ++BandIndex)
+    {
+        occlusion_band *Band = Buffer->Bands + BandIndex;
+        Band->Buffer = Buffer;
+        Band->Triangles = PushArray(Arena, OCCLUSION_MAX_TRIANGLES, uint32);
+        Band->TriangleCount = 0;
+        Band->FirstRow = BandIndex*OCCLUSION_BAND_HEIGHT;
+    }
+    Buffer->Queue = Queue;
+    Buffer->RecordOccludees = false;
+    Buffer->Occludees = 0;
+    Buffer->OccludeeCount = 0;
+    Buffer->MaxOccludees = 0;
+}
+
+// Note(joe): MaxOccludees is only used when RecordOccludees is set, the records go
+// in FrameArena.
+static void BeginOcclusionFrame(occlusion_buffer *Buffer, memory_arena *FrameArena, uint32 MaxOccludees)
+{
+    Buffer->TriangleCount = 0;
+    for (int BandIndex = 0; BandIndex < OCCLUSION_BAND_COUNT; ++BandIndex)
+    {
+        Buffer->Bands[BandIndex].TriangleCount = 0;
+    }
+
+    Buffer->OccludeeCount = 0;
+    Buffer->MaxOccludees = Buffer->RecordOccludees ? MaxOccludees : 0;
+    Buffer->Occludees = Buffer->RecordOccludees ? PushArray(FrameArena, MaxOccludees, occludee_record) : 0;
+}
+
+// Note(joe): Inside the near plane, GL's clip space runs z from -w to w.
+inline bool IsInFrontOfNearPlane(glm::vec4 Clip)
+{
+    return (Clip.w > 0.0f) && (Clip.z >= -Clip.w);
+}
+
+inline glm::vec3 GetOcclusionScreenPosition(glm::vec4 Clip)
+{
+    float InverseW = 1.0f / Clip.w;
+    glm::vec3 Result((0.5f*Clip.x*InverseW + 0.5f)*OCCLUSION_WIDTH,
+                     (0.5f*Clip.y*InverseW + 0.5f)*OCCLUSION_HEIGHT,
+                     InverseW);
+    return Result;
+}
+
+// Note(joe): Indices are triangles into Positions. Both windings are drawn, the
+// meshes don't promise one, and the back faces of a closed mesh are behind its front
+// ones anyway. Returns false once the frame's triangles have run out. The loader
+// rejects files with an index past its mesh's vertices, so they're only asserted.
+static bool PushOccluder(occlusion_buffer *Buffer, glm::mat4 &ClipFromModel, glm::vec3 *Positions, uint32 VertexCount,
+                         uint32 *Indices, uint32 IndexCount)
+{
+    bool Result = true;
+    for (uint32 Index = 0; Index + 2 < IndexCount; Index += 3)
+    {
+        glm::vec4 Clip[3];
+        bool InFront = true;
+        for (int Corner = 0; Corner < 3; ++Corner)
+        {
+            assert(Indices[Index + Corner] < VertexCount);
+            Clip[Corner] = ClipFromModel*glm::vec4(Positions[Indices[Index + Corner]], 1.0f);
+            InFront = InFront && IsInFrontOfNearPlane(Clip[Corner]);
+        }
+        if (!InFront)
+        {
+            continue;
+        }
+
+        glm::vec3 P0 = GetOcclusionScreenPosition(Clip[0]);
+        glm::vec3 P1 = GetOcclusionScreenPosition(Clip[1]);
+        glm::vec3 P2 = GetOcclusionScreenPosition(Clip[2]);
+        float Area = (P1.x - P0.x)*(P2.y - P0.y) - (P2.x - P0.x)*(P1.y - P0.y);
+        if (Area == 0.0f)
+        {
+            continue;
+        }
+
+        // Note(joe): Pixel centres are at +0.5, the range is the ones the triangle's
+        // bounds could hold.
+        float MinX = glm::min(P0.x, glm::min(P1.x, P2.x));
+        float MaxX = glm::max(P0.x, glm::max(P1.x, P2.x));
+        float MinY = glm::min(P0.y, glm::min(P1.y, P2.y));
+        float MaxY = glm::max(P0.y, glm::max(P1.y, P2.y));
+        int FirstX = glm::max((int)ceilf(MinX - 0.5f), 0);
+        int LastX = glm::min((int)floorf(MaxX - 0.5f), OCCLUSION_WIDTH - 1);
+        int FirstY = glm::max((int)ceilf(MinY - 0.5f), 0);
+        int LastY = glm::min((int)floorf(MaxY - 0.5f), OCCLUSION_HEIGHT - 1);
+        if (FirstX > LastX || FirstY > LastY)
+        {
+            continue;
+        }
+
+        if (Buffer->TriangleCount == OCCLUSION_MAX_TRIANGLES)
+        {
+            Result = false;
+            break;
+        }
+        uint32 TriangleIndex = Buffer->TriangleCount++;
+        ++GlobalRenderStats.OccluderTriangles;
+        occlusion_triangle *Triangle = Buffer->Triangles + TriangleIndex;
+
+        float Sign = (Area > 0.0f) ? 1.0f : -1.0f;
+        glm::vec3 Points[3] = { P0, P1, P2 };
+        for (int Edge = 0; Edge < 3; ++Edge)
+        {
+            glm::vec3 From = Points[Edge];
+            glm::vec3 To = Points[(Edge + 1) % 3];
+            Triangle->EdgeA[Edge] = Sign*(From.y - To.y);
+            Triangle->EdgeB[Edge] = Sign*(To.x - From.x);
+            Triangle->EdgeC[Edge] = Sign*(From.x*To.y - To.x*From.y);
+        }
+
+        float InverseArea = 1.0f / Area;
+        float DepthA = ((P1.z - P0.z)*(P2.y - P0.y) - (P2.z - P0.z)*(P1.y - P0.y))*InverseArea;
+        float DepthB = ((P1.x - P0.x)*(P2.z - P0.z) - (P2.x - P0.x)*(P1.z - P0.z))*InverseArea;
+        Triangle->DepthA = DepthA;
+        Triangle->DepthB = DepthB;
+        Triangle->DepthC = P0.z - DepthA*P0.x - DepthB*P0.y - 0.5f*(fabsf(DepthA) + fabsf(DepthB));
+        Triangle->DepthMin = glm::min(P0.z, glm::min(P1.z, P2.z));
+
+        Triangle->MinX = FirstX;
+        Triangle->MinY = FirstY;
+        Triangle->MaxX = LastX;
+        Triangle->MaxY = LastY;
+
+        for (int BandIndex = FirstY / OCCLUSION_BAND_HEIGHT; BandIndex <= LastY / OCCLUSION_BAND_HEIGHT; ++BandIndex)
+        {
+            occlusion_band *Band = Buffer->Bands + BandIndex;
+            Band->Triangles[Band->TriangleCount++] = TriangleIndex;
+        }
+    }
+
+    return Result;
+}
+
+static void RasterizeOcclusionTriangle(float *Depth, occlusion_triangle *Triangle, int FirstRow, int LastRow)
+{
+    int FirstY = glm::max(Triangle->MinY, FirstRow);
+    int LastY = glm::min(Triangle->MaxY, LastRow);
+    int FirstX = Triangle->MinX & ~3;
+
+#if AQCUBE_SSE2
+    __m128 LaneX = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 EdgeA[3];
+    __m128 EdgeStep[3];
+    for (int Edge = 0; Edge < 3; ++Edge)
+    {
+        EdgeA[Edge] = _mm_set1_ps(Triangle->EdgeA[Edge]);
+        EdgeStep[Edge] = _mm_set1_ps(4.0f*Triangle->EdgeA[Edge]);
+    }
+    __m128 DepthStep = _mm_set1_ps(4.0f*Triangle->DepthA);
+    __m128 DepthMin = _mm_set1_ps(Triangle->DepthMin);
+    __m128 Zero = _mm_setzero_ps();
+    __m128 StartX = _mm_add_ps(_mm_set1_ps((float)FirstX), LaneX);
+
+    for (int Y = FirstY; Y <= LastY; ++Y)
+    {
+        float CenterY = (float)Y + 0.5f;
+        __m128 Edges[3];
+        for (int Edge = 0; Edge < 3; ++Edge)
+        {
+            Edges[Edge] = _mm_add_ps(_mm_mul_ps(EdgeA[Edge], StartX),
+                                     _mm_set1_ps(Triangle->EdgeB[Edge]*CenterY + Triangle->EdgeC[Edge]));
+        }
+        __m128 Plane = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Triangle->DepthA), StartX),
+                                  _mm_set1_ps(Triangle->DepthB*CenterY + Triangle->DepthC));
+
+        float *Row = Depth + Y*OCCLUSION_WIDTH;
+        for (int X = FirstX; X <= Triangle->MaxX; X += 4)
+        {
+            __m128 Inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(Edges[0], Zero), _mm_cmpgt_ps(Edges[1], Zero)),
+                                       _mm_cmpgt_ps(Edges[2], Zero));
+            if (_mm_movemask_ps(Inside))
+            {
+                __m128 Old = _mm_load_ps(Row + X);
+                __m128 New = _mm_max_ps(Old, _mm_max_ps(Plane, DepthMin));
+                _mm_store_ps(Row + X, _mm_or_ps(_mm_and_ps(Inside, New), _mm_andnot_ps(Inside, Old)));
+            }
+            for (int Edge = 0; Edge < 3; ++Edge)
+            {
+                Edges[Edge] = _mm_add_ps(Edges[Edge], EdgeStep[Edge]);
+            }
+            Plane = _mm_add_ps(Plane, DepthStep);
+        }
+    }
+#else
+    for (int Y = FirstY; Y <= LastY; ++Y)
+    {
+        float CenterY = (float)Y + 0.5f;
+        float *Row = Depth + Y*OCCLUSION_WIDTH;
+        for (int X = FirstX; X <= Triangle->MaxX; ++X)
+        {
+            float CenterX = (float)X + 0.5f;
+            bool Inside = true;
+            for (int Edge = 0; Edge < 3; ++Edge)
+            {
+                Inside = Inside && (Triangle->EdgeA[Edge]*CenterX + Triangle->EdgeB[Edge]*CenterY + Triangle->EdgeC[Edge] > 0.0f);
+            }
+            if (Inside)
+            {
+                float Value = glm::max(Triangle->DepthA*CenterX + Triangle->DepthB*CenterY + Triangle->DepthC, Triangle->DepthMin);
+                Row[X] = glm::max(Row[X], Value);
+            }
+        }
+    }
+#endif
+}
+
+static PLATFORM_WORK_QUEUE_CALLBACK(RasterizeOcclusionBand)
+{
+    TIMED_FUNCTION();
+
+    occlusion_band *Band = (occlusion_band *)Data;
+    occlusion_buffer *Buffer = Band->Buffer;
+    int LastRow = Band->FirstRow + OCCLUSION_BAND_HEIGHT - 1;
+
+    float *BandDepth = Buffer->Depth + Band->FirstRow*OCCLUSION_WIDTH;
+    memset(BandDepth, 0, OCCLUSION_BAND_HEIGHT*OCCLUSION_WIDTH*sizeof(float));
+    for (uint32 i = 0; i < Band->TriangleCount; ++i)
+    {
+        RasterizeOcclusionTriangle(Buffer->Depth, Buffer->Triangles + Band->Triangles[i], Band->FirstRow, LastRow);
+    }
+
+    for (int TileY = Band->FirstRow / OCCLUSION_TILE_SIZE; TileY <= LastRow / OCCLUSION_TILE_SIZE; ++TileY)
+    {
+        for (int TileX = 0; TileX < OCCLUSION_TILES_X; ++TileX)
+        {
+            float Farthest = FLT_MAX;
+            for (int Y = 0; Y < OCCLUSION_TILE_SIZE; ++Y)
+            {
+                float *Row = Buffer->Depth + (TileY*OCCLUSION_TILE_SIZE + Y)*OCCLUSION_WIDTH + TileX*OCCLUSION_TILE_SIZE;
+                for (int X = 0; X < OCCLUSION_TILE_SIZE; ++X)
+                {
+                    Farthest = glm::min(Farthest, Row[X]);
+                }
+            }
+            Buffer->TileDepth[TileY*OCCLUSION_TILES_X + TileX] = Farthest;
+        }
+    }
+}
+
+// Note(joe): Draws everything pushed since BeginOcclusionFrame.
+static void RenderOcclusionBuffer(occlusion_buffer *Buffer)
+{
+    TIMED_FUNCTION();
+
+    uint64 Start = GetProfileClock();
+    for (int BandIndex = 0; BandIndex < OCCLUSION_BAND_COUNT; ++BandIndex)
+    {
+        if (Buffer->Queue)
+        {
+            AddWorkQueueEntry(Buffer->Queue, RasterizeOcclusionBand, Buffer->Bands + BandIndex);
+        }
+        else
+        {
+            RasterizeOcclusionBand(0, Buffer->Bands + BandIndex);
+        }
+    }
+    if (Buffer->Queue)
+    {
+        CompleteAllWork(Buffer->Queue);
+    }
+    GlobalRenderStats.OcclusionRasterMs += 1000.0*(double)(GetProfileClock() - Start) / (double)GetProfileClockFrequency();
+}
+
+// Note(joe): The pixels a box covers, the depth of its nearest corner, and false if
+// it reaches through the near plane or misses the buffer, when it can't be judged.
+static bool GetOccludeeRect(glm::mat4 &ClipFromModel, glm::vec3 BoundsMin, glm::vec3 BoundsMax, int Width, int Height,
+                            int *MinX, int *MinY, int *MaxX, int *MaxY, glm::vec4 *NearestClip)
+{
+    float ScreenMinX = FLT_MAX;
+    float ScreenMinY = FLT_MAX;
+    float ScreenMaxX = -FLT_MAX;
+    float ScreenMaxY = -FLT_MAX;
+    for (int Corner = 0; Corner < 8; ++Corner)
+    {
+        glm::vec3 Position((Corner & 1) ? BoundsMax.x : BoundsMin.x,
+                           (Corner & 2) ? BoundsMax.y : BoundsMin.y,
+                           (Corner & 4) ? BoundsMax.z : BoundsMin.z);
+        glm::vec4 Clip = ClipFromModel*glm::vec4(Position, 1.0f);
+        if (!IsInFrontOfNearPlane(Clip))
+        {
+            return false;
+        }
+        float X = (0.5f*Clip.x / Clip.w + 0.5f)*Width;
+        float Y = (0.5f*Clip.y / Clip.w + 0.5f)*Height;
+        ScreenMinX = glm::min(ScreenMinX, X);
+        ScreenMinY = glm::min(ScreenMinY, Y);
+        ScreenMaxX = glm::max(ScreenMaxX, X);
+        ScreenMaxY = glm::max(ScreenMaxY, Y);
+        if (Corner == 0 || Clip.w < NearestClip->w)
+        {
+            *NearestClip = Clip;
+        }
+    }
+
+    // Note(joe): One pixel more all round than it touches.
+    *MinX = glm::max((int)floorf(ScreenMinX) - 1, 0);
+    *MinY = glm::max((int)floorf(ScreenMinY) - 1, 0);
+    *MaxX = glm::min((int)floorf(ScreenMaxX) + 1, Width - 1);
+    *MaxY = glm::min((int)floorf(ScreenMaxY) + 1, Height - 1);
+    return (*MinX <= *MaxX) && (*MinY <= *MaxY);
+}
+
+// Note(joe): True if the box is behind the occluders everywhere it could show.
+static bool IsOccluded(occlusion_buffer *Buffer, glm::mat4 &ClipFromModel, glm::vec3 BoundsMin, glm::vec3 BoundsMax)
+{
+    uint64 Start = GetProfileClock();
+
+    int MinX, MinY, MaxX, MaxY;
+    glm::vec4 Nearest;
+    bool Result = GetOccludeeRect(ClipFromModel, BoundsMin, BoundsMax, OCCLUSION_WIDTH, OCCLUSION_HEIGHT,
+                                  &MinX, &MinY, &MaxX, &MaxY, &Nearest);
+    if (Result)
+    {
+        float NearestDepth = 1.0f / Nearest.w;
+        for (int TileY = MinY / OCCLUSION_TILE_SIZE; Result && TileY <= MaxY / OCCLUSION_TILE_SIZE; ++TileY)
+        {
+            for (int TileX = MinX / OCCLUSION_TILE_SIZE; Result && TileX <= MaxX / OCCLUSION_TILE_SIZE; ++TileX)
+            {
+                if (Buffer->TileDepth[TileY*OCCLUSION_TILES_X + TileX] > NearestDepth)
+                {
+                    continue;
+                }
+
+                // Note(joe): Some of the tile is behind the box, down to the pixels the
+                // box covers.
+                int FirstX = glm::max(MinX, TileX*OCCLUSION_TILE_SIZE);
+                int LastX = glm::min(MaxX, TileX*OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+                int FirstY = glm::max(MinY, TileY*OCCLUSION_TILE_SIZE);
+                int LastY = glm::min(MaxY, TileY*OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+                for (int Y = FirstY; Result && Y <= LastY; ++Y)
+                {
+                    float *Row = Buffer->Depth + Y*OCCLUSION_WIDTH;
+                    for (int X = FirstX; Result && X <= LastX; ++X)
+                    {
+                        Result = (Row[X] > NearestDepth);
+                    }
+                }
+            }
+        }
+    }
+
+    if (Buffer->OccludeeCount < Buffer->MaxOccludees)
+    {
+        occludee_record *Record = Buffer->Occludees + Buffer->OccludeeCount++;
+        Record->ClipFromModel = ClipFromModel;
+        Record->BoundsMin = BoundsMin;
+        Record->BoundsMax = BoundsMax;
+        Record->Culled = Result;
+    }
+
+    ++GlobalRenderStats.OccludeesTested;
+    GlobalRenderStats.OccludeesCulled += Result ? 1 : 0;
+    GlobalRenderStats.OcclusionTestMs += 1000.0*(double)(GetProfileClock() - Start) / (double)GetProfileClockFrequency();
+    return Result;
+}
+
+// Note(joe): Checks this frame's verdicts against the depth buffer the GPU actually
+// drew, Depth is a Width by Height glReadPixels of it. A box counts as hidden if
+// everything the GPU drew over all of it is nearer than its nearest corner.
+// FalseCulls were culled and not hidden, so could have shown. Missed were hidden and
+// drawn anyway, occlusion a finer buffer or more occluders would have found.
+static void CheckOcclusion(occlusion_buffer *Buffer, float *Depth, int Width, int Height, uint32 *FalseCulls, uint32 *Missed)
+{
+    for (uint32 RecordIndex = 0; RecordIndex < Buffer->OccludeeCount; ++RecordIndex)
+    {
+        occludee_record *Record = Buffer->Occludees + RecordIndex;
+
+        int MinX, MinY, MaxX, MaxY;
+        glm::vec4 Nearest;
+        if (!GetOccludeeRect(Record->ClipFromModel, Record->BoundsMin, Record->BoundsMax, Width, Height,
+                             &MinX, &MinY, &MaxX, &MaxY, &Nearest))
+        {
+            continue;
+        }
+
+        // Note(joe): Window depth with the default glDepthRange.
+        float NearestDepth = 0.5f*Nearest.z / Nearest.w + 0.5f;
+        bool Hidden = true;
+        for (int Y = MinY; Hidden && Y <= MaxY; ++Y)
+        {
+            for (int X = MinX; Hidden && X <= MaxX; ++X)
+            {
+                Hidden = (Depth[Y*Width + X] < NearestDepth);
+            }
+        }
+
+        *FalseCulls += (Record->Culled && !Hidden) ? 1 : 0;
+        *Missed += (!Record->Culled && Hidden) ? 1 : 0;
+    }
+}
@@ -0,0 +1,321 @@
+//
+// Profiler, the collecting side. See aqcube_profile.h for the recording side.
+//
+// Note(joe): Once a frame the main thread drains every thread's ring. Begin/end pairs
+// are folded into a tree of nodes per thread (same name under the same parent is the
+// same node) with a call count and the time spent inside. Scopes that are still open
+// when the frame ends (a worker decoding a texture) are charged up to the end of the
+// frame and carry on into the next one. With a trace open the raw events are also
+// written out in the Chrome trace format, load it in chrome://tracing or
+// ui.perfetto.dev.
+//
+
+#if AQCUBE_PROFILE
+
+#define MAX_PROFILE_NODES 512
+#define MAX_PROFILE_DEPTH 32
+#define PROFILE_NO_NODE 0xFFFFFFFF
+
+struct profile_node
+{
+    const char *Name;
+    uint32 Parent;
+    uint32 ThreadIndex;
+    uint32 Depth;
+    uint32 CallCount;
+    uint64 Clocks;
+};
+
+struct profile_frame
+{
+    uint64 BeginClock;
+    uint64 EndClock;
+    uint32 DroppedEvents;
+    uint32 NodeCount;
+    profile_node Nodes[MAX_PROFILE_NODES];
+};
+
+// Note(joe): What a thread had open when the last frame was collected.
+struct profile_thread_stack
+{
+    uint32 Depth;
+    const char *Names[MAX_PROFILE_DEPTH];
+    uint32 Nodes[MAX_PROFILE_DEPTH];
+    uint64 Clocks[MAX_PROFILE_DEPTH];
+};
+
+struct profiler
+{
+    uint64 ClockFrequency;
+    uint64 StartClock;
+    uint64 FrameBeginClock;
+    profile_thread_stack Stacks[MAX_PROFILE_THREADS];
+    profile_frame Frame;
+
+    bool Tracing;
+    bool TraceHasEvents;
+    write_file TraceFile;
+    uint32 TraceBufferUsed;
+    char TraceBuffer[Kilobytes(64)];
+};
+
+static profiler GlobalProfiler;
+
+static void InitProfiler()
+{
+    GlobalProfiler.ClockFrequency = GetProfileClockFrequency();
+    GlobalProfiler.StartClock = GetProfileClock();
+    GlobalProfiler.FrameBeginClock = GlobalProfiler.StartClock;
+}
+
+inline float GetProfileMilliseconds(uint64 Clocks)
+{
+    float Result = 1000.0f*(float)((double)Clocks / (double)GlobalProfiler.ClockFrequency);
+    return Result;
+}
+
+static void FlushProfileTrace()
+{
+    profiler *Profiler = &GlobalProfiler;
+    WriteToFile(&Profiler->TraceFile, Profiler->TraceBuffer, Profiler->TraceBufferUsed);
+    Profiler->TraceBufferUsed = 0;
+}
+
+static void WriteProfileTraceEvent(const char *Name, char Phase, uint64 Clock, uint32 ThreadIndex)
+{
+    profiler *Profiler = &GlobalProfiler;
+    if (Profiler->TraceBufferUsed + 512 > sizeof(Profiler->TraceBuffer))
+    {
+        FlushProfileTrace();
+    }
+
+    double Microseconds = 1000000.0*(double)(Clock - Profiler->StartClock) / (double)Profiler->ClockFrequency;
+    Profiler->TraceBufferUsed += sprintf_s(Profiler->TraceBuffer + Profiler->TraceBufferUsed,
+                                           sizeof(Profiler->TraceBuffer) - Profiler->TraceBufferUsed,
+                                           "%s\n{\"name\":\"%.200s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                                           Profiler->TraceHasEvents ? "," : "", Name, Phase, Microseconds, ThreadIndex);
+    Profiler->TraceHasEvents = true;
+}
+
+// Note(joe): Everything recorded from now until EndProfileTrace ends up in FileName.
+static bool BeginProfileTrace(char *FileName)
+{
+    profiler *Profiler = &GlobalProfiler;
+    Profiler->TraceFile = BeginWriteFile(FileName);
+    Profiler->Tracing = Profiler->TraceFile.NoErrors;
+    Profiler->TraceHasEvents = false;
+    Profiler->TraceBufferUsed = sprintf_s(Profiler->TraceBuffer, sizeof(Profiler->TraceBuffer), "{\"traceEvents\":[");
+    return Profiler->Tracing;
+}
+
+static bool EndProfileTrace()
+{
+    profiler *Profiler = &GlobalProfiler;
+    if (!Profiler->Tracing)
+    {
+        return false;
+    }
+
+    for (uint32 ThreadIndex = 0; ThreadIndex < GlobalProfileRings.ThreadCount; ++ThreadIndex)
+    {
+        if (Profiler->TraceBufferUsed + 512 > sizeof(Profiler->TraceBuffer))
+        {
+            FlushProfileTrace();
+        }
+        Profiler->TraceBufferUsed += sprintf_s(Profiler->TraceBuffer + Profiler->TraceBufferUsed,
+                                               sizeof(Profiler->TraceBuffer) - Profiler->TraceBufferUsed,
+                                               "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                                               Profiler->TraceHasEvents ? "," : "", ThreadIndex,
+                                               ThreadIndex ? "Worker" : "Main", ThreadIndex);
+        Profiler->TraceHasEvents = true;
+    }
+    Profiler->TraceBufferUsed += sprintf_s(Profiler->TraceBuffer + Profiler->TraceBufferUsed,
+                                           sizeof(Profiler->TraceBuffer) - Profiler->TraceBufferUsed, "\n]}\n");
+    FlushProfileTrace();
+
+    Profiler->Tracing = false;
+    return EndWriteFile(&Profiler->TraceFile);
+}
+
+static uint32 GetProfileNode(profile_frame *Frame, uint32 Parent, const char *Name, uint32 ThreadIndex, uint32 Depth)
+{
+    // Note(joe): Names are compared by pointer, the same scope always hands in the
+    // same string. A few hundred nodes at most, a linear search is fine.
+    for (uint32 NodeIndex = 0; NodeIndex < Frame->NodeCount; ++NodeIndex)
+    {
+        profile_node *Node = Frame->Nodes + NodeIndex;
+        if (Node->Name == Name && Node->Parent == Parent && Node->ThreadIndex == ThreadIndex)
+        {
+            return NodeIndex;
+        }
+    }
+
+    if (Frame->NodeCount == MAX_PROFILE_NODES)
+    {
+        return PROFILE_NO_NODE;
+    }
+
+    uint32 NodeIndex = Frame->NodeCount++;
+    profile_node *Node = Frame->Nodes + NodeIndex;
+    Node->Name = Name;
+    Node->Parent = Parent;
+    Node->ThreadIndex = ThreadIndex;
+    Node->Depth = Depth;
+    Node->CallCount = 0;
+    Node->Clocks = 0;
+    return NodeIndex;
+}
+
+static void CollectProfileRing(profile_frame *Frame, uint32 ThreadIndex)
+{
+    profiler *Profiler = &GlobalProfiler;
+    profile_ring *Ring = GlobalProfileRings.Rings + ThreadIndex;
+    profile_thread_stack *Stack = Profiler->Stacks + ThreadIndex;
+
+    uint32 WriteCount = Ring->WriteCount;
+    CompletePreviousReadsBeforeFutureReads;
+    if (WriteCount - Ring->ReadCount > PROFILE_RING_SIZE)
+    {
+        Frame->DroppedEvents += (WriteCount - Ring->ReadCount) - PROFILE_RING_SIZE;
+        Ring->ReadCount = WriteCount - PROFILE_RING_SIZE;
+    }
+
+    for (uint32 EventIndex = Ring->ReadCount; EventIndex != WriteCount; ++EventIndex)
+    {
+        profile_event Event = Ring->Events[EventIndex & (PROFILE_RING_SIZE - 1)];
+
+        // Note(joe): The owning thread carries on writing while we read. Anything it
+        // could have lapped since we looked at WriteCount is thrown away.
+        CompletePreviousReadsBeforeFutureReads;
+        uint32 LatestWriteCount = Ring->WriteCount;
+        if (LatestWriteCount - EventIndex > PROFILE_RING_SIZE)
+        {
+            ++Frame->DroppedEvents;
+            continue;
+        }
+
+        if (Profiler->Tracing)
+        {
+            WriteProfileTraceEvent(Event.Name, (Event.Type == ProfileEvent_Begin) ? 'B' : 'E', Event.Clock, ThreadIndex);
+        }
+
+        if (Event.Type == ProfileEvent_Begin)
+        {
+            if (Stack->Depth < MAX_PROFILE_DEPTH)
+            {
+                uint32 Parent = Stack->Depth ? Stack->Nodes[Stack->Depth - 1] : PROFILE_NO_NODE;
+                Stack->Names[Stack->Depth] = Event.Name;
+                Stack->Nodes[Stack->Depth] = GetProfileNode(Frame, Parent, Event.Name, ThreadIndex, Stack->Depth);
+                Stack->Clocks[Stack->Depth] = Event.Clock;
+            }
+            ++Stack->Depth;
+        }
+        else if (Stack->Depth)
+        {
+            --Stack->Depth;
+            if (Stack->Depth < MAX_PROFILE_DEPTH && Stack->Nodes[Stack->Depth] != PROFILE_NO_NODE)
+            {
+                profile_node *Node = Frame->Nodes + Stack->Nodes[Stack->Depth];
+                Node->Clocks += Event.Clock - Stack->Clocks[Stack->Depth];
+                ++Node->CallCount;
+            }
+        }
+    }
+    Ring->ReadCount = WriteCount;
+}
+
+// Note(joe): Call on the main thread once a frame, and once after loading to get the
+// load on its own. The returned frame is good until the next call.
+static profile_frame *EndProfileFrame()
+{
+    profiler *Profiler = &GlobalProfiler;
+    profile_frame *Frame = &Profiler->Frame;
+    uint64 FrameEndClock = GetProfileClock();
+
+    Frame->BeginClock = Profiler->FrameBeginClock;
+    Frame->EndClock = FrameEndClock;
+    Frame->DroppedEvents = 0;
+    Frame->NodeCount = 0;
+
+    uint32 ThreadCount = GlobalProfileRings.ThreadCount;
+    for (uint32 ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        // Note(joe): Scopes left open last frame pick up where they left off.
+        profile_thread_stack *Stack = Profiler->Stacks + ThreadIndex;
+        uint32 OpenCount = (Stack->Depth < MAX_PROFILE_DEPTH) ? Stack->Depth : MAX_PROFILE_DEPTH;
+        for (uint32 Depth = 0; Depth < OpenCount; ++Depth)
+        {
+            uint32 Parent = Depth ? Stack->Nodes[Depth - 1] : PROFILE_NO_NODE;
+            Stack->Nodes[Depth] = GetProfileNode(Frame, Parent, Stack->Names[Depth], ThreadIndex, Depth);
+        }
+
+        CollectProfileRing(Frame, ThreadIndex);
+
+        // Note(joe): And whatever is still open gets charged up to now.
+        OpenCount = (Stack->Depth < MAX_PROFILE_DEPTH) ? Stack->Depth : MAX_PROFILE_DEPTH;
+        for (uint32 Depth = 0; Depth < OpenCount; ++Depth)
+        {
+            if (Stack->Nodes[Depth] != PROFILE_NO_NODE && Stack->Clocks[Depth] < FrameEndClock)
+            {
+                Frame->Nodes[Stack->Nodes[Depth]].Clocks += FrameEndClock - Stack->Clocks[Depth];
+                Stack->Clocks[Depth] = FrameEndClock;
+            }
+        }
+    }
+
+    Profiler->FrameBeginClock = FrameEndClock;
+    return Frame;
+}
+
+static void FormatProfileNodes(profile_frame *Frame, uint32 Parent, uint32 ThreadIndex,
+                               char **Text, char *TextEnd)
+{
+    for (uint32 NodeIndex = 0; NodeIndex < Frame->NodeCount; ++NodeIndex)
+    {
+        profile_node *Node = Frame->Nodes + NodeIndex;
+        if (Node->Parent == Parent && Node->ThreadIndex == ThreadIndex && *Text < TextEnd)
+        {
+            int Indent = 2*(int)Node->Depth;
+            int Written = snprintf(*Text, TextEnd - *Text, "  %*s%-*s %9.3f ms %6u\n",
+                                   Indent, "", 40 - Indent, Node->Name,
+                                   GetProfileMilliseconds(Node->Clocks), Node->CallCount);
+            *Text += (Written < TextEnd - *Text) ? Written : (TextEnd - *Text);
+            FormatProfileNodes(Frame, NodeIndex, ThreadIndex, Text, TextEnd);
+        }
+    }
+}
+
+// Note(joe): The scope tree as text, a thread at a time.
+static void FormatProfileFrame(profile_frame *Frame, char *Buffer, size_t BufferSize)
+{
+    char *Text = Buffer;
+    char *TextEnd = Buffer + BufferSize;
+    Text += snprintf(Text, TextEnd - Text, "Profile: %.3f ms, %u dropped events\n",
+                     GetProfileMilliseconds(Frame->EndClock - Frame->BeginClock), Frame->DroppedEvents);
+
+    uint32 ThreadCount = GlobalProfileRings.ThreadCount;
+    for (uint32 ThreadIndex = 0; ThreadIndex < ThreadCount && Text < TextEnd; ++ThreadIndex)
+    {
+        char *ThreadStart = Text;
+        Text += snprintf(Text, TextEnd - Text, " %s %u\n", ThreadIndex ? "Worker" : "Main", ThreadIndex);
+        char *NodesStart = Text;
+        FormatProfileNodes(Frame, PROFILE_NO_NODE, ThreadIndex, &Text, TextEnd);
+        if (Text == NodesStart)
+        {
+            // Note(joe): Nothing happened on this thread, leave it out.
+            Text = ThreadStart;
+            *Text = 0;
+        }
+    }
+}
+
+#else
+
+struct profile_frame;
+inline void InitProfiler() {}
+inline bool BeginProfileTrace(char *FileName) { return false; }
+inline bool EndProfileTrace() { return false; }
+inline profile_frame *EndProfileFrame() { return 0; }
+inline void FormatProfileFrame(profile_frame *Frame, char *Buffer, size_t BufferSize) { if (BufferSize) { Buffer[0] = 0; } }
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+
+//
+// Profiler
+//
+// Note(joe): TIMED_SCOPE("Name") and TIMED_FUNCTION() record a begin event when
+// they're constructed and an end event when they go out of scope. Events go into a
+// ring owned by the thread that made them, so recording one is a clock read and a
+// few stores, no locks. The main thread drains all the rings once a frame with
+// EndProfileFrame (aqcube_profile.cpp), which rebuilds the scope hierarchy and can
+// stream the raw events out as a Chrome trace. Build with AQCUBE_PROFILE=0 and the
+// macros compile away to nothing.
+//
+
+#ifndef AQCUBE_PROFILE
+#define AQCUBE_PROFILE 1
+#endif
+
+// Note(joe): Platform services, the hosts hand out their high resolution clock.
+uint64 GetProfileClock();
+uint64 GetProfileClockFrequency();
+
+#if AQCUBE_PROFILE
+
+enum profile_event_type
+{
+    ProfileEvent_Begin,
+    ProfileEvent_End,
+};
+
+struct profile_event
+{
+    uint64 Clock;
+    const char *Name; // Has to outlive the profiler, string literals and __FUNCTION__ do.
+    uint32 Type;
+};
+
+// Note(joe): Per thread, a power of two. The main thread drains them every frame, so
+// this only has to hold a frame's worth (or a load's worth, for the workers).
+#define PROFILE_RING_SIZE 8192
+#define MAX_PROFILE_THREADS 16
+
+struct profile_ring
+{
+    uint32 volatile WriteCount; // Only the owning thread writes this.
+    uint32 ReadCount;           // Only the main thread touches this.
+    profile_event Events[PROFILE_RING_SIZE];
+};
+
+struct profile_rings
+{
+    uint32 volatile ThreadCount;
+    profile_ring Rings[MAX_PROFILE_THREADS];
+};
+
+static profile_rings GlobalProfileRings;
+static thread_local profile_ring *ThreadProfileRing;
+
+// Note(joe): Threads get a ring the first time they record anything, in that order,
+// so the thread that records first (the main thread, at startup) is thread 0.
+inline profile_ring *GetThreadProfileRing()
+{
+    profile_ring *Ring = ThreadProfileRing;
+    if (!Ring)
+    {
+        uint32 ThreadIndex = AtomicAddUInt32(&GlobalProfileRings.ThreadCount, 1);
+        assert(ThreadIndex < MAX_PROFILE_THREADS);
+        Ring = ThreadProfileRing = GlobalProfileRings.Rings + ThreadIndex;
+    }
+    return Ring;
+}
+
+inline void RecordProfileEvent(uint32 Type, const char *Name)
+{
+    profile_ring *Ring = GetThreadProfileRing();
+    uint32 WriteCount = Ring->WriteCount;
+    profile_event *Event = Ring->Events + (WriteCount & (PROFILE_RING_SIZE - 1));
+    Event->Clock = GetProfileClock();
+    Event->Name = Name;
+    Event->Type = Type;
+    CompletePreviousWritesBeforeFutureWrites;
+    Ring->WriteCount = WriteCount + 1;
+}
+
+struct timed_scope
+{
+    const char *Name;
+
+    timed_scope(const char *Name) : Name(Name)
+    {
+        RecordProfileEvent(ProfileEvent_Begin, Name);
+    }
+
+    ~timed_scope()
+    {
+        RecordProfileEvent(ProfileEvent_End, Name);
+    }
+};
+
+#define TIMED_SCOPE_NAME__(Line) TimedScope_##Line
+#define TIMED_SCOPE_NAME_(Line) TIMED_SCOPE_NAME__(Line)
+#define TIMED_SCOPE(Name) timed_scope TIMED_SCOPE_NAME_(__LINE__)(Name)
+#define TIMED_FUNCTION() TIMED_SCOPE(__FUNCTION__)
+
+#else
+
+#define TIMED_SCOPE(Name)
+#define TIMED_FUNCTION()
+
+#endif
@@ -0,0 +1,301 @@
+//
+// Render queue
+//
+// Note(joe): Scenes don't draw as they walk their models. Every draw is pushed as a
+// render_command with a 64 bit sort key, the queue is radix sorted once the frame has
+// been submitted, and then it's walked in key order only touching the GL state that
+// actually changes. Each run of draws with the same state goes out as a single
+// multi-draw. The key is packed most significant first, so draws group by whatever
+// is most expensive to switch:
+//
+//   63..62  pass          opaque first, then translucent
+//   61..56  program
+//   55..40  material      the texture set
+//   39..24  vertex array
+//   23..0   depth         front to back for opaque so early-z throws more away,
+//                         back to front for translucent so blending comes out right
+//
+// The ids are truncated to fit. Two things sharing an id only costs sort quality,
+// nothing is skipped without comparing the real state.
+//
+
+struct texture
+{
+    GLuint Id;
+    const char *Type;
+    uint64 SamplerHash; // "texture_diffuse1" and friends, filled in by InitRenderMaterial.
+};
+
+// Note(joe): The textures a draw samples. Meshes with the same material share one, so
+// drawing them back to back doesn't rebind anything.
+struct render_material
+{
+    texture *Textures;
+    uint32 TextureCount;
+    uint32 SortId;
+};
+
+static uint32 GlobalNextMaterialSortId;
+
+static void InitRenderMaterial(render_material *Material, texture *Textures, uint32 TextureCount)
+{
+    Material->Textures = Textures;
+    Material->TextureCount = TextureCount;
+    Material->SortId = GlobalNextMaterialSortId++;
+
+    // Note(joe): Texture i always goes on unit i and the sampler it binds to only
+    // depends on its slot in the material, so the name is built once here rather
+    // than on every draw.
+    GLuint DiffuseNum = 1;
+    GLuint SpecularNum = 1;
+    for (GLuint i = 0; i < TextureCount; ++i)
+    {
+        int number = 0;
+        if (strcmp(Textures[i].Type, "texture_diffuse") == 0)
+        {
+            number = DiffuseNum++;
+        }
+        else if (strcmp(Textures[i].Type, "texture_specular") == 0)
+        {
+            number = SpecularNum++;
+        }
+
+        char Uniform[64];
+        int UniformLength = sprintf_s(Uniform, sizeof(Uniform)/sizeof(Uniform[0]), "%s%i", Textures[i].Type, number);
+        Textures[i].SamplerHash = HashUniformName(Uniform, UniformLength);
+    }
+}
+
+enum render_pass
+{
+    RenderPass_Opaque,
+    RenderPass_Translucent,
+};
+
+#define RENDER_KEY_DEPTH_BITS 24
+#define RENDER_KEY_VERTEX_ARRAY_SHIFT 24
+#define RENDER_KEY_MATERIAL_SHIFT 40
+#define RENDER_KEY_PROGRAM_SHIFT 56
+#define RENDER_KEY_PASS_SHIFT 62
+
+// Note(joe): Depth is the view space distance over the far plane, anything outside
+// [0, 1] is clamped.
+inline uint64 MakeRenderKey(render_pass Pass, shader_program *Program, render_material *Material, GLuint VertexArray, float Depth)
+{
+    uint32 MaxDepth = (1 << RENDER_KEY_DEPTH_BITS) - 1;
+    Depth = (Depth < 0.0f) ? 0.0f : ((Depth > 1.0f) ? 1.0f : Depth);
+    uint32 QuantizedDepth = (uint32)(Depth*(float)MaxDepth);
+    if (Pass == RenderPass_Translucent)
+    {
+        QuantizedDepth = MaxDepth - QuantizedDepth;
+    }
+
+    uint64 Result = ((uint64)Pass << RENDER_KEY_PASS_SHIFT) |
+                    ((uint64)(Program->Id & 0x3F) << RENDER_KEY_PROGRAM_SHIFT) |
+                    ((uint64)(Material->SortId & 0xFFFF) << RENDER_KEY_MATERIAL_SHIFT) |
+                    ((uint64)(VertexArray & 0xFFFF) << RENDER_KEY_VERTEX_ARRAY_SHIFT) |
+                    (uint64)QuantizedDepth;
+    return Result;
+}
+
+struct render_command
+{
+    shader_program *Program;
+    render_material *Material;
+    GLuint VertexArray;
+    GLuint IndexCount;
+    GLuint FirstIndex;
+    GLint BaseVertex;
+    GLenum IndexType;
+    uint32 Instance; // Where the draw's transform is in the instance buffer.
+};
+
+struct render_sort_entry
+{
+    uint64 Key;
+    uint32 CommandIndex;
+};
+
+struct render_queue
+{
+    uint32 MaxCommands;
+    uint32 CommandCount;
+    render_command *Commands;
+    render_sort_entry *Entries;
+};
+
+// Note(joe): The queue only lives for a frame, everything comes out of the frame arena.
+static void BeginRenderQueue(render_queue *Queue, memory_arena *FrameArena, uint32 MaxCommands)
+{
+    Queue->MaxCommands = MaxCommands;
+    Queue->CommandCount = 0;
+    Queue->Commands = PushArray(FrameArena, MaxCommands, render_command);
+    Queue->Entries = PushArray(FrameArena, MaxCommands, render_sort_entry);
+}
+
+// Note(joe): Returns the command to fill in.
+inline render_command *PushRenderCommand(render_queue *Queue, uint64 Key)
+{
+    assert(Queue->CommandCount < Queue->MaxCommands);
+    uint32 CommandIndex = Queue->CommandCount++;
+    Queue->Entries[CommandIndex].Key = Key;
+    Queue->Entries[CommandIndex].CommandIndex = CommandIndex;
+    return Queue->Commands + CommandIndex;
+}
+
+// Note(joe): LSD radix sort a byte at a time. All eight histograms come out of one
+// pass over the keys, and a byte that's the same in every key (most of them, there are
+// only a few passes and programs) doesn't get a pass at all. It's stable, so draws with
+// equal keys keep the order they were pushed in. Returns whichever of the two buffers
+// ended up holding the sorted entries.
+static render_sort_entry *RadixSortRenderEntries(render_sort_entry *Entries, render_sort_entry *Temp, uint32 Count)
+{
+    TIMED_FUNCTION();
+
+    uint32 Counts[8][256] = {};
+    for (uint32 EntryIndex = 0; EntryIndex < Count; ++EntryIndex)
+    {
+        uint64 Key = Entries[EntryIndex].Key;
+        for (uint32 Byte = 0; Byte < 8; ++Byte)
+        {
+            ++Counts[Byte][(Key >> (Byte*8)) & 0xFF];
+        }
+    }
+
+    render_sort_entry *Source = Entries;
+    render_sort_entry *Dest = Temp;
+    for (uint32 Byte = 0; Count && Byte < 8; ++Byte)
+    {
+        uint32 Shift = Byte*8;
+        uint32 *ByteCounts = Counts[Byte];
+        if (ByteCounts[(Source[0].Key >> Shift) & 0xFF] == Count)
+        {
+            continue;
+        }
+
+        uint32 Offset = 0;
+        for (uint32 Bucket = 0; Bucket < 256; ++Bucket)
+        {
+            uint32 BucketCount = ByteCounts[Bucket];
+            ByteCounts[Bucket] = Offset;
+            Offset += BucketCount;
+        }
+
+        for (uint32 EntryIndex = 0; EntryIndex < Count; ++EntryIndex)
+        {
+            Dest[ByteCounts[(Source[EntryIndex].Key >> Shift) & 0xFF]++] = Source[EntryIndex];
+        }
+
+        render_sort_entry *Swap = Source;
+        Source = Dest;
+        Dest = Swap;
+    }
+
+    return Source;
+}
+
+#define RENDER_MAX_TEXTURE_UNITS 8
+
+// Note(joe): A run of sorted commands that share all their state, it goes to the
+// driver as one multi-draw.
+struct render_batch
+{
+    shader_program *Program;
+    render_material *Material;
+    GLuint VertexArray;
+    GLenum IndexType;
+    uint32 FirstCommand;
+    uint32 CommandCount;
+};
+
+// Note(joe): Sorts and draws everything in the queue. The GL state cache drops the
+// binds that repeat, this only remembers enough to skip walking a material's textures
+// and to keep the sampler uniforms, which the cache doesn't see, from being set again.
+static void ExecuteRenderQueue(render_queue *Queue, instance_buffer *Instances, indirect_buffer *Indirect, memory_arena *Scratch)
+{
+    TIMED_FUNCTION();
+
+    temporary_memory SortMemory = BeginTemporaryMemory(Scratch);
+    render_sort_entry *Temp = PushArray(Scratch, Queue->CommandCount, render_sort_entry);
+    render_sort_entry *Sorted = RadixSortRenderEntries(Queue->Entries, Temp, Queue->CommandCount);
+
+    // Note(joe): The whole frame's indirect commands go up in one upload, in key order,
+    // and the batches are ranges of them.
+    draw_elements_indirect_command *DrawCommands = PushArray(Scratch, Queue->CommandCount, draw_elements_indirect_command);
+    render_batch *Batches = PushArray(Scratch, Queue->CommandCount, render_batch);
+    uint32 BatchCount = 0;
+    for (uint32 EntryIndex = 0; EntryIndex < Queue->CommandCount; ++EntryIndex)
+    {
+        render_command *Command = Queue->Commands + Sorted[EntryIndex].CommandIndex;
+
+        render_batch *Batch = BatchCount ? (Batches + BatchCount - 1) : 0;
+        if (!Batch ||
+            (Batch->Program != Command->Program) ||
+            (Batch->Material != Command->Material) ||
+            (Batch->VertexArray != Command->VertexArray) ||
+            (Batch->IndexType != Command->IndexType))
+        {
+            Batch = Batches + BatchCount++;
+            Batch->Program = Command->Program;
+            Batch->Material = Command->Material;
+            Batch->VertexArray = Command->VertexArray;
+            Batch->IndexType = Command->IndexType;
+            Batch->FirstCommand = EntryIndex;
+            Batch->CommandCount = 0;
+        }
+        ++Batch->CommandCount;
+
+        draw_elements_indirect_command *DrawCommand = DrawCommands + EntryIndex;
+        DrawCommand->Count = Command->IndexCount;
+        DrawCommand->InstanceCount = 1;
+        DrawCommand->FirstIndex = Command->FirstIndex;
+        DrawCommand->BaseVertex = Command->BaseVertex;
+        DrawCommand->BaseInstance = Command->Instance;
+    }
+    Win32UploadIndirectCommands(Indirect, DrawCommands, Queue->CommandCount);
+
+    shader_program *Program = 0;
+    // Note(joe): Sampler values stick to the program, this is what each unit's been
+    // told to sample with since the program was bound.
+    uint64 UnitSamplers[RENDER_MAX_TEXTURE_UNITS] = {};
+
+    for (uint32 BatchIndex = 0; BatchIndex < BatchCount; ++BatchIndex)
+    {
+        render_batch *Batch = Batches + BatchIndex;
+
+        if (Batch->Program != Program)
+        {
+            Program = Batch->Program;
+            Win32UseProgram(Program->Id);
+            memset(UnitSamplers, 0, sizeof(UnitSamplers));
+        }
+
+        // Note(joe): Consecutive batches always differ in something, usually this.
+        render_material *Material = Batch->Material;
+        assert(Material->TextureCount <= RENDER_MAX_TEXTURE_UNITS);
+        for (GLuint Unit = 0; Unit < Material->TextureCount; ++Unit)
+        {
+            texture *Texture = Material->Textures + Unit;
+            Win32BindTexture(Unit, Texture->Id);
+
+            if (UnitSamplers[Unit] != Texture->SamplerHash)
+            {
+                SetUniform(GetUniformSampler(Program, Texture->SamplerHash), Unit);
+                // Note(joe): The sampler isn't on any other unit any more.
+                for (GLuint OtherUnit = 0; OtherUnit < RENDER_MAX_TEXTURE_UNITS; ++OtherUnit)
+                {
+                    if (UnitSamplers[OtherUnit] == Texture->SamplerHash)
+                    {
+                        UnitSamplers[OtherUnit] = 0;
+                    }
+                }
+                UnitSamplers[Unit] = Texture->SamplerHash;
+            }
+        }
+
+        Win32BindVertexArray(Batch->VertexArray);
+        Win32MultiDrawElementsIndirect(Indirect, Instances, Batch->IndexType, Batch->FirstCommand, Batch->CommandCount);
+    }
+
+    EndTemporaryMemory(SortMemory);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Note(joe): SSE2 is there on every x64 target, and on x86 when the compiler is told
+// so. Code that has a SIMD path checks AQCUBE_SSE2 and keeps a scalar version for
+// everything else.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AQCUBE_SSE2 1
+#include <emmintrin.h>
+#else
+#define AQCUBE_SSE2 0
+#endif
+
+// Note(joe): AVX only when the compiler is told it can use it (-mavx, /arch:AVX),
+// there's no runtime dispatch. Code with an AVX path keeps its SSE2 one.
+#if defined(__AVX__)
+#define AQCUBE_AVX 1
+#include <immintrin.h>
+#else
+#define AQCUBE_AVX 0
+#endif
+
+// Note(joe): Same again for AVX2 (-mavx2, /arch:AVX2), which is what 256 bit integer
+// work needs. Code with an AVX2 path keeps its SSE2 one.
+#if defined(__AVX2__)
+#define AQCUBE_AVX2 1
+#include <immintrin.h>
+#else
+#define AQCUBE_AVX2 0
+#endif
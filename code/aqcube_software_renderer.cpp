@@ -0,0 +1,667 @@
+//
+// Software renderer
+//
+// Note(joe): Draws indexed triangle lists into a game_back_buffer with no GPU at all,
+// as the fallback when there's no GL and as a reference to hold the GL path up to.
+// It follows GL's conventions so the same matrices work: clip space z runs -w to w,
+// counter-clockwise is the front and only the front is drawn, and the depth test is
+// LESS against a buffer cleared to 1. The back buffer's rows go top down.
+//
+// Triangles are transformed, clipped against the near plane, lit and set up on the
+// calling thread as they're pushed. RenderSoftwareFrame then bins them into 64x64
+// tiles and hands the tiles out to the work queue. Each tile clears and draws its own
+// pixels, in the order the triangles were pushed, so nothing is shared between
+// threads and the image doesn't depend on how many there are.
+//
+// Pixels are tested 8 at a time with AVX, 4 with SSE2, against the three edge
+// functions and the depth plane. Pixel centres on an edge count as inside for both
+// triangles that share it, there's no top-left rule. With opaque, depth tested
+// triangles that only means a pixel is drawn twice, never a crack.
+//
+
+#include <cfloat>
+
+#include "aqcube_simd.h"
+
+#define SOFTWARE_TILE_SIZE 64
+
+// Note(joe): A frame's worth of set up triangles. Past this, DrawSoftwareMesh drops them.
+#define SOFTWARE_MAX_TRIANGLES (256*1024)
+
+// Note(joe): The tiles are taken off a shared counter, so this only has to be enough
+// to keep every worker busy, and it keeps a 4K frame from filling the queue.
+#define SOFTWARE_MAX_TILE_JOBS 64
+
+#if AQCUBE_AVX
+#define SOFTWARE_LANES 8
+#elif AQCUBE_SSE2
+#define SOFTWARE_LANES 4
+#else
+#define SOFTWARE_LANES 1
+#endif
+
+// Note(joe): Positions and triangles into them, the same layout Mesh draws from.
+struct software_mesh
+{
+    glm::vec3 *Positions;
+    uint32 VertexCount;
+    uint32 *Indices;
+    uint32 IndexCount;
+};
+
+struct software_triangle
+{
+    // Note(joe): Edge functions, Ax + By + C, all three positive inside.
+    float EdgeA[3];
+    float EdgeB[3];
+    float EdgeC[3];
+
+    // Note(joe): Window z, which is linear across the triangle on screen.
+    float DepthA;
+    float DepthB;
+    float DepthC;
+
+    uint32 Color;
+
+    int MinX;
+    int MinY;
+    int MaxX;
+    int MaxY;
+};
+
+// Note(joe): Bounds are inclusive and already clipped to the back buffer.
+struct software_tile
+{
+    uint32 *Triangles;
+    uint32 TriangleCount;
+    int MinX;
+    int MinY;
+    int MaxX;
+    int MaxY;
+};
+
+struct software_stats
+{
+    uint32 TrianglesSubmitted;
+    uint32 TrianglesDrawn; // Set up, after culling and near clipping.
+    uint32 TileTriangles;  // Summed over the tiles, so bigger than Drawn by the overlap.
+    uint32 TileCount;
+    uint32 TileJobs;
+    double SetupMs;
+    double BinMs;
+    double RasterMs;
+};
+
+struct software_renderer
+{
+    game_back_buffer *Target;
+    float *Depth;
+    int DepthPitch; // In floats, rounded up to a whole number of SIMD blocks.
+    bool ClearTarget;
+    uint32 ClearColor;
+
+    // Note(joe): World space, pointing at the light.
+    glm::vec3 LightDirection;
+    float Ambient;
+
+    software_triangle *Triangles;
+    uint32 TriangleCount;
+
+    software_tile *Tiles;
+    int TilesX;
+    int TilesY;
+    uint32 volatile NextTile;
+
+    memory_arena *FrameArena;
+    platform_work_queue *Queue; // Can be 0, the tiles are done in turn then.
+
+    software_stats Stats;
+};
+
+inline double GetSoftwareMilliseconds(uint64 Start, uint64 End)
+{
+    return 1000.0*(double)(End - Start) / (double)GetProfileClockFrequency();
+}
+
+inline uint32 PackSoftwareColor(glm::vec3 Color)
+{
+    Color = glm::clamp(Color, glm::vec3(0.0f), glm::vec3(1.0f));
+    uint32 Result = (((uint32)(255.0f*Color.b + 0.5f) << 0) |
+                     ((uint32)(255.0f*Color.g + 0.5f) << 8) |
+                     ((uint32)(255.0f*Color.r + 0.5f) << 16));
+    return Result;
+}
+
+// Note(joe): Everything for the frame goes in FrameArena, which has to outlive
+// RenderSoftwareFrame. The back buffer is 32 bits a pixel, blue in the low byte.
+// With ClearColor 0 the pixels already in it are drawn over, only depth is cleared.
+static void BeginSoftwareFrame(software_renderer *Renderer, memory_arena *FrameArena, game_back_buffer *Target,
+                               platform_work_queue *Queue, glm::vec3 *ClearColor)
+{
+    assert(Target->BytesPerPixel == 4);
+
+    Renderer->Target = Target;
+    Renderer->DepthPitch = (Target->Width + SOFTWARE_LANES - 1) & ~(SOFTWARE_LANES - 1);
+    Renderer->Depth = (float *)PushSizeAligned(FrameArena, (uint64)Renderer->DepthPitch*Target->Height*sizeof(float), 32);
+    Renderer->ClearTarget = (ClearColor != 0);
+    Renderer->ClearColor = ClearColor ? PackSoftwareColor(*ClearColor) : 0;
+
+    Renderer->Triangles = PushArray(FrameArena, SOFTWARE_MAX_TRIANGLES, software_triangle);
+    Renderer->TriangleCount = 0;
+
+    Renderer->TilesX = (Target->Width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    Renderer->TilesY = (Target->Height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    Renderer->Tiles = PushArray(FrameArena, Renderer->TilesX*Renderer->TilesY, software_tile);
+    for (int TileY = 0; TileY < Renderer->TilesY; ++TileY)
+    {
+        for (int TileX = 0; TileX < Renderer->TilesX; ++TileX)
+        {
+            software_tile *Tile = Renderer->Tiles + TileY*Renderer->TilesX + TileX;
+            Tile->Triangles = 0;
+            Tile->TriangleCount = 0;
+            Tile->MinX = TileX*SOFTWARE_TILE_SIZE;
+            Tile->MinY = TileY*SOFTWARE_TILE_SIZE;
+            Tile->MaxX = glm::min(Tile->MinX + SOFTWARE_TILE_SIZE, Target->Width) - 1;
+            Tile->MaxY = glm::min(Tile->MinY + SOFTWARE_TILE_SIZE, Target->Height) - 1;
+        }
+    }
+
+    Renderer->FrameArena = FrameArena;
+    Renderer->Queue = Queue;
+    Renderer->Stats = {};
+}
+
+// Note(joe): Returns false once the frame's triangles have run out.
+static bool SetupSoftwareTriangle(software_renderer *Renderer, glm::vec4 *Clip, uint32 Color)
+{
+    int Width = Renderer->Target->Width;
+    int Height = Renderer->Target->Height;
+
+    glm::vec3 Points[3];
+    for (int Corner = 0; Corner < 3; ++Corner)
+    {
+        float InverseW = 1.0f / Clip[Corner].w;
+        Points[Corner] = glm::vec3((0.5f*Clip[Corner].x*InverseW + 0.5f)*Width,
+                                   (0.5f - 0.5f*Clip[Corner].y*InverseW)*Height,
+                                   0.5f*Clip[Corner].z*InverseW + 0.5f);
+    }
+    glm::vec3 P0 = Points[0];
+    glm::vec3 P1 = Points[1];
+    glm::vec3 P2 = Points[2];
+
+    // Note(joe): y is flipped on the way to the rows, so the front faces come out
+    // negative here.
+    float Area = (P1.x - P0.x)*(P2.y - P0.y) - (P2.x - P0.x)*(P1.y - P0.y);
+    if (!(Area < 0.0f))
+    {
+        return true;
+    }
+
+    float MinX = glm::min(P0.x, glm::min(P1.x, P2.x));
+    float MaxX = glm::max(P0.x, glm::max(P1.x, P2.x));
+    float MinY = glm::min(P0.y, glm::min(P1.y, P2.y));
+    float MaxY = glm::max(P0.y, glm::max(P1.y, P2.y));
+    if (MaxX < 0.0f || MaxY < 0.0f || MinX > (float)Width || MinY > (float)Height)
+    {
+        return true;
+    }
+    int FirstX = glm::max((int)ceilf(MinX - 0.5f), 0);
+    int LastX = glm::min((int)floorf(MaxX - 0.5f), Width - 1);
+    int FirstY = glm::max((int)ceilf(MinY - 0.5f), 0);
+    int LastY = glm::min((int)floorf(MaxY - 0.5f), Height - 1);
+    if (FirstX > LastX || FirstY > LastY)
+    {
+        return true;
+    }
+
+    if (Renderer->TriangleCount == SOFTWARE_MAX_TRIANGLES)
+    {
+        return false;
+    }
+    software_triangle *Triangle = Renderer->Triangles + Renderer->TriangleCount++;
+    ++Renderer->Stats.TrianglesDrawn;
+
+    for (int Edge = 0; Edge < 3; ++Edge)
+    {
+        glm::vec3 From = Points[Edge];
+        glm::vec3 To = Points[(Edge + 1) % 3];
+        Triangle->EdgeA[Edge] = To.y - From.y;
+        Triangle->EdgeB[Edge] = From.x - To.x;
+        Triangle->EdgeC[Edge] = To.x*From.y - From.x*To.y;
+    }
+
+    float InverseArea = 1.0f / Area;
+    Triangle->DepthA = ((P1.z - P0.z)*(P2.y - P0.y) - (P2.z - P0.z)*(P1.y - P0.y))*InverseArea;
+    Triangle->DepthB = ((P1.x - P0.x)*(P2.z - P0.z) - (P2.x - P0.x)*(P1.z - P0.z))*InverseArea;
+    Triangle->DepthC = P0.z - Triangle->DepthA*P0.x - Triangle->DepthB*P0.y;
+    Triangle->Color = Color;
+
+    Triangle->MinX = FirstX;
+    Triangle->MinY = FirstY;
+    Triangle->MaxX = LastX;
+    Triangle->MaxY = LastY;
+
+    return true;
+}
+
+// Note(joe): GL's clip planes, a vertex outside one sets its bit.
+inline uint32 GetSoftwareOutCode(glm::vec4 Clip)
+{
+    uint32 Result = (((Clip.x < -Clip.w) ? 0x01 : 0) |
+                     ((Clip.x > Clip.w) ? 0x02 : 0) |
+                     ((Clip.y < -Clip.w) ? 0x04 : 0) |
+                     ((Clip.y > Clip.w) ? 0x08 : 0) |
+                     ((Clip.z < -Clip.w) ? 0x10 : 0) |
+                     ((Clip.z > Clip.w) ? 0x20 : 0));
+    return Result;
+}
+#define SOFTWARE_OUT_NEAR 0x10
+
+// Note(joe): Only the near plane is clipped against, the others are left to the
+// bounds and the edge functions. What's left is a triangle or a quad.
+static int ClipSoftwareTriangleToNear(glm::vec4 *In, glm::vec4 *Out)
+{
+    int Result = 0;
+    for (int Corner = 0; Corner < 3; ++Corner)
+    {
+        glm::vec4 From = In[Corner];
+        glm::vec4 To = In[(Corner + 1) % 3];
+        float FromDistance = From.z + From.w;
+        float ToDistance = To.z + To.w;
+        if (FromDistance >= 0.0f)
+        {
+            Out[Result++] = From;
+        }
+        if ((FromDistance >= 0.0f) != (ToDistance >= 0.0f))
+        {
+            float t = FromDistance / (FromDistance - ToDistance);
+            Out[Result++] = From + t*(To - From);
+        }
+    }
+    return Result;
+}
+
+// Note(joe): Flat shaded, Color lit by the face's normal. Returns false once the
+// frame's triangles have run out.
+static bool DrawSoftwareMesh(software_renderer *Renderer, glm::mat4 &ClipFromWorld, glm::mat4 &WorldFromModel,
+                             software_mesh *Mesh, glm::vec3 Color)
+{
+    TIMED_FUNCTION();
+
+    uint64 Start = GetProfileClock();
+    temporary_memory TempMemory = BeginTemporaryMemory(Renderer->FrameArena);
+
+    glm::vec3 *World = PushArray(Renderer->FrameArena, Mesh->VertexCount, glm::vec3);
+    glm::vec4 *Clip = PushArray(Renderer->FrameArena, Mesh->VertexCount, glm::vec4);
+    uint32 *OutCodes = PushArray(Renderer->FrameArena, Mesh->VertexCount, uint32);
+    for (uint32 Vertex = 0; Vertex < Mesh->VertexCount; ++Vertex)
+    {
+        World[Vertex] = glm::vec3(WorldFromModel*glm::vec4(Mesh->Positions[Vertex], 1.0f));
+        Clip[Vertex] = ClipFromWorld*glm::vec4(World[Vertex], 1.0f);
+        OutCodes[Vertex] = GetSoftwareOutCode(Clip[Vertex]);
+    }
+
+    bool Result = true;
+    for (uint32 Index = 0; Result && Index + 2 < Mesh->IndexCount; Index += 3)
+    {
+        uint32 I0 = Mesh->Indices[Index + 0];
+        uint32 I1 = Mesh->Indices[Index + 1];
+        uint32 I2 = Mesh->Indices[Index + 2];
+        ++Renderer->Stats.TrianglesSubmitted;
+        if (OutCodes[I0] & OutCodes[I1] & OutCodes[I2])
+        {
+            continue;
+        }
+
+        glm::vec3 Normal = glm::cross(World[I1] - World[I0], World[I2] - World[I0]);
+        float Length = glm::length(Normal);
+        float Diffuse = (Length > 0.0f) ? glm::max(glm::dot(Normal, Renderer->LightDirection) / Length, 0.0f) : 0.0f;
+        uint32 Packed = PackSoftwareColor((Renderer->Ambient + (1.0f - Renderer->Ambient)*Diffuse)*Color);
+
+        glm::vec4 Corners[3] = { Clip[I0], Clip[I1], Clip[I2] };
+        if ((OutCodes[I0] | OutCodes[I1] | OutCodes[I2]) & SOFTWARE_OUT_NEAR)
+        {
+            glm::vec4 Clipped[4];
+            int ClippedCount = ClipSoftwareTriangleToNear(Corners, Clipped);
+            for (int Fan = 1; Result && Fan + 1 < ClippedCount; ++Fan)
+            {
+                glm::vec4 FanCorners[3] = { Clipped[0], Clipped[Fan], Clipped[Fan + 1] };
+                Result = SetupSoftwareTriangle(Renderer, FanCorners, Packed);
+            }
+        }
+        else
+        {
+            Result = SetupSoftwareTriangle(Renderer, Corners, Packed);
+        }
+    }
+
+    EndTemporaryMemory(TempMemory);
+    Renderer->Stats.SetupMs += GetSoftwareMilliseconds(Start, GetProfileClock());
+
+    return Result;
+}
+
+// Note(joe): False if the triangle is outside one of its edges over the whole tile,
+// tested at the tile's pixel centre furthest along that edge.
+inline bool SoftwareTriangleTouchesTile(software_triangle *Triangle, software_tile *Tile)
+{
+    if (Triangle->MaxX < Tile->MinX || Triangle->MinX > Tile->MaxX ||
+        Triangle->MaxY < Tile->MinY || Triangle->MinY > Tile->MaxY)
+    {
+        return false;
+    }
+    for (int Edge = 0; Edge < 3; ++Edge)
+    {
+        float X = (float)((Triangle->EdgeA[Edge] > 0.0f) ? Tile->MaxX : Tile->MinX) + 0.5f;
+        float Y = (float)((Triangle->EdgeB[Edge] > 0.0f) ? Tile->MaxY : Tile->MinY) + 0.5f;
+        if (Triangle->EdgeA[Edge]*X + Triangle->EdgeB[Edge]*Y + Triangle->EdgeC[Edge] < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void ClearSoftwareTile(software_renderer *Renderer, software_tile *Tile)
+{
+    game_back_buffer *Target = Renderer->Target;
+    for (int Y = Tile->MinY; Y <= Tile->MaxY; ++Y)
+    {
+        uint32 *Pixel = (uint32 *)((uint8 *)Target->Memory + Y*Target->Pitch) + Tile->MinX;
+        float *Depth = Renderer->Depth + Y*Renderer->DepthPitch + Tile->MinX;
+        for (int X = Tile->MinX; X <= Tile->MaxX; ++X)
+        {
+            *Depth++ = 1.0f;
+        }
+        if (Renderer->ClearTarget)
+        {
+            for (int X = Tile->MinX; X <= Tile->MaxX; ++X)
+            {
+                *Pixel++ = Renderer->ClearColor;
+            }
+        }
+    }
+}
+
+static void RasterizeSoftwareTriangle(software_renderer *Renderer, software_triangle *Triangle, software_tile *Tile)
+{
+    game_back_buffer *Target = Renderer->Target;
+    int FirstY = glm::max(Triangle->MinY, Tile->MinY);
+    int LastY = glm::min(Triangle->MaxY, Tile->MaxY);
+    int FirstX = glm::max(Triangle->MinX, Tile->MinX);
+    int LastX = glm::min(Triangle->MaxX, Tile->MaxX);
+    // Note(joe): Tiles start on a block, so the blocks never reach into the next one.
+    int BlockX = FirstX & ~(SOFTWARE_LANES - 1);
+
+#if AQCUBE_AVX
+    __m256 LaneX = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 StartX = _mm256_add_ps(_mm256_set1_ps((float)BlockX), LaneX);
+    __m256 CenterX = _mm256_add_ps(StartX, _mm256_set1_ps(0.5f));
+    __m256 Step = _mm256_set1_ps((float)SOFTWARE_LANES);
+    __m256 FirstLane = _mm256_set1_ps((float)FirstX - 0.5f);
+    __m256 LastLane = _mm256_set1_ps((float)LastX + 0.5f);
+    __m256 EdgeStep[3];
+    for (int Edge = 0; Edge < 3; ++Edge)
+    {
+        EdgeStep[Edge] = _mm256_set1_ps(SOFTWARE_LANES*Triangle->EdgeA[Edge]);
+    }
+    __m256 DepthStep = _mm256_set1_ps(SOFTWARE_LANES*Triangle->DepthA);
+    __m256 Color = _mm256_castsi256_ps(_mm256_set1_epi32((int)Triangle->Color));
+    __m256 Zero = _mm256_setzero_ps();
+
+    for (int Y = FirstY; Y <= LastY; ++Y)
+    {
+        float CenterY = (float)Y + 0.5f;
+        __m256 Edges[3];
+        for (int Edge = 0; Edge < 3; ++Edge)
+        {
+            Edges[Edge] = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(Triangle->EdgeA[Edge]), CenterX),
+                                        _mm256_set1_ps(Triangle->EdgeB[Edge]*CenterY + Triangle->EdgeC[Edge]));
+        }
+        __m256 Plane = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(Triangle->DepthA), CenterX),
+                                     _mm256_set1_ps(Triangle->DepthB*CenterY + Triangle->DepthC));
+        __m256 X = StartX;
+
+        uint32 *Row = (uint32 *)((uint8 *)Target->Memory + Y*Target->Pitch);
+        float *DepthRow = Renderer->Depth + Y*Renderer->DepthPitch;
+        for (int PixelX = BlockX; PixelX <= LastX; PixelX += SOFTWARE_LANES)
+        {
+            __m256 Inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(Edges[0], Zero, _CMP_GE_OQ),
+                                                        _mm256_cmp_ps(Edges[1], Zero, _CMP_GE_OQ)),
+                                          _mm256_cmp_ps(Edges[2], Zero, _CMP_GE_OQ));
+            Inside = _mm256_and_ps(Inside, _mm256_and_ps(_mm256_cmp_ps(X, FirstLane, _CMP_GT_OQ),
+                                                         _mm256_cmp_ps(X, LastLane, _CMP_LT_OQ)));
+            if (_mm256_movemask_ps(Inside))
+            {
+                __m256 OldDepth = _mm256_load_ps(DepthRow + PixelX);
+                __m256 Pass = _mm256_and_ps(Inside, _mm256_cmp_ps(Plane, OldDepth, _CMP_LT_OQ));
+                int PassMask = _mm256_movemask_ps(Pass);
+                if (PassMask)
+                {
+                    _mm256_store_ps(DepthRow + PixelX, _mm256_blendv_ps(OldDepth, Plane, Pass));
+                    if (PixelX + SOFTWARE_LANES <= Target->Width)
+                    {
+                        __m256 OldColor = _mm256_loadu_ps((float *)(Row + PixelX));
+                        _mm256_storeu_ps((float *)(Row + PixelX), _mm256_blendv_ps(OldColor, Color, Pass));
+                    }
+                    else
+                    {
+                        for (int Lane = 0; Lane < SOFTWARE_LANES; ++Lane)
+                        {
+                            if (PassMask & (1 << Lane))
+                            {
+                                Row[PixelX + Lane] = Triangle->Color;
+                            }
+                        }
+                    }
+                }
+            }
+            for (int Edge = 0; Edge < 3; ++Edge)
+            {
+                Edges[Edge] = _mm256_add_ps(Edges[Edge], EdgeStep[Edge]);
+            }
+            Plane = _mm256_add_ps(Plane, DepthStep);
+            X = _mm256_add_ps(X, Step);
+        }
+    }
+#elif AQCUBE_SSE2
+    __m128 LaneX = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 StartX = _mm_add_ps(_mm_set1_ps((float)BlockX), LaneX);
+    __m128 CenterX = _mm_add_ps(StartX, _mm_set1_ps(0.5f));
+    __m128 Step = _mm_set1_ps((float)SOFTWARE_LANES);
+    __m128 FirstLane = _mm_set1_ps((float)FirstX - 0.5f);
+    __m128 LastLane = _mm_set1_ps((float)LastX + 0.5f);
+    __m128 EdgeStep[3];
+    for (int Edge = 0; Edge < 3; ++Edge)
+    {
+        EdgeStep[Edge] = _mm_set1_ps(SOFTWARE_LANES*Triangle->EdgeA[Edge]);
+    }
+    __m128 DepthStep = _mm_set1_ps(SOFTWARE_LANES*Triangle->DepthA);
+    __m128i Color = _mm_set1_epi32((int)Triangle->Color);
+    __m128 Zero = _mm_setzero_ps();
+
+    for (int Y = FirstY; Y <= LastY; ++Y)
+    {
+        float CenterY = (float)Y + 0.5f;
+        __m128 Edges[3];
+        for (int Edge = 0; Edge < 3; ++Edge)
+        {
+            Edges[Edge] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Triangle->EdgeA[Edge]), CenterX),
+                                     _mm_set1_ps(Triangle->EdgeB[Edge]*CenterY + Triangle->EdgeC[Edge]));
+        }
+        __m128 Plane = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Triangle->DepthA), CenterX),
+                                  _mm_set1_ps(Triangle->DepthB*CenterY + Triangle->DepthC));
+        __m128 X = StartX;
+
+        uint32 *Row = (uint32 *)((uint8 *)Target->Memory + Y*Target->Pitch);
+        float *DepthRow = Renderer->Depth + Y*Renderer->DepthPitch;
+        for (int PixelX = BlockX; PixelX <= LastX; PixelX += SOFTWARE_LANES)
+        {
+            __m128 Inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(Edges[0], Zero), _mm_cmpge_ps(Edges[1], Zero)),
+                                       _mm_cmpge_ps(Edges[2], Zero));
+            Inside = _mm_and_ps(Inside, _mm_and_ps(_mm_cmpgt_ps(X, FirstLane), _mm_cmplt_ps(X, LastLane)));
+            if (_mm_movemask_ps(Inside))
+            {
+                __m128 OldDepth = _mm_load_ps(DepthRow + PixelX);
+                __m128 Pass = _mm_and_ps(Inside, _mm_cmplt_ps(Plane, OldDepth));
+                int PassMask = _mm_movemask_ps(Pass);
+                if (PassMask)
+                {
+                    _mm_store_ps(DepthRow + PixelX, _mm_or_ps(_mm_and_ps(Pass, Plane), _mm_andnot_ps(Pass, OldDepth)));
+                    if (PixelX + SOFTWARE_LANES <= Target->Width)
+                    {
+                        __m128i PassBits = _mm_castps_si128(Pass);
+                        __m128i OldColor = _mm_loadu_si128((__m128i *)(Row + PixelX));
+                        _mm_storeu_si128((__m128i *)(Row + PixelX),
+                                         _mm_or_si128(_mm_and_si128(PassBits, Color), _mm_andnot_si128(PassBits, OldColor)));
+                    }
+                    else
+                    {
+                        for (int Lane = 0; Lane < SOFTWARE_LANES; ++Lane)
+                        {
+                            if (PassMask & (1 << Lane))
+                            {
+                                Row[PixelX + Lane] = Triangle->Color;
+                            }
+                        }
+                    }
+                }
+            }
+            for (int Edge = 0; Edge < 3; ++Edge)
+            {
+                Edges[Edge] = _mm_add_ps(Edges[Edge], EdgeStep[Edge]);
+            }
+            Plane = _mm_add_ps(Plane, DepthStep);
+            X = _mm_add_ps(X, Step);
+        }
+    }
+#else
+    for (int Y = FirstY; Y <= LastY; ++Y)
+    {
+        float CenterY = (float)Y + 0.5f;
+        uint32 *Row = (uint32 *)((uint8 *)Target->Memory + Y*Target->Pitch);
+        float *DepthRow = Renderer->Depth + Y*Renderer->DepthPitch;
+        for (int X = FirstX; X <= LastX; ++X)
+        {
+            float CenterX = (float)X + 0.5f;
+            bool Inside = true;
+            for (int Edge = 0; Edge < 3; ++Edge)
+            {
+                Inside = Inside && (Triangle->EdgeA[Edge]*CenterX + Triangle->EdgeB[Edge]*CenterY + Triangle->EdgeC[Edge] >= 0.0f);
+            }
+            if (Inside)
+            {
+                float Depth = Triangle->DepthA*CenterX + Triangle->DepthB*CenterY + Triangle->DepthC;
+                if (Depth < DepthRow[X])
+                {
+                    DepthRow[X] = Depth;
+                    Row[X] = Triangle->Color;
+                }
+            }
+        }
+    }
+#endif
+}
+
+static PLATFORM_WORK_QUEUE_CALLBACK(RasterizeSoftwareTiles)
+{
+    TIMED_FUNCTION();
+
+    software_renderer *Renderer = (software_renderer *)Data;
+    uint32 TileCount = (uint32)(Renderer->TilesX*Renderer->TilesY);
+    for (;;)
+    {
+        uint32 TileIndex = AtomicAddUInt32(&Renderer->NextTile, 1);
+        if (TileIndex >= TileCount)
+        {
+            break;
+        }
+
+        software_tile *Tile = Renderer->Tiles + TileIndex;
+        ClearSoftwareTile(Renderer, Tile);
+        for (uint32 i = 0; i < Tile->TriangleCount; ++i)
+        {
+            RasterizeSoftwareTriangle(Renderer, Renderer->Triangles + Tile->Triangles[i], Tile);
+        }
+    }
+}
+
+// Note(joe): Bins and draws everything pushed since BeginSoftwareFrame. The bins are
+// counted first and then filled, so they're packed in one array.
+static void RenderSoftwareFrame(software_renderer *Renderer)
+{
+    TIMED_FUNCTION();
+
+    uint64 Start = GetProfileClock();
+    uint32 TileCount = (uint32)(Renderer->TilesX*Renderer->TilesY);
+    for (uint32 TriangleIndex = 0; TriangleIndex < Renderer->TriangleCount; ++TriangleIndex)
+    {
+        software_triangle *Triangle = Renderer->Triangles + TriangleIndex;
+        for (int TileY = Triangle->MinY / SOFTWARE_TILE_SIZE; TileY <= Triangle->MaxY / SOFTWARE_TILE_SIZE; ++TileY)
+        {
+            for (int TileX = Triangle->MinX / SOFTWARE_TILE_SIZE; TileX <= Triangle->MaxX / SOFTWARE_TILE_SIZE; ++TileX)
+            {
+                software_tile *Tile = Renderer->Tiles + TileY*Renderer->TilesX + TileX;
+                if (SoftwareTriangleTouchesTile(Triangle, Tile))
+                {
+                    ++Tile->TriangleCount;
+                }
+            }
+        }
+    }
+
+    uint32 BinnedCount = 0;
+    for (uint32 TileIndex = 0; TileIndex < TileCount; ++TileIndex)
+    {
+        BinnedCount += Renderer->Tiles[TileIndex].TriangleCount;
+    }
+    uint32 *Bins = PushArray(Renderer->FrameArena, BinnedCount, uint32);
+    uint32 Offset = 0;
+    for (uint32 TileIndex = 0; TileIndex < TileCount; ++TileIndex)
+    {
+        software_tile *Tile = Renderer->Tiles + TileIndex;
+        Tile->Triangles = Bins + Offset;
+        Offset += Tile->TriangleCount;
+        Tile->TriangleCount = 0;
+    }
+
+    for (uint32 TriangleIndex = 0; TriangleIndex < Renderer->TriangleCount; ++TriangleIndex)
+    {
+        software_triangle *Triangle = Renderer->Triangles + TriangleIndex;
+        for (int TileY = Triangle->MinY / SOFTWARE_TILE_SIZE; TileY <= Triangle->MaxY / SOFTWARE_TILE_SIZE; ++TileY)
+        {
+            for (int TileX = Triangle->MinX / SOFTWARE_TILE_SIZE; TileX <= Triangle->MaxX / SOFTWARE_TILE_SIZE; ++TileX)
+            {
+                software_tile *Tile = Renderer->Tiles + TileY*Renderer->TilesX + TileX;
+                if (SoftwareTriangleTouchesTile(Triangle, Tile))
+                {
+                    Tile->Triangles[Tile->TriangleCount++] = TriangleIndex;
+                }
+            }
+        }
+    }
+    uint64 BinEnd = GetProfileClock();
+
+    Renderer->NextTile = 0;
+    uint32 JobCount = 1;
+    if (Renderer->Queue)
+    {
+        JobCount = glm::min(TileCount, (uint32)SOFTWARE_MAX_TILE_JOBS);
+        for (uint32 Job = 0; Job < JobCount; ++Job)
+        {
+            AddWorkQueueEntry(Renderer->Queue, RasterizeSoftwareTiles, Renderer);
+        }
+        CompleteAllWork(Renderer->Queue);
+    }
+    else
+    {
+        RasterizeSoftwareTiles(0, Renderer);
+    }
+    uint64 End = GetProfileClock();
+
+    Renderer->Stats.TileTriangles = BinnedCount;
+    Renderer->Stats.TileCount = TileCount;
+    Renderer->Stats.TileJobs = JobCount;
+    Renderer->Stats.BinMs += GetSoftwareMilliseconds(Start, BinEnd);
+    Renderer->Stats.RasterMs += GetSoftwareMilliseconds(BinEnd, End);
+}
@@ -0,0 +1,322 @@
+// Note(joe): On-disk cache of decoded images, so a run only pays for decoding a PNG
+// the first time it sees it. Blobs are keyed by a hash of the source file's bytes
+// plus the decode options, so renaming or touching a file doesn't miss, and editing
+// one can never hand back stale pixels.
+//
+//   <Directory>/<key>.tex    texture_cache_blob followed by the raw texels
+//   <Directory>/index        texture_cache_index followed by the entries
+//
+// The index keeps the size and last use of every blob for the LRU eviction and is
+// only ever touched on the main thread. Workers may write blobs (WriteCachedImage)
+// but hand the result back to the main thread to be added. Blobs the index doesn't
+// know about, say from a run that never saved it, get picked up on their first hit.
+
+#define TEXTURE_CACHE_BLOB_MAGIC (((uint32)'A' << 0) | ((uint32)'Q' << 8) | ((uint32)'T' << 16) | ((uint32)'C' << 24))
+#define TEXTURE_CACHE_INDEX_MAGIC (((uint32)'A' << 0) | ((uint32)'Q' << 8) | ((uint32)'T' << 16) | ((uint32)'I' << 24))
+#define TEXTURE_CACHE_VERSION 1
+
+#define MAX_TEXTURE_CACHE_ENTRIES 1024
+
+struct texture_cache_blob
+{
+    uint32 Magic;
+    uint32 Version;
+    uint64 Key;
+    uint32 Width;
+    uint32 Height;
+    uint32 ComponentCount;
+    uint32 Reserved;
+    uint64 DataSize;
+};
+
+struct texture_cache_index
+{
+    uint32 Magic;
+    uint32 Version;
+    uint32 EntryCount;
+    uint32 Reserved;
+    uint64 Clock;
+};
+
+struct texture_cache_entry
+{
+    uint64 Key;
+    uint64 Size;
+    uint64 LastUsed;
+};
+
+struct texture_cache
+{
+    bool IsValid;
+    bool IsDirty;
+    char Directory[200];
+    uint64 MaxSize;
+
+    // Note(joe): Ticks once per use and is saved with the index, so the LRU order
+    // carries across runs.
+    uint64 Clock;
+    uint64 TotalSize;
+    uint32 EntryCount;
+    texture_cache_entry Entries[MAX_TEXTURE_CACHE_ENTRIES];
+
+    uint32 Lookups;
+    uint32 Hits;
+    uint64 BytesServed;       // Texels that didn't need decoding.
+    uint64 SourceBytesSkipped; // Compressed source those texels would have come from.
+    uint32 Writes;
+    uint64 BytesWritten;
+    uint32 Evictions;
+    uint64 BytesEvicted;
+};
+
+// Note(joe): Set by the host, DEBUGLoadImage and the texture loader use it when it's there.
+static texture_cache *GlobalTextureCache;
+
+// Note(joe): Anything that changes the decoded texels has to go in the seed.
+static uint64 GetTextureCacheKey(mapped_file *Source, bool FlipVertically, int DesiredComponentCount)
+{
+    uint64 Seed = ((uint64)TEXTURE_CACHE_VERSION << 32) | ((uint64)DesiredComponentCount << 1) | (FlipVertically ? 1 : 0);
+    uint64 Result = HashBytes(Source->Memory, Source->Size, Seed);
+    return Result;
+}
+
+static void GetCachedImageFileName(char *Directory, uint64 Key, char *Result, int ResultSize)
+{
+    sprintf_s(Result, ResultSize, "%s/%016llx.tex", Directory, (unsigned long long)Key);
+}
+
+static texture_cache_entry *FindTextureCacheEntry(texture_cache *Cache, uint64 Key)
+{
+    texture_cache_entry *Result = 0;
+    for (uint32 EntryIndex = 0; EntryIndex < Cache->EntryCount; ++EntryIndex)
+    {
+        if (Cache->Entries[EntryIndex].Key == Key)
+        {
+            Result = Cache->Entries + EntryIndex;
+            break;
+        }
+    }
+    return Result;
+}
+
+static void RemoveTextureCacheEntry(texture_cache *Cache, texture_cache_entry *Entry, bool DeleteBlob)
+{
+    if (DeleteBlob)
+    {
+        char FileName[256];
+        GetCachedImageFileName(Cache->Directory, Entry->Key, FileName, sizeof(FileName));
+        RemoveFile(FileName);
+        ++Cache->Evictions;
+        Cache->BytesEvicted += Entry->Size;
+    }
+
+    Cache->TotalSize -= Entry->Size;
+    *Entry = Cache->Entries[--Cache->EntryCount];
+    Cache->IsDirty = true;
+}
+
+// Note(joe): Drops the least recently used blobs until the cache is back under its
+// budget and has no more than MaxEntryCount entries.
+static void EvictTextureCacheEntries(texture_cache *Cache, uint64 KeepKey, uint32 MaxEntryCount)
+{
+    while (Cache->EntryCount && ((Cache->TotalSize > Cache->MaxSize) || (Cache->EntryCount > MaxEntryCount)))
+    {
+        // Note(joe): The entry that was just added only goes if it can't fit on its own.
+        texture_cache_entry *Oldest = 0;
+        for (uint32 EntryIndex = 0; EntryIndex < Cache->EntryCount; ++EntryIndex)
+        {
+            texture_cache_entry *Entry = Cache->Entries + EntryIndex;
+            if ((Entry->Key != KeepKey || Cache->EntryCount == 1) &&
+                (!Oldest || Entry->LastUsed < Oldest->LastUsed))
+            {
+                Oldest = Entry;
+            }
+        }
+        RemoveTextureCacheEntry(Cache, Oldest, true);
+    }
+}
+
+// Note(joe): Main thread only. Called once a blob for Key is on disk.
+static void AddTextureCacheEntry(texture_cache *Cache, uint64 Key, uint64 Size)
+{
+    texture_cache_entry *Entry = FindTextureCacheEntry(Cache, Key);
+    if (!Entry)
+    {
+        EvictTextureCacheEntries(Cache, Key, MAX_TEXTURE_CACHE_ENTRIES - 1);
+        Entry = Cache->Entries + Cache->EntryCount++;
+        Entry->Key = Key;
+        Entry->Size = 0;
+    }
+
+    Cache->TotalSize += Size - Entry->Size;
+    Entry->Size = Size;
+    Entry->LastUsed = ++Cache->Clock;
+    Cache->IsDirty = true;
+
+    EvictTextureCacheEntries(Cache, Key, MAX_TEXTURE_CACHE_ENTRIES);
+}
+
+static void InitTextureCache(texture_cache *Cache, char *Directory, uint64 MaxSize)
+{
+    TIMED_FUNCTION();
+
+    *Cache = {};
+    sprintf_s(Cache->Directory, sizeof(Cache->Directory), "%s", Directory);
+    Cache->MaxSize = MaxSize;
+    Cache->IsValid = MakeDirectory(Directory);
+    if (!Cache->IsValid)
+    {
+        OutputDebugStringA("Texture cache directory can't be created, caching is off\n");
+        return;
+    }
+
+    char IndexFileName[256];
+    sprintf_s(IndexFileName, sizeof(IndexFileName), "%s/index", Directory);
+    mapped_file IndexFile = MapFile(IndexFileName, FileAccess_Sequential);
+    texture_cache_index *Index = (texture_cache_index *)IndexFile.Memory;
+    if (Index && IndexFile.Size >= sizeof(texture_cache_index) &&
+        Index->Magic == TEXTURE_CACHE_INDEX_MAGIC && Index->Version == TEXTURE_CACHE_VERSION &&
+        Index->EntryCount <= MAX_TEXTURE_CACHE_ENTRIES &&
+        IndexFile.Size == sizeof(texture_cache_index) + Index->EntryCount*sizeof(texture_cache_entry))
+    {
+        Cache->Clock = Index->Clock;
+        Cache->EntryCount = Index->EntryCount;
+        memcpy(Cache->Entries, Index + 1, Index->EntryCount*sizeof(texture_cache_entry));
+        for (uint32 EntryIndex = 0; EntryIndex < Cache->EntryCount; ++EntryIndex)
+        {
+            Cache->TotalSize += Cache->Entries[EntryIndex].Size;
+        }
+    }
+    UnmapFile(&IndexFile);
+
+    // Note(joe): The budget may have shrunk since the last run.
+    EvictTextureCacheEntries(Cache, 0, MAX_TEXTURE_CACHE_ENTRIES);
+}
+
+// Note(joe): Main thread only. On a hit Image points into Blob, which the caller
+// unmaps once it's done with the texels.
+static bool LookupCachedImage(texture_cache *Cache, uint64 Key, mapped_file *Source, mapped_file *Blob, loaded_image *Image)
+{
+    TIMED_FUNCTION();
+
+    bool Result = false;
+    if (!Cache->IsValid)
+    {
+        return Result;
+    }
+
+    ++Cache->Lookups;
+
+    char FileName[256];
+    GetCachedImageFileName(Cache->Directory, Key, FileName, sizeof(FileName));
+    *Blob = MapFile(FileName, FileAccess_Sequential);
+
+    texture_cache_blob *Header = (texture_cache_blob *)Blob->Memory;
+    if (Header && Blob->Size >= sizeof(texture_cache_blob) &&
+        Header->Magic == TEXTURE_CACHE_BLOB_MAGIC && Header->Version == TEXTURE_CACHE_VERSION &&
+        Header->Key == Key && Header->ComponentCount >= 1 && Header->ComponentCount <= 4 &&
+        Header->DataSize == (uint64)Header->Width*Header->Height*Header->ComponentCount &&
+        Blob->Size == sizeof(texture_cache_blob) + Header->DataSize)
+    {
+        Image->Width = (int)Header->Width;
+        Image->Height = (int)Header->Height;
+        Image->PixelComponentCount = (int)Header->ComponentCount;
+        Image->Data = (unsigned char *)(Header + 1);
+
+        ++Cache->Hits;
+        Cache->BytesServed += Header->DataSize;
+        Cache->SourceBytesSkipped += Source->Size;
+        AddTextureCacheEntry(Cache, Key, Blob->Size);
+        Result = true;
+    }
+    else
+    {
+        UnmapFile(Blob);
+        texture_cache_entry *Stale = FindTextureCacheEntry(Cache, Key);
+        if (Stale)
+        {
+            RemoveTextureCacheEntry(Cache, Stale, false);
+        }
+    }
+
+    return Result;
+}
+
+// Note(joe): Safe on any thread, it doesn't touch the index. Returns the size of the
+// blob written or 0, pass that to AddTextureCacheEntry on the main thread.
+static uint64 WriteCachedImage(texture_cache *Cache, uint64 Key, loaded_image Image)
+{
+    TIMED_FUNCTION();
+
+    uint64 Result = 0;
+
+    if (Cache->IsValid && Image.Data)
+    {
+        texture_cache_blob Header = {};
+        Header.Magic = TEXTURE_CACHE_BLOB_MAGIC;
+        Header.Version = TEXTURE_CACHE_VERSION;
+        Header.Key = Key;
+        Header.Width = (uint32)Image.Width;
+        Header.Height = (uint32)Image.Height;
+        Header.ComponentCount = (uint32)Image.PixelComponentCount;
+        Header.DataSize = (uint64)Image.Width*Image.Height*Image.PixelComponentCount;
+
+        char FileName[256];
+        GetCachedImageFileName(Cache->Directory, Key, FileName, sizeof(FileName));
+        write_file File = BeginWriteFile(FileName);
+        WriteToFile(&File, &Header, sizeof(Header));
+        WriteToFile(&File, Image.Data, Header.DataSize);
+        if (EndWriteFile(&File))
+        {
+            Result = sizeof(Header) + Header.DataSize;
+        }
+    }
+
+    return Result;
+}
+
+// Note(joe): Main thread only.
+static void RecordCachedImageWrite(texture_cache *Cache, uint64 Key, uint64 Size)
+{
+    if (Size)
+    {
+        ++Cache->Writes;
+        Cache->BytesWritten += Size;
+        AddTextureCacheEntry(Cache, Key, Size);
+    }
+}
+
+// Note(joe): Writes the index back if anything changed and reports how the run went.
+static void SaveTextureCache(texture_cache *Cache)
+{
+    TIMED_FUNCTION();
+
+    if (!Cache->IsValid)
+    {
+        return;
+    }
+
+    if (Cache->IsDirty)
+    {
+        texture_cache_index Index = {};
+        Index.Magic = TEXTURE_CACHE_INDEX_MAGIC;
+        Index.Version = TEXTURE_CACHE_VERSION;
+        Index.EntryCount = Cache->EntryCount;
+        Index.Clock = Cache->Clock;
+
+        char IndexFileName[256];
+        sprintf_s(IndexFileName, sizeof(IndexFileName), "%s/index", Cache->Directory);
+        write_file File = BeginWriteFile(IndexFileName);
+        WriteToFile(&File, &Index, sizeof(Index));
+        WriteToFile(&File, Cache->Entries, Cache->EntryCount*sizeof(texture_cache_entry));
+        Cache->IsDirty = !EndWriteFile(&File);
+    }
+
+    char Report[300];
+    sprintf_s(Report, sizeof(Report),
+              "Texture cache: %u/%u hits, %.1f MB served, %.1f MB written, %u evicted, %.1f/%.1f MB used\n",
+              Cache->Hits, Cache->Lookups, (double)Cache->BytesServed / (1024.0*1024.0),
+              (double)Cache->BytesWritten / (1024.0*1024.0), Cache->Evictions,
+              (double)Cache->TotalSize / (1024.0*1024.0), (double)Cache->MaxSize / (1024.0*1024.0));
+    OutputDebugStringA(Report);
+}
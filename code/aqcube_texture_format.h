@@ -0,0 +1,104 @@
+#pragma once
+
+// Note(joe): Cooked textures are plain DDS files holding block compressed data with
+// the whole mip chain, written by aqcube_cook and uploaded without any decoding.
+// Only what aqcube_cook writes is supported: 2D, BC1/BC3/BC4/BC5, either the
+// legacy FourCC header or the DX10 one (needed for the sRGB formats).
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+#define DDS_FOURCC(a, b, c, d) ((uint32)(a) | ((uint32)(b) << 8) | ((uint32)(c) << 16) | ((uint32)(d) << 24))
+
+#define DDSD_CAPS        0x1
+#define DDSD_HEIGHT      0x2
+#define DDSD_WIDTH       0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE  0x80000
+
+#define DDPF_FOURCC 0x4
+
+#define DDSCAPS_COMPLEX 0x8
+#define DDSCAPS_TEXTURE 0x1000
+#define DDSCAPS_MIPMAP  0x400000
+
+#define DXGI_FORMAT_BC1_UNORM      71
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72
+#define DXGI_FORMAT_BC3_UNORM      77
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78
+#define DXGI_FORMAT_BC4_UNORM      80
+#define DXGI_FORMAT_BC5_UNORM      83
+
+#define DDS_DIMENSION_TEXTURE2D 3
+
+#define MAX_TEXTURE_LEVELS 16
+
+struct dds_pixel_format
+{
+    uint32 Size;
+    uint32 Flags;
+    uint32 FourCC;
+    uint32 RGBBitCount;
+    uint32 RBitMask;
+    uint32 GBitMask;
+    uint32 BBitMask;
+    uint32 ABitMask;
+};
+
+struct dds_header
+{
+    uint32 Size;
+    uint32 Flags;
+    uint32 Height;
+    uint32 Width;
+    uint32 PitchOrLinearSize;
+    uint32 Depth;
+    uint32 MipMapCount;
+    uint32 Reserved1[11];
+    dds_pixel_format PixelFormat;
+    uint32 Caps;
+    uint32 Caps2;
+    uint32 Caps3;
+    uint32 Caps4;
+    uint32 Reserved2;
+};
+
+struct dds_header_dx10
+{
+    uint32 DXGIFormat;
+    uint32 ResourceDimension;
+    uint32 MiscFlag;
+    uint32 ArraySize;
+    uint32 MiscFlags2;
+};
+
+enum texture_block_format
+{
+    BlockFormat_BC1,
+    BlockFormat_BC3,
+    BlockFormat_BC4,
+    BlockFormat_BC5,
+};
+
+inline uint32 GetBlockSize(texture_block_format Format)
+{
+    uint32 Result = (Format == BlockFormat_BC1 || Format == BlockFormat_BC4) ? 8 : 16;
+    return Result;
+}
+
+inline uint32 GetCompressedLevelSize(texture_block_format Format, uint32 Width, uint32 Height)
+{
+    uint32 Result = ((Width + 3) / 4) * ((Height + 3) / 4) * GetBlockSize(Format);
+    return Result;
+}
+
+// Note(joe): Points into the file the texture was parsed from.
+struct compressed_texture
+{
+    texture_block_format Format;
+    bool IsSRGB;
+    uint32 Width;
+    uint32 Height;
+    uint32 LevelCount;
+    uint8 *Levels[MAX_TEXTURE_LEVELS];
+    uint32 LevelSizes[MAX_TEXTURE_LEVELS];
+};
@@ -0,0 +1,271 @@
+// Note(joe): Decodes textures on the work queue while the GL thread carries on.
+// Every load gets its texture name straight away and its own slice of the load
+// arena to decode into. Finished loads come back through a completion queue and
+// only the GL thread ever uploads them.
+//
+// If aqcube_cook has left a .dds next to the source image that gets used instead.
+// It's already block compressed with all its mips, so it goes to GL straight out
+// of the mapped file and never touches the workers. Failing that, a hit in
+// GlobalTextureCache goes straight to GL the same way, and misses leave their
+// decoded pixels behind in the cache for next time.
+
+#define MAX_TEXTURE_LOADS 64
+
+struct texture_loader;
+
+struct texture_load
+{
+    texture_loader *Loader;
+    mapped_file File;
+    memory_arena Arena;
+
+    GLuint Texture;
+    loaded_image Image;
+
+    uint64 CacheKey;
+    uint64 CacheBlobSize;
+};
+
+struct texture_loader
+{
+    platform_work_queue *Queue;
+    memory_arena *Arena;
+    temporary_memory BatchMemory;
+
+    uint32 LoadCount;
+    texture_load Loads[MAX_TEXTURE_LOADS];
+
+    // Note(joe): The completion queue. A worker claims the next slot with an atomic
+    // add and then publishes its load there. The GL thread reads the slots in order
+    // and a null slot means that load hasn't landed yet.
+    uint32 volatile NextCompletedSlot;
+    texture_load *volatile Completed[MAX_TEXTURE_LOADS];
+    uint32 NextToUpload;
+
+    uint32 TexturesLoaded;
+    uint32 TexturesFailed;
+    uint64 BytesDecoded;
+    uint32 CookedTexturesLoaded;
+    uint64 CookedBytesUploaded;
+    uint32 CachedTexturesLoaded;
+};
+
+static PLATFORM_WORK_QUEUE_CALLBACK(DecodeTextureWork)
+{
+    TIMED_SCOPE("DecodeTextureWork");
+
+    texture_load *Load = (texture_load *)Data;
+    texture_loader *Loader = Load->Loader;
+
+    Load->Image = DecodeImage(&Load->Arena, &Load->File);
+    UnmapFile(&Load->File);
+    if (GlobalTextureCache)
+    {
+        Load->CacheBlobSize = WriteCachedImage(GlobalTextureCache, Load->CacheKey, Load->Image);
+    }
+
+    uint32 Slot = AtomicAddUInt32(&Loader->NextCompletedSlot, 1);
+    CompletePreviousWritesBeforeFutureWrites;
+    Loader->Completed[Slot] = Load;
+}
+
+static void BeginTextureBatch(texture_loader *Loader)
+{
+    Loader->BatchMemory = BeginTemporaryMemory(Loader->Arena);
+    Loader->LoadCount = 0;
+    Loader->NextCompletedSlot = 0;
+    Loader->NextToUpload = 0;
+    for (uint32 SlotIndex = 0; SlotIndex < MAX_TEXTURE_LOADS; ++SlotIndex)
+    {
+        Loader->Completed[SlotIndex] = 0;
+    }
+}
+
+// Note(joe): The loader pops Arena back whenever it runs out of room, so nothing
+// else can be pushed onto it between Begin and EndTextureLoads.
+static void BeginTextureLoads(texture_loader *Loader, platform_work_queue *Queue, memory_arena *Arena)
+{
+    PrepareImageDecodeForThreads();
+
+    Loader->Queue = Queue;
+    Loader->Arena = Arena;
+    Loader->TexturesLoaded = 0;
+    Loader->TexturesFailed = 0;
+    Loader->BytesDecoded = 0;
+    Loader->CookedTexturesLoaded = 0;
+    Loader->CookedBytesUploaded = 0;
+    Loader->CachedTexturesLoaded = 0;
+    BeginTextureBatch(Loader);
+}
+
+// Note(joe): Uploads whatever has finished decoding, without waiting. Returns how
+// many it got through.
+static uint32 UploadCompletedTextures(texture_loader *Loader)
+{
+    TIMED_FUNCTION();
+
+    uint32 Result = 0;
+
+    while (Loader->NextToUpload < Loader->LoadCount)
+    {
+        texture_load *Load = Loader->Completed[Loader->NextToUpload];
+        if (!Load)
+        {
+            break;
+        }
+        CompletePreviousReadsBeforeFutureReads;
+
+        loaded_image Image = Load->Image;
+        if (GlobalTextureCache)
+        {
+            RecordCachedImageWrite(GlobalTextureCache, Load->CacheKey, Load->CacheBlobSize);
+        }
+        if (Image.Data)
+        {
+            Win32UploadTexture(Load->Texture, Image, Image.PixelComponentCount == 4 ? GL_RGBA : GL_RGB);
+            ++Loader->TexturesLoaded;
+            Loader->BytesDecoded += (uint64)Image.Width*Image.Height*Image.PixelComponentCount;
+        }
+        else
+        {
+            ++Loader->TexturesFailed;
+        }
+
+        ++Loader->NextToUpload;
+        ++Result;
+    }
+
+    return Result;
+}
+
+// Note(joe): Waits for everything queued so far and gives the batch's memory back.
+// The GL thread decodes too while it waits instead of just spinning.
+static void FinishTextureBatch(texture_loader *Loader)
+{
+    while (Loader->NextToUpload < Loader->LoadCount)
+    {
+        if (!UploadCompletedTextures(Loader))
+        {
+            DoNextWorkQueueEntry(Loader->Queue);
+        }
+    }
+
+    EndTemporaryMemory(Loader->BatchMemory);
+}
+
+static void EndTextureLoads(texture_loader *Loader)
+{
+    TIMED_FUNCTION();
+
+    FinishTextureBatch(Loader);
+}
+
+static bool LoadCookedTexture(texture_loader *Loader, GLuint Texture, char *FileName)
+{
+    TIMED_FUNCTION();
+
+    bool Result = false;
+
+    char CookedFileName[256];
+    char *Extension = strrchr(FileName, '.');
+    int BaseLength = Extension ? (int)(Extension - FileName) : (int)strlen(FileName);
+    sprintf_s(CookedFileName, 256, "%.*s.dds", BaseLength, FileName);
+
+    mapped_file File = MapFile(CookedFileName, FileAccess_Sequential);
+    compressed_texture Cooked;
+    if (File.Memory && ParseDDS(File.Memory, File.Size, &Cooked) &&
+        Win32UploadCompressedTexture(Texture, &Cooked))
+    {
+        ++Loader->TexturesLoaded;
+        ++Loader->CookedTexturesLoaded;
+        for (uint32 LevelIndex = 0; LevelIndex < Cooked.LevelCount; ++LevelIndex)
+        {
+            Loader->CookedBytesUploaded += Cooked.LevelSizes[LevelIndex];
+        }
+        Result = true;
+    }
+    UnmapFile(&File);
+
+    return Result;
+}
+
+static bool LoadCachedTexture(texture_loader *Loader, GLuint Texture, mapped_file *File, uint64 CacheKey)
+{
+    TIMED_FUNCTION();
+
+    bool Result = false;
+
+    mapped_file Blob;
+    loaded_image Image;
+    if (LookupCachedImage(GlobalTextureCache, CacheKey, File, &Blob, &Image))
+    {
+        Win32UploadTexture(Texture, Image, Image.PixelComponentCount == 4 ? GL_RGBA : GL_RGB);
+        UnmapFile(&Blob);
+        ++Loader->TexturesLoaded;
+        ++Loader->CachedTexturesLoaded;
+        Result = true;
+    }
+
+    return Result;
+}
+
+// Note(joe): The texture name is good to bind right away, the pixels show up once
+// the load gets uploaded.
+static GLuint QueueTextureLoad(texture_loader *Loader, char *FileName)
+{
+    GLuint Result;
+    glGenTextures(1, &Result);
+
+    if (LoadCookedTexture(Loader, Result, FileName))
+    {
+        return Result;
+    }
+
+    mapped_file File = MapFile(FileName, FileAccess_Sequential);
+    uint64 CacheKey = 0;
+    if (GlobalTextureCache && File.Memory)
+    {
+        CacheKey = GetTextureCacheKey(&File, false, 0);
+        if (LoadCachedTexture(Loader, Result, &File, CacheKey))
+        {
+            UnmapFile(&File);
+            return Result;
+        }
+    }
+
+    uint64 DecodeSize = GetImageDecodeSize(Loader->Arena, &File);
+    if (DecodeSize)
+    {
+        // Note(joe): Out of room, so drain what's in flight and start over.
+        if ((Loader->LoadCount == MAX_TEXTURE_LOADS) ||
+            (DecodeSize > GetArenaSizeRemaining(Loader->Arena)))
+        {
+            FinishTextureBatch(Loader);
+            BeginTextureBatch(Loader);
+        }
+    }
+
+    if (DecodeSize && (DecodeSize <= GetArenaSizeRemaining(Loader->Arena)))
+    {
+        texture_load *Load = Loader->Loads + Loader->LoadCount++;
+        Load->Loader = Loader;
+        Load->File = File;
+        SubArena(&Load->Arena, "Texture", Loader->Arena, DecodeSize);
+        Load->Texture = Result;
+        Load->Image = {};
+        Load->CacheKey = CacheKey;
+        Load->CacheBlobSize = 0;
+
+        AddWorkQueueEntry(Loader->Queue, DecodeTextureWork, Load);
+    }
+    else
+    {
+        char ErrorString[300];
+        sprintf_s(ErrorString, 300, "Can't load texture %s\n", FileName);
+        OutputDebugStringA(ErrorString);
+        ++Loader->TexturesFailed;
+        UnmapFile(&File);
+    }
+
+    return Result;
+}
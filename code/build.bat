@@ -10,6 +10,12 @@ REM Lighting Chapter
 cl /Od /Zi /nologo /wd4577 ..\code\win32_lighting.cpp /link user32.lib Gdi32.lib DSound.lib Winmm.lib Opengl32.lib
 
 REM Model Chapter
-cl /Od /Zi /EHsc /nologo /wd4577 ..\code\win32_model.cpp /link user32.lib Gdi32.lib DSound.lib Winmm.lib Opengl32.lib assimp-vc140-mt.lib /libpath:..\code\libs\assimp\Release
+cl /Od /Zi /nologo /wd4577 ..\code\win32_model.cpp /link user32.lib Gdi32.lib DSound.lib Winmm.lib Opengl32.lib
+
+REM Asset Cooker
+cl /O2 /Zi /EHsc /nologo /wd4577 ..\code\aqcube_cook.cpp /link assimp-vc140-mt.lib /libpath:..\code\libs\assimp\Release
+if exist ..\data\nanosuit\nanosuit.obj aqcube_cook mesh ..\data\nanosuit\nanosuit.obj ..\data\nanosuit\nanosuit.aqmesh
+for %%f in (..\data\nanosuit\*.png) do aqcube_cook texture %%f ..\data\nanosuit\%%~nf.dds > nul
+for %%f in (..\data\nanosuit\*_ddn.png) do aqcube_cook texture %%f ..\data\nanosuit\%%~nf.dds --normal > nul
 
 popd
@@ -0,0 +1,29 @@
+#!/bin/bash
+
+mkdir -p ../build
+pushd ../build > /dev/null
+
+# Headless benchmark host (EGL surfaceless, runs on Mesa llvmpipe)
+g++ -O2 -g -std=c++11 -Wno-write-strings ../code/linux_aqcube_headless.cpp -o aqcube_headless -lEGL -lGL -pthread
+
+# Asset cooker, the model scene loads what it writes:
+#   ./aqcube_cook mesh ../data/nanosuit/nanosuit.obj ../data/nanosuit/nanosuit.aqmesh
+# Mesh cooking needs Assimp, without it only textures can be cooked.
+if [ -f /usr/include/assimp/Importer.hpp ]; then
+    g++ -O2 -g -std=c++11 -Wno-write-strings ../code/aqcube_cook.cpp -o aqcube_cook -lassimp
+else
+    g++ -O2 -g -std=c++11 -Wno-write-strings -DCOOK_MESHES=0 ../code/aqcube_cook.cpp -o aqcube_cook
+fi
+
+# Cooked textures sit next to their source images, the loader picks them up by name.
+for Image in ../data/nanosuit/*.png; do
+    Cooked="${Image%.png}.dds"
+    if [ ! -f "$Cooked" ] || [ "$Image" -nt "$Cooked" ]; then
+        case "$Image" in
+            *_ddn.png) ./aqcube_cook texture "$Image" "$Cooked" --normal > /dev/null ;;
+            *)         ./aqcube_cook texture "$Image" "$Cooked" > /dev/null ;;
+        esac
+    fi
+done
+
+popd > /dev/null
@@ -0,0 +1,225 @@
+// Note(joe): Linux implementation of the file services declared in aqcube.h.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void *ReadFile(char *Filename)
+{
+    void *Result = 0;
+
+    int File = open(Filename, O_RDONLY);
+    if (File >= 0)
+    {
+        struct stat FileStat;
+        if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+        {
+            size_t FileSize = (size_t)FileStat.st_size;
+            Result = mmap(0, FileSize + sizeof(size_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (Result != MAP_FAILED)
+            {
+                // Note(joe): munmap needs the size back, so it rides in front of the memory.
+                *(size_t *)Result = FileSize + sizeof(size_t);
+                Result = (uint8 *)Result + sizeof(size_t);
+
+                size_t BytesRead = 0;
+                while (BytesRead < FileSize)
+                {
+                    ssize_t Count = read(File, (uint8 *)Result + BytesRead, FileSize - BytesRead);
+                    if (Count <= 0)
+                    {
+                        break;
+                    }
+                    BytesRead += (size_t)Count;
+                }
+
+                if (BytesRead != FileSize)
+                {
+                    FreeMemory(Result);
+                    Result = 0;
+                }
+            }
+            else
+            {
+                Result = 0;
+            }
+        }
+
+        close(File);
+    }
+
+    return Result;
+}
+
+void FreeMemory(void *Memory)
+{
+    if (Memory)
+    {
+        uint8 *Base = (uint8 *)Memory - sizeof(size_t);
+        munmap(Base, *(size_t *)Base);
+    }
+}
+
+mapped_file MapFile(char *Filename, file_access_hint Hint)
+{
+    mapped_file Result = {};
+
+    int File = open(Filename, O_RDONLY);
+    if (File >= 0)
+    {
+        struct stat FileStat;
+        // Note(joe): Empty files can't be mapped, they come back as a null view.
+        if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+        {
+            void *Memory = mmap(0, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+            if (Memory != MAP_FAILED)
+            {
+                Result.Memory = Memory;
+                Result.Size = (uint64)FileStat.st_size;
+            }
+        }
+
+        // Note(joe): The mapping holds its own reference to the file.
+        close(File);
+    }
+
+    if (Result.Memory && Hint != FileAccess_Normal)
+    {
+        AdviseMappedFile(&Result, 0, Result.Size, Hint);
+    }
+
+    return Result;
+}
+
+void AdviseMappedFile(mapped_file *File, uint64 Offset, uint64 Size, file_access_hint Hint)
+{
+    if (File->Memory && Offset < File->Size)
+    {
+        if (Size > File->Size - Offset)
+        {
+            Size = File->Size - Offset;
+        }
+
+        // Note(joe): madvise wants a page aligned start.
+        uint64 PageSize = (uint64)sysconf(_SC_PAGESIZE);
+        uint64 AlignedOffset = Offset & ~(PageSize - 1);
+        Size += Offset - AlignedOffset;
+
+        int Advice = MADV_NORMAL;
+        switch (Hint)
+        {
+            case FileAccess_Sequential: { Advice = MADV_SEQUENTIAL; } break;
+            case FileAccess_Random:     { Advice = MADV_RANDOM; } break;
+            case FileAccess_WillNeed:   { Advice = MADV_WILLNEED; } break;
+            case FileAccess_DontNeed:   { Advice = MADV_DONTNEED; } break;
+            default: break;
+        }
+
+        madvise((uint8 *)File->Memory + AlignedOffset, (size_t)Size, Advice);
+    }
+}
+
+void UnmapFile(mapped_file *File)
+{
+    if (File->Memory)
+    {
+        munmap(File->Memory, (size_t)File->Size);
+    }
+    File->Memory = 0;
+    File->Size = 0;
+}
+
+static uint32 volatile GlobalTempFileCounter;
+
+write_file BeginWriteFile(char *Filename)
+{
+    write_file Result = {};
+
+    // Note(joe): Two threads can be writing the same file, so each gets its own
+    // temporary and the last rename wins.
+    uint32 Counter = AtomicAddUInt32(&GlobalTempFileCounter, 1);
+    snprintf(Result.FileName, sizeof(Result.FileName), "%s", Filename);
+    snprintf(Result.TempFileName, sizeof(Result.TempFileName), "%s.%d.%u.tmp", Filename, (int)getpid(), Counter);
+
+    int File = open(Result.TempFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    Result.Handle = File;
+    Result.NoErrors = (File >= 0) && (strlen(Filename) < sizeof(Result.FileName));
+
+    return Result;
+}
+
+void WriteToFile(write_file *File, void *Memory, uint64 Size)
+{
+    uint64 BytesWritten = 0;
+    while (File->NoErrors && BytesWritten < Size)
+    {
+        ssize_t Count = write((int)File->Handle, (uint8 *)Memory + BytesWritten, (size_t)(Size - BytesWritten));
+        if (Count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (Count <= 0)
+        {
+            File->NoErrors = false;
+        }
+        else
+        {
+            BytesWritten += (uint64)Count;
+        }
+    }
+}
+
+bool EndWriteFile(write_file *File)
+{
+    bool Result = false;
+
+    if (File->Handle >= 0)
+    {
+        bool Closed = (close((int)File->Handle) == 0);
+        if (File->NoErrors && Closed && rename(File->TempFileName, File->FileName) == 0)
+        {
+            Result = true;
+        }
+        else
+        {
+            unlink(File->TempFileName);
+        }
+    }
+    File->Handle = -1;
+
+    return Result;
+}
+
+bool RemoveFile(char *Filename)
+{
+    bool Result = (unlink(Filename) == 0);
+    return Result;
+}
+
+bool MakeDirectory(char *Path)
+{
+    char Partial[256];
+    size_t Length = strlen(Path);
+    if (Length == 0 || Length >= sizeof(Partial))
+    {
+        return false;
+    }
+
+    memcpy(Partial, Path, Length + 1);
+    for (size_t Index = 1; Index <= Length; ++Index)
+    {
+        if (Partial[Index] == '/' || Partial[Index] == 0)
+        {
+            char Separator = Partial[Index];
+            Partial[Index] = 0;
+            mkdir(Partial, 0755);
+            Partial[Index] = Separator;
+        }
+    }
+
+    struct stat DirectoryStat;
+    bool Result = (stat(Path, &DirectoryStat) == 0) && S_ISDIR(DirectoryStat.st_mode);
+    return Result;
+}
@@ -0,0 +1,1740 @@
+// Note(joe): Headless benchmark host. Runs the same scene init and per-frame code as
+// win32_lighting.cpp / win32_model.cpp, but into an offscreen framebuffer on an EGL
+// surfaceless context (Mesa llvmpipe works), so it can run on machines without a
+// GPU or a display. Results are written to stdout as JSON.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// Note(joe): Mesa's gl.h declares everything up to 1.3, here those are pointers
+// loaded by InitOpenGLExtensions just like on Windows.
+#define GL_GLEXT_LEGACY
+#define glActiveTexture glActiveTexture_Unused
+#define glCompressedTexImage2D glCompressedTexImage2D_Unused
+#include <GL/gl.h>
+#undef glActiveTexture
+#undef glCompressedTexImage2D
+
+#define GET_PROC_ADDRESS(Name) eglGetProcAddress(Name)
+#include "win32_aqcube_opengl.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <new>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+
+#define PI32 3.14159265359f
+
+#define DEG_TO_RAD(VALUE) ((VALUE)*(PI32/180.0f))
+
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+
+// Note(joe): The shared code reports through these Win32/CRT calls.
+static void OutputDebugStringA(const char *String)
+{
+    if (String)
+    {
+        fputs(String, stderr);
+    }
+}
+#define sprintf_s snprintf
+static int memcpy_s(void *Dest, size_t DestSize, const void *Source, size_t Count)
+{
+    int Result = 0;
+    if (Count <= DestSize)
+    {
+        memcpy(Dest, Source, Count);
+    }
+    else
+    {
+        Result = -1;
+    }
+    return Result;
+}
+
+#include "aqcube.cpp"
+#include "linux_aqcube_file.cpp"
+#include "aqcube_profile.cpp"
+#include "linux_aqcube_thread.cpp"
+#include "win32_aqcube_opengl.cpp"
+
+#include "aqcube_texture_cache.cpp"
+#include "aqcube_image.cpp"
+#include "aqcube_texture_loader.cpp"
+#include "aqcube_mips.cpp"
+#include "aqcube_camera.h"
+#include "aqcube_culling.cpp"
+#include "aqcube_aabb_tree.cpp"
+#include "aqcube_occlusion.cpp"
+#include "aqcube_lighting.cpp"
+#include "aqcube_mesh_format.h"
+#include "aqcube_render_queue.cpp"
+#include "aqcube_model.cpp"
+
+inline static uint64 LinuxGetClock()
+{
+    timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    uint64 Result = (uint64)Time.tv_sec*1000000000ull + (uint64)Time.tv_nsec;
+    return Result;
+}
+
+inline static float LinuxGetElapsedSeconds(uint64 Start, uint64 End)
+{
+    float Result = (float)(End - Start) / 1000000000.0f;
+    return Result;
+}
+
+uint64 GetProfileClock()
+{
+    return LinuxGetClock();
+}
+
+uint64 GetProfileClockFrequency()
+{
+    return 1000000000ull;
+}
+
+enum headless_scene
+{
+    HeadlessScene_Lighting,
+    HeadlessScene_Model,
+    HeadlessScene_Textures,
+    HeadlessScene_Mips,
+    HeadlessScene_Culling,
+    HeadlessScene_Tree,
+    HeadlessScene_Software,
+    HeadlessScene_Fill,
+    HeadlessScene_Audio,
+};
+
+struct headless_options
+{
+    headless_scene Scene;
+    int FrameCount;
+    int WarmupFrameCount;
+    int Width;
+    int Height;
+    char *DataPath;
+    char *DumpPath;
+    int ThreadCount;
+    char *CachePath;
+    int CacheMegabytes;
+    int ExtraCubeCount;
+    int ExtraModelCount;
+    bool NoIndirect;
+    bool NoOcclusion;
+    bool CheckOcclusion;
+    float LodThreshold;
+    char *ProfilePath;
+};
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: aqcube_headless [--scene lighting|model|textures|mips|culling|tree|software|fill|audio]\n"
+            "                       [--frames N] [--warmup N]\n"
+            "                       [--width W] [--height H] [--data DIR] [--dump FILE.ppm]\n"
+            "                       [--threads N] [--cache DIR] [--cache-mb N] [--extra-cubes N]\n"
+            "                       [--extra-models N] [--indirect on|off] [--lod-threshold PIXELS]\n"
+            "                       [--occlusion on|off|check] [--profile FILE.json]\n"
+            "\n"
+            "  textures  decodes and uploads every nanosuit texture through the work queue,\n"
+            "            startup_ms is the number to look at.\n"
+            "  mips      uploads every nanosuit texture with glGenerateMipmap and again with\n"
+            "            a mip chain built on the CPU, and times both.\n"
+            "  culling   times the frustum cull over 10k, 100k and 1M random boxes, scalar\n"
+            "            and SIMD.\n"
+            "  tree      builds the AABB tree over 10k, 100k and 1M random boxes and times\n"
+            "            sphere, ray and frustum queries against it, and objects moving.\n"
+            "  software  draws the game layer's cube field with the software renderer into a\n"
+            "            CPU back buffer, the tiles go through the work queue. --dump writes\n"
+            "            that buffer.\n"
+            "  fill      times the gradient back buffer fill at 800x600, 1080p and 4K, scalar,\n"
+            "            SIMD, SIMD with streaming stores and banded over the work queue, in\n"
+            "            GB/s next to memset on the same buffer.\n"
+            "  audio     mixes a second of 48kHz audio through the mixer with 1, 16, 128 and\n"
+            "            512 voices, half oscillators and half looping sounds, all panning.\n"
+            "  --threads worker threads for the work queue, defaults to one less than the\n"
+            "            number of cores.\n"
+            "  --cache   keep decoded textures and linked programs under DIR (relative to\n"
+            "            the data directory) and reuse them on the next run. Textures are\n"
+            "            limited to --cache-mb (default 256).\n"
+            "  --extra-cubes adds N cubes behind the lighting scene's ten, they all go\n"
+            "            through the same instanced draw.\n"
+            "  --extra-models adds N copies of the model behind the model scene's one.\n"
+            "  --indirect off draws the model scene one glDrawElementsInstancedBaseVertex at\n"
+            "            a time even when glMultiDrawElementsIndirect is there.\n"
+            "  --lod-threshold is the most error a model LOD can show on screen, in pixels\n"
+            "            (default 1). 0 always draws the full detail meshes.\n"
+            "  --occlusion off leaves the model scene's CPU occlusion culling out. check\n"
+            "            also reads back the depth buffer every frame and counts the meshes\n"
+            "            it culled that could have shown, and the ones it drew that were hidden.\n"
+            "  --profile writes a Chrome trace of startup and every frame to FILE.json and\n"
+            "            prints the startup and last frame scope trees to stderr.\n");
+}
+
+static bool ParseCommandLine(int ArgCount, char **Args, headless_options *Options)
+{
+    bool Result = true;
+
+    for (int ArgIndex = 1; Result && ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char *Arg = Args[ArgIndex];
+        char *Value = (ArgIndex + 1 < ArgCount) ? Args[ArgIndex + 1] : 0;
+        if (!Value)
+        {
+            Result = false;
+        }
+        else if (strcmp(Arg, "--scene") == 0)
+        {
+            if (strcmp(Value, "lighting") == 0)
+            {
+                Options->Scene = HeadlessScene_Lighting;
+            }
+            else if (strcmp(Value, "model") == 0)
+            {
+                Options->Scene = HeadlessScene_Model;
+            }
+            else if (strcmp(Value, "textures") == 0)
+            {
+                Options->Scene = HeadlessScene_Textures;
+            }
+            else if (strcmp(Value, "mips") == 0)
+            {
+                Options->Scene = HeadlessScene_Mips;
+            }
+            else if (strcmp(Value, "culling") == 0)
+            {
+                Options->Scene = HeadlessScene_Culling;
+            }
+            else if (strcmp(Value, "tree") == 0)
+            {
+                Options->Scene = HeadlessScene_Tree;
+            }
+            else if (strcmp(Value, "software") == 0)
+            {
+                Options->Scene = HeadlessScene_Software;
+            }
+            else if (strcmp(Value, "fill") == 0)
+            {
+                Options->Scene = HeadlessScene_Fill;
+            }
+            else if (strcmp(Value, "audio") == 0)
+            {
+                Options->Scene = HeadlessScene_Audio;
+            }
+            else
+            {
+                Result = false;
+            }
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--frames") == 0)
+        {
+            Options->FrameCount = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--warmup") == 0)
+        {
+            Options->WarmupFrameCount = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--width") == 0)
+        {
+            Options->Width = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--height") == 0)
+        {
+            Options->Height = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--data") == 0)
+        {
+            Options->DataPath = Value;
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--dump") == 0)
+        {
+            Options->DumpPath = Value;
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--profile") == 0)
+        {
+            Options->ProfilePath = Value;
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--extra-cubes") == 0)
+        {
+            Options->ExtraCubeCount = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--indirect") == 0)
+        {
+            Options->NoIndirect = (strcmp(Value, "off") == 0);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--occlusion") == 0)
+        {
+            Options->NoOcclusion = (strcmp(Value, "off") == 0);
+            Options->CheckOcclusion = (strcmp(Value, "check") == 0);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--lod-threshold") == 0)
+        {
+            Options->LodThreshold = (float)atof(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--extra-models") == 0)
+        {
+            Options->ExtraModelCount = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--threads") == 0)
+        {
+            Options->ThreadCount = atoi(Value);
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--cache") == 0)
+        {
+            Options->CachePath = Value;
+            ++ArgIndex;
+        }
+        else if (strcmp(Arg, "--cache-mb") == 0)
+        {
+            Options->CacheMegabytes = atoi(Value);
+            ++ArgIndex;
+        }
+        else
+        {
+            Result = false;
+        }
+    }
+
+    if (Options->FrameCount <= 0 || Options->WarmupFrameCount < 0 ||
+        Options->Width <= 0 || Options->Height <= 0 || Options->ThreadCount < 0 ||
+        Options->CacheMegabytes <= 0 || Options->LodThreshold < 0.0f)
+    {
+        Result = false;
+    }
+
+    return Result;
+}
+
+static EGLContext LinuxInitializeOpenGL(EGLDisplay *DisplayResult)
+{
+    EGLContext Result = EGL_NO_CONTEXT;
+
+    EGLDisplay Display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (eglGetPlatformDisplayEXT)
+    {
+        Display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+    }
+    if (Display == EGL_NO_DISPLAY)
+    {
+        Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint Major, Minor;
+    if (Display != EGL_NO_DISPLAY && eglInitialize(Display, &Major, &Minor) && eglBindAPI(EGL_OPENGL_API))
+    {
+        // Note(joe): Without EGL_KHR_no_config_context a config is still needed
+        // even though nothing is ever drawn to an EGL surface.
+        EGLConfig Config = EGL_NO_CONFIG_KHR;
+        const char *Extensions = eglQueryString(Display, EGL_EXTENSIONS);
+        if (!Extensions || !strstr(Extensions, "EGL_KHR_no_config_context"))
+        {
+            EGLint ConfigAttribs[] = {
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_NONE
+            };
+            EGLint ConfigCount = 0;
+            eglChooseConfig(Display, ConfigAttribs, &Config, 1, &ConfigCount);
+        }
+
+        EGLint ContextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        Result = eglCreateContext(Display, Config, EGL_NO_CONTEXT, ContextAttribs);
+        if (Result != EGL_NO_CONTEXT)
+        {
+            if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Result))
+            {
+                eglDestroyContext(Display, Result);
+                Result = EGL_NO_CONTEXT;
+            }
+        }
+    }
+
+    *DisplayResult = Display;
+    return Result;
+}
+
+static GLuint LinuxCreateOffscreenFramebuffer(int Width, int Height)
+{
+    GLuint Framebuffer;
+    glGenFramebuffers(1, &Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+
+    GLuint Renderbuffers[2];
+    glGenRenderbuffers(2, Renderbuffers);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, Renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, Renderbuffers[0]);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, Renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, Renderbuffers[1]);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        Framebuffer = 0;
+    }
+
+    Win32Viewport(0, 0, Width, Height);
+
+    return Framebuffer;
+}
+
+// Note(joe): Writes the framebuffer as a binary PPM so a run can be eyeballed. Relative
+// paths end up in the data directory since that is the working directory by then.
+static bool LinuxDumpFramebuffer(char *Filename, int Width, int Height)
+{
+    bool Result = false;
+
+    uint8 *Pixels = (uint8 *)malloc(Width*Height*3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, Pixels);
+
+    FILE *File = fopen(Filename, "wb");
+    if (File)
+    {
+        fprintf(File, "P6\n%d %d\n255\n", Width, Height);
+        // Note(joe): GL rows go bottom up.
+        for (int Row = Height - 1; Row >= 0; --Row)
+        {
+            fwrite(Pixels + Row*Width*3, 1, Width*3, File);
+        }
+        Result = (fclose(File) == 0);
+    }
+    free(Pixels);
+
+    return Result;
+}
+
+// Note(joe): Same as LinuxDumpFramebuffer for a game_back_buffer, whose rows already
+// go top down and whose pixels are blue in the low byte.
+static bool LinuxDumpBackBuffer(char *Filename, game_back_buffer *BackBuffer)
+{
+    bool Result = false;
+
+    uint8 *Pixels = (uint8 *)malloc(BackBuffer->Width*3);
+    FILE *File = fopen(Filename, "wb");
+    if (File)
+    {
+        fprintf(File, "P6\n%d %d\n255\n", BackBuffer->Width, BackBuffer->Height);
+        for (int Row = 0; Row < BackBuffer->Height; ++Row)
+        {
+            uint32 *Source = (uint32 *)((uint8 *)BackBuffer->Memory + Row*BackBuffer->Pitch);
+            for (int X = 0; X < BackBuffer->Width; ++X)
+            {
+                Pixels[3*X + 0] = (uint8)(Source[X] >> 16);
+                Pixels[3*X + 1] = (uint8)(Source[X] >> 8);
+                Pixels[3*X + 2] = (uint8)(Source[X] >> 0);
+            }
+            fwrite(Pixels, 1, BackBuffer->Width*3, File);
+        }
+        Result = (fclose(File) == 0);
+    }
+    free(Pixels);
+
+    return Result;
+}
+
+// Note(joe): Stands in for the model's texture loads without needing Assimp, it
+// pushes every PNG in the nanosuit directory through the same loader.
+static void InitTextureScene(texture_loader *Loader, platform_work_queue *Queue, memory_arena *LoadArena)
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    BeginTextureLoads(Loader, Queue, LoadArena);
+
+    DIR *Directory = opendir("nanosuit");
+    if (Directory)
+    {
+        while (dirent *Entry = readdir(Directory))
+        {
+            size_t Length = strlen(Entry->d_name);
+            if (Length > 4 && strcmp(Entry->d_name + Length - 4, ".png") == 0)
+            {
+                char FileName[256];
+                snprintf(FileName, sizeof(FileName), "nanosuit/%s", Entry->d_name);
+                QueueTextureLoad(Loader, FileName);
+            }
+        }
+        closedir(Directory);
+    }
+
+    EndTextureLoads(Loader);
+}
+
+struct mip_benchmark
+{
+    uint32 TextureCount;
+    uint64 BytesUploaded;
+    float DriverSeconds;
+    float PrebuiltSeconds;
+    float BuildSeconds[3];
+};
+
+// Note(joe): What baking the mips at cook time buys. The driver path is the usual
+// glTexImage2D + glGenerateMipmap, the prebuilt path uploads a chain built with
+// BuildMipChain. Building the chain is timed on its own for every filter, since
+// that's work the cooker does and the runtime never sees.
+static void RunMipBenchmark(mip_benchmark *Benchmark, memory_arena *LoadArena)
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    DIR *Directory = opendir("nanosuit");
+    if (!Directory)
+    {
+        return;
+    }
+
+    while (dirent *Entry = readdir(Directory))
+    {
+        size_t Length = strlen(Entry->d_name);
+        if (Length <= 4 || strcmp(Entry->d_name + Length - 4, ".png") != 0)
+        {
+            continue;
+        }
+
+        char FileName[256];
+        snprintf(FileName, sizeof(FileName), "nanosuit/%s", Entry->d_name);
+        bool IsNormalMap = (strstr(Entry->d_name, "_ddn") != 0);
+
+        temporary_memory ImageMemory = BeginTemporaryMemory(LoadArena);
+        loaded_image Image = DEBUGLoadImage(LoadArena, FileName);
+        if (Image.Data)
+        {
+            GLint SourcePixelFormat = (Image.PixelComponentCount == 4) ? GL_RGBA : GL_RGB;
+            uint32 Width = (uint32)Image.Width;
+            uint32 Height = (uint32)Image.Height;
+            uint32 ComponentCount = (uint32)Image.PixelComponentCount;
+
+            GLuint Textures[2];
+            glGenTextures(2, Textures);
+            glFinish();
+
+            uint64 DriverStart = LinuxGetClock();
+            Win32UploadTexture(Textures[0], Image, SourcePixelFormat);
+            glFinish();
+            Benchmark->DriverSeconds += LinuxGetElapsedSeconds(DriverStart, LinuxGetClock());
+
+            loaded_image Chain = Image;
+            Chain.Data = PushArray(LoadArena, GetMipChainSize(Width, Height, ComponentCount), uint8);
+            void *Scratch = PushSizeAligned(LoadArena, GetMipScratchSize(Width, Height), 16);
+            uint32 LevelCount = 0;
+            for (int Filter = 0; Filter < ArrayCount(Benchmark->BuildSeconds); ++Filter)
+            {
+                uint64 BuildStart = LinuxGetClock();
+                LevelCount = BuildMipChain(Image.Data, Width, Height, ComponentCount, (mip_filter)Filter,
+                                           IsNormalMap ? MipContent_Normal : MipContent_SRGB, Chain.Data, Scratch);
+                Benchmark->BuildSeconds[Filter] += LinuxGetElapsedSeconds(BuildStart, LinuxGetClock());
+            }
+
+            uint64 PrebuiltStart = LinuxGetClock();
+            Win32UploadTextureMips(Textures[1], Chain, LevelCount, SourcePixelFormat);
+            glFinish();
+            Benchmark->PrebuiltSeconds += LinuxGetElapsedSeconds(PrebuiltStart, LinuxGetClock());
+
+            Win32DeleteTextures(2, Textures);
+            ++Benchmark->TextureCount;
+            Benchmark->BytesUploaded += GetMipChainSize(Width, Height, ComponentCount);
+        }
+        EndTemporaryMemory(ImageMemory);
+    }
+    closedir(Directory);
+}
+
+// Note(joe): xorshift32, [0, 1).
+inline float RandomUnilateral(uint32 *State)
+{
+    uint32 Random = *State;
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    *State = Random;
+    return (float)(Random >> 8) / (float)(1 << 24);
+}
+
+#define CULLING_BENCHMARK_SIZES 3
+
+struct culling_benchmark
+{
+    uint32 ObjectCounts[CULLING_BENCHMARK_SIZES];
+    uint32 VisibleCounts[CULLING_BENCHMARK_SIZES];
+    float ScalarSeconds[CULLING_BENCHMARK_SIZES]; // Best of the runs.
+    float SimdSeconds[CULLING_BENCHMARK_SIZES];
+    bool Matches[CULLING_BENCHMARK_SIZES]; // Both found the same objects.
+};
+
+// Note(joe): Boxes of random size and rotation scattered through a cube 200 units
+// across, looked at from the middle. About one in twenty ends up in view.
+static void RunCullingBenchmark(culling_benchmark *Benchmark, memory_arena *LoadArena)
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Projection = glm::perspective(DEG_TO_RAD(45), 16.0f / 9.0f, 0.01f, 100.0f);
+    glm::mat4 ViewProjection = Projection*View;
+    frustum Frustum = ExtractFrustum(ViewProjection);
+
+    uint32 ObjectCounts[CULLING_BENCHMARK_SIZES] = { 10000, 100000, 1000000 };
+    for (int SizeIndex = 0; SizeIndex < CULLING_BENCHMARK_SIZES; ++SizeIndex)
+    {
+        uint32 ObjectCount = ObjectCounts[SizeIndex];
+        temporary_memory BenchmarkMemory = BeginTemporaryMemory(LoadArena);
+
+        cull_bounds Bounds;
+        BeginCullBounds(&Bounds, LoadArena, ObjectCount);
+        uint32 Random = 0x9E3779B9;
+        for (uint32 ObjectIndex = 0; ObjectIndex < ObjectCount; ++ObjectIndex)
+        {
+            float Values[7];
+            for (int ValueIndex = 0; ValueIndex < ArrayCount(Values); ++ValueIndex)
+            {
+                Values[ValueIndex] = RandomUnilateral(&Random);
+            }
+            glm::mat4 Transform = glm::translate(glm::mat4(), 200.0f*glm::vec3(Values[0], Values[1], Values[2]) - 100.0f);
+            Transform = glm::rotate(Transform, 2.0f*PI32*Values[3], glm::normalize(glm::vec3(Values[4], Values[5], 1.0f)));
+            glm::vec3 Extent(0.5f + 1.5f*Values[6]);
+            PushCullBounds(&Bounds, Transform, -Extent, Extent, glm::length(Extent));
+        }
+
+        uint32 *ScalarVisible = PushArray(LoadArena, GetCullPaddedCount(ObjectCount), uint32);
+        uint32 *SimdVisible = PushArray(LoadArena, GetCullPaddedCount(ObjectCount), uint32);
+        uint32 ScalarCount = 0;
+        uint32 SimdCount = 0;
+        float BestScalar = 1e30f;
+        float BestSimd = 1e30f;
+        uint32 RunCount = 2 + 2000000 / ObjectCount;
+        for (uint32 Run = 0; Run < RunCount; ++Run)
+        {
+            uint64 ScalarStart = LinuxGetClock();
+            ScalarCount = CullBoundsScalar(&Frustum, &Bounds, ScalarVisible);
+            uint64 SimdStart = LinuxGetClock();
+            SimdCount = CullBounds(&Frustum, &Bounds, SimdVisible);
+            uint64 SimdEnd = LinuxGetClock();
+            BestScalar = glm::min(BestScalar, LinuxGetElapsedSeconds(ScalarStart, SimdStart));
+            BestSimd = glm::min(BestSimd, LinuxGetElapsedSeconds(SimdStart, SimdEnd));
+        }
+
+        Benchmark->ObjectCounts[SizeIndex] = ObjectCount;
+        Benchmark->VisibleCounts[SizeIndex] = SimdCount;
+        Benchmark->ScalarSeconds[SizeIndex] = BestScalar;
+        Benchmark->SimdSeconds[SizeIndex] = BestSimd;
+        Benchmark->Matches[SizeIndex] = (ScalarCount == SimdCount) &&
+                                        (memcmp(ScalarVisible, SimdVisible, SimdCount*sizeof(uint32)) == 0);
+        EndTemporaryMemory(BenchmarkMemory);
+    }
+}
+
+#define FILL_BENCHMARK_SIZES 3
+
+// Note(joe): Best of the runs for each.
+struct fill_benchmark
+{
+    int Widths[FILL_BENCHMARK_SIZES];
+    int Heights[FILL_BENCHMARK_SIZES];
+    float ScalarSeconds[FILL_BENCHMARK_SIZES];
+    float SimdSeconds[FILL_BENCHMARK_SIZES];
+    float StreamSeconds[FILL_BENCHMARK_SIZES];
+    float ThreadedSeconds[FILL_BENCHMARK_SIZES];
+    float MemsetSeconds[FILL_BENCHMARK_SIZES];
+    bool Matches[FILL_BENCHMARK_SIZES]; // Every fast path wrote what the scalar one did.
+};
+
+static void RunFillBenchmark(fill_benchmark *Benchmark, memory_arena *LoadArena, platform_work_queue *Queue)
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    int Widths[FILL_BENCHMARK_SIZES] = { 800, 1920, 3840 };
+    int Heights[FILL_BENCHMARK_SIZES] = { 600, 1080, 2160 };
+    int OffsetX = 37;
+    int OffsetY = 11;
+    for (int SizeIndex = 0; SizeIndex < FILL_BENCHMARK_SIZES; ++SizeIndex)
+    {
+        temporary_memory BenchmarkMemory = BeginTemporaryMemory(LoadArena);
+
+        game_back_buffer Reference = {};
+        Reference.Width = Widths[SizeIndex];
+        Reference.Height = Heights[SizeIndex];
+        Reference.BytesPerPixel = 4;
+        Reference.Pitch = Reference.Width*Reference.BytesPerPixel;
+        uint64 Size = (uint64)Reference.Pitch*Reference.Height;
+        Reference.Memory = PushSizeAligned(LoadArena, Size, 64);
+        game_back_buffer Target = Reference;
+        Target.Memory = PushSizeAligned(LoadArena, Size, 64);
+
+        bool Matches = true;
+        float BestScalar = 1e30f;
+        float BestSimd = 1e30f;
+        float BestStream = 1e30f;
+        float BestThreaded = 1e30f;
+        float BestMemset = 1e30f;
+        uint32 RunCount = 3 + (uint32)(Megabytes(512) / Size);
+        for (uint32 Run = 0; Run < RunCount; ++Run)
+        {
+            uint64 Start = LinuxGetClock();
+            for (int Y = 0; Y < Reference.Height; ++Y)
+            {
+                uint32 *Row = (uint32 *)((uint8 *)Reference.Memory + Y*Reference.Pitch);
+                FillGradientRowScalar(Row, Reference.Width, Y, OffsetX, OffsetY);
+            }
+            BestScalar = glm::min(BestScalar, LinuxGetElapsedSeconds(Start, LinuxGetClock()));
+
+            Start = LinuxGetClock();
+            FillBackBufferGradient(&Target, OffsetX, OffsetY, 0, false);
+            BestSimd = glm::min(BestSimd, LinuxGetElapsedSeconds(Start, LinuxGetClock()));
+            Matches = Matches && (memcmp(Reference.Memory, Target.Memory, Size) == 0);
+
+            Start = LinuxGetClock();
+            FillBackBufferGradient(&Target, OffsetX, OffsetY, 0, true);
+            BestStream = glm::min(BestStream, LinuxGetElapsedSeconds(Start, LinuxGetClock()));
+            Matches = Matches && (memcmp(Reference.Memory, Target.Memory, Size) == 0);
+
+            Start = LinuxGetClock();
+            FillBackBufferGradient(&Target, OffsetX, OffsetY, Queue, true);
+            BestThreaded = glm::min(BestThreaded, LinuxGetElapsedSeconds(Start, LinuxGetClock()));
+            Matches = Matches && (memcmp(Reference.Memory, Target.Memory, Size) == 0);
+
+            Start = LinuxGetClock();
+            memset(Target.Memory, (int)Run, Size);
+            BestMemset = glm::min(BestMemset, LinuxGetElapsedSeconds(Start, LinuxGetClock()));
+        }
+
+        Benchmark->Widths[SizeIndex] = Reference.Width;
+        Benchmark->Heights[SizeIndex] = Reference.Height;
+        Benchmark->ScalarSeconds[SizeIndex] = BestScalar;
+        Benchmark->SimdSeconds[SizeIndex] = BestSimd;
+        Benchmark->StreamSeconds[SizeIndex] = BestStream;
+        Benchmark->ThreadedSeconds[SizeIndex] = BestThreaded;
+        Benchmark->MemsetSeconds[SizeIndex] = BestMemset;
+        Benchmark->Matches[SizeIndex] = Matches;
+        EndTemporaryMemory(BenchmarkMemory);
+    }
+}
+
+#define AUDIO_BENCHMARK_SIZES 4
+#define AUDIO_BENCHMARK_RATE 48000
+#define AUDIO_BENCHMARK_CHUNK 800 // A 60Hz frame's worth.
+
+struct audio_benchmark
+{
+    uint32 VoiceCounts[AUDIO_BENCHMARK_SIZES];
+    float Seconds[AUDIO_BENCHMARK_SIZES]; // Best of the runs, for a second of audio.
+    float SinfToneSeconds; // The sinf per sample tone the mixer replaced, for the same second.
+    float SineMaxError;
+    bool StopMatches; // Stopped voices went silent, and a stale id didn't stop its slot's new voice.
+};
+
+static void RunAudioBenchmark(audio_benchmark *Benchmark, memory_arena *LoadArena)
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    // Note(joe): A plucked string-ish sound, a decaying tone with a bit of noise.
+    loaded_sound Sound;
+    PushLoadedSound(&Sound, LoadArena, AUDIO_BENCHMARK_RATE*3/8);
+    uint32 Random = 0x9E3779B9;
+    for (uint32 SampleIndex = 0; SampleIndex < Sound.SampleCount; ++SampleIndex)
+    {
+        float t = (float)SampleIndex / AUDIO_BENCHMARK_RATE;
+        float Noise = 2.0f*RandomUnilateral(&Random) - 1.0f;
+        Sound.Samples[SampleIndex] = expf(-6.0f*t)*(0.8f*sinf(2.0f*PI32*220.0f*t) + 0.2f*Noise);
+    }
+
+    game_sound_buffer SoundBuffer = {};
+    SoundBuffer.Samples = PushArray(LoadArena, 2*AUDIO_BENCHMARK_CHUNK, int16);
+    SoundBuffer.SampleCount = AUDIO_BENCHMARK_CHUNK;
+    SoundBuffer.SamplesPerSec = AUDIO_BENCHMARK_RATE;
+    uint32 ChunkCount = AUDIO_BENCHMARK_RATE / AUDIO_BENCHMARK_CHUNK;
+
+    audio_mixer *Mixer = PushStruct(LoadArena, audio_mixer);
+    uint32 VoiceCounts[AUDIO_BENCHMARK_SIZES] = { 1, 16, 128, 512 };
+    for (int SizeIndex = 0; SizeIndex < AUDIO_BENCHMARK_SIZES; ++SizeIndex)
+    {
+        uint32 VoiceCount = VoiceCounts[SizeIndex];
+        InitAudioMixer(Mixer, 1.0f / sqrtf((float)VoiceCount));
+        uint32 *Voices = PushArray(LoadArena, VoiceCount, uint32);
+        for (uint32 VoiceIndex = 0; VoiceIndex < VoiceCount; ++VoiceIndex)
+        {
+            float Pan = 2.0f*RandomUnilateral(&Random) - 1.0f;
+            if (VoiceIndex & 1)
+            {
+                Voices[VoiceIndex] = PlaySound(Mixer, &Sound, 0.5f, Pan, true);
+            }
+            else
+            {
+                Voices[VoiceIndex] = PlaySine(Mixer, 110.0f + 7.0f*VoiceIndex, 0.5f, Pan);
+            }
+        }
+
+        float Best = 1e30f;
+        for (int Run = 0; Run < 3; ++Run)
+        {
+            uint64 Start = LinuxGetClock();
+            for (uint32 Chunk = 0; Chunk < ChunkCount; ++Chunk)
+            {
+                // Note(joe): Every voice moves every chunk, so they all ramp.
+                for (uint32 VoiceIndex = 0; VoiceIndex < VoiceCount; ++VoiceIndex)
+                {
+                    float Pan = sinf(0.1f*(float)(Chunk + VoiceIndex));
+                    SetVoiceVolume(Mixer, Voices[VoiceIndex], 0.5f, Pan);
+                }
+                MixSound(Mixer, &SoundBuffer, LoadArena);
+            }
+            Best = glm::min(Best, LinuxGetElapsedSeconds(Start, LinuxGetClock()));
+        }
+        Benchmark->VoiceCounts[SizeIndex] = VoiceCount;
+        Benchmark->Seconds[SizeIndex] = Best;
+
+        // Note(joe): On the last mixer, stop everything and mix a chunk, which has to
+        // come out silent. Then a new voice takes the first slot back, and the id the
+        // slot had before must not reach it.
+        if (SizeIndex == AUDIO_BENCHMARK_SIZES - 1)
+        {
+            for (uint32 VoiceIndex = 0; VoiceIndex < VoiceCount; ++VoiceIndex)
+            {
+                StopVoice(Mixer, Voices[VoiceIndex]);
+            }
+            MixSound(Mixer, &SoundBuffer, LoadArena);
+            bool Silent = (Mixer->ActiveVoiceCount == 0) && (Mixer->VoiceHighWater == 0);
+            for (uint32 SampleIndex = 0; SampleIndex < 2*AUDIO_BENCHMARK_CHUNK; ++SampleIndex)
+            {
+                Silent = Silent && (SoundBuffer.Samples[SampleIndex] == 0);
+            }
+
+            uint32 Reused = PlaySine(Mixer, 440.0f, 0.5f, 0.0f);
+            StopVoice(Mixer, Voices[0]);
+            SetVoiceVolume(Mixer, Voices[0], 0.0f, 0.0f);
+            playing_voice *Voice = GetVoice(Mixer, Reused);
+            bool StaleIgnored = (Reused != Voices[0]) && Voice && (Voice->Volume == 0.5f) && (Mixer->ActiveVoiceCount == 1);
+            StopVoice(Mixer, Reused);
+            StopVoice(Mixer, Reused);
+            Benchmark->StopMatches = Silent && StaleIgnored && (Mixer->ActiveVoiceCount == 0);
+        }
+    }
+
+    uint64 Start = LinuxGetClock();
+    float tSine = 0.0f;
+    for (uint32 Chunk = 0; Chunk < ChunkCount; ++Chunk)
+    {
+        int16 *Sample = SoundBuffer.Samples;
+        for (uint32 SampleIndex = 0; SampleIndex < AUDIO_BENCHMARK_CHUNK; ++SampleIndex)
+        {
+            int16 ToneValue = (int16)(8000.0f*sinf(tSine));
+            *Sample++ = ToneValue;
+            *Sample++ = ToneValue;
+            tSine += 2.0f*PI32*256.0f / AUDIO_BENCHMARK_RATE;
+        }
+    }
+    Benchmark->SinfToneSeconds = LinuxGetElapsedSeconds(Start, LinuxGetClock());
+
+    float MaxError = 0.0f;
+    for (int Step = 0; Step <= 100000; ++Step)
+    {
+        float x = -PI32 + 2.0f*PI32*(float)Step / 100000.0f;
+        MaxError = glm::max(MaxError, fabsf(GetSineApproximation(x) - sinf(x)));
+    }
+    Benchmark->SineMaxError = MaxError;
+}
+
+#define TREE_BENCHMARK_SIZES 3
+#define TREE_BENCHMARK_QUERIES 1000
+
+// Note(joe): Per query, or per object moved, averaged over the batch.
+struct tree_query_stats
+{
+    float Microseconds;
+    float NodesVisited;
+    float Results;
+};
+
+struct tree_benchmark
+{
+    uint32 ObjectCounts[TREE_BENCHMARK_SIZES];
+    float InsertSeconds[TREE_BENCHMARK_SIZES];
+    float RebuildSeconds[TREE_BENCHMARK_SIZES];
+    int32 InsertedHeights[TREE_BENCHMARK_SIZES];
+    int32 RebuiltHeights[TREE_BENCHMARK_SIZES];
+    float InsertedCosts[TREE_BENCHMARK_SIZES];
+    float RebuiltCosts[TREE_BENCHMARK_SIZES];
+
+    // Note(joe): [0] on the tree as inserted, [1] after the rebuild.
+    tree_query_stats Spheres[TREE_BENCHMARK_SIZES][2];
+    tree_query_stats Rays[TREE_BENCHMARK_SIZES][2];
+    tree_query_stats Frustums[TREE_BENCHMARK_SIZES];
+    tree_query_stats BruteSpheres[TREE_BENCHMARK_SIZES];
+    bool Matches[TREE_BENCHMARK_SIZES]; // Brute force found what the tree did.
+
+    tree_query_stats Moves[TREE_BENCHMARK_SIZES]; // Results is the fraction reinserted.
+
+    // Note(joe): Per object, and whether the tree still finds what brute force does
+    // once they're done.
+    float RefitMicroseconds[TREE_BENCHMARK_SIZES];
+    float RefitCosts[TREE_BENCHMARK_SIZES];
+    bool RefitMatches[TREE_BENCHMARK_SIZES];
+    float DestroyMicroseconds[TREE_BENCHMARK_SIZES];
+    uint32 DestroyedLeafCounts[TREE_BENCHMARK_SIZES]; // What's left in the tree.
+    bool DestroyMatches[TREE_BENCHMARK_SIZES];
+};
+
+static tree_query_stats RunTreeSphereQueries(aabb_tree *Tree, glm::vec3 *Centers, float Radius, uint32 *Results, uint32 MaxResults)
+{
+    uint64 NodesStart = Tree->NodesVisited;
+    uint64 ResultCount = 0;
+    uint64 Start = LinuxGetClock();
+    for (int QueryIndex = 0; QueryIndex < TREE_BENCHMARK_QUERIES; ++QueryIndex)
+    {
+        ResultCount += QueryAabbTreeSphere(Tree, Centers[QueryIndex], Radius, Results, MaxResults);
+    }
+    uint64 End = LinuxGetClock();
+
+    tree_query_stats Result;
+    Result.Microseconds = 1e6f*LinuxGetElapsedSeconds(Start, End) / TREE_BENCHMARK_QUERIES;
+    Result.NodesVisited = (float)(Tree->NodesVisited - NodesStart) / TREE_BENCHMARK_QUERIES;
+    Result.Results = (float)ResultCount / TREE_BENCHMARK_QUERIES;
+    return Result;
+}
+
+static tree_query_stats RunTreeRayQueries(aabb_tree *Tree, glm::vec3 *Origins, glm::vec3 *Directions, float Length)
+{
+    uint64 NodesStart = Tree->NodesVisited;
+    uint32 HitCount = 0;
+    uint64 Start = LinuxGetClock();
+    for (int QueryIndex = 0; QueryIndex < TREE_BENCHMARK_QUERIES; ++QueryIndex)
+    {
+        uint32 Hit;
+        float Distance;
+        HitCount += RayCastAabbTree(Tree, Origins[QueryIndex], Directions[QueryIndex], Length, &Hit, &Distance) ? 1 : 0;
+    }
+    uint64 End = LinuxGetClock();
+
+    tree_query_stats Result;
+    Result.Microseconds = 1e6f*LinuxGetElapsedSeconds(Start, End) / TREE_BENCHMARK_QUERIES;
+    Result.NodesVisited = (float)(Tree->NodesVisited - NodesStart) / TREE_BENCHMARK_QUERIES;
+    Result.Results = (float)HitCount / TREE_BENCHMARK_QUERIES;
+    return Result;
+}
+
+// Note(joe): Counts against every box that's still in, Removed can be 0.
+static bool MatchesBruteForceSpheres(aabb_tree *Tree, aabb *Boxes, bool *Removed, uint32 ObjectCount,
+                                     glm::vec3 *Centers, float Radius, uint32 QueryCount, uint32 *Results)
+{
+    uint64 TreeCount = 0;
+    uint64 BruteCount = 0;
+    for (uint32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+    {
+        for (uint32 ObjectIndex = 0; ObjectIndex < ObjectCount; ++ObjectIndex)
+        {
+            if (!(Removed && Removed[ObjectIndex]))
+            {
+                BruteCount += OverlapsSphere(Boxes[ObjectIndex], Centers[QueryIndex], Radius) ? 1 : 0;
+            }
+        }
+        TreeCount += QueryAabbTreeSphere(Tree, Centers[QueryIndex], Radius, Results, ObjectCount);
+    }
+    return (TreeCount == BruteCount);
+}
+
+// Note(joe): Boxes half a unit to two across, scattered at the same density however
+// many there are, about one per 64 cubic units. The queries are all the same size,
+// so each one finds about as much at every count and any growth in cost is the tree.
+static void RunTreeBenchmark(tree_benchmark *Benchmark, memory_arena *LoadArena)
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    float SphereRadius = 8.0f;
+    float RayLength = 50.0f;
+    glm::mat4 Projection = glm::perspective(DEG_TO_RAD(45), 16.0f / 9.0f, 0.1f, 50.0f);
+
+    uint32 ObjectCounts[TREE_BENCHMARK_SIZES] = { 10000, 100000, 1000000 };
+    for (int SizeIndex = 0; SizeIndex < TREE_BENCHMARK_SIZES; ++SizeIndex)
+    {
+        uint32 ObjectCount = ObjectCounts[SizeIndex];
+        float WorldSize = 4.0f*cbrtf((float)ObjectCount);
+        temporary_memory BenchmarkMemory = BeginTemporaryMemory(LoadArena);
+
+        uint32 Random = 0x9E3779B9;
+        aabb *Boxes = PushArray(LoadArena, ObjectCount, aabb);
+        for (uint32 ObjectIndex = 0; ObjectIndex < ObjectCount; ++ObjectIndex)
+        {
+            glm::vec3 Center(RandomUnilateral(&Random), RandomUnilateral(&Random), RandomUnilateral(&Random));
+            glm::vec3 Extent(RandomUnilateral(&Random), RandomUnilateral(&Random), RandomUnilateral(&Random));
+            Center = WorldSize*Center;
+            Extent = 0.25f + 0.75f*Extent;
+            Boxes[ObjectIndex].Min = Center - Extent;
+            Boxes[ObjectIndex].Max = Center + Extent;
+        }
+
+        glm::vec3 *Centers = PushArray(LoadArena, TREE_BENCHMARK_QUERIES, glm::vec3);
+        glm::vec3 *Directions = PushArray(LoadArena, TREE_BENCHMARK_QUERIES, glm::vec3);
+        for (int QueryIndex = 0; QueryIndex < TREE_BENCHMARK_QUERIES; ++QueryIndex)
+        {
+            Centers[QueryIndex] = WorldSize*glm::vec3(RandomUnilateral(&Random), RandomUnilateral(&Random), RandomUnilateral(&Random));
+            glm::vec3 Direction(RandomUnilateral(&Random) - 0.5f, RandomUnilateral(&Random) - 0.5f, RandomUnilateral(&Random) - 0.5f);
+            Directions[QueryIndex] = glm::normalize(Direction + glm::vec3(1e-3f));
+        }
+        uint32 *Results = PushArray(LoadArena, ObjectCount, uint32);
+
+        aabb_tree Tree;
+        InitAabbTree(&Tree, LoadArena, ObjectCount);
+        uint32 *Proxies = PushArray(LoadArena, ObjectCount, uint32);
+        uint64 InsertStart = LinuxGetClock();
+        for (uint32 ObjectIndex = 0; ObjectIndex < ObjectCount; ++ObjectIndex)
+        {
+            Proxies[ObjectIndex] = CreateAabbTreeProxy(&Tree, Boxes[ObjectIndex], ObjectIndex);
+        }
+        uint64 InsertEnd = LinuxGetClock();
+        Benchmark->InsertSeconds[SizeIndex] = LinuxGetElapsedSeconds(InsertStart, InsertEnd);
+        Benchmark->InsertedHeights[SizeIndex] = Tree.Nodes[Tree.Root].Height;
+        Benchmark->InsertedCosts[SizeIndex] = GetAabbTreeCost(&Tree);
+        Benchmark->Spheres[SizeIndex][0] = RunTreeSphereQueries(&Tree, Centers, SphereRadius, Results, ObjectCount);
+        Benchmark->Rays[SizeIndex][0] = RunTreeRayQueries(&Tree, Centers, Directions, RayLength);
+
+        uint64 RebuildStart = LinuxGetClock();
+        RebuildAabbTree(&Tree, LoadArena);
+        uint64 RebuildEnd = LinuxGetClock();
+        Benchmark->RebuildSeconds[SizeIndex] = LinuxGetElapsedSeconds(RebuildStart, RebuildEnd);
+        Benchmark->RebuiltHeights[SizeIndex] = Tree.Nodes[Tree.Root].Height;
+        Benchmark->RebuiltCosts[SizeIndex] = GetAabbTreeCost(&Tree);
+        Benchmark->Spheres[SizeIndex][1] = RunTreeSphereQueries(&Tree, Centers, SphereRadius, Results, ObjectCount);
+        Benchmark->Rays[SizeIndex][1] = RunTreeRayQueries(&Tree, Centers, Directions, RayLength);
+
+        // Note(joe): Cameras at the query points looking along the ray directions, with
+        // the far plane pulled in so the volume doesn't change with the world size.
+        {
+            uint64 NodesStart = Tree.NodesVisited;
+            uint64 VisibleCount = 0;
+            uint64 Start = LinuxGetClock();
+            for (int QueryIndex = 0; QueryIndex < TREE_BENCHMARK_QUERIES; ++QueryIndex)
+            {
+                glm::vec3 Up = (fabsf(Directions[QueryIndex].y) < 0.9f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                glm::mat4 ViewProjection = Projection*glm::lookAt(Centers[QueryIndex], Centers[QueryIndex] + Directions[QueryIndex], Up);
+                frustum Frustum = ExtractFrustum(ViewProjection);
+                VisibleCount += QueryAabbTreeFrustum(&Tree, &Frustum, Results, ObjectCount);
+            }
+            uint64 End = LinuxGetClock();
+
+            tree_query_stats *Stats = Benchmark->Frustums + SizeIndex;
+            Stats->Microseconds = 1e6f*LinuxGetElapsedSeconds(Start, End) / TREE_BENCHMARK_QUERIES;
+            Stats->NodesVisited = (float)(Tree.NodesVisited - NodesStart) / TREE_BENCHMARK_QUERIES;
+            Stats->Results = (float)VisibleCount / TREE_BENCHMARK_QUERIES;
+        }
+
+        // Note(joe): The same spheres against every box, fewer of them as the count goes
+        // up. Comparing counts is enough, the tree's leaves test the same boxes.
+        uint32 BruteQueryCount = glm::min((uint32)TREE_BENCHMARK_QUERIES, 100000000 / ObjectCount);
+        {
+            uint64 TreeCount = 0;
+            uint64 BruteCount = 0;
+            uint64 Start = LinuxGetClock();
+            for (uint32 QueryIndex = 0; QueryIndex < BruteQueryCount; ++QueryIndex)
+            {
+                for (uint32 ObjectIndex = 0; ObjectIndex < ObjectCount; ++ObjectIndex)
+                {
+                    BruteCount += OverlapsSphere(Boxes[ObjectIndex], Centers[QueryIndex], SphereRadius) ? 1 : 0;
+                }
+            }
+            uint64 End = LinuxGetClock();
+            for (uint32 QueryIndex = 0; QueryIndex < BruteQueryCount; ++QueryIndex)
+            {
+                TreeCount += QueryAabbTreeSphere(&Tree, Centers[QueryIndex], SphereRadius, Results, ObjectCount);
+            }
+
+            tree_query_stats *Stats = Benchmark->BruteSpheres + SizeIndex;
+            Stats->Microseconds = 1e6f*LinuxGetElapsedSeconds(Start, End) / BruteQueryCount;
+            Stats->NodesVisited = (float)ObjectCount;
+            Stats->Results = (float)BruteCount / BruteQueryCount;
+            Benchmark->Matches[SizeIndex] = (TreeCount == BruteCount);
+        }
+
+        // Note(joe): A tenth of the objects drift a little every step, the way most of a
+        // scene does frame to frame. Most moves should stay inside their fat boxes.
+        {
+            uint32 MoverCount = ObjectCount / 10;
+            int StepCount = 10;
+            glm::vec3 *Velocities = PushArray(LoadArena, MoverCount, glm::vec3);
+            for (uint32 MoverIndex = 0; MoverIndex < MoverCount; ++MoverIndex)
+            {
+                glm::vec3 Direction(RandomUnilateral(&Random) - 0.5f, RandomUnilateral(&Random) - 0.5f, RandomUnilateral(&Random) - 0.5f);
+                Velocities[MoverIndex] = 0.05f*glm::normalize(Direction + glm::vec3(1e-3f));
+            }
+
+            Tree.Reinserts = 0;
+            uint64 Start = LinuxGetClock();
+            for (int Step = 0; Step < StepCount; ++Step)
+            {
+                for (uint32 MoverIndex = 0; MoverIndex < MoverCount; ++MoverIndex)
+                {
+                    uint32 ObjectIndex = MoverIndex*10;
+                    aabb *Box = Boxes + ObjectIndex;
+                    Box->Min += Velocities[MoverIndex];
+                    Box->Max += Velocities[MoverIndex];
+                    MoveAabbTreeProxy(&Tree, Proxies[ObjectIndex], *Box, Velocities[MoverIndex]);
+                }
+            }
+            uint64 End = LinuxGetClock();
+
+            uint32 MoveCount = MoverCount*StepCount;
+            tree_query_stats *Stats = Benchmark->Moves + SizeIndex;
+            Stats->Microseconds = 1e6f*LinuxGetElapsedSeconds(Start, End) / MoveCount;
+            Stats->NodesVisited = 0.0f;
+            Stats->Results = (float)Tree.Reinserts / MoveCount;
+        }
+
+        // Note(joe): A different tenth shake back and forth on the spot and are refit,
+        // which only ever grows boxes. The queries have to find the same as before.
+        {
+            uint32 WobblerCount = ObjectCount / 10;
+            int StepCount = 10;
+            glm::vec3 *Wobbles = PushArray(LoadArena, WobblerCount, glm::vec3);
+            for (uint32 WobblerIndex = 0; WobblerIndex < WobblerCount; ++WobblerIndex)
+            {
+                glm::vec3 Direction(RandomUnilateral(&Random) - 0.5f, RandomUnilateral(&Random) - 0.5f, RandomUnilateral(&Random) - 0.5f);
+                Wobbles[WobblerIndex] = 0.3f*glm::normalize(Direction + glm::vec3(1e-3f));
+            }
+
+            // Note(joe): Out to one side, then swinging to the other and back, so they
+            // finish away from where they were inserted.
+            uint64 Start = LinuxGetClock();
+            for (int Step = 0; Step < StepCount; ++Step)
+            {
+                float Scale = (Step == 0) ? 1.0f : ((Step & 1) ? -2.0f : 2.0f);
+                for (uint32 WobblerIndex = 0; WobblerIndex < WobblerCount; ++WobblerIndex)
+                {
+                    uint32 ObjectIndex = WobblerIndex*10 + 5;
+                    aabb *Box = Boxes + ObjectIndex;
+                    Box->Min += Scale*Wobbles[WobblerIndex];
+                    Box->Max += Scale*Wobbles[WobblerIndex];
+                    RefitAabbTreeProxy(&Tree, Proxies[ObjectIndex], *Box);
+                }
+            }
+            uint64 End = LinuxGetClock();
+
+            Benchmark->RefitMicroseconds[SizeIndex] = 1e6f*LinuxGetElapsedSeconds(Start, End) / (WobblerCount*StepCount);
+            Benchmark->RefitCosts[SizeIndex] = GetAabbTreeCost(&Tree);
+            Benchmark->RefitMatches[SizeIndex] = MatchesBruteForceSpheres(&Tree, Boxes, 0, ObjectCount, Centers, SphereRadius,
+                                                                          BruteQueryCount, Results);
+        }
+
+        // Note(joe): Every fourth object goes, then what's left has to match.
+        {
+            bool *Removed = PushArray(LoadArena, ObjectCount, bool);
+            uint32 DestroyCount = 0;
+            uint64 Start = LinuxGetClock();
+            for (uint32 ObjectIndex = 0; ObjectIndex < ObjectCount; ++ObjectIndex)
+            {
+                Removed[ObjectIndex] = ((ObjectIndex & 3) == 3);
+                if (Removed[ObjectIndex])
+                {
+                    DestroyAabbTreeProxy(&Tree, Proxies[ObjectIndex]);
+                    ++DestroyCount;
+                }
+            }
+            uint64 End = LinuxGetClock();
+
+            Benchmark->DestroyMicroseconds[SizeIndex] = 1e6f*LinuxGetElapsedSeconds(Start, End) / DestroyCount;
+            Benchmark->DestroyedLeafCounts[SizeIndex] = Tree.LeafCount;
+            Benchmark->DestroyMatches[SizeIndex] = (Tree.LeafCount == ObjectCount - DestroyCount) &&
+                                                   MatchesBruteForceSpheres(&Tree, Boxes, Removed, ObjectCount, Centers, SphereRadius,
+                                                                            BruteQueryCount, Results);
+        }
+
+        Benchmark->ObjectCounts[SizeIndex] = ObjectCount;
+        EndTemporaryMemory(BenchmarkMemory);
+    }
+}
+
+// Note(joe): Nearest rank, Values has to be sorted.
+static float Percentile(float *Values, int Count, float Percent)
+{
+    int Rank = (int)ceilf(Percent / 100.0f * Count);
+    if (Rank < 1)
+    {
+        Rank = 1;
+    }
+    if (Rank > Count)
+    {
+        Rank = Count;
+    }
+    return Values[Rank - 1];
+}
+
+int main(int ArgCount, char **Args)
+{
+    uint64 ProcessStart = LinuxGetClock();
+    InitProfiler();
+
+    headless_options Options = {};
+    Options.Scene = HeadlessScene_Lighting;
+    Options.FrameCount = 500;
+    Options.WarmupFrameCount = 10;
+    Options.Width = 800;
+    Options.Height = 600;
+    Options.DataPath = "../data";
+    Options.ThreadCount = LinuxGetWorkerThreadCount();
+    Options.CacheMegabytes = 256;
+    Options.LodThreshold = MODEL_SCENE_LOD_THRESHOLD;
+    if (!ParseCommandLine(ArgCount, Args, &Options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Note(joe): Assets are loaded relative to data/ just like the Windows builds.
+    if (chdir(Options.DataPath) != 0)
+    {
+        fprintf(stderr, "aqcube_headless: can't change to data directory %s\n", Options.DataPath);
+        return 1;
+    }
+
+    if (Options.ProfilePath && !BeginProfileTrace(Options.ProfilePath))
+    {
+        fprintf(stderr, "aqcube_headless: can't write %s\n", Options.ProfilePath);
+    }
+
+    EGLDisplay Display;
+    EGLContext OpenGLContext = LinuxInitializeOpenGL(&Display);
+    if (OpenGLContext == EGL_NO_CONTEXT)
+    {
+        fprintf(stderr, "aqcube_headless: can't create an OpenGL 3.3 context (EGL error 0x%x)\n", eglGetError());
+        return 1;
+    }
+    InitOpenGLExtensions();
+    if (Options.NoIndirect)
+    {
+        GlobalHasMultiDrawIndirect = false;
+    }
+
+    GLuint Framebuffer = LinuxCreateOffscreenFramebuffer(Options.Width, Options.Height);
+    if (!Framebuffer)
+    {
+        fprintf(stderr, "aqcube_headless: offscreen framebuffer is incomplete\n");
+        return 1;
+    }
+    uint64 ContextEnd = LinuxGetClock();
+
+    game_memory GameMemory = {};
+    GameMemory.PermanentStorageSize = Megabytes(64);
+    GameMemory.TransientStorageSize = Megabytes(512);
+    GameMemory.PermanentStorage = mmap(0, (size_t)(GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize),
+                                       PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (GameMemory.PermanentStorage == MAP_FAILED)
+    {
+        fprintf(stderr, "aqcube_headless: can't allocate game memory\n");
+        return 1;
+    }
+    GameMemory.TransientStorage = (uint8 *)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize;
+
+    scene_arenas Arenas = {};
+    InitializeSceneArenas(&Arenas, &GameMemory, Megabytes(16));
+
+    platform_work_queue WorkQueue = {};
+    LinuxMakeQueue(&WorkQueue, Options.ThreadCount);
+
+    texture_cache *TextureCache = 0;
+    if (Options.CachePath)
+    {
+        char CacheDirectory[256];
+        snprintf(CacheDirectory, sizeof(CacheDirectory), "%s/textures", Options.CachePath);
+        TextureCache = PushStruct(&Arenas.Assets, texture_cache);
+        InitTextureCache(TextureCache, CacheDirectory, Megabytes((uint64)Options.CacheMegabytes));
+        GlobalTextureCache = TextureCache;
+
+        snprintf(CacheDirectory, sizeof(CacheDirectory), "%s/programs", Options.CachePath);
+        InitProgramCache(CacheDirectory);
+    }
+
+    lighting_scene LightingScene = {};
+    texture_loader TextureLoader = {};
+    model_scene ModelScene = {};
+    mip_benchmark MipBenchmark = {};
+    culling_benchmark CullingBenchmark = {};
+    tree_benchmark TreeBenchmark = {};
+    // Note(joe): The software scene is the game layer, with its own game_memory since
+    // its game_state sits at the start of PermanentStorage.
+    fill_benchmark FillBenchmark = {};
+    audio_benchmark AudioBenchmark = {};
+    game_memory SoftwareMemory = {};
+    game_back_buffer SoftwareBackBuffer = {};
+    game_sound_buffer SoftwareSoundBuffer = {};
+    switch (Options.Scene)
+    {
+        case HeadlessScene_Lighting:
+        {
+            LightingScene.ExtraCubeCount = Options.ExtraCubeCount;
+            InitLightingScene(&LightingScene, &Arenas.Assets, &Arenas.Load);
+        } break;
+        case HeadlessScene_Model:
+        {
+            ModelScene.ExtraModelCount = Options.ExtraModelCount;
+            InitModelScene(&ModelScene, &Arenas.Assets, &Arenas.Load, &WorkQueue);
+            ModelScene.LodThreshold = Options.LodThreshold;
+            ModelScene.OcclusionCulling = !Options.NoOcclusion;
+            ModelScene.Occlusion.RecordOccludees = Options.CheckOcclusion;
+        } break;
+        case HeadlessScene_Textures:
+        {
+            InitTextureScene(&TextureLoader, &WorkQueue, &Arenas.Load);
+        } break;
+        case HeadlessScene_Mips:
+        {
+            RunMipBenchmark(&MipBenchmark, &Arenas.Load);
+        } break;
+        case HeadlessScene_Culling:
+        {
+            RunCullingBenchmark(&CullingBenchmark, &Arenas.Load);
+        } break;
+        case HeadlessScene_Tree:
+        {
+            RunTreeBenchmark(&TreeBenchmark, &Arenas.Load);
+        } break;
+        case HeadlessScene_Fill:
+        {
+            RunFillBenchmark(&FillBenchmark, &Arenas.Load, &WorkQueue);
+        } break;
+        case HeadlessScene_Audio:
+        {
+            RunAudioBenchmark(&AudioBenchmark, &Arenas.Load);
+        } break;
+        case HeadlessScene_Software:
+        {
+            SoftwareMemory.PermanentStorageSize = Megabytes(1);
+            SoftwareMemory.TransientStorageSize = Megabytes(64);
+            SoftwareMemory.PermanentStorage = PushSize(&Arenas.Assets, SoftwareMemory.PermanentStorageSize);
+            SoftwareMemory.TransientStorage = PushSize(&Arenas.Load, SoftwareMemory.TransientStorageSize);
+            SoftwareMemory.HighPriorityQueue = &WorkQueue;
+
+            SoftwareBackBuffer.Width = Options.Width;
+            SoftwareBackBuffer.Height = Options.Height;
+            SoftwareBackBuffer.BytesPerPixel = 4;
+            SoftwareBackBuffer.Pitch = Options.Width*SoftwareBackBuffer.BytesPerPixel;
+            SoftwareBackBuffer.Memory = PushSize(&Arenas.Load, (uint64)SoftwareBackBuffer.Pitch*Options.Height);
+
+            SoftwareSoundBuffer.SamplesPerSec = 48000;
+            SoftwareSoundBuffer.SampleCount = SoftwareSoundBuffer.SamplesPerSec / 60;
+            SoftwareSoundBuffer.Samples = PushArray(&Arenas.Load, 2*SoftwareSoundBuffer.SampleCount, int16);
+        } break;
+        default: break;
+    }
+    // Note(joe): Make sure the driver has really finished the uploads and compiles.
+    glFinish();
+    uint64 StartupEnd = LinuxGetClock();
+    if (TextureCache)
+    {
+        SaveTextureCache(TextureCache);
+    }
+
+    char ProfileText[16384];
+    profile_frame *Profile = EndProfileFrame();
+    if (Options.ProfilePath)
+    {
+        FormatProfileFrame(Profile, ProfileText, sizeof(ProfileText));
+        fprintf(stderr, "Startup\n%s", ProfileText);
+    }
+
+    camera Camera = {};
+    Camera.Position = glm::vec3(0.0f, 0.0f, 3.0f);
+    Camera.Front = glm::vec3(0.0f, 0.0f, -1.0f);
+    Camera.Up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    float *FrameSeconds = (float *)malloc(Options.FrameCount * sizeof(float));
+    uint64 DrawCallCount = 0;
+    uint64 UniformCallCount = 0;
+    uint64 BufferCallCount = 0;
+    uint64 ProgramBindCount = 0;
+    uint64 TextureBindCount = 0;
+    uint64 VertexArrayBindCount = 0;
+    uint64 StateCallCount = 0;
+    uint64 FilteredStateCallCount = 0;
+    uint64 TriangleCount = 0;
+    uint64 ObjectsTestedCount = 0;
+    uint64 ObjectsVisibleCount = 0;
+    uint64 OccluderTriangleCount = 0;
+    uint64 OccludeesTestedCount = 0;
+    uint64 OccludeesCulledCount = 0;
+    double OcclusionRasterMs = 0.0;
+    double OcclusionTestMs = 0.0;
+    uint32 OcclusionFalseCulls = 0;
+    uint32 OcclusionMissed = 0;
+    float SubmitSeconds = 0.0f;
+    software_stats SoftwareStats = {};
+    game_controller_input SoftwareInput = {};
+
+    // Note(joe): For --occlusion check, the GPU's depth buffer every frame.
+    float *CheckDepth = 0;
+    if (Options.CheckOcclusion)
+    {
+        CheckDepth = (float *)malloc((size_t)Options.Width*Options.Height*sizeof(float));
+    }
+
+    int TotalFrameCount = Options.WarmupFrameCount + Options.FrameCount;
+    for (int FrameIndex = 0; FrameIndex < TotalFrameCount; ++FrameIndex)
+    {
+        // Note(joe): Fixed time step so every run draws the same frames.
+        float t = FrameIndex / 60.0f;
+
+        // Note(joe): Collects the frame before, so the Frame scope below is closed.
+        if (FrameIndex)
+        {
+            EndProfileFrame();
+        }
+        TIMED_SCOPE("Frame");
+
+        uint64 FrameStart = LinuxGetClock();
+        temporary_memory FrameMemory = BeginTemporaryMemory(&Arenas.Frame);
+        GlobalRenderStats = {};
+        switch (Options.Scene)
+        {
+            case HeadlessScene_Lighting:
+            {
+                RenderLightingScene(&LightingScene, &Camera, &Arenas.Frame, Options.Width, Options.Height, t);
+            } break;
+            case HeadlessScene_Model:
+            {
+                RenderModelScene(&ModelScene, &Camera, &Arenas.Frame, Options.Width, Options.Height);
+                if (CheckDepth && ModelScene.OcclusionCulling && FrameIndex >= Options.WarmupFrameCount)
+                {
+                    glReadPixels(0, 0, Options.Width, Options.Height, GL_DEPTH_COMPONENT, GL_FLOAT, CheckDepth);
+                    CheckOcclusion(&ModelScene.Occlusion, CheckDepth, Options.Width, Options.Height,
+                                   &OcclusionFalseCulls, &OcclusionMissed);
+                }
+            } break;
+            case HeadlessScene_Software:
+            {
+                UpdateGameAndRender(&SoftwareMemory, &SoftwareBackBuffer, &SoftwareSoundBuffer, &SoftwareInput);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (FrameIndex >= Options.WarmupFrameCount)
+                {
+                    software_stats *Stats = &((game_state *)SoftwareMemory.PermanentStorage)->Renderer.Stats;
+                    SoftwareStats.TrianglesSubmitted += Stats->TrianglesSubmitted;
+                    SoftwareStats.TrianglesDrawn += Stats->TrianglesDrawn;
+                    SoftwareStats.TileTriangles += Stats->TileTriangles;
+                    SoftwareStats.TileCount = Stats->TileCount;
+                    SoftwareStats.TileJobs = Stats->TileJobs;
+                    SoftwareStats.SetupMs += Stats->SetupMs;
+                    SoftwareStats.BinMs += Stats->BinMs;
+                    SoftwareStats.RasterMs += Stats->RasterMs;
+                }
+            } break;
+            case HeadlessScene_Textures:
+            case HeadlessScene_Mips:
+            case HeadlessScene_Culling:
+            case HeadlessScene_Tree:
+            case HeadlessScene_Fill:
+            case HeadlessScene_Audio:
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            } break;
+            default: break;
+        }
+        EndTemporaryMemory(FrameMemory);
+        uint64 SubmitEnd = LinuxGetClock();
+        // Note(joe): Stands in for SwapBuffers, otherwise the frame never really happens.
+        {
+            TIMED_SCOPE("glFinish");
+            glFinish();
+        }
+        uint64 FrameEnd = LinuxGetClock();
+
+        if (FrameIndex >= Options.WarmupFrameCount)
+        {
+            FrameSeconds[FrameIndex - Options.WarmupFrameCount] = LinuxGetElapsedSeconds(FrameStart, FrameEnd);
+            DrawCallCount += GlobalRenderStats.DrawCalls;
+            UniformCallCount += GlobalRenderStats.UniformCalls;
+            BufferCallCount += GlobalRenderStats.BufferCalls;
+            ProgramBindCount += GlobalRenderStats.ProgramBinds;
+            TextureBindCount += GlobalRenderStats.TextureBinds;
+            VertexArrayBindCount += GlobalRenderStats.VertexArrayBinds;
+            StateCallCount += GlobalRenderStats.StateCalls;
+            FilteredStateCallCount += GlobalRenderStats.FilteredStateCalls;
+            TriangleCount += GlobalRenderStats.Triangles;
+            ObjectsTestedCount += GlobalRenderStats.ObjectsTested;
+            ObjectsVisibleCount += GlobalRenderStats.ObjectsVisible;
+            OccluderTriangleCount += GlobalRenderStats.OccluderTriangles;
+            OccludeesTestedCount += GlobalRenderStats.OccludeesTested;
+            OccludeesCulledCount += GlobalRenderStats.OccludeesCulled;
+            OcclusionRasterMs += GlobalRenderStats.OcclusionRasterMs;
+            OcclusionTestMs += GlobalRenderStats.OcclusionTestMs;
+            SubmitSeconds += LinuxGetElapsedSeconds(FrameStart, SubmitEnd);
+        }
+    }
+    GLenum Error = glGetError();
+
+    Profile = EndProfileFrame();
+    if (Options.ProfilePath)
+    {
+        FormatProfileFrame(Profile, ProfileText, sizeof(ProfileText));
+        fprintf(stderr, "Last frame\n%s", ProfileText);
+        if (!EndProfileTrace())
+        {
+            fprintf(stderr, "aqcube_headless: can't write %s\n", Options.ProfilePath);
+        }
+    }
+
+    if (Options.Scene == HeadlessScene_Software)
+    {
+        if (Options.DumpPath && !LinuxDumpBackBuffer(Options.DumpPath, &SoftwareBackBuffer))
+        {
+            fprintf(stderr, "aqcube_headless: can't write %s\n", Options.DumpPath);
+        }
+    }
+    else if (Options.DumpPath && !LinuxDumpFramebuffer(Options.DumpPath, Options.Width, Options.Height))
+    {
+        fprintf(stderr, "aqcube_headless: can't write %s\n", Options.DumpPath);
+    }
+
+    float TotalSeconds = 0.0f;
+    for (int FrameIndex = 0; FrameIndex < Options.FrameCount; ++FrameIndex)
+    {
+        TotalSeconds += FrameSeconds[FrameIndex];
+    }
+    std::sort(FrameSeconds, FrameSeconds + Options.FrameCount);
+
+    printf("{\n");
+    char *SceneNames[] = { "lighting", "model", "textures", "mips", "culling", "tree", "software", "fill", "audio" };
+    printf("  \"scene\": \"%s\",\n", SceneNames[Options.Scene]);
+    printf("  \"renderer\": \"%s\",\n", (char *)glGetString(GL_RENDERER));
+    printf("  \"version\": \"%s\",\n", (char *)glGetString(GL_VERSION));
+    printf("  \"width\": %d,\n", Options.Width);
+    printf("  \"height\": %d,\n", Options.Height);
+    printf("  \"frames\": %d,\n", Options.FrameCount);
+    printf("  \"warmup_frames\": %d,\n", Options.WarmupFrameCount);
+    printf("  \"worker_threads\": %d,\n", Options.ThreadCount);
+    printf("  \"multi_draw_indirect\": %s,\n", GlobalHasMultiDrawIndirect ? "true" : "false");
+    printf("  \"context_ms\": %.3f,\n", 1000.0f*LinuxGetElapsedSeconds(ProcessStart, ContextEnd));
+    printf("  \"startup_ms\": %.3f,\n", 1000.0f*LinuxGetElapsedSeconds(ProcessStart, StartupEnd));
+    printf("  \"frame_ms\": {\n");
+    printf("    \"min\": %.4f,\n", 1000.0f*FrameSeconds[0]);
+    printf("    \"median\": %.4f,\n", 1000.0f*Percentile(FrameSeconds, Options.FrameCount, 50.0f));
+    printf("    \"p99\": %.4f,\n", 1000.0f*Percentile(FrameSeconds, Options.FrameCount, 99.0f));
+    printf("    \"max\": %.4f,\n", 1000.0f*FrameSeconds[Options.FrameCount - 1]);
+    printf("    \"mean\": %.4f\n", 1000.0f*TotalSeconds / Options.FrameCount);
+    printf("  },\n");
+    // Note(joe): Time spent issuing the frame on the CPU, before the glFinish.
+    printf("  \"submit_ms\": %.4f,\n", 1000.0f*SubmitSeconds / Options.FrameCount);
+    printf("  \"draw_calls_per_frame\": %.2f,\n", (double)DrawCallCount / Options.FrameCount);
+    printf("  \"uniform_calls_per_frame\": %.2f,\n", (double)UniformCallCount / Options.FrameCount);
+    printf("  \"buffer_calls_per_frame\": %.2f,\n", (double)BufferCallCount / Options.FrameCount);
+    printf("  \"program_binds_per_frame\": %.2f,\n", (double)ProgramBindCount / Options.FrameCount);
+    printf("  \"texture_binds_per_frame\": %.2f,\n", (double)TextureBindCount / Options.FrameCount);
+    printf("  \"vertex_array_binds_per_frame\": %.2f,\n", (double)VertexArrayBindCount / Options.FrameCount);
+    printf("  \"state_calls_per_frame\": %.2f,\n", (double)StateCallCount / Options.FrameCount);
+    printf("  \"filtered_state_calls_per_frame\": %.2f,\n", (double)FilteredStateCallCount / Options.FrameCount);
+    printf("  \"triangles_per_frame\": %.2f,\n", (double)TriangleCount / Options.FrameCount);
+    printf("  \"objects_tested_per_frame\": %.2f,\n", (double)ObjectsTestedCount / Options.FrameCount);
+    printf("  \"objects_submitted_per_frame\": %.2f,\n", (double)ObjectsVisibleCount / Options.FrameCount);
+    if (Options.Scene == HeadlessScene_Textures)
+    {
+        printf("  \"textures\": { \"loaded\": %u, \"failed\": %u, \"decoded_mb\": %.2f, \"cooked\": %u, \"cooked_mb\": %.2f, \"cached\": %u },\n",
+               TextureLoader.TexturesLoaded, TextureLoader.TexturesFailed,
+               (double)TextureLoader.BytesDecoded / (1024.0*1024.0),
+               TextureLoader.CookedTexturesLoaded, (double)TextureLoader.CookedBytesUploaded / (1024.0*1024.0),
+               TextureLoader.CachedTexturesLoaded);
+    }
+    if (Options.Scene == HeadlessScene_Mips)
+    {
+        printf("  \"mips\": { \"textures\": %u, \"uploaded_mb\": %.2f, \"driver_ms\": %.3f, \"prebuilt_upload_ms\": %.3f,\n",
+               MipBenchmark.TextureCount, (double)MipBenchmark.BytesUploaded / (1024.0*1024.0),
+               1000.0f*MipBenchmark.DriverSeconds, 1000.0f*MipBenchmark.PrebuiltSeconds);
+        printf("            \"build_ms\": { \"box\": %.3f, \"kaiser\": %.3f, \"lanczos\": %.3f } },\n",
+               1000.0f*MipBenchmark.BuildSeconds[MipFilter_Box], 1000.0f*MipBenchmark.BuildSeconds[MipFilter_Kaiser],
+               1000.0f*MipBenchmark.BuildSeconds[MipFilter_Lanczos]);
+    }
+    if (Options.Scene == HeadlessScene_Culling)
+    {
+        printf("  \"culling\": { \"simd_width\": %u, \"runs\": [\n", GetCullWidth());
+        for (int SizeIndex = 0; SizeIndex < CULLING_BENCHMARK_SIZES; ++SizeIndex)
+        {
+            float ScalarSeconds = CullingBenchmark.ScalarSeconds[SizeIndex];
+            float SimdSeconds = CullingBenchmark.SimdSeconds[SizeIndex];
+            printf("    { \"objects\": %u, \"visible\": %u, \"scalar_ms\": %.4f, \"simd_ms\": %.4f, \"speedup\": %.2f, \"match\": %s }%s\n",
+                   CullingBenchmark.ObjectCounts[SizeIndex], CullingBenchmark.VisibleCounts[SizeIndex],
+                   1000.0f*ScalarSeconds, 1000.0f*SimdSeconds, (SimdSeconds > 0.0f) ? ScalarSeconds / SimdSeconds : 0.0f,
+                   CullingBenchmark.Matches[SizeIndex] ? "true" : "false",
+                   (SizeIndex + 1 < CULLING_BENCHMARK_SIZES) ? "," : "");
+        }
+        printf("  ] },\n");
+    }
+    if (Options.Scene == HeadlessScene_Tree)
+    {
+        printf("  \"aabb_tree\": [\n");
+        for (int SizeIndex = 0; SizeIndex < TREE_BENCHMARK_SIZES; ++SizeIndex)
+        {
+            tree_query_stats *Inserted[] = { &TreeBenchmark.Spheres[SizeIndex][0], &TreeBenchmark.Rays[SizeIndex][0] };
+            tree_query_stats *Rebuilt[] = { &TreeBenchmark.Spheres[SizeIndex][1], &TreeBenchmark.Rays[SizeIndex][1] };
+            tree_query_stats *Frustum = TreeBenchmark.Frustums + SizeIndex;
+            tree_query_stats *Brute = TreeBenchmark.BruteSpheres + SizeIndex;
+            tree_query_stats *Move = TreeBenchmark.Moves + SizeIndex;
+            printf("    { \"objects\": %u,\n", TreeBenchmark.ObjectCounts[SizeIndex]);
+            printf("      \"inserted\": { \"build_ms\": %.2f, \"height\": %d, \"sah_cost\": %.1f,\n",
+                   1000.0f*TreeBenchmark.InsertSeconds[SizeIndex], TreeBenchmark.InsertedHeights[SizeIndex], TreeBenchmark.InsertedCosts[SizeIndex]);
+            printf("                    \"sphere\": { \"us\": %.3f, \"nodes\": %.1f, \"found\": %.1f }, \"ray\": { \"us\": %.3f, \"nodes\": %.1f, \"hit_rate\": %.3f } },\n",
+                   Inserted[0]->Microseconds, Inserted[0]->NodesVisited, Inserted[0]->Results,
+                   Inserted[1]->Microseconds, Inserted[1]->NodesVisited, Inserted[1]->Results);
+            printf("      \"rebuilt\": { \"build_ms\": %.2f, \"height\": %d, \"sah_cost\": %.1f,\n",
+                   1000.0f*TreeBenchmark.RebuildSeconds[SizeIndex], TreeBenchmark.RebuiltHeights[SizeIndex], TreeBenchmark.RebuiltCosts[SizeIndex]);
+            printf("                   \"sphere\": { \"us\": %.3f, \"nodes\": %.1f, \"found\": %.1f }, \"ray\": { \"us\": %.3f, \"nodes\": %.1f, \"hit_rate\": %.3f },\n",
+                   Rebuilt[0]->Microseconds, Rebuilt[0]->NodesVisited, Rebuilt[0]->Results,
+                   Rebuilt[1]->Microseconds, Rebuilt[1]->NodesVisited, Rebuilt[1]->Results);
+            printf("                   \"frustum\": { \"us\": %.3f, \"nodes\": %.1f, \"visible\": %.1f } },\n",
+                   Frustum->Microseconds, Frustum->NodesVisited, Frustum->Results);
+            printf("      \"brute_sphere\": { \"us\": %.3f, \"found\": %.1f, \"match\": %s },\n",
+                   Brute->Microseconds, Brute->Results, TreeBenchmark.Matches[SizeIndex] ? "true" : "false");
+            printf("      \"move\": { \"us\": %.4f, \"reinsert_rate\": %.4f },\n", Move->Microseconds, Move->Results);
+            printf("      \"refit\": { \"us\": %.4f, \"sah_cost\": %.1f, \"match\": %s },\n",
+                   TreeBenchmark.RefitMicroseconds[SizeIndex], TreeBenchmark.RefitCosts[SizeIndex],
+                   TreeBenchmark.RefitMatches[SizeIndex] ? "true" : "false");
+            printf("      \"destroy\": { \"us\": %.4f, \"leaves\": %u, \"match\": %s } }%s\n",
+                   TreeBenchmark.DestroyMicroseconds[SizeIndex], TreeBenchmark.DestroyedLeafCounts[SizeIndex],
+                   TreeBenchmark.DestroyMatches[SizeIndex] ? "true" : "false", (SizeIndex + 1 < TREE_BENCHMARK_SIZES) ? "," : "");
+        }
+        printf("  ],\n");
+    }
+    if (Options.Scene == HeadlessScene_Fill)
+    {
+        // Note(joe): memset on the same buffer is the bandwidth the fills are up against.
+        printf("  \"fill\": { \"simd_width\": %d, \"runs\": [\n", AQCUBE_AVX2 ? 8 : (AQCUBE_SSE2 ? 4 : 1));
+        for (int SizeIndex = 0; SizeIndex < FILL_BENCHMARK_SIZES; ++SizeIndex)
+        {
+            double Bytes = 4.0*FillBenchmark.Widths[SizeIndex]*FillBenchmark.Heights[SizeIndex];
+            printf("    { \"size\": \"%dx%d\", \"mb\": %.2f, \"gb_per_s\": { \"scalar\": %.2f, \"simd\": %.2f, \"stream\": %.2f, \"threaded\": %.2f, \"memset\": %.2f }, \"match\": %s }%s\n",
+                   FillBenchmark.Widths[SizeIndex], FillBenchmark.Heights[SizeIndex], Bytes / (1024.0*1024.0),
+                   Bytes / (1e9*FillBenchmark.ScalarSeconds[SizeIndex]), Bytes / (1e9*FillBenchmark.SimdSeconds[SizeIndex]),
+                   Bytes / (1e9*FillBenchmark.StreamSeconds[SizeIndex]), Bytes / (1e9*FillBenchmark.ThreadedSeconds[SizeIndex]),
+                   Bytes / (1e9*FillBenchmark.MemsetSeconds[SizeIndex]), FillBenchmark.Matches[SizeIndex] ? "true" : "false",
+                   (SizeIndex + 1 < FILL_BENCHMARK_SIZES) ? "," : "");
+        }
+        printf("  ] },\n");
+    }
+    if (Options.Scene == HeadlessScene_Audio)
+    {
+        // Note(joe): cpu_share is of one core, for one second of audio.
+        printf("  \"audio\": { \"rate\": %d, \"chunk\": %d, \"sine_max_error\": %.5f, \"sinf_tone_ms\": %.3f, \"stop_match\": %s, \"runs\": [\n",
+               AUDIO_BENCHMARK_RATE, AUDIO_BENCHMARK_CHUNK, AudioBenchmark.SineMaxError, 1000.0f*AudioBenchmark.SinfToneSeconds,
+               AudioBenchmark.StopMatches ? "true" : "false");
+        for (int SizeIndex = 0; SizeIndex < AUDIO_BENCHMARK_SIZES; ++SizeIndex)
+        {
+            float Seconds = AudioBenchmark.Seconds[SizeIndex];
+            uint32 VoiceCount = AudioBenchmark.VoiceCounts[SizeIndex];
+            printf("    { \"voices\": %u, \"ms\": %.3f, \"us_per_chunk\": %.2f, \"ns_per_voice_sample\": %.3f, \"cpu_share\": %.4f }%s\n",
+                   VoiceCount, 1000.0f*Seconds, 1e6f*Seconds / (AUDIO_BENCHMARK_RATE / AUDIO_BENCHMARK_CHUNK),
+                   1e9f*Seconds / ((float)VoiceCount*AUDIO_BENCHMARK_RATE), Seconds,
+                   (SizeIndex + 1 < AUDIO_BENCHMARK_SIZES) ? "," : "");
+        }
+        printf("  ] },\n");
+    }
+    if (Options.Scene == HeadlessScene_Software)
+    {
+        printf("  \"software\": { \"simd_width\": %d, \"tile_size\": %d, \"tiles\": %u, \"tile_jobs\": %u,\n",
+               SOFTWARE_LANES, SOFTWARE_TILE_SIZE, SoftwareStats.TileCount, SoftwareStats.TileJobs);
+        printf("                \"triangles_per_frame\": %.2f, \"drawn_per_frame\": %.2f, \"binned_per_frame\": %.2f,\n",
+               (double)SoftwareStats.TrianglesSubmitted / Options.FrameCount, (double)SoftwareStats.TrianglesDrawn / Options.FrameCount,
+               (double)SoftwareStats.TileTriangles / Options.FrameCount);
+        printf("                \"setup_ms\": %.4f, \"bin_ms\": %.4f, \"raster_ms\": %.4f },\n",
+               SoftwareStats.SetupMs / Options.FrameCount, SoftwareStats.BinMs / Options.FrameCount,
+               SoftwareStats.RasterMs / Options.FrameCount);
+    }
+    if (Options.Scene == HeadlessScene_Model && ModelScene.OcclusionCulling)
+    {
+        printf("  \"occlusion\": { \"buffer\": \"%dx%d\", \"occluder_triangles_per_frame\": %.2f, \"tested_per_frame\": %.2f, \"culled_per_frame\": %.2f,\n",
+               OCCLUSION_WIDTH, OCCLUSION_HEIGHT, (double)OccluderTriangleCount / Options.FrameCount,
+               (double)OccludeesTestedCount / Options.FrameCount, (double)OccludeesCulledCount / Options.FrameCount);
+        printf("                 \"raster_ms\": %.4f, \"test_ms\": %.4f",
+               OcclusionRasterMs / Options.FrameCount, OcclusionTestMs / Options.FrameCount);
+        if (CheckDepth)
+        {
+            // Note(joe): Per frame, see CheckOcclusion.
+            printf(",\n                 \"false_culls_per_frame\": %.2f, \"missed_per_frame\": %.2f",
+                   (double)OcclusionFalseCulls / Options.FrameCount, (double)OcclusionMissed / Options.FrameCount);
+        }
+        printf(" },\n");
+    }
+    if (Options.Scene == HeadlessScene_Model)
+    {
+        geometry_pool *Geometry = &ModelScene.Geometry;
+        printf("  \"geometry\": { \"vertex_format\": \"%s\", \"vertex_stride\": %u, \"vertices\": %u, \"vertex_kb\": %.1f, \"index_kb\": %.1f },\n",
+               (Geometry->VertexFormat == AQMeshVertex_Packed) ? "packed" : "float", Geometry->VertexStride, Geometry->VertexCount,
+               (double)Geometry->VertexCount*Geometry->VertexStride / 1024.0, (double)Geometry->IndexBufferUsed / 1024.0);
+    }
+    if (GlobalProgramCache.IsValid)
+    {
+        printf("  \"program_cache\": { \"hits\": %u, \"misses\": %u, \"rejected\": %u, \"writes\": %u },\n",
+               GlobalProgramCache.Hits, GlobalProgramCache.Misses, GlobalProgramCache.Rejected, GlobalProgramCache.Writes);
+    }
+    if (TextureCache)
+    {
+        printf("  \"texture_cache\": { \"lookups\": %u, \"hits\": %u, \"hit_rate\": %.3f, \"served_mb\": %.2f, \"source_mb_skipped\": %.2f,\n",
+               TextureCache->Lookups, TextureCache->Hits,
+               TextureCache->Lookups ? (double)TextureCache->Hits / TextureCache->Lookups : 0.0,
+               (double)TextureCache->BytesServed / (1024.0*1024.0), (double)TextureCache->SourceBytesSkipped / (1024.0*1024.0));
+        printf("                     \"written_mb\": %.2f, \"evictions\": %u, \"evicted_mb\": %.2f, \"entries\": %u, \"size_mb\": %.2f },\n",
+               (double)TextureCache->BytesWritten / (1024.0*1024.0), TextureCache->Evictions,
+               (double)TextureCache->BytesEvicted / (1024.0*1024.0), TextureCache->EntryCount,
+               (double)TextureCache->TotalSize / (1024.0*1024.0));
+    }
+    printf("  \"memory\": {\n");
+    memory_arena *ReportArenas[] = { &Arenas.Assets, &Arenas.Load, &Arenas.Frame };
+    for (int ArenaIndex = 0; ArenaIndex < ArrayCount(ReportArenas); ++ArenaIndex)
+    {
+        memory_arena *Arena = ReportArenas[ArenaIndex];
+        printf("    \"%s\": { \"size\": %llu, \"used\": %llu, \"high_water\": %llu, \"overflows\": %u }%s\n",
+               Arena->Name, (unsigned long long)Arena->Size, (unsigned long long)Arena->Used,
+               (unsigned long long)Arena->HighWater, Arena->OverflowCount,
+               (ArenaIndex + 1 < ArrayCount(ReportArenas)) ? "," : "");
+    }
+    printf("  },\n");
+    printf("  \"gl_error\": %u\n", Error);
+    printf("}\n");
+
+    free(FrameSeconds);
+    free(CheckDepth);
+
+    eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(Display, OpenGLContext);
+    eglTerminate(Display);
+
+    return (Error == GL_NO_ERROR) ? 0 : 2;
+}
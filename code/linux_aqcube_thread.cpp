@@ -0,0 +1,112 @@
+// Note(joe): Linux implementation of the work queue declared in aqcube.h.
+
+#include <pthread.h>
+#include <semaphore.h>
+
+struct platform_work_queue_entry
+{
+    platform_work_queue_callback *Callback;
+    void *Data;
+};
+
+struct platform_work_queue
+{
+    uint32 volatile CompletionGoal;
+    uint32 volatile CompletionCount;
+
+    uint32 volatile NextEntryToWrite;
+    uint32 volatile NextEntryToRead;
+    sem_t Semaphore;
+
+    platform_work_queue_entry Entries[256];
+};
+
+void AddWorkQueueEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data)
+{
+    // Note(joe): Single producer, so the write index doesn't need to be atomic.
+    uint32 NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+    assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+    platform_work_queue_entry *Entry = Queue->Entries + Queue->NextEntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->CompletionGoal;
+    CompletePreviousWritesBeforeFutureWrites;
+    Queue->NextEntryToWrite = NewNextEntryToWrite;
+    sem_post(&Queue->Semaphore);
+}
+
+bool DoNextWorkQueueEntry(platform_work_queue *Queue)
+{
+    bool Result = false;
+
+    uint32 OriginalNextEntryToRead = Queue->NextEntryToRead;
+    uint32 NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+    if (OriginalNextEntryToRead != Queue->NextEntryToWrite)
+    {
+        uint32 Index = AtomicCompareExchangeUInt32(&Queue->NextEntryToRead, NewNextEntryToRead, OriginalNextEntryToRead);
+        if (Index == OriginalNextEntryToRead)
+        {
+            CompletePreviousReadsBeforeFutureReads;
+            platform_work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Queue, Entry.Data);
+            AtomicAddUInt32(&Queue->CompletionCount, 1);
+        }
+        // Note(joe): Losing the race still counts, there is more to take.
+        Result = true;
+    }
+
+    return Result;
+}
+
+void CompleteAllWork(platform_work_queue *Queue)
+{
+    while (Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        DoNextWorkQueueEntry(Queue);
+    }
+
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+}
+
+static void *LinuxWorkQueueThreadProc(void *Parameter)
+{
+    platform_work_queue *Queue = (platform_work_queue *)Parameter;
+
+    for (;;)
+    {
+        if (!DoNextWorkQueueEntry(Queue))
+        {
+            sem_wait(&Queue->Semaphore);
+        }
+    }
+
+    return 0;
+}
+
+static void LinuxMakeQueue(platform_work_queue *Queue, uint32 ThreadCount)
+{
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+    Queue->NextEntryToWrite = 0;
+    Queue->NextEntryToRead = 0;
+
+    sem_init(&Queue->Semaphore, 0, 0);
+
+    for (uint32 ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        pthread_t Thread;
+        if (pthread_create(&Thread, 0, LinuxWorkQueueThreadProc, Queue) == 0)
+        {
+            pthread_detach(Thread);
+        }
+    }
+}
+
+// Note(joe): Leaves a core for the main thread, which helps out anyway while it waits.
+static uint32 LinuxGetWorkerThreadCount()
+{
+    long ProcessorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32 Result = (ProcessorCount > 1) ? (uint32)ProcessorCount - 1 : 0;
+    return Result;
+}
@@ -0,0 +1,248 @@
+// Note(joe): Win32 implementation of the file services declared in aqcube.h.
+
+void *ReadFile(char *Filename)
+{
+    void *Result = 0;
+
+    HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if (FileHandle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER FileSize;
+        if(GetFileSizeEx(FileHandle, &FileSize) && FileSize.QuadPart <= 0xFFFFFFFF)
+        {
+            // Note(joe): ReadFile can only do 32 bits at a time, bigger files should be mapped.
+            DWORD FileSize32 = (DWORD)FileSize.QuadPart;
+            Result = VirtualAlloc(0, FileSize32, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            if (Result)
+            {
+                DWORD BytesRead = 0;
+                ReadFile(FileHandle, Result, FileSize32, &BytesRead, 0);
+                if (BytesRead == FileSize32)
+                {
+                    // Success
+                }
+                else
+                {
+                    FreeMemory(Result);
+                    Result = 0;
+                }
+            }
+        }
+
+        CloseHandle(FileHandle);
+    }
+
+    return Result;
+}
+
+void FreeMemory(void *Memory)
+{
+    if (Memory)
+    {
+        VirtualFree(Memory, 0, MEM_RELEASE);
+        Memory = 0;
+    }
+}
+
+// Note(joe): PrefetchVirtualMemory only exists on Windows 8 and up so it gets
+// looked up at runtime instead of linked.
+struct win32_memory_range_entry
+{
+    void *VirtualAddress;
+    SIZE_T NumberOfBytes;
+};
+typedef BOOL WINAPI prefetch_virtual_memory(HANDLE Process, ULONG_PTR NumberOfEntries, win32_memory_range_entry *VirtualAddresses, ULONG Flags);
+
+static prefetch_virtual_memory *Win32PrefetchVirtualMemory_;
+static bool Win32PrefetchVirtualMemoryLoaded;
+
+mapped_file MapFile(char *Filename, file_access_hint Hint)
+{
+    mapped_file Result = {};
+
+    DWORD Flags = FILE_ATTRIBUTE_NORMAL;
+    if (Hint == FileAccess_Sequential)
+    {
+        Flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    else if (Hint == FileAccess_Random)
+    {
+        Flags |= FILE_FLAG_RANDOM_ACCESS;
+    }
+
+    HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, Flags, 0);
+    if (FileHandle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER FileSize;
+        // Note(joe): Empty files can't be mapped, they come back as a null view.
+        if (GetFileSizeEx(FileHandle, &FileSize) && FileSize.QuadPart > 0)
+        {
+            HANDLE Mapping = CreateFileMappingA(FileHandle, 0, PAGE_READONLY, 0, 0, 0);
+            if (Mapping)
+            {
+                Result.Memory = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+                if (Result.Memory)
+                {
+                    Result.Size = (uint64)FileSize.QuadPart;
+                }
+
+                // Note(joe): The view keeps the section alive on its own.
+                CloseHandle(Mapping);
+            }
+        }
+
+        CloseHandle(FileHandle);
+    }
+
+    if (Result.Memory && Hint == FileAccess_WillNeed)
+    {
+        AdviseMappedFile(&Result, 0, Result.Size, Hint);
+    }
+
+    return Result;
+}
+
+void AdviseMappedFile(mapped_file *File, uint64 Offset, uint64 Size, file_access_hint Hint)
+{
+    if (File->Memory && Offset < File->Size)
+    {
+        if (Size > File->Size - Offset)
+        {
+            Size = File->Size - Offset;
+        }
+
+        win32_memory_range_entry Range;
+        Range.VirtualAddress = (uint8 *)File->Memory + Offset;
+        Range.NumberOfBytes = (SIZE_T)Size;
+
+        switch (Hint)
+        {
+            case FileAccess_WillNeed:
+            {
+                if (!Win32PrefetchVirtualMemoryLoaded)
+                {
+                    HMODULE Kernel = GetModuleHandleA("kernel32.dll");
+                    Win32PrefetchVirtualMemory_ = (prefetch_virtual_memory *)GetProcAddress(Kernel, "PrefetchVirtualMemory");
+                    Win32PrefetchVirtualMemoryLoaded = true;
+                }
+                if (Win32PrefetchVirtualMemory_)
+                {
+                    Win32PrefetchVirtualMemory_(GetCurrentProcess(), 1, &Range, 0);
+                }
+            } break;
+            case FileAccess_DontNeed:
+            {
+                // Note(joe): Unlocking pages that were never locked just trims them
+                // from the working set, they stay in the file cache.
+                VirtualUnlock(Range.VirtualAddress, Range.NumberOfBytes);
+            } break;
+            default:
+            {
+                // Note(joe): Sequential/Random can only be given to CreateFile on Win32.
+            } break;
+        }
+    }
+}
+
+void UnmapFile(mapped_file *File)
+{
+    if (File->Memory)
+    {
+        UnmapViewOfFile(File->Memory);
+    }
+    File->Memory = 0;
+    File->Size = 0;
+}
+
+static uint32 volatile GlobalTempFileCounter;
+
+write_file BeginWriteFile(char *Filename)
+{
+    write_file Result = {};
+
+    // Note(joe): Two threads can be writing the same file, so each gets its own
+    // temporary and the last rename wins.
+    uint32 Counter = AtomicAddUInt32(&GlobalTempFileCounter, 1);
+    _snprintf_s(Result.FileName, sizeof(Result.FileName), _TRUNCATE, "%s", Filename);
+    _snprintf_s(Result.TempFileName, sizeof(Result.TempFileName), _TRUNCATE, "%s.%u.%u.tmp",
+                Filename, GetCurrentProcessId(), Counter);
+
+    HANDLE FileHandle = CreateFileA(Result.TempFileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    Result.Handle = (intptr_t)FileHandle;
+    Result.NoErrors = (FileHandle != INVALID_HANDLE_VALUE) && (strlen(Filename) < sizeof(Result.FileName));
+
+    return Result;
+}
+
+void WriteToFile(write_file *File, void *Memory, uint64 Size)
+{
+    uint64 BytesWritten = 0;
+    while (File->NoErrors && BytesWritten < Size)
+    {
+        // Note(joe): WriteFile can only do 32 bits at a time too.
+        uint64 Remaining = Size - BytesWritten;
+        DWORD Count = (Remaining > 0x40000000) ? 0x40000000 : (DWORD)Remaining;
+        DWORD Written = 0;
+        if (WriteFile((HANDLE)File->Handle, (uint8 *)Memory + BytesWritten, Count, &Written, 0) && Written)
+        {
+            BytesWritten += Written;
+        }
+        else
+        {
+            File->NoErrors = false;
+        }
+    }
+}
+
+bool EndWriteFile(write_file *File)
+{
+    bool Result = false;
+
+    if ((HANDLE)File->Handle != INVALID_HANDLE_VALUE)
+    {
+        bool Closed = (CloseHandle((HANDLE)File->Handle) != 0);
+        if (File->NoErrors && Closed && MoveFileExA(File->TempFileName, File->FileName, MOVEFILE_REPLACE_EXISTING))
+        {
+            Result = true;
+        }
+        else
+        {
+            DeleteFileA(File->TempFileName);
+        }
+    }
+    File->Handle = (intptr_t)INVALID_HANDLE_VALUE;
+
+    return Result;
+}
+
+bool RemoveFile(char *Filename)
+{
+    bool Result = (DeleteFileA(Filename) != 0);
+    return Result;
+}
+
+bool MakeDirectory(char *Path)
+{
+    char Partial[MAX_PATH];
+    size_t Length = strlen(Path);
+    if (Length == 0 || Length >= sizeof(Partial))
+    {
+        return false;
+    }
+
+    memcpy(Partial, Path, Length + 1);
+    for (size_t Index = 1; Index <= Length; ++Index)
+    {
+        if (Partial[Index] == '/' || Partial[Index] == '\\' || Partial[Index] == 0)
+        {
+            char Separator = Partial[Index];
+            Partial[Index] = 0;
+            CreateDirectoryA(Partial, 0);
+            Partial[Index] = Separator;
+        }
+    }
+
+    DWORD Attributes = GetFileAttributesA(Path);
+    bool Result = (Attributes != INVALID_FILE_ATTRIBUTES) && (Attributes & FILE_ATTRIBUTE_DIRECTORY);
+    return Result;
+}
@@ -1,3 +1,4 @@
+#ifdef _WIN32
 static HGLRC Win32InitializeOpenGL(HDC DeviceContext)
 {
     HGLRC Result = 0;
@@ -20,72 +21,1041 @@ static HGLRC Win32InitializeOpenGL(HDC DeviceContext)
 
     return Result;
 }
+#endif
 
-GLuint Win32CompileShader(GLenum ShaderType, char *ShaderFile)
+//
+// GL state cache
+//
+// Note(joe): Binds, enables and the viewport go through these instead of straight to
+// GL. They shadow what's bound in GlobalGLState and drop the calls that wouldn't
+// change anything, so code binds what it needs and never has to unbind after itself.
+// Anything that changes this state has to come through here as well (deletes
+// included), or call Win32ResetGLState afterwards. Element array buffers belong to the
+// bound VAO, so those binds aren't shadowed and always go through.
+//
+
+// Note(joe): True if the call has to go to the driver, the shadow is updated already.
+inline bool Win32UpdateShadow(GLuint *Shadow, GLuint Value)
 {
-    GLuint Shader = 0;
+    bool Result = (*Shadow != Value);
+    if (Result)
+    {
+        *Shadow = Value;
+        ++GlobalRenderStats.StateCalls;
+    }
+    else
+    {
+        ++GlobalRenderStats.FilteredStateCalls;
+    }
+    return Result;
+}
 
-    const GLchar *ShaderSource = (GLchar *)ReadFile(ShaderFile);
-    if (ShaderSource)
+inline void Win32UseProgram(GLuint Program)
+{
+    if (Win32UpdateShadow(&GlobalGLState.Program, Program))
     {
-        Shader = glCreateShader(ShaderType);
-        glShaderSource(Shader, 1, &ShaderSource, 0);
-        glCompileShader(Shader);
+        glUseProgram(Program);
+        ++GlobalRenderStats.ProgramBinds;
+    }
+}
 
-        GLint CompileStatus;
-        glGetShaderiv(Shader, GL_COMPILE_STATUS, &CompileStatus);
+inline void Win32BindVertexArray(GLuint VertexArray)
+{
+    if (Win32UpdateShadow(&GlobalGLState.VertexArray, VertexArray))
+    {
+        glBindVertexArray(VertexArray);
+        ++GlobalRenderStats.VertexArrayBinds;
+    }
+}
 
-        if (CompileStatus == GL_TRUE)
+inline void Win32BindBuffer(GLenum Target, GLuint Buffer)
+{
+    GLuint *Shadow = 0;
+    switch (Target)
+    {
+        case GL_ARRAY_BUFFER: { Shadow = &GlobalGLState.ArrayBuffer; } break;
+        case GL_UNIFORM_BUFFER: { Shadow = &GlobalGLState.UniformBuffer; } break;
+        case GL_DRAW_INDIRECT_BUFFER: { Shadow = &GlobalGLState.DrawIndirectBuffer; } break;
+    }
+
+    if (!Shadow)
+    {
+        glBindBuffer(Target, Buffer);
+        ++GlobalRenderStats.StateCalls;
+        ++GlobalRenderStats.BufferCalls;
+    }
+    else if (Win32UpdateShadow(Shadow, Buffer))
+    {
+        glBindBuffer(Target, Buffer);
+        ++GlobalRenderStats.BufferCalls;
+    }
+}
+
+// Note(joe): Like GL, this binds the generic GL_UNIFORM_BUFFER point as well. Only
+// uniform buffers have indexed bindings here.
+inline void Win32BindBufferRange(GLenum Target, GLuint Index, GLuint Buffer, GLintptr Offset, GLsizeiptr Size)
+{
+    assert((Target == GL_UNIFORM_BUFFER) && (Index < GL_STATE_MAX_UNIFORM_BINDINGS));
+
+    gl_buffer_range *Range = GlobalGLState.UniformRanges + Index;
+    if ((Range->Buffer != Buffer) || (Range->Offset != Offset) || (Range->Size != Size))
+    {
+        glBindBufferRange(Target, Index, Buffer, Offset, Size);
+        Range->Buffer = Buffer;
+        Range->Offset = Offset;
+        Range->Size = Size;
+        GlobalGLState.UniformBuffer = Buffer;
+        ++GlobalRenderStats.StateCalls;
+        ++GlobalRenderStats.BufferCalls;
+    }
+    else
+    {
+        ++GlobalRenderStats.FilteredStateCalls;
+    }
+}
+
+// Note(joe): The whole buffer, recorded as a range with no size.
+inline void Win32BindBufferBase(GLenum Target, GLuint Index, GLuint Buffer)
+{
+    assert((Target == GL_UNIFORM_BUFFER) && (Index < GL_STATE_MAX_UNIFORM_BINDINGS));
+
+    gl_buffer_range *Range = GlobalGLState.UniformRanges + Index;
+    if ((Range->Buffer != Buffer) || (Range->Offset != 0) || (Range->Size != 0))
+    {
+        glBindBufferBase(Target, Index, Buffer);
+        Range->Buffer = Buffer;
+        Range->Offset = 0;
+        Range->Size = 0;
+        GlobalGLState.UniformBuffer = Buffer;
+        ++GlobalRenderStats.StateCalls;
+        ++GlobalRenderStats.BufferCalls;
+    }
+    else
+    {
+        ++GlobalRenderStats.FilteredStateCalls;
+    }
+}
+
+inline void Win32ActiveTexture(GLuint Unit)
+{
+    if (Win32UpdateShadow(&GlobalGLState.ActiveTexture, Unit))
+    {
+        glActiveTexture(GL_TEXTURE0 + Unit);
+    }
+}
+
+// Note(joe): Only switches the active unit when the bind really happens.
+inline void Win32BindTexture(GLuint Unit, GLuint Texture)
+{
+    assert(Unit < GL_STATE_MAX_TEXTURE_UNITS);
+
+    if (GlobalGLState.Textures[Unit] != Texture)
+    {
+        Win32ActiveTexture(Unit);
+        glBindTexture(GL_TEXTURE_2D, Texture);
+        GlobalGLState.Textures[Unit] = Texture;
+        ++GlobalRenderStats.StateCalls;
+        ++GlobalRenderStats.TextureBinds;
+    }
+    else
+    {
+        ++GlobalRenderStats.FilteredStateCalls;
+    }
+}
+
+// Note(joe): GL unbinds a deleted texture from every unit, so the shadow has to as well
+// or a recycled name would look like it's still bound.
+static void Win32DeleteTextures(GLsizei Count, GLuint *Textures)
+{
+    glDeleteTextures(Count, Textures);
+    for (GLsizei TextureIndex = 0; TextureIndex < Count; ++TextureIndex)
+    {
+        for (GLuint Unit = 0; Unit < GL_STATE_MAX_TEXTURE_UNITS; ++Unit)
+        {
+            if (GlobalGLState.Textures[Unit] == Textures[TextureIndex])
+            {
+                GlobalGLState.Textures[Unit] = 0;
+            }
+        }
+    }
+}
+
+// Note(joe): The capabilities the cache knows about, anything else always goes through.
+inline GLuint Win32GetCapBit(GLenum Cap)
+{
+    GLuint Result = 0;
+    switch (Cap)
+    {
+        case GL_DEPTH_TEST: { Result = (1 << 0); } break;
+        case GL_CULL_FACE: { Result = (1 << 1); } break;
+        case GL_BLEND: { Result = (1 << 2); } break;
+        case GL_SCISSOR_TEST: { Result = (1 << 3); } break;
+        case GL_STENCIL_TEST: { Result = (1 << 4); } break;
+    }
+    return Result;
+}
+
+inline void Win32SetCap(GLenum Cap, bool Enable)
+{
+    GLuint Bit = Win32GetCapBit(Cap);
+    bool Known = (GlobalGLState.KnownCaps & Bit) != 0;
+    bool Enabled = (GlobalGLState.EnabledCaps & Bit) != 0;
+    if (!Bit || !Known || (Enabled != Enable))
+    {
+        if (Enable)
         {
-            char Log[512];
-            glGetShaderInfoLog(Shader, 512, 0, Log);
-            OutputDebugStringA(Log);
+            glEnable(Cap);
+            GlobalGLState.EnabledCaps |= Bit;
         }
+        else
+        {
+            glDisable(Cap);
+            GlobalGLState.EnabledCaps &= ~Bit;
+        }
+        GlobalGLState.KnownCaps |= Bit;
+        ++GlobalRenderStats.StateCalls;
+    }
+    else
+    {
+        ++GlobalRenderStats.FilteredStateCalls;
+    }
+}
+
+inline void Win32Enable(GLenum Cap)
+{
+    Win32SetCap(Cap, true);
+}
+
+inline void Win32Disable(GLenum Cap)
+{
+    Win32SetCap(Cap, false);
+}
+
+inline void Win32Viewport(GLint X, GLint Y, GLsizei Width, GLsizei Height)
+{
+    GLint *Viewport = GlobalGLState.Viewport;
+    if ((Viewport[0] != X) || (Viewport[1] != Y) || (Viewport[2] != Width) || (Viewport[3] != Height))
+    {
+        glViewport(X, Y, Width, Height);
+        Viewport[0] = X;
+        Viewport[1] = Y;
+        Viewport[2] = Width;
+        Viewport[3] = Height;
+        ++GlobalRenderStats.StateCalls;
+    }
+    else
+    {
+        ++GlobalRenderStats.FilteredStateCalls;
+    }
+}
+
+// Note(joe): Defines (a block of "#define NAME VALUE\n" lines, or 0) go right after
+// the #version line, which has to stay first.
+static GLuint Win32CompileShaderSource(GLenum ShaderType, char *Source, GLint SourceLength, char *Defines)
+{
+    TIMED_FUNCTION();
+
+    const GLchar *Strings[3];
+    GLint Lengths[3];
+    GLsizei StringCount = 0;
+
+    GLint VersionLength = 0;
+    if (Defines && SourceLength > 8 && strncmp(Source, "#version", 8) == 0)
+    {
+        while (VersionLength < SourceLength && Source[VersionLength++] != '\n') {}
+        Strings[StringCount] = Source;
+        Lengths[StringCount++] = VersionLength;
+    }
+    if (Defines)
+    {
+        Strings[StringCount] = Defines;
+        Lengths[StringCount++] = (GLint)strlen(Defines);
+    }
+    Strings[StringCount] = Source + VersionLength;
+    Lengths[StringCount++] = SourceLength - VersionLength;
+
+    GLuint Shader = glCreateShader(ShaderType);
+    glShaderSource(Shader, StringCount, Strings, Lengths);
+    glCompileShader(Shader);
+
+    GLint CompileStatus;
+    glGetShaderiv(Shader, GL_COMPILE_STATUS, &CompileStatus);
+    if (CompileStatus != GL_TRUE)
+    {
+        char Log[512];
+        glGetShaderInfoLog(Shader, 512, 0, Log);
+        OutputDebugStringA(Log);
+    }
+
+    return Shader;
+}
+
+GLuint Win32CompileShader(GLenum ShaderType, char *ShaderFile)
+{
+    GLuint Shader = 0;
+
+    // Note(joe): The mapped view isn't null terminated so the length has to be passed along.
+    mapped_file SourceFile = MapFile(ShaderFile, FileAccess_Sequential);
+    if (SourceFile.Memory)
+    {
+        Shader = Win32CompileShaderSource(ShaderType, (char *)SourceFile.Memory, (GLint)SourceFile.Size, 0);
+        UnmapFile(&SourceFile);
     }
 
     assert(Shader);
     return Shader;
 }
 
+static GLuint Win32LinkProgram(GLuint ShaderProgram, GLuint *Shaders, int ShaderCount)
+{
+    TIMED_FUNCTION();
+
+    for (int ShaderIndex = 0; ShaderIndex < ShaderCount; ++ShaderIndex)
+    {
+        GLuint Shader = Shaders[ShaderIndex];
+        glAttachShader(ShaderProgram, Shader);
+    }
+    glLinkProgram(ShaderProgram);
+
+    GLint Success;
+    glGetProgramiv(ShaderProgram, GL_LINK_STATUS, &Success);
+    if (!Success)
+    {
+        char Log[512];
+        glGetProgramInfoLog(ShaderProgram, 512, NULL, Log);
+        OutputDebugStringA(Log);
+    }
+
+    for (int ShaderIndex = 0; ShaderIndex < ShaderCount; ++ShaderIndex)
+    {
+        GLuint Shader = Shaders[ShaderIndex];
+        glDeleteShader(Shader);
+    }
+
+    return ShaderProgram;
+}
+
 GLuint Win32CreateProgram(GLuint *Shaders, int ShaderCount)
 {
     GLuint ShaderProgram = glCreateProgram();
 
     if (ShaderProgram)
     {
-        for (int ShaderIndex = 0; ShaderIndex < ShaderCount; ++ShaderIndex)
+        Win32LinkProgram(ShaderProgram, Shaders, ShaderCount);
+    }
+
+    return ShaderProgram;
+}
+
+//
+// Program binary cache
+//
+// Note(joe): A blob per program, <Directory>/<key>.bin, holding program_cache_blob
+// and then whatever glGetProgramBinary gave back. The key covers the sources, the
+// defines and the driver strings, so a driver update just misses. Drivers can
+// still refuse a binary they wrote themselves (say after a settings change), then
+// it's compiled again and the blob rewritten.
+//
+
+#define PROGRAM_CACHE_MAGIC (((uint32)'A' << 0) | ((uint32)'Q' << 8) | ((uint32)'P' << 16) | ((uint32)'B' << 24))
+#define PROGRAM_CACHE_VERSION 1
+#define MAX_PROGRAM_SHADERS 4
+
+struct program_cache_blob
+{
+    uint32 Magic;
+    uint32 Version;
+    uint64 Key;
+    uint32 BinaryFormat;
+    uint32 BinarySize;
+};
+
+// Note(joe): Off until the host calls InitProgramCache.
+struct program_cache
+{
+    bool IsValid;
+    char Directory[200];
+    uint64 DriverKey;
+
+    uint32 Hits;
+    uint32 Misses;
+    uint32 Rejected; // Found, but the driver wouldn't take it back. Also counted as a miss.
+    uint32 Writes;
+};
+static program_cache GlobalProgramCache;
+
+struct shader_file
+{
+    GLenum Type;
+    char *FileName;
+};
+
+// Note(joe): Needs a current context, it checks the driver can hand binaries back.
+static void InitProgramCache(char *Directory)
+{
+    program_cache *Cache = &GlobalProgramCache;
+    *Cache = {};
+
+    GLint BinaryFormatCount = 0;
+    if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &BinaryFormatCount);
+    }
+
+    if (BinaryFormatCount > 0 && MakeDirectory(Directory))
+    {
+        sprintf_s(Cache->Directory, sizeof(Cache->Directory), "%s", Directory);
+
+        GLenum DriverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int StringIndex = 0; StringIndex < ArrayCount(DriverStrings); ++StringIndex)
+        {
+            const char *String = (const char *)glGetString(DriverStrings[StringIndex]);
+            if (String)
+            {
+                Cache->DriverKey = HashBytes((void *)String, strlen(String), Cache->DriverKey);
+            }
+        }
+        Cache->IsValid = true;
+    }
+}
+
+static bool Win32LoadCachedProgram(GLuint Program, uint64 Key, char *FileName)
+{
+    TIMED_FUNCTION();
+
+    bool Result = false;
+
+    mapped_file File = MapFile(FileName, FileAccess_Sequential);
+    program_cache_blob *Header = (program_cache_blob *)File.Memory;
+    if (Header && File.Size >= sizeof(program_cache_blob) &&
+        Header->Magic == PROGRAM_CACHE_MAGIC && Header->Version == PROGRAM_CACHE_VERSION &&
+        Header->Key == Key && File.Size == sizeof(program_cache_blob) + Header->BinarySize)
+    {
+        glProgramBinary(Program, Header->BinaryFormat, Header + 1, (GLsizei)Header->BinarySize);
+
+        GLint Success = GL_FALSE;
+        glGetProgramiv(Program, GL_LINK_STATUS, &Success);
+        Result = (Success == GL_TRUE);
+        if (!Result)
+        {
+            ++GlobalProgramCache.Rejected;
+        }
+    }
+    UnmapFile(&File);
+
+    return Result;
+}
+
+static void Win32WriteCachedProgram(memory_arena *TempArena, GLuint Program, uint64 Key, char *FileName)
+{
+    TIMED_FUNCTION();
+
+    GLint BinaryLength = 0;
+    glGetProgramiv(Program, GL_PROGRAM_BINARY_LENGTH, &BinaryLength);
+    if (BinaryLength <= 0)
+    {
+        return;
+    }
+
+    temporary_memory BinaryMemory = BeginTemporaryMemory(TempArena);
+    void *Binary = PushSize(TempArena, (uint64)BinaryLength);
+    if (Binary)
+    {
+        program_cache_blob Header = {};
+        Header.Magic = PROGRAM_CACHE_MAGIC;
+        Header.Version = PROGRAM_CACHE_VERSION;
+        Header.Key = Key;
+
+        GLenum BinaryFormat = 0;
+        GLsizei Length = 0;
+        glGetProgramBinary(Program, BinaryLength, &Length, &BinaryFormat, Binary);
+        Header.BinaryFormat = BinaryFormat;
+        Header.BinarySize = (uint32)Length;
+
+        write_file File = BeginWriteFile(FileName);
+        WriteToFile(&File, &Header, sizeof(Header));
+        WriteToFile(&File, Binary, (uint64)Length);
+        if (Length > 0 && EndWriteFile(&File))
+        {
+            ++GlobalProgramCache.Writes;
+        }
+    }
+    EndTemporaryMemory(BinaryMemory);
+}
+
+static void ReportProgramCache()
+{
+    program_cache *Cache = &GlobalProgramCache;
+    char Report[200];
+    if (Cache->IsValid)
+    {
+        sprintf_s(Report, sizeof(Report), "Program cache: %u hits, %u misses (%u rejected by the driver), %u written\n",
+                  Cache->Hits, Cache->Misses, Cache->Rejected, Cache->Writes);
+    }
+    else
+    {
+        sprintf_s(Report, sizeof(Report), "Program cache: off\n");
+    }
+    OutputDebugStringA(Report);
+}
+
+// Note(joe): Compiles and links the shader files into a program, or pulls the linked
+// program out of GlobalProgramCache when it's been built before. TempArena is only
+// used for the duration of the call.
+GLuint Win32LoadProgram(memory_arena *TempArena, shader_file *Files, int FileCount, char *Defines = 0)
+{
+    TIMED_FUNCTION();
+
+    assert(FileCount <= MAX_PROGRAM_SHADERS);
+
+    mapped_file Sources[MAX_PROGRAM_SHADERS];
+    uint64 Key = GlobalProgramCache.DriverKey;
+    for (int FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+    {
+        Sources[FileIndex] = MapFile(Files[FileIndex].FileName, FileAccess_Sequential);
+        Key = HashBytes(&Files[FileIndex].Type, sizeof(GLenum), Key);
+        Key = HashBytes(Sources[FileIndex].Memory, Sources[FileIndex].Size, Key);
+    }
+    if (Defines)
+    {
+        Key = HashBytes(Defines, strlen(Defines), Key);
+    }
+
+    char CacheFileName[256];
+    sprintf_s(CacheFileName, sizeof(CacheFileName), "%s/%016llx.bin", GlobalProgramCache.Directory, (unsigned long long)Key);
+
+    GLuint Program = glCreateProgram();
+    if (GlobalProgramCache.IsValid && Win32LoadCachedProgram(Program, Key, CacheFileName))
+    {
+        ++GlobalProgramCache.Hits;
+    }
+    else
+    {
+        // Note(joe): A program that failed to load a binary can't be trusted to link
+        // cleanly afterwards on every driver, so start from a fresh one.
+        if (GlobalProgramCache.IsValid)
         {
-            GLuint Shader = Shaders[ShaderIndex];
-            glAttachShader(ShaderProgram, Shader);
+            ++GlobalProgramCache.Misses;
+            glDeleteProgram(Program);
+            Program = glCreateProgram();
+            glProgramParameteri(Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         }
-        glLinkProgram(ShaderProgram);
 
-        GLint Success;
-        glGetProgramiv(ShaderProgram, GL_LINK_STATUS, &Success);
-        if (!Success)
+        GLuint Shaders[MAX_PROGRAM_SHADERS];
+        for (int FileIndex = 0; FileIndex < FileCount; ++FileIndex)
         {
-            char Log[512];
-            glGetProgramInfoLog(ShaderProgram, 512, NULL, Log);
-            OutputDebugStringA(Log);
+            Shaders[FileIndex] = 0;
+            if (Sources[FileIndex].Memory)
+            {
+                Shaders[FileIndex] = Win32CompileShaderSource(Files[FileIndex].Type, (char *)Sources[FileIndex].Memory,
+                                                              (GLint)Sources[FileIndex].Size, Defines);
+            }
+            assert(Shaders[FileIndex]);
         }
+        Win32LinkProgram(Program, Shaders, FileCount);
 
-        for (int ShaderIndex = 0; ShaderIndex < ShaderCount; ++ShaderIndex)
+        GLint Success = GL_FALSE;
+        glGetProgramiv(Program, GL_LINK_STATUS, &Success);
+        if (GlobalProgramCache.IsValid && Success == GL_TRUE)
         {
-            GLuint Shader = Shaders[ShaderIndex];
-            glDeleteShader(Shader);
+            Win32WriteCachedProgram(TempArena, Program, Key, CacheFileName);
         }
     }
 
-    return ShaderProgram;
+    for (int FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+    {
+        UnmapFile(&Sources[FileIndex]);
+    }
+
+    return Program;
 }
 
-// TODO(joe): Make it possible for the loaded_image to know the Source Pixel Format?
-GLuint Win32CreateTexture(loaded_image Image, GLint SourcePixelFormat)
+//
+// Uniform blocks
+//
+// Note(joe): Data every program wants lives in std140 blocks on fixed binding points
+// instead of loose uniforms. Camera is written once a frame and Lights whenever the
+// scene's lights change, per-draw transforms come from the instance buffer. Programs
+// get their blocks hooked up to these bindings by Win32ReflectProgram. The C++
+// structs mirror the GLSL std140 layout, so vec3s are padded out to vec4s.
+// Win32InitUniformBlocks goes first, Win32ReflectProgram checks each block against
+// the size of the buffer on its binding.
+//
+
+enum uniform_block_binding
 {
-    GLuint Texture;
-    glGenTextures(1, &Texture);
-    //glActiveTexture(TextureUnit);
-    glBindTexture(GL_TEXTURE_2D, Texture);
+    UniformBlock_Camera,
+    UniformBlock_Lights,
+
+    UniformBlock_Count,
+};
+
+static char *UniformBlockNames[UniformBlock_Count] = { "Camera", "Lights" };
+static GLsizeiptr UniformBlockSizes[UniformBlock_Count]; // 0 until the scene creates the buffer.
+
+struct camera_block
+{
+    glm::mat4 View;
+    glm::mat4 Projection;
+    glm::vec4 ViewPos;
+};
+
+struct uniform_blocks
+{
+    GLuint Camera;
+    GLuint Lights;
+};
+
+static GLuint Win32CreateUniformBuffer(GLuint Binding, GLsizeiptr Size)
+{
+    GLuint Buffer;
+    glGenBuffers(1, &Buffer);
+    Win32BindBuffer(GL_UNIFORM_BUFFER, Buffer);
+    glBufferData(GL_UNIFORM_BUFFER, Size, 0, GL_DYNAMIC_DRAW);
+    Win32BindBufferBase(GL_UNIFORM_BUFFER, Binding, Buffer);
+    return Buffer;
+}
+
+static void Win32UpdateUniformBuffer(GLuint Buffer, void *Data, GLsizeiptr Size)
+{
+    TIMED_FUNCTION();
+
+    Win32BindBuffer(GL_UNIFORM_BUFFER, Buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, Size, Data);
+    ++GlobalRenderStats.BufferCalls;
+}
+
+static void Win32InitUniformBlocks(uniform_blocks *Blocks, GLsizeiptr LightsSize)
+{
+    Blocks->Camera = Win32CreateUniformBuffer(UniformBlock_Camera, sizeof(camera_block));
+    UniformBlockSizes[UniformBlock_Camera] = sizeof(camera_block);
+    if (LightsSize)
+    {
+        Blocks->Lights = Win32CreateUniformBuffer(UniformBlock_Lights, LightsSize);
+    }
+    UniformBlockSizes[UniformBlock_Lights] = LightsSize;
+}
+
+inline void Win32SetCameraBlock(uniform_blocks *Blocks, glm::mat4 &View, glm::mat4 &Projection, glm::vec3 ViewPos)
+{
+    camera_block Camera;
+    Camera.View = View;
+    Camera.Projection = Projection;
+    Camera.ViewPos = glm::vec4(ViewPos, 1.0f);
+    Win32UpdateUniformBuffer(Blocks->Camera, &Camera, sizeof(Camera));
+}
+
+//
+// Instancing
+//
+// Note(joe): Per-instance transforms stream through one vertex buffer as a mat4
+// attribute, four vec4 slots with a divisor of one. The buffer is orphaned at the
+// start of every frame so the driver can hand back fresh storage rather than wait
+// on last frame's draws, then batches are appended to it. However many instances a
+// batch has it's one draw call.
+//
+
+#define INSTANCE_TRANSFORM_LOCATION 3
+
+struct instance_buffer
+{
+    GLuint Buffer;
+    uint32 MaxInstances; // Per frame.
+    uint32 InstanceCount;
+};
+
+static void Win32InitInstanceBuffer(instance_buffer *Instances, uint32 MaxInstances)
+{
+    Instances->MaxInstances = MaxInstances;
+    Instances->InstanceCount = 0;
+    glGenBuffers(1, &Instances->Buffer);
+    Win32BindBuffer(GL_ARRAY_BUFFER, Instances->Buffer);
+    glBufferData(GL_ARRAY_BUFFER, MaxInstances*sizeof(glm::mat4), 0, GL_STREAM_DRAW);
+}
+
+// Note(joe): Call with the VAO that's going to be drawn instanced bound.
+static void Win32EnableInstanceAttributes()
+{
+    for (GLuint Column = 0; Column < 4; ++Column)
+    {
+        glEnableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION + Column);
+        glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION + Column, 1);
+    }
+}
+
+static void Win32BeginInstances(instance_buffer *Instances)
+{
+    Win32BindBuffer(GL_ARRAY_BUFFER, Instances->Buffer);
+    glBufferData(GL_ARRAY_BUFFER, Instances->MaxInstances*sizeof(glm::mat4), 0, GL_STREAM_DRAW);
+    ++GlobalRenderStats.BufferCalls;
+    Instances->InstanceCount = 0;
+}
+
+// Note(joe): Returns the index of the first transform, hand it to the draw.
+static uint32 Win32PushInstances(instance_buffer *Instances, glm::mat4 *Transforms, uint32 Count)
+{
+    TIMED_FUNCTION();
+
+    assert(Instances->InstanceCount + Count <= Instances->MaxInstances);
+
+    uint32 FirstInstance = Instances->InstanceCount;
+    Win32BindBuffer(GL_ARRAY_BUFFER, Instances->Buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, FirstInstance*sizeof(glm::mat4), Count*sizeof(glm::mat4), Transforms);
+    ++GlobalRenderStats.BufferCalls;
+    Instances->InstanceCount += Count;
+
+    return FirstInstance;
+}
+
+// Note(joe): GL 3.3 has no base instance, so the attributes get pointed at the batch
+// instead. The VAO has to be bound.
+static void Win32BindInstances(instance_buffer *Instances, uint32 FirstInstance)
+{
+    uint8 *Base = (uint8 *)0 + FirstInstance*sizeof(glm::mat4);
+    Win32BindBuffer(GL_ARRAY_BUFFER, Instances->Buffer);
+    for (GLuint Column = 0; Column < 4; ++Column)
+    {
+        glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION + Column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              Base + Column*sizeof(glm::vec4));
+    }
+}
+
+static void Win32DrawArraysInstanced(instance_buffer *Instances, uint32 FirstInstance, uint32 InstanceCount,
+                                     GLenum Mode, GLint First, GLsizei VertexCount)
+{
+    Win32BindInstances(Instances, FirstInstance);
+    glDrawArraysInstanced(Mode, First, VertexCount, InstanceCount);
+    ++GlobalRenderStats.DrawCalls;
+    if (Mode == GL_TRIANGLES)
+    {
+        GlobalRenderStats.Triangles += (VertexCount / 3)*InstanceCount;
+    }
+}
+
+//
+// Multi-draw indirect
+//
+// Note(joe): Indexed draws that share a VAO, program and textures go to the driver as
+// one glMultiDrawElementsIndirect. The frame's commands are uploaded in one go into a
+// buffer that's orphaned every frame like the instance buffer, and each command's
+// baseInstance picks its transform out of the instance buffer. Without 4.3 the same
+// commands are issued one at a time from the CPU copy.
+//
+
+struct draw_elements_indirect_command
+{
+    GLuint Count;
+    GLuint InstanceCount;
+    GLuint FirstIndex;
+    GLint BaseVertex;
+    GLuint BaseInstance;
+};
+
+struct indirect_buffer
+{
+    GLuint Buffer;
+    uint32 MaxCommands; // Per frame.
+    uint32 CommandCount;
+    draw_elements_indirect_command *Commands; // This frame's, the fallback draws from these.
+};
+
+static void Win32InitIndirectBuffer(indirect_buffer *Indirect, uint32 MaxCommands)
+{
+    Indirect->MaxCommands = MaxCommands;
+    Indirect->CommandCount = 0;
+    Indirect->Commands = 0;
+    if (GlobalHasMultiDrawIndirect)
+    {
+        glGenBuffers(1, &Indirect->Buffer);
+        Win32BindBuffer(GL_DRAW_INDIRECT_BUFFER, Indirect->Buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, MaxCommands*sizeof(draw_elements_indirect_command), 0, GL_STREAM_DRAW);
+    }
+}
+
+// Note(joe): Commands has to stay around until the frame's draws have been issued.
+static void Win32UploadIndirectCommands(indirect_buffer *Indirect, draw_elements_indirect_command *Commands, uint32 Count)
+{
+    TIMED_FUNCTION();
+
+    assert(Count <= Indirect->MaxCommands);
+    Indirect->Commands = Commands;
+    Indirect->CommandCount = Count;
+    if (GlobalHasMultiDrawIndirect && Count)
+    {
+        Win32BindBuffer(GL_DRAW_INDIRECT_BUFFER, Indirect->Buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, Indirect->MaxCommands*sizeof(draw_elements_indirect_command), 0, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, Count*sizeof(draw_elements_indirect_command), Commands);
+        GlobalRenderStats.BufferCalls += 2;
+    }
+}
+
+// Note(joe): The VAO has to be bound and have its instance attributes enabled.
+static void Win32MultiDrawElementsIndirect(indirect_buffer *Indirect, instance_buffer *Instances, GLenum IndexType,
+                                           uint32 FirstCommand, uint32 CommandCount)
+{
+    assert(FirstCommand + CommandCount <= Indirect->CommandCount);
+    for (uint32 CommandIndex = FirstCommand; CommandIndex < FirstCommand + CommandCount; ++CommandIndex)
+    {
+        draw_elements_indirect_command *Command = Indirect->Commands + CommandIndex;
+        GlobalRenderStats.Triangles += (Command->Count / 3)*Command->InstanceCount;
+    }
+
+    if (GlobalHasMultiDrawIndirect)
+    {
+        // Note(joe): baseInstance does the offsetting, so the attributes start at zero.
+        Win32BindInstances(Instances, 0);
+        Win32BindBuffer(GL_DRAW_INDIRECT_BUFFER, Indirect->Buffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, IndexType, (GLvoid *)(FirstCommand*sizeof(draw_elements_indirect_command)),
+                                    CommandCount, 0);
+        ++GlobalRenderStats.DrawCalls;
+    }
+    else
+    {
+        GLuint IndexSize = (IndexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        GLuint BoundInstance = GL_STATE_UNKNOWN;
+        for (uint32 CommandIndex = FirstCommand; CommandIndex < FirstCommand + CommandCount; ++CommandIndex)
+        {
+            draw_elements_indirect_command *Command = Indirect->Commands + CommandIndex;
+            if (Command->BaseInstance != BoundInstance)
+            {
+                BoundInstance = Command->BaseInstance;
+                Win32BindInstances(Instances, BoundInstance);
+            }
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, Command->Count, IndexType, (GLvoid *)((GLintptr)Command->FirstIndex*IndexSize),
+                                              Command->InstanceCount, Command->BaseVertex);
+            ++GlobalRenderStats.DrawCalls;
+        }
+    }
+}
+
+//
+// Program reflection
+//
+// Note(joe): After linking, every active uniform goes into a small open addressed
+// table keyed by the hash of its name, with its location and type. The scenes pull
+// typed handles out of it once at init, so frame code never formats a name or asks
+// the driver for a location. Arrays get an entry per element ("lights[2]") as well
+// as the bare name for element zero.
+//
+
+#define MAX_PROGRAM_UNIFORMS 128
+
+struct program_uniform
+{
+    uint64 NameHash; // Zero marks an empty slot.
+    GLint Location;
+    GLenum Type;
+};
+
+struct shader_program
+{
+    GLuint Id;
+    uint32 UniformCount;
+    program_uniform Uniforms[MAX_PROGRAM_UNIFORMS];
+};
+
+// Note(joe): A handle is just a location, the type only lives in the struct so the
+// wrong SetUniform won't compile. Missing or inactive uniforms get -1, which GL
+// quietly ignores.
+struct uniform_int { GLint Location; };
+struct uniform_float { GLint Location; };
+struct uniform_vec3 { GLint Location; };
+struct uniform_mat4 { GLint Location; };
+struct uniform_sampler { GLint Location; };
+
+inline uint64 HashUniformName(char *Name, size_t Length)
+{
+    uint64 Hash = HashBytes(Name, Length, 0);
+    return Hash ? Hash : 1;
+}
+
+static void AddProgramUniform(shader_program *Program, char *Name, size_t NameLength, GLint Location, GLenum Type)
+{
+    assert(Program->UniformCount < MAX_PROGRAM_UNIFORMS / 2);
+
+    uint64 NameHash = HashUniformName(Name, NameLength);
+    uint32 Mask = MAX_PROGRAM_UNIFORMS - 1;
+    for (uint32 Slot = (uint32)NameHash & Mask; ; Slot = (Slot + 1) & Mask)
+    {
+        program_uniform *Uniform = Program->Uniforms + Slot;
+        if (Uniform->NameHash == NameHash)
+        {
+            break;
+        }
+        if (Uniform->NameHash == 0)
+        {
+            Uniform->NameHash = NameHash;
+            Uniform->Location = Location;
+            Uniform->Type = Type;
+            ++Program->UniformCount;
+            break;
+        }
+    }
+}
+
+static program_uniform *FindProgramUniform(shader_program *Program, uint64 NameHash)
+{
+    uint32 Mask = MAX_PROGRAM_UNIFORMS - 1;
+    for (uint32 Slot = (uint32)NameHash & Mask; ; Slot = (Slot + 1) & Mask)
+    {
+        program_uniform *Uniform = Program->Uniforms + Slot;
+        if (Uniform->NameHash == NameHash)
+        {
+            return Uniform;
+        }
+        if (Uniform->NameHash == 0)
+        {
+            return 0;
+        }
+    }
+}
+
+static void Win32ReflectProgram(shader_program *Program, GLuint Id)
+{
+    TIMED_FUNCTION();
+
+    memset(Program, 0, sizeof(*Program));
+    Program->Id = Id;
+
+    for (GLuint Binding = 0; Binding < UniformBlock_Count; ++Binding)
+    {
+        GLuint BlockIndex = glGetUniformBlockIndex(Id, UniformBlockNames[Binding]);
+        if (BlockIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(Id, BlockIndex, Binding);
+
+            // Note(joe): Catches a shader block drifting away from its C++ struct, or
+            // using a block the scene never made a buffer for.
+            GLint DataSize = 0;
+            glGetActiveUniformBlockiv(Id, BlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &DataSize);
+            assert((DataSize > 0) && (DataSize <= UniformBlockSizes[Binding]));
+        }
+    }
+
+    GLint UniformCount = 0;
+    glGetProgramiv(Id, GL_ACTIVE_UNIFORMS, &UniformCount);
+    for (GLint UniformIndex = 0; UniformIndex < UniformCount; ++UniformIndex)
+    {
+        char Name[128];
+        GLsizei NameLength = 0;
+        GLint Size = 0;
+        GLenum Type = 0;
+        glGetActiveUniform(Id, UniformIndex, sizeof(Name), &NameLength, &Size, &Type, Name);
+
+        // Note(joe): Members of uniform blocks don't have a location.
+        GLint Location = glGetUniformLocation(Id, Name);
+        if (Location < 0)
+        {
+            continue;
+        }
+
+        // Note(joe): Arrays come back as "name[0]".
+        char *Bracket = (NameLength > 3) ? strstr(Name, "[0]") : 0;
+        if (Bracket && Bracket + 3 == Name + NameLength)
+        {
+            AddProgramUniform(Program, Name, Bracket - Name, Location, Type);
+            for (GLint Element = 0; Element < Size; ++Element)
+            {
+                char ElementName[160];
+                int ElementLength = sprintf_s(ElementName, sizeof(ElementName), "%.*s[%d]", (int)(Bracket - Name), Name, Element);
+                GLint ElementLocation = Element ? glGetUniformLocation(Id, ElementName) : Location;
+                AddProgramUniform(Program, ElementName, ElementLength, ElementLocation, Type);
+            }
+        }
+        else
+        {
+            AddProgramUniform(Program, Name, NameLength, Location, Type);
+        }
+    }
+}
+
+static GLint GetUniformLocation(shader_program *Program, uint64 NameHash, GLenum Type)
+{
+    program_uniform *Uniform = FindProgramUniform(Program, NameHash);
+    if (Uniform)
+    {
+        assert(Uniform->Type == Type);
+        return Uniform->Location;
+    }
+    return -1;
+}
+
+inline GLint GetUniformLocation(shader_program *Program, char *Name, GLenum Type)
+{
+    return GetUniformLocation(Program, HashUniformName(Name, strlen(Name)), Type);
+}
+
+inline uniform_int GetUniformInt(shader_program *Program, char *Name)
+{
+    uniform_int Result = { GetUniformLocation(Program, Name, GL_INT) };
+    return Result;
+}
+
+inline uniform_float GetUniformFloat(shader_program *Program, char *Name)
+{
+    uniform_float Result = { GetUniformLocation(Program, Name, GL_FLOAT) };
+    return Result;
+}
+
+inline uniform_vec3 GetUniformVec3(shader_program *Program, char *Name)
+{
+    uniform_vec3 Result = { GetUniformLocation(Program, Name, GL_FLOAT_VEC3) };
+    return Result;
+}
+
+inline uniform_mat4 GetUniformMat4(shader_program *Program, char *Name)
+{
+    uniform_mat4 Result = { GetUniformLocation(Program, Name, GL_FLOAT_MAT4) };
+    return Result;
+}
+
+inline uniform_sampler GetUniformSampler(shader_program *Program, uint64 NameHash)
+{
+    uniform_sampler Result = { GetUniformLocation(Program, NameHash, GL_SAMPLER_2D) };
+    return Result;
+}
+
+inline uniform_sampler GetUniformSampler(shader_program *Program, char *Name)
+{
+    return GetUniformSampler(Program, HashUniformName(Name, strlen(Name)));
+}
+
+inline void SetUniform(uniform_int Uniform, GLint Value)
+{
+    glUniform1i(Uniform.Location, Value);
+    ++GlobalRenderStats.UniformCalls;
+}
+
+inline void SetUniform(uniform_float Uniform, GLfloat Value)
+{
+    glUniform1f(Uniform.Location, Value);
+    ++GlobalRenderStats.UniformCalls;
+}
+
+inline void SetUniform(uniform_vec3 Uniform, glm::vec3 Value)
+{
+    glUniform3f(Uniform.Location, Value.x, Value.y, Value.z);
+    ++GlobalRenderStats.UniformCalls;
+}
+
+inline void SetUniform(uniform_mat4 Uniform, const glm::mat4 &Value)
+{
+    glUniformMatrix4fv(Uniform.Location, 1, GL_FALSE, glm::value_ptr(Value));
+    ++GlobalRenderStats.UniformCalls;
+}
+
+inline void SetUniform(uniform_sampler Uniform, GLint TextureUnit)
+{
+    glUniform1i(Uniform.Location, TextureUnit);
+    ++GlobalRenderStats.UniformCalls;
+}
+
+// Note(joe): Fills in a texture name that was handed out before the pixels were ready.
+void Win32UploadTexture(GLuint Texture, loaded_image Image, GLint SourcePixelFormat)
+{
+    TIMED_FUNCTION();
+
+    Win32BindTexture(0, Texture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Image.Width, Image.Height, 0, SourcePixelFormat, GL_UNSIGNED_BYTE, Image.Data);
     glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -93,10 +1063,92 @@ GLuint Win32CreateTexture(loaded_image Image, GLint SourcePixelFormat)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+// Note(joe): Uploads a cooked texture and all of its levels straight from wherever
+// it was parsed from. Returns false if the driver can't take the format, so the
+// caller can fall back to the source image.
+bool Win32UploadCompressedTexture(GLuint Texture, compressed_texture *Source)
+{
+    TIMED_FUNCTION();
 
-    return Texture;
+    GLenum InternalFormat = 0;
+    switch (Source->Format)
+    {
+        case BlockFormat_BC1:
+        {
+            InternalFormat = Source->IsSRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        } break;
+        case BlockFormat_BC3:
+        {
+            InternalFormat = Source->IsSRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        } break;
+        case BlockFormat_BC4: { InternalFormat = GL_COMPRESSED_RED_RGTC1; } break;
+        case BlockFormat_BC5: { InternalFormat = GL_COMPRESSED_RG_RGTC2; } break;
+    }
+    if ((Source->Format == BlockFormat_BC1 || Source->Format == BlockFormat_BC3) && !GlobalHasS3TC)
+    {
+        return false;
+    }
+
+    Win32BindTexture(0, Texture);
+
+    GLsizei Width = Source->Width;
+    GLsizei Height = Source->Height;
+    for (uint32 LevelIndex = 0; LevelIndex < Source->LevelCount; ++LevelIndex)
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, LevelIndex, InternalFormat, Width, Height, 0,
+                               Source->LevelSizes[LevelIndex], Source->Levels[LevelIndex]);
+        Width = (Width > 1) ? Width / 2 : 1;
+        Height = (Height > 1) ? Height / 2 : 1;
+    }
+    // Note(joe): A chain that stops short of 1x1 is still complete this way.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Source->LevelCount - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (Source->LevelCount > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return true;
+}
+
+// Note(joe): Same as Win32UploadTexture but with a mip chain that was built ahead of
+// time (see aqcube_mips.cpp), so the driver doesn't generate one. Image.Data holds
+// all LevelCount levels packed back to back.
+void Win32UploadTextureMips(GLuint Texture, loaded_image Image, uint32 LevelCount, GLint SourcePixelFormat)
+{
+    TIMED_FUNCTION();
+
+    Win32BindTexture(0, Texture);
+
+    // Note(joe): The small levels of an RGB chain aren't 4 byte aligned rows.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    uint8 *Level = Image.Data;
+    GLsizei Width = Image.Width;
+    GLsizei Height = Image.Height;
+    for (uint32 LevelIndex = 0; LevelIndex < LevelCount; ++LevelIndex)
+    {
+        glTexImage2D(GL_TEXTURE_2D, LevelIndex, GL_RGB, Width, Height, 0, SourcePixelFormat, GL_UNSIGNED_BYTE, Level);
+        Level += Width*Height*Image.PixelComponentCount;
+        Width = (Width > 1) ? Width / 2 : 1;
+        Height = (Height > 1) ? Height / 2 : 1;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, LevelCount - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (LevelCount > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
+// TODO(joe): Make it possible for the loaded_image to know the Source Pixel Format?
+GLuint Win32CreateTexture(loaded_image Image, GLint SourcePixelFormat)
+{
+    GLuint Texture;
+    glGenTextures(1, &Texture);
+    Win32UploadTexture(Texture, Image, SourcePixelFormat);
 
+    return Texture;
+}
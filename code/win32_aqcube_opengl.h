@@ -2,6 +2,67 @@
 
 #include "glext.h"
 
+#include <string.h>
+
+// Note(joe): Counters for the frame loops, the hosts reset them every frame.
+struct render_stats
+{
+    int DrawCalls;
+    int UniformCalls; // glUniform*
+    int BufferCalls;  // Buffer uploads and binds.
+    int ProgramBinds;
+    int TextureBinds;
+    int VertexArrayBinds;
+    int StateCalls;         // Binds, enables and viewports that went to the driver,
+    int FilteredStateCalls; // and the ones the state cache dropped.
+    int Triangles;
+    int ObjectsTested; // By the frustum cull,
+    int ObjectsVisible; // and what it let through.
+    int OccluderTriangles; // Pushed into the occlusion buffer,
+    int OccludeesTested;   // the boxes tested against it,
+    int OccludeesCulled;   // and the ones it hid.
+    double OcclusionRasterMs;
+    double OcclusionTestMs;
+};
+static render_stats GlobalRenderStats;
+
+// Note(joe): What the state cache in win32_aqcube_opengl.cpp thinks is bound. All ones
+// means it doesn't know.
+#define GL_STATE_UNKNOWN 0xFFFFFFFF
+#define GL_STATE_MAX_TEXTURE_UNITS 16
+#define GL_STATE_MAX_UNIFORM_BINDINGS 16
+
+struct gl_buffer_range
+{
+    GLuint Buffer;
+    GLintptr Offset;
+    GLsizeiptr Size;
+};
+
+struct gl_state
+{
+    GLuint Program;
+    GLuint VertexArray;
+    GLuint ArrayBuffer;
+    GLuint UniformBuffer;
+    GLuint DrawIndirectBuffer;
+    gl_buffer_range UniformRanges[GL_STATE_MAX_UNIFORM_BINDINGS];
+    GLuint ActiveTexture; // An index, not GL_TEXTUREi.
+    GLuint Textures[GL_STATE_MAX_TEXTURE_UNITS]; // GL_TEXTURE_2D only.
+    GLuint EnabledCaps;
+    GLuint KnownCaps;
+    GLint Viewport[4];
+};
+static gl_state GlobalGLState;
+
+// Note(joe): Call whenever the state might have changed behind the cache's back, a
+// new context or code that calls GL directly.
+inline void Win32ResetGLState()
+{
+    memset(&GlobalGLState, 0xFF, sizeof(GlobalGLState));
+    GlobalGLState.EnabledCaps = 0;
+    GlobalGLState.KnownCaps = 0;
+}
 
 // Buffers
 typedef void (*GENBUFFERS)(GLsizei n, GLuint * buffers);
@@ -9,12 +70,18 @@ typedef void (*BINDBUFFER)(GLenum target, GLuint buffer);
 typedef void (*BUFFERDATA)(GLenum target, GLsizeiptr size, const GLvoid * data, GLenum usage);
 typedef void (*GENVERTEXARRAYS)(GLsizei n, GLuint *arrays);
 typedef void (*BINDVERTEXARRAY)(GLuint array);
+typedef void (*BUFFERSUBDATA)(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data);
+typedef void (*BINDBUFFERBASE)(GLenum target, GLuint index, GLuint buffer);
+typedef void (*BINDBUFFERRANGE)(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
 
 GENBUFFERS glGenBuffers;
 BINDBUFFER glBindBuffer;
 BUFFERDATA glBufferData;
 GENVERTEXARRAYS glGenVertexArrays;
 BINDVERTEXARRAY glBindVertexArray;
+BUFFERSUBDATA glBufferSubData;
+BINDBUFFERBASE glBindBufferBase;
+BINDBUFFERRANGE glBindBufferRange;
 
 // Shaders
 typedef GLuint (*CREATESHADER)(GLenum shaderType);
@@ -33,12 +100,40 @@ GETSHADERIV glGetShaderiv;
 GETSHADERINFOLOG glGetShaderInfoLog;
 BINDFRAGDATALOCATION glBindFragDataLocation;
 
+// Queries
+typedef const GLubyte *(*GETSTRINGI)(GLenum name, GLuint index);
+
+GETSTRINGI glGetStringi;
+
 //Textures
 typedef void (*GENERATEMIPMAP)(GLenum target);
 typedef void (*ACTIVETEXTURE)(GLenum texture);
 
+typedef void (*COMPRESSEDTEXIMAGE2D)(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data);
+
 GENERATEMIPMAP glGenerateMipmap;
 ACTIVETEXTURE glActiveTexture;
+COMPRESSEDTEXIMAGE2D glCompressedTexImage2D;
+
+// Note(joe): BC4/BC5 (RGTC) are core in 3.0, BC1/BC3 (S3TC) are still an extension.
+static bool GlobalHasS3TC;
+
+// Framebuffers
+typedef void (*GENFRAMEBUFFERS)(GLsizei n, GLuint *framebuffers);
+typedef void (*BINDFRAMEBUFFER)(GLenum target, GLuint framebuffer);
+typedef GLenum (*CHECKFRAMEBUFFERSTATUS)(GLenum target);
+typedef void (*FRAMEBUFFERRENDERBUFFER)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+typedef void (*GENRENDERBUFFERS)(GLsizei n, GLuint *renderbuffers);
+typedef void (*BINDRENDERBUFFER)(GLenum target, GLuint renderbuffer);
+typedef void (*RENDERBUFFERSTORAGE)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+
+GENFRAMEBUFFERS glGenFramebuffers;
+BINDFRAMEBUFFER glBindFramebuffer;
+CHECKFRAMEBUFFERSTATUS glCheckFramebufferStatus;
+FRAMEBUFFERRENDERBUFFER glFramebufferRenderbuffer;
+GENRENDERBUFFERS glGenRenderbuffers;
+BINDRENDERBUFFER glBindRenderbuffer;
+RENDERBUFFERSTORAGE glRenderbufferStorage;
 
 // Program
 typedef GLuint (*CREATEPROGRAM)(void);
@@ -49,6 +144,14 @@ typedef GLint (*GETATTRIBLOCATION)(GLuint program, const GLchar *name);
 typedef GLint (*GETUNIFORMLOCATION)(GLuint program, const GLchar *name);
 typedef void (*GETPROGRAM)(GLuint program, GLenum pname, GLint *params);
 typedef void (*GETPROGRAMINFOLOG)(GLuint program, GLsizei maxLength, GLsizei *length, GLchar *infoLog);
+typedef void (*GETACTIVEUNIFORM)(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name);
+typedef GLuint (*GETUNIFORMBLOCKINDEX)(GLuint program, const GLchar *uniformBlockName);
+typedef void (*GETACTIVEUNIFORMBLOCKIV)(GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint *params);
+typedef void (*UNIFORMBLOCKBINDING)(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+typedef void (*DELETEPROGRAM)(GLuint program);
+typedef void (*PROGRAMPARAMETERI)(GLuint program, GLenum pname, GLint value);
+typedef void (*GETPROGRAMBINARY)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (*PROGRAMBINARY)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
 
 CREATEPROGRAM glCreateProgram;
 ATTACHSHADER glAttachShader;
@@ -58,12 +161,34 @@ GETATTRIBLOCATION glGetAttribLocation;
 GETUNIFORMLOCATION glGetUniformLocation;
 GETPROGRAM glGetProgramiv;
 GETPROGRAMINFOLOG glGetProgramInfoLog;
+GETACTIVEUNIFORM glGetActiveUniform;
+GETUNIFORMBLOCKINDEX glGetUniformBlockIndex;
+GETACTIVEUNIFORMBLOCKIV glGetActiveUniformBlockiv;
+UNIFORMBLOCKBINDING glUniformBlockBinding;
+DELETEPROGRAM glDeleteProgram;
+PROGRAMPARAMETERI glProgramParameteri;
+GETPROGRAMBINARY glGetProgramBinary;
+PROGRAMBINARY glProgramBinary;
 
 typedef void (*VERTEXATTRIBPOINTER)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid * pointer);
 typedef void (*ENABLEVERTEXATTRIBARRAY)(GLuint index);
+typedef void (*VERTEXATTRIBDIVISOR)(GLuint index, GLuint divisor);
+typedef void (*DRAWARRAYSINSTANCED)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef void (*DRAWELEMENTSINSTANCED)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount);
+typedef void (*DRAWELEMENTSINSTANCEDBASEVERTEX)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLint basevertex);
+typedef void (*MULTIDRAWELEMENTSINDIRECT)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
 
 VERTEXATTRIBPOINTER glVertexAttribPointer;
 ENABLEVERTEXATTRIBARRAY glEnableVertexAttribArray;
+VERTEXATTRIBDIVISOR glVertexAttribDivisor;
+DRAWARRAYSINSTANCED glDrawArraysInstanced;
+DRAWELEMENTSINSTANCED glDrawElementsInstanced;
+DRAWELEMENTSINSTANCEDBASEVERTEX glDrawElementsInstancedBaseVertex;
+MULTIDRAWELEMENTSINDIRECT glMultiDrawElementsIndirect;
+
+// Note(joe): Core in 4.3. The indirect commands need baseInstance to work as well,
+// which came with 4.2, so both get checked for.
+static bool GlobalHasMultiDrawIndirect;
 
 typedef void (*UNIFORM1I)(GLint location, GLint v0);
 typedef void (*UNIFORM1F)(GLint location, GLfloat v0);
@@ -76,15 +201,23 @@ UNIFORM3F glUniform3f;
 UNIFORM1I glUniform1i;
 UNIFORMMATRIX4FV glUniformMatrix4fv;
 
+// Note(joe): Hosts that don't use wgl define this before including the file.
+#ifndef GET_PROC_ADDRESS
+#define GET_PROC_ADDRESS(Name) wglGetProcAddress(Name)
+#endif
+
 void InitOpenGLExtensions()
 {
-#define GET_FUNC(sig, name) name = (sig)wglGetProcAddress(#name)
+#define GET_FUNC(sig, name) name = (sig)GET_PROC_ADDRESS(#name)
     // Buffers
     GET_FUNC(GENBUFFERS, glGenBuffers);
     GET_FUNC(BINDBUFFER, glBindBuffer);
     GET_FUNC(BUFFERDATA, glBufferData);
     GET_FUNC(GENVERTEXARRAYS, glGenVertexArrays);
     GET_FUNC(BINDVERTEXARRAY, glBindVertexArray);
+    GET_FUNC(BUFFERSUBDATA, glBufferSubData);
+    GET_FUNC(BINDBUFFERBASE, glBindBufferBase);
+    GET_FUNC(BINDBUFFERRANGE, glBindBufferRange);
 
     // Shaders
     GET_FUNC(CREATESHADER, glCreateShader);
@@ -95,11 +228,24 @@ void InitOpenGLExtensions()
     GET_FUNC(GETSHADERINFOLOG, glGetShaderInfoLog);
     GET_FUNC(BINDFRAGDATALOCATION, glBindFragDataLocation);
 
+    // Queries
+    GET_FUNC(GETSTRINGI, glGetStringi);
+
     // Textures
     GET_FUNC(GENERATEMIPMAP, glGenerateMipmap);
     GET_FUNC(ACTIVETEXTURE, glActiveTexture);
+    GET_FUNC(COMPRESSEDTEXIMAGE2D, glCompressedTexImage2D);
     GET_FUNC(UNIFORMMATRIX4FV, glUniformMatrix4fv);
 
+    // Framebuffers
+    GET_FUNC(GENFRAMEBUFFERS, glGenFramebuffers);
+    GET_FUNC(BINDFRAMEBUFFER, glBindFramebuffer);
+    GET_FUNC(CHECKFRAMEBUFFERSTATUS, glCheckFramebufferStatus);
+    GET_FUNC(FRAMEBUFFERRENDERBUFFER, glFramebufferRenderbuffer);
+    GET_FUNC(GENRENDERBUFFERS, glGenRenderbuffers);
+    GET_FUNC(BINDRENDERBUFFER, glBindRenderbuffer);
+    GET_FUNC(RENDERBUFFERSTORAGE, glRenderbufferStorage);
+
     // Program
     GET_FUNC(CREATEPROGRAM, glCreateProgram);
     GET_FUNC(ATTACHSHADER, glAttachShader);
@@ -109,13 +255,61 @@ void InitOpenGLExtensions()
     GET_FUNC(GETUNIFORMLOCATION, glGetUniformLocation);
     GET_FUNC(GETPROGRAM, glGetProgramiv);
     GET_FUNC(GETPROGRAMINFOLOG, glGetProgramInfoLog);
+    GET_FUNC(GETACTIVEUNIFORM, glGetActiveUniform);
+    GET_FUNC(GETUNIFORMBLOCKINDEX, glGetUniformBlockIndex);
+    GET_FUNC(GETACTIVEUNIFORMBLOCKIV, glGetActiveUniformBlockiv);
+    GET_FUNC(UNIFORMBLOCKBINDING, glUniformBlockBinding);
+    GET_FUNC(DELETEPROGRAM, glDeleteProgram);
+    GET_FUNC(PROGRAMPARAMETERI, glProgramParameteri);
+    GET_FUNC(GETPROGRAMBINARY, glGetProgramBinary);
+    GET_FUNC(PROGRAMBINARY, glProgramBinary);
 
     GET_FUNC(VERTEXATTRIBPOINTER, glVertexAttribPointer);
     GET_FUNC(ENABLEVERTEXATTRIBARRAY, glEnableVertexAttribArray);
+    GET_FUNC(VERTEXATTRIBDIVISOR, glVertexAttribDivisor);
+    GET_FUNC(DRAWARRAYSINSTANCED, glDrawArraysInstanced);
+    GET_FUNC(DRAWELEMENTSINSTANCED, glDrawElementsInstanced);
+    GET_FUNC(DRAWELEMENTSINSTANCEDBASEVERTEX, glDrawElementsInstancedBaseVertex);
+    GET_FUNC(MULTIDRAWELEMENTSINDIRECT, glMultiDrawElementsIndirect);
 
     GET_FUNC(UNIFORM1I, glUniform1i);
     GET_FUNC(UNIFORM1F, glUniform1f);
     GET_FUNC(UNIFORM3F, glUniform3f);
 
 #undef GET_FUNC
+
+    Win32ResetGLState();
+
+    GLint MajorVersion = 0;
+    GLint MinorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &MajorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &MinorVersion);
+    bool HasMultiDrawIndirect = (MajorVersion > 4) || ((MajorVersion == 4) && (MinorVersion >= 3));
+    bool HasBaseInstance = HasMultiDrawIndirect;
+
+    GLint ExtensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+    for (GLint ExtensionIndex = 0; glGetStringi && ExtensionIndex < ExtensionCount; ++ExtensionIndex)
+    {
+        const char *Extension = (const char *)glGetStringi(GL_EXTENSIONS, ExtensionIndex);
+        if (!Extension)
+        {
+            continue;
+        }
+
+        if (strcmp(Extension, "GL_EXT_texture_compression_s3tc") == 0)
+        {
+            GlobalHasS3TC = true;
+        }
+        else if (strcmp(Extension, "GL_ARB_multi_draw_indirect") == 0)
+        {
+            HasMultiDrawIndirect = true;
+        }
+        else if (strcmp(Extension, "GL_ARB_base_instance") == 0)
+        {
+            HasBaseInstance = true;
+        }
+    }
+
+    GlobalHasMultiDrawIndirect = HasMultiDrawIndirect && HasBaseInstance && glMultiDrawElementsIndirect;
 }
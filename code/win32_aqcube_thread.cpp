@@ -0,0 +1,107 @@
+// Note(joe): Win32 implementation of the work queue declared in aqcube.h.
+
+struct platform_work_queue_entry
+{
+    platform_work_queue_callback *Callback;
+    void *Data;
+};
+
+struct platform_work_queue
+{
+    uint32 volatile CompletionGoal;
+    uint32 volatile CompletionCount;
+
+    uint32 volatile NextEntryToWrite;
+    uint32 volatile NextEntryToRead;
+    HANDLE SemaphoreHandle;
+
+    platform_work_queue_entry Entries[256];
+};
+
+void AddWorkQueueEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data)
+{
+    // Note(joe): Single producer, so the write index doesn't need to be atomic.
+    uint32 NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+    assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+    platform_work_queue_entry *Entry = Queue->Entries + Queue->NextEntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->CompletionGoal;
+    CompletePreviousWritesBeforeFutureWrites;
+    Queue->NextEntryToWrite = NewNextEntryToWrite;
+    ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+}
+
+bool DoNextWorkQueueEntry(platform_work_queue *Queue)
+{
+    bool Result = false;
+
+    uint32 OriginalNextEntryToRead = Queue->NextEntryToRead;
+    uint32 NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+    if (OriginalNextEntryToRead != Queue->NextEntryToWrite)
+    {
+        uint32 Index = AtomicCompareExchangeUInt32(&Queue->NextEntryToRead, NewNextEntryToRead, OriginalNextEntryToRead);
+        if (Index == OriginalNextEntryToRead)
+        {
+            CompletePreviousReadsBeforeFutureReads;
+            platform_work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Queue, Entry.Data);
+            AtomicAddUInt32(&Queue->CompletionCount, 1);
+        }
+        // Note(joe): Losing the race still counts, there is more to take.
+        Result = true;
+    }
+
+    return Result;
+}
+
+void CompleteAllWork(platform_work_queue *Queue)
+{
+    while (Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        DoNextWorkQueueEntry(Queue);
+    }
+
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+}
+
+static DWORD WINAPI Win32WorkQueueThreadProc(LPVOID Parameter)
+{
+    platform_work_queue *Queue = (platform_work_queue *)Parameter;
+
+    for (;;)
+    {
+        if (!DoNextWorkQueueEntry(Queue))
+        {
+            WaitForSingleObjectEx(Queue->SemaphoreHandle, INFINITE, FALSE);
+        }
+    }
+}
+
+static void Win32MakeQueue(platform_work_queue *Queue, uint32 ThreadCount)
+{
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+    Queue->NextEntryToWrite = 0;
+    Queue->NextEntryToRead = 0;
+
+    uint32 InitialCount = 0;
+    Queue->SemaphoreHandle = CreateSemaphoreEx(0, InitialCount, ThreadCount ? ThreadCount : 1, 0, 0, SEMAPHORE_ALL_ACCESS);
+
+    for (uint32 ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        DWORD ThreadID;
+        HANDLE ThreadHandle = CreateThread(0, 0, Win32WorkQueueThreadProc, Queue, 0, &ThreadID);
+        CloseHandle(ThreadHandle);
+    }
+}
+
+// Note(joe): Leaves a core for the main thread, which helps out anyway while it waits.
+static uint32 Win32GetWorkerThreadCount()
+{
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    uint32 Result = (Info.dwNumberOfProcessors > 1) ? (uint32)Info.dwNumberOfProcessors - 1 : 0;
+    return Result;
+}
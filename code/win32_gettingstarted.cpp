@@ -32,6 +32,9 @@ typedef uint32_t uint32;
 typedef uint64_t uint64;
 
 #include "aqcube.cpp"
+#include "win32_aqcube_file.cpp"
+#include "aqcube_profile.cpp"
+#include "win32_aqcube_thread.cpp"
 #include "win32_aqcube_opengl.cpp"
 
 struct win32_back_buffer
@@ -44,48 +47,6 @@ struct win32_back_buffer
     int BytesPerPixel;
 };
 
-void *ReadFile(char *Filename)
-{
-    void *Result = 0;
-
-    HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-    if (FileHandle)
-    {
-        LARGE_INTEGER FileSize;
-        if(GetFileSizeEx(FileHandle, &FileSize))
-        {
-            DWORD FileSize32 = (DWORD)FileSize.QuadPart; // TODO(joe): Safe truncation?
-            Result = VirtualAlloc(0, FileSize32, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-            if (Result)
-            {
-                DWORD BytesRead = 0;
-                ReadFile(FileHandle, Result, FileSize32, &BytesRead, 0);
-                if (BytesRead == FileSize32)
-                {
-                    // Success
-                }
-                else
-                {
-                    FreeMemory(Result);
-                }
-            }
-        }
-
-        CloseHandle(FileHandle);
-    }
-
-    return Result;
-}
-
-void FreeMemory(void *Memory)
-{
-    if (Memory)
-    {
-        VirtualFree(Memory, 0, MEM_RELEASE);
-        Memory = 0;
-    }
-}
-
 loaded_image DEBUGLoadImage(char *FileName, bool FlipVertically = false)
 {
     loaded_image Result = {};
@@ -94,7 +55,13 @@ loaded_image DEBUGLoadImage(char *FileName, bool FlipVertically = false)
     {
         stbi_set_flip_vertically_on_load(1);
     }
-    Result.Data = stbi_load(FileName, &Result.Width, &Result.Height, &Result.PixelComponentCount, 0);
+    mapped_file File = MapFile(FileName, FileAccess_Sequential);
+    if (File.Memory)
+    {
+        assert(File.Size <= 0x7FFFFFFF);
+        Result.Data = stbi_load_from_memory((stbi_uc *)File.Memory, (int)File.Size, &Result.Width, &Result.Height, &Result.PixelComponentCount, 0);
+        UnmapFile(&File);
+    }
     if (FlipVertically)
     {
         stbi_set_flip_vertically_on_load(0);
@@ -105,7 +72,7 @@ loaded_image DEBUGLoadImage(char *FileName, bool FlipVertically = false)
     }
 
     return Result;
-};
+}
 
 void DEBUGFreeImage(loaded_image Image)
 {
@@ -133,6 +100,18 @@ inline static float Win32GetElapsedSeconds(LARGE_INTEGER Start, LARGE_INTEGER En
     return Result;
 }
 
+uint64 GetProfileClock()
+{
+    return (uint64)Win32GetClock().QuadPart;
+}
+
+uint64 GetProfileClockFrequency()
+{
+    LARGE_INTEGER Frequency;
+    QueryPerformanceFrequency(&Frequency);
+    return (uint64)Frequency.QuadPart;
+}
+
 static LRESULT CALLBACK Win32MainCallWindowCallback(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam)
 {
     LRESULT Result = 0;
@@ -349,6 +328,10 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
             glEnableVertexAttribArray(0);
             glEnableVertexAttribArray(1);
 
+            instance_buffer Instances = {};
+            Win32InitInstanceBuffer(&Instances, ArrayCount(CubePositions));
+            Win32EnableInstanceAttributes();
+
             // VBO: Vertex Buffer Object
             //GLuint EBO;
             //glGenBuffers(1, &EBO);
@@ -453,14 +436,15 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
                 glBindTexture(GL_TEXTURE_2D, Texture2);
                 glUniform1i(glGetUniformLocation(ShaderProgram, "ourTexture2"), 1);
 
-                GLuint ModelLoc = glGetUniformLocation(ShaderProgram, "model");
                 GLuint ViewLoc = glGetUniformLocation(ShaderProgram, "view");
                 GLuint ProjectionLoc = glGetUniformLocation(ShaderProgram, "projection");
 
                 glUniformMatrix4fv(ViewLoc, 1, GL_FALSE, glm::value_ptr(View));
                 glUniformMatrix4fv(ProjectionLoc, 1, GL_FALSE, glm::value_ptr(Projection));
 
-                glBindVertexArray(VAO);
+                // Note(joe): Every cube's transform goes up in one upload and they're
+                // all a single instanced draw.
+                glm::mat4 Transforms[ArrayCount(CubePositions)];
                 for (int i = 0; i < ArrayCount(CubePositions); ++i)
                 {
                     glm::mat4 Model;
@@ -471,10 +455,13 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
                         Angle = t * 50.0f;
                     }
                     Model = glm::rotate(Model, DEG_TO_RAD(Angle), glm::vec3(1.0f, 0.3f, 0.5f));
-                    glUniformMatrix4fv(ModelLoc, 1, GL_FALSE, glm::value_ptr(Model));
-
-                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                    Transforms[i] = Model;
                 }
+
+                glBindVertexArray(VAO);
+                Win32BeginInstances(&Instances);
+                uint32 FirstCube = Win32PushInstances(&Instances, Transforms, ArrayCount(CubePositions));
+                Win32DrawArraysInstanced(&Instances, FirstCube, ArrayCount(CubePositions), GL_TRIANGLES, 0, 36);
                 glBindVertexArray(0);
                 glBindTexture(GL_TEXTURE_2D, 0);
                 glUseProgram(0);
@@ -5,9 +5,6 @@
 #include <GL\gl.h>
 #include "win32_aqcube_opengl.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
@@ -32,6 +29,9 @@ typedef uint32_t uint32;
 typedef uint64_t uint64;
 
 #include "aqcube.cpp"
+#include "win32_aqcube_file.cpp"
+#include "aqcube_profile.cpp"
+#include "win32_aqcube_thread.cpp"
 #include "win32_aqcube_opengl.cpp"
 
 struct win32_back_buffer
@@ -44,77 +44,12 @@ struct win32_back_buffer
     int BytesPerPixel;
 };
 
-void *ReadFile(char *Filename)
-{
-    void *Result = 0;
-
-    HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-    if (FileHandle)
-    {
-        LARGE_INTEGER FileSize;
-        if(GetFileSizeEx(FileHandle, &FileSize))
-        {
-            DWORD FileSize32 = (DWORD)FileSize.QuadPart; // TODO(joe): Safe truncation?
-            Result = VirtualAlloc(0, FileSize32, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-            if (Result)
-            {
-                DWORD BytesRead = 0;
-                ReadFile(FileHandle, Result, FileSize32, &BytesRead, 0);
-                if (BytesRead == FileSize32)
-                {
-                    // Success
-                }
-                else
-                {
-                    FreeMemory(Result);
-                }
-            }
-        }
-
-        CloseHandle(FileHandle);
-    }
-
-    return Result;
-}
-
-void FreeMemory(void *Memory)
-{
-    if (Memory)
-    {
-        VirtualFree(Memory, 0, MEM_RELEASE);
-        Memory = 0;
-    }
-}
-
-loaded_image DEBUGLoadImage(char *FileName, bool FlipVertically = false)
-{
-    loaded_image Result = {};
-
-    if (FlipVertically)
-    {
-        stbi_set_flip_vertically_on_load(1);
-    }
-    Result.Data = stbi_load(FileName, &Result.Width, &Result.Height, &Result.PixelComponentCount, 0);
-    if (FlipVertically)
-    {
-        stbi_set_flip_vertically_on_load(0);
-    }
-    if (!Result.Data)
-    {
-        OutputDebugStringA(stbi_failure_reason());
-    }
-
-    return Result;
-};
-
-void DEBUGFreeImage(loaded_image Image)
-{
-    if (Image.Data)
-    {
-        stbi_image_free(Image.Data);
-        Image.Data = 0;
-    }
-}
+#include "aqcube_texture_cache.cpp"
+#include "aqcube_image.cpp"
+#include "aqcube_camera.h"
+#include "aqcube_culling.cpp"
+#include "aqcube_aabb_tree.cpp"
+#include "aqcube_lighting.cpp"
 
 static bool GlobalRunning = true;
 static bool GlobalWindowHasFocus = false;
@@ -135,6 +70,18 @@ inline static float Win32GetElapsedSeconds(LARGE_INTEGER Start, LARGE_INTEGER En
     return Result;
 }
 
+uint64 GetProfileClock()
+{
+    return (uint64)Win32GetClock().QuadPart;
+}
+
+uint64 GetProfileClockFrequency()
+{
+    LARGE_INTEGER Frequency;
+    QueryPerformanceFrequency(&Frequency);
+    return (uint64)Frequency.QuadPart;
+}
+
 void Win32WarpCursor(HWND Window, int x, int y)
 {
     POINT p;
@@ -200,6 +147,8 @@ static void Win32ProcessButtonState(button_state *Button, bool IsDown)
 
 static void Win32ProcessPendingMessages(game_controller_input *Input)
 {
+    TIMED_FUNCTION();
+
     // Process the message pump.
     MSG Message;
     while(PeekMessage(&Message, 0, 0, 0, PM_REMOVE))
@@ -251,59 +200,6 @@ static void Win32ProcessPendingMessages(game_controller_input *Input)
     }
 }
 
-struct camera
-{
-    glm::vec3 Position;
-    glm::vec3 Front;
-    glm::vec3 Up;
-};
-struct camera_angles
-{
-    float Pitch;
-    float Yaw;
-};
-static void UpdateCamera(camera *Camera, camera_angles *CameraAngles, game_controller_input *Input, float CameraSpeed, int WindowCenterX, int WindowCenterY)
-{
-    if (Input->Up.IsDown)
-    {
-        Camera->Position += CameraSpeed * Camera->Front;
-    }
-    if (Input->Down.IsDown)
-    {
-        Camera->Position -= CameraSpeed * Camera->Front;
-    }
-    if (Input->Left.IsDown)
-    {
-        Camera->Position -= glm::normalize(glm::cross(Camera->Front, Camera->Up)) * CameraSpeed;
-    }
-    if (Input->Right.IsDown)
-    {
-        Camera->Position += glm::normalize(glm::cross(Camera->Front, Camera->Up)) * CameraSpeed;
-    }
-
-    float Sensitivity = 0.1f;
-    float XOffset = (Input->Mouse.x - WindowCenterX) * Sensitivity;
-    float YOffset = (WindowCenterY - Input->Mouse.y) * Sensitivity;
-
-    CameraAngles->Yaw += XOffset;
-    CameraAngles->Pitch += YOffset;
-    if (CameraAngles->Pitch > 89.0f)
-    {
-        CameraAngles->Pitch = 89.0f;
-    }
-    if (CameraAngles->Pitch < -89.0f)
-    {
-        CameraAngles->Pitch = -89.0f;
-    }
-
-    glm::vec3 Front;
-    Front.x = cos(DEG_TO_RAD(CameraAngles->Pitch)) * cos(DEG_TO_RAD(CameraAngles->Yaw));
-    Front.y = sin(DEG_TO_RAD(CameraAngles->Pitch));
-    Front.z = cos(DEG_TO_RAD(CameraAngles->Pitch)) * sin(DEG_TO_RAD(CameraAngles->Yaw));
-    Camera->Front = glm::normalize(Front);
-}
-
-
 int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLine, int ShowCode)
 {
     WNDCLASSA WindowClass = {};
@@ -332,6 +228,26 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
         if (Window)
         {
             QueryPerformanceFrequency(&GlobalPerfFrequencyCount);
+            InitProfiler();
+
+            game_memory GameMemory = {};
+            GameMemory.PermanentStorageSize = Megabytes(64);
+            GameMemory.TransientStorageSize = Megabytes(512);
+            GameMemory.PermanentStorage = VirtualAlloc(0, (size_t)(GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize),
+                                                       MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            GameMemory.TransientStorage = (uint8 *)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize;
+            assert(GameMemory.PermanentStorage);
+
+            scene_arenas Arenas = {};
+            InitializeSceneArenas(&Arenas, &GameMemory, Megabytes(16));
+
+            texture_cache *TextureCache = PushStruct(&Arenas.Assets, texture_cache);
+            InitTextureCache(TextureCache, "cache/textures", Megabytes(256));
+            GlobalTextureCache = TextureCache;
+
+            // Note(joe): Startup and the first few seconds of frames, open it in
+            // chrome://tracing.
+            BeginProfileTrace("cache/lighting_trace.json");
 
             HDC DeviceContext = GetDC(Window);
             HGLRC OpenGLContext = 0;
@@ -342,6 +258,7 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
                 {
                     wglMakeCurrent(DeviceContext, OpenGLContext);
                     InitOpenGLExtensions();
+                    InitProgramCache("cache/programs");
                 }
                 else
                 {
@@ -351,117 +268,14 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 
 
             // Init
-            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-            glEnable(GL_DEPTH_TEST);
-
-            // Initialize the cube.
-            GLfloat Vertices[] = {
-                // Positions           // Normals           // Texture Coords
-                -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-                 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
-                 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-                 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-                -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
-                -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-
-                -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-                 0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
-                 0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-                 0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-                -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
-                -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-
-                -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-                -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-                -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-                -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-                -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-                -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-                 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-                 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-                 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-                 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-                 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-                 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-                -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-                 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
-                 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-                 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-                -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
-                -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-
-                -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-                 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
-                 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-                 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-                -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-                -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
-            };
-
-            glm::vec3 CubePositions[] = {
-                glm::vec3( 0.0f,  0.0f,  0.0f),
-                glm::vec3( 2.0f,  5.0f, -15.0f),
-                glm::vec3(-1.5f, -2.2f, -2.5f),
-                glm::vec3(-3.8f, -2.0f, -12.3f),
-                glm::vec3( 2.4f, -0.4f, -3.5f),
-                glm::vec3(-1.7f,  3.0f, -7.5f),
-                glm::vec3( 1.3f, -2.0f, -2.5f),
-                glm::vec3( 1.5f,  2.0f, -2.5f),
-                glm::vec3( 1.5f,  0.2f, -1.5f),
-                glm::vec3(-1.3f,  1.0f, -1.5f)
-            };
-
-            glm::vec3 PointLightPositions[] = {
-                glm::vec3( 0.7f,  0.2f,  2.0f),
-                glm::vec3( 2.3f, -3.3f, -4.0f),
-                glm::vec3(-4.0f,  2.0f, -12.0f),
-                glm::vec3( 0.0f,  0.0f, -3.0f)
-            };
-
-            loaded_image DiffuseImage = DEBUGLoadImage("container2.png");
-            GLuint DiffuseMap = Win32CreateTexture(DiffuseImage, GL_RGBA);
-
-            loaded_image SpecularImage = DEBUGLoadImage("container2_specular.png");
-            GLuint SpecularMap = Win32CreateTexture(SpecularImage, GL_RGBA);
-
-            GLuint VAO;
-            glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
-
-            // VBO: Vertex Buffer Object
-            GLuint VBO;
-            glGenBuffers(1, &VBO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices), Vertices, GL_STATIC_DRAW);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), 0);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void *)(3*sizeof(GLfloat)));
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void *)(6*sizeof(GLfloat)));
-            glEnableVertexAttribArray(0);
-            glEnableVertexAttribArray(1);
-            glEnableVertexAttribArray(2);
-
-            glBindVertexArray(0);
-
-            GLuint LightVAO;
-            glGenVertexArrays(1, &LightVAO);
-            glBindVertexArray(LightVAO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), 0);
-            glEnableVertexAttribArray(0);
-            glBindVertexArray(0);
-
-            GLuint VertexShader = Win32CompileShader(GL_VERTEX_SHADER, "lighting.vert");
-            GLuint FragmentShader = Win32CompileShader(GL_FRAGMENT_SHADER, "lighting.frag");
-
-            GLuint LightingShaders[] = { VertexShader, FragmentShader };
-            GLuint LightingProgram = Win32CreateProgram(LightingShaders, ArrayCount(LightingShaders));
-
-            GLuint LampVertexShader = Win32CompileShader(GL_VERTEX_SHADER, "lamp.vert");
-            GLuint LampFragmentShader = Win32CompileShader(GL_FRAGMENT_SHADER, "lamp.frag");
-            GLuint LampShaders[] = { LampVertexShader, LampFragmentShader };
-            GLuint LampProgram = Win32CreateProgram(LampShaders, ArrayCount(LampShaders));
+            lighting_scene Scene = {};
+            InitLightingScene(&Scene, &Arenas.Assets, &Arenas.Load);
+            SaveTextureCache(TextureCache);
+            ReportProgramCache();
+
+            char ProfileText[16384];
+            FormatProfileFrame(EndProfileFrame(), ProfileText, sizeof(ProfileText));
+            OutputDebugStringA(ProfileText);
 
             LARGE_INTEGER StartTime = Win32GetClock();
 
@@ -480,8 +294,24 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 
             game_controller_input Input = {};
             GlobalRunning = OpenGLContext != 0;
-            while(GlobalRunning)
+            for (uint32 FrameIndex = 0; GlobalRunning; ++FrameIndex)
             {
+                // Note(joe): Collects the frame before, so the Frame scope below is closed.
+                if (FrameIndex)
+                {
+                    profile_frame *Profile = EndProfileFrame();
+                    if (FrameIndex == 300)
+                    {
+                        EndProfileTrace();
+                    }
+                    if ((FrameIndex % 300) == 0)
+                    {
+                        FormatProfileFrame(Profile, ProfileText, sizeof(ProfileText));
+                        OutputDebugStringA(ProfileText);
+                    }
+                }
+                TIMED_SCOPE("Frame");
+
                 Win32ProcessPendingMessages(&Input);
 
                 if (GlobalWindowHasFocus)
@@ -490,134 +320,17 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
                     Win32WarpCursor(Window, WindowCenterX, WindowCenterY);
                 }
 
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
                 float t = Win32GetElapsedSeconds(StartTime, Win32GetClock());
 
-                glm::mat4 View;
-                View = glm::lookAt(Camera.Position, Camera.Position + Camera.Front, Camera.Up);
-
-                glm::mat4 Projection;
-                Projection = glm::perspective(DEG_TO_RAD(45), (float)ScreenWidth/(float)ScreenHeight, 0.01f, 100.0f);
-
-                float LampX = cos(DEG_TO_RAD(t*25.0f));
-                float LampZ = sin(DEG_TO_RAD(t*25.0f));
-#if 0
-                glm::vec3 LightPos(LampX, 1.2f, LampZ);
-#else
-                glm::vec3 LightPos(1.2f, 1.0f, 2.0f);
-#endif
-
-                glUseProgram(LightingProgram);
-
-                // Set the view location.
-                GLint ViewPosLoc = glGetUniformLocation(LightingProgram, "viewPos");
-                glUniform3f(ViewPosLoc, Camera.Position.x, Camera.Position.y, Camera.Position.z);
-
-                glm::vec3 LightColor(1.0f, 1.0f, 1.0f);
-                glm::vec3 DiffuseColor = LightColor * glm::vec3(0.5f); // Decrease the influence.
-                glm::vec3 AmbientColor = DiffuseColor * glm::vec3(0.2f); // Low influence.
-
-                // Set the direction light properties (ambient, diffuse, specular).
-                glUniform3f(glGetUniformLocation(LightingProgram, "dirLight.direction"), -0.2f, -1.0f, -0.3f);
-                glUniform3f(glGetUniformLocation(LightingProgram, "dirLight.ambient"), AmbientColor.x, AmbientColor.y, AmbientColor.z);
-                glUniform3f(glGetUniformLocation(LightingProgram, "dirLight.diffuse"), DiffuseColor.x, DiffuseColor.y, DiffuseColor.z);
-                glUniform3f(glGetUniformLocation(LightingProgram, "dirLight.specular"), 1.0f, 1.0f, 1.0f);
-
-                // Set the point light properties.
-#define NR_POINT_LIGHTS 4
-#define POINT_LIGHT_UNIFORM(Buffer, Index, Uniform) sprintf_s(Buffer, (sizeof(Buffer) / sizeof(Buffer[0])), "pointLights[%i].%s", (Index), (Uniform))
-                for (int LightIndex = 0; LightIndex < NR_POINT_LIGHTS; ++LightIndex)
-                {
-                    char Buffer[64];
-
-                    // Position
-                    glm::vec3 *Position = PointLightPositions + LightIndex;
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "position");
-                    glUniform3f(glGetUniformLocation(LightingProgram, Buffer), Position->x, Position->y, Position->z);
-
-                    // Attenuation
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "constant");
-                    glUniform1f(glGetUniformLocation(LightingProgram, Buffer), 1.0f);
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "linear");
-                    glUniform1f(glGetUniformLocation(LightingProgram, Buffer), 0.09f);
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "quadratic");
-                    glUniform1f(glGetUniformLocation(LightingProgram, Buffer), 0.032f);
-
-                    // Light properties
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "ambient");
-                    glUniform3f(glGetUniformLocation(LightingProgram, Buffer), AmbientColor.x, AmbientColor.y, AmbientColor.z);
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "diffuse");
-                    glUniform3f(glGetUniformLocation(LightingProgram, Buffer), DiffuseColor.x, DiffuseColor.y, DiffuseColor.z);
-                    POINT_LIGHT_UNIFORM(Buffer, LightIndex, "specular");
-                    glUniform3f(glGetUniformLocation(LightingProgram, Buffer), 1.0f, 1.0f, 1.0f);
-                }
-
-#if 0
-                // Spotlight
-                GLint LightSpotDirLoc = glGetUniformLocation(LightingProgram, "light.direction");
-                GLint LightSpotCutOffLoc = glGetUniformLocation(LightingProgram, "light.cutOff");
-                GLint LightSpotOuterCutOffLoc = glGetUniformLocation(LightingProgram, "light.outerCutOff");
-
-                glUniform3f(LightPosLoc, Camera.Position.x, Camera.Position.y, Camera.Position.z);
-                glUniform3f(LightSpotDirLoc, Camera.Front.x, Camera.Front.y, Camera.Front.z);
-                glUniform1f(LightSpotCutOffLoc, glm::cos(DEG_TO_RAD(12.5f)));
-                glUniform1f(LightSpotOuterCutOffLoc, glm::cos(DEG_TO_RAD(17.5f)));
-#endif
-
-                // Set the material properties.
-                glUniform1i(glGetUniformLocation(LightingProgram, "material.diffuse"),   0);
-                glUniform1i(glGetUniformLocation(LightingProgram, "material.specular"),  1);
-                glUniform1f(glGetUniformLocation(LightingProgram, "material.shininess"), 32.0f);
-
-                GLuint ModelLoc = glGetUniformLocation(LightingProgram, "model");
-                GLuint ViewLoc = glGetUniformLocation(LightingProgram, "view");
-                GLuint ProjectionLoc = glGetUniformLocation(LightingProgram, "projection");
-
-                glUniformMatrix4fv(ViewLoc, 1, GL_FALSE, glm::value_ptr(View));
-                glUniformMatrix4fv(ProjectionLoc, 1, GL_FALSE, glm::value_ptr(Projection));
-
-                glBindVertexArray(VAO);
-
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, DiffuseMap);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, SpecularMap);
-
-                glm::mat4 Model;
-                for (int PositionIndex = 0; PositionIndex < ArrayCount(CubePositions); ++PositionIndex)
-                {
-                    Model = glm::mat4();
-                    Model = glm::translate(Model, CubePositions[PositionIndex]);
-                    GLfloat angle = 20.0f * PositionIndex;
-                    Model = glm::rotate(Model, DEG_TO_RAD(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-
-                    glUniformMatrix4fv(ModelLoc, 1, GL_FALSE, glm::value_ptr(Model));
-                    glDrawArrays(GL_TRIANGLES, 0, 36);
-                }
-
-#if 1
-                glUseProgram(LampProgram);
-                glBindVertexArray(LightVAO);
-
-                glUniformMatrix4fv(glGetUniformLocation(LampProgram, "view"), 1, GL_FALSE, glm::value_ptr(View));
-                glUniformMatrix4fv(glGetUniformLocation(LampProgram, "projection"), 1, GL_FALSE, glm::value_ptr(Projection));
-
-                for (int PositionIndex = 0; PositionIndex < ArrayCount(PointLightPositions); ++PositionIndex)
-                {
-                    Model = glm::mat4();
-                    Model = glm::translate(Model, PointLightPositions[PositionIndex]);
-                    Model = glm::scale(Model, glm::vec3(0.2f));
-                    glUniformMatrix4fv(glGetUniformLocation(LampProgram, "model"), 1, GL_FALSE, glm::value_ptr(Model));
-                    glDrawArrays(GL_TRIANGLES, 0, 36);
-                }
-#endif
-
-                glBindVertexArray(0);
-                glUseProgram(0);
+                temporary_memory FrameMemory = BeginTemporaryMemory(&Arenas.Frame);
+                GlobalRenderStats = {};
+                RenderLightingScene(&Scene, &Camera, &Arenas.Frame, ScreenWidth, ScreenHeight, t);
+                EndTemporaryMemory(FrameMemory);
 
+                TIMED_SCOPE("SwapBuffers");
                 SwapBuffers(DeviceContext);
             }
+            EndProfileTrace();
 
             wglMakeCurrent(0, 0);
             wglDeleteContext(OpenGLContext);
@@ -1,9 +1,13 @@
 #version 330 core
 layout (location = 0) in vec3 position;
+layout (location = 3) in mat4 model; // Per instance.
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
 
 void main()
 {
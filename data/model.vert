@@ -1,16 +1,46 @@
 #version 330 core
+#ifdef PACKED_VERTICES
+// position is unorm16 over the model's bounds, the instance transform puts it back.
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 octNormal; // Octahedral snorm16.
+layout (location = 2) in vec2 texCoords; // Half floats.
+#else
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
+#endif
+layout (location = 3) in mat4 model; // Per instance.
 
+out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+#ifdef PACKED_VERTICES
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f)
+    {
+        vec2 s = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        n.xy = (1.0f - abs(n.yx)) * s;
+    }
+    return normalize(n);
+}
+#endif
 
 void main()
 {
+#ifdef PACKED_VERTICES
+    vec3 normal = OctDecode(octNormal);
+#endif
     gl_Position = projection * view * model * vec4(position, 1.0f);
+    // The model transforms only scale uniformly, so there's no need for the inverse transpose.
+    Normal = normalize(mat3(model) * normal);
     TexCoords = texCoords;
 }
@@ -2,10 +2,10 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 texCoord;
+layout (location = 3) in mat4 model; // Per instance.
 
 out vec2 TexCoord;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 